@@ -0,0 +1,22 @@
+// compression.h
+// Copyright 2014 - 2019 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Minimalist lz4 block compression, output is compatible with the reference lz4 block format (no frame header).
+// Compression is a fast greedy single pass, decompression is bounds checked and safe to run on untrusted data.
+// Allocate dst with at least compress_lz4_bound(src_size) bytes to guarantee compression succeeds.
+
+#pragma once
+
+#include "pen.h"
+
+namespace pen
+{
+    u32 compress_lz4_bound(u32 src_size);
+
+    // returns the size of the compressed data written to dst or 0 on failure
+    u32 compress_lz4(const void* src, u32 src_size, void* dst, u32 dst_capacity);
+
+    // returns the size of the decompressed data written to dst or 0 if src is malformed or dst is too small
+    u32 decompress_lz4(const void* src, u32 src_size, void* dst, u32 dst_size);
+} // namespace pen
@@ -10,6 +10,9 @@
 #include "memory.h"
 #include "threads.h"
 
+#include <atomic>
+#include <new>
+
 #ifndef NO_STRETCHY_BUFFER_SHORT_NAMES
 #define sb_free stb_sb_free
 #define sb_push stb_sb_push
@@ -19,7 +22,7 @@
 #define sb_grow stb__sbgrow
 #endif
 
-#define stb_sb_free(a) ((a) ? free(stb__sbraw(a)), 0 : 0)
+#define stb_sb_free(a) ((a) ? pen::memory_free(stb__sbraw(a)), 0 : 0)
 #define stb_sb_push(a, v) (stb__sbmaybegrow(a, 1), (a)[stb__sbn(a)++] = (v))
 #define stb_sb_count(a) ((a) ? stb__sbn(a) : 0)
 #define stb_sb_add(a, n) (stb__sbmaybegrow(a, n), stb__sbn(a) += (n), &(a)[stb__sbn(a) - (n)])
@@ -48,7 +51,7 @@ static void* stb__sbgrowf(void* arr, int increment, int itemsize)
     int* p = nullptr;
     {
         uint32_t total_size = itemsize * m + sizeof(int) * 2;
-        p = (int*)realloc(arr ? stb__sbraw(arr) : 0, total_size);
+        p = (int*)pen::memory_realloc(arr ? stb__sbraw(arr) : 0, total_size);
 
         char*    pp = (char*)p;
         uint32_t preserve_size = sizeof(int) * 2 + itemsize * start;
@@ -86,23 +89,72 @@ namespace pen
         int  size();
     };
 
-    // lockless single producer single consumer - thread safe ring buffer
+    namespace e_ring_buffer_full
+    {
+        enum ring_buffer_full_t
+        {
+            block, // producer spins then backs off with short sleeps, the consumer must drain without waiting on it
+            spin,  // as block but busy waits, for consumers which are always draining
+            grow   // chain on a segment of twice the size, for consumers which only drain at sync points
+        };
+    }
+    typedef e_ring_buffer_full::ring_buffer_full_t ring_buffer_full;
+
+    static const u32 k_cache_line_size = 64;
+
+    // lockless single producer single consumer - thread safe ring buffer with power of 2 capacity.
+    // put never overwrites unconsumed items, when full it blocks, spins or grows as specified in create.
+    // every slot holds a constructed T which put assigns over, slots are destroyed when their segment is freed.
+    // pointers returned by get and check remain valid until the consumer next calls get, check or get_n.
+    // before create the consumer functions return nothing.
     template <typename T>
     struct ring_buffer
     {
-        T* data = nullptr;
-
-        a_u32               get_pos;
-        a_u32               put_pos;
-        std::atomic<size_t> _capacity;
+        struct segment
+        {
+            T*                    data = nullptr;
+            u32                   mask = 0;
+            std::atomic<segment*> next = {nullptr};
+            u8                    _pad0[k_cache_line_size];
+            std::atomic<u32>      put_pos = {0};
+            u8                    _pad1[k_cache_line_size];
+            std::atomic<u32>      get_pos = {0};
+            u8                    _pad2[k_cache_line_size];
+        };
+
+        // producer
+        segment*         _write_seg = nullptr;
+        u32              _put = 0;
+        u32              _cached_get = 0;
+        ring_buffer_full _full = e_ring_buffer_full::block;
+        u8               _pad[k_cache_line_size];
+
+        // consumer
+        segment* _read_seg = nullptr;
+        u32      _read = 0;
+        u32      _cached_put = 0;
 
-        ring_buffer();
         ~ring_buffer();
 
-        void create(u32 capacity);
+        void create(u32 capacity, ring_buffer_full full = e_ring_buffer_full::block);
+        u32  capacity();
+
+        // producer
         void put(const T& item);
-        T*   get();
-        T*   check();
+        void put_n(const T* items, u32 count);
+        bool try_put(const T& item); // returns false when full regardless of the ring_buffer_full mode
+
+        // consumer
+        T*  get();
+        T*  check();
+        u32 get_n(T* items, u32 max_count); // copies out up to max_count items and returns the number read
+
+      private:
+        segment* alloc_segment(u32 capacity);
+        void     free_segment(segment* seg);
+        u32      writable(u32 count);
+        void     wait_writable(u32 count);
+        T*       next(bool consume);
     };
 
     // lockless single producer multiple consumer - thread safe resource pool which will grow to accomodate contents
@@ -220,56 +272,231 @@ namespace pen
     }
 
     template <typename T>
-    pen_inline ring_buffer<T>::ring_buffer()
+    pen_inline ring_buffer<T>::~ring_buffer()
+    {
+        segment* seg = _read_seg;
+        while (seg)
+        {
+            segment* next = seg->next.load();
+            free_segment(seg);
+            seg = next;
+        }
+    }
+
+    template <typename T>
+    inline typename ring_buffer<T>::segment* ring_buffer<T>::alloc_segment(u32 capacity)
     {
-        get_pos = 0;
-        put_pos = 0;
-        _capacity = 0;
+        segment* seg = new (pen::memory_alloc(sizeof(segment))) segment();
+
+        seg->data = (T*)pen::memory_alloc(sizeof(T) * capacity);
+        for (u32 i = 0; i < capacity; ++i)
+            new (&seg->data[i]) T();
+
+        seg->mask = capacity - 1;
+
+        return seg;
     }
 
     template <typename T>
-    pen_inline ring_buffer<T>::~ring_buffer()
+    inline void ring_buffer<T>::free_segment(segment* seg)
     {
-        pen::memory_free(data);
+        u32 capacity = seg->mask + 1;
+        for (u32 i = 0; i < capacity; ++i)
+            seg->data[i].~T();
+
+        pen::memory_free(seg->data);
+
+        seg->~segment();
+        pen::memory_free(seg);
+    }
+
+    template <typename T>
+    inline void ring_buffer<T>::create(u32 capacity, ring_buffer_full full)
+    {
+        u32 pow2 = 1;
+        while (pow2 < capacity)
+            pow2 <<= 1;
+
+#if PEN_SINGLE_THREADED
+        // the consumer cannot run while the producer waits
+        full = e_ring_buffer_full::grow;
+#endif
+        _full = full;
+        _write_seg = alloc_segment(pow2);
+        _read_seg = _write_seg;
+        _put = _cached_get = 0;
+        _read = _cached_put = 0;
+    }
+
+    template <typename T>
+    pen_inline u32 ring_buffer<T>::capacity()
+    {
+        return _write_seg ? _write_seg->mask + 1 : 0;
     }
 
     template <typename T>
-    inline void ring_buffer<T>::create(u32 capacity)
+    pen_inline u32 ring_buffer<T>::writable(u32 count)
     {
-        get_pos = 0;
-        put_pos = 0;
-        _capacity = capacity;
+        // only touch the consumers cache line when the cached position says we are full
+        u32 capacity = _write_seg->mask + 1;
+        if (capacity - (_put - _cached_get) < count)
+            _cached_get = _write_seg->get_pos.load(std::memory_order_acquire);
 
-        data = (T*)pen::memory_alloc(sizeof(T) * _capacity.load());
-        memset(data, 0x0, sizeof(T) * _capacity.load());
+        return capacity - (_put - _cached_get);
+    }
+
+    template <typename T>
+    inline void ring_buffer<T>::wait_writable(u32 count)
+    {
+        if (_full == e_ring_buffer_full::grow)
+        {
+            // the consumer drains this segment then follows next, the producer never writes to it again
+            u32 capacity = (_write_seg->mask + 1) * 2;
+            while (capacity < count)
+                capacity <<= 1;
+
+            segment* seg = alloc_segment(capacity);
+            _write_seg->next.store(seg, std::memory_order_release);
+            _write_seg = seg;
+            _put = _cached_get = 0;
+            return;
+        }
+
+        // spin with backoff, the consumer only publishes its position so there is no wait primitive to signal
+        static const u32 k_block_spins = 64;
+
+        u32 spins = 0;
+        while (writable(1) == 0)
+        {
+            if (_full == e_ring_buffer_full::block && ++spins > k_block_spins)
+                pen::thread_sleep_us(10);
+        }
     }
 
     template <typename T>
     pen_inline void ring_buffer<T>::put(const T& item)
     {
-        data[put_pos] = item;
-        put_pos = (put_pos + 1) % _capacity;
+        if (writable(1) == 0)
+            wait_writable(1);
+
+        _write_seg->data[_put & _write_seg->mask] = item;
+        _write_seg->put_pos.store(++_put, std::memory_order_release);
     }
 
     template <typename T>
-    pen_inline T* ring_buffer<T>::get()
+    inline void ring_buffer<T>::put_n(const T* items, u32 count)
+    {
+        while (count > 0)
+        {
+            u32 n = std::min<u32>(writable(count), count);
+            if (n == 0)
+            {
+                wait_writable(count);
+                continue;
+            }
+
+            // items are published with a single store
+            for (u32 i = 0; i < n; ++i)
+                _write_seg->data[(_put + i) & _write_seg->mask] = items[i];
+
+            _put += n;
+            _write_seg->put_pos.store(_put, std::memory_order_release);
+
+            items += n;
+            count -= n;
+        }
+    }
+
+    template <typename T>
+    pen_inline bool ring_buffer<T>::try_put(const T& item)
     {
-        u32 gp = get_pos;
-        if (gp == put_pos)
+        if (writable(1) == 0)
+            return false;
+
+        _write_seg->data[_put & _write_seg->mask] = item;
+        _write_seg->put_pos.store(++_put, std::memory_order_release);
+        return true;
+    }
+
+    template <typename T>
+    inline T* ring_buffer<T>::next(bool consume)
+    {
+        segment* seg = _read_seg;
+
+        // consumers may poll a ring buffer the producer creates lazily on first put
+        if (!seg)
             return nullptr;
 
-        get_pos = (get_pos + 1) % _capacity;
+        // hand back the slot returned by the previous call
+        seg->get_pos.store(_read, std::memory_order_release);
 
-        return &data[gp];
+        if (_read == _cached_put)
+        {
+            _cached_put = seg->put_pos.load(std::memory_order_acquire);
+            if (_read == _cached_put)
+            {
+                segment* next_seg = seg->next.load(std::memory_order_acquire);
+                if (!next_seg)
+                    return nullptr;
+
+                // next is linked after the last put to this segment, so re-check before moving on
+                _cached_put = seg->put_pos.load(std::memory_order_acquire);
+                if (_read == _cached_put)
+                {
+                    free_segment(seg);
+                    _read_seg = next_seg;
+                    _read = _cached_put = 0;
+                    return next(consume);
+                }
+            }
+        }
+
+        T* item = &seg->data[_read & seg->mask];
+        if (consume)
+            ++_read;
+
+        return item;
+    }
+
+    template <typename T>
+    pen_inline T* ring_buffer<T>::get()
+    {
+        return next(true);
     }
 
     template <typename T>
     pen_inline T* ring_buffer<T>::check()
     {
-        u32 gp = get_pos;
-        if (gp == put_pos)
-            return nullptr;
-        return &data[gp];
+        return next(false);
+    }
+
+    template <typename T>
+    inline u32 ring_buffer<T>::get_n(T* items, u32 max_count)
+    {
+        if (!_read_seg)
+            return 0;
+
+        u32 count = 0;
+        while (count < max_count)
+        {
+            // next hands back the previous slot and moves across segments, the rest of the run is copied in one go
+            T* item = next(true);
+            if (!item)
+                break;
+
+            items[count++] = *item;
+
+            segment* seg = _read_seg;
+            u32      n = std::min<u32>(_cached_put - _read, max_count - count);
+            for (u32 i = 0; i < n; ++i)
+                items[count++] = seg->data[(_read + i) & seg->mask];
+
+            _read += n;
+        }
+
+        // release the last item now it has been copied out
+        _read_seg->get_pos.store(_read, std::memory_order_release);
+        return count;
     }
 
     template <typename T>
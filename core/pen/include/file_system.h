@@ -7,6 +7,12 @@
 // Can read files and also enumerate file system and volumes as an fs_tree_node.
 // Make sure to free p_buffer yourself allocated from filesystem_read_file_to_buffer.
 // Make sure to call filesystem_enum_free_mem with your fs_tree_node once finished with it.
+// Files can be memory mapped read only with filesystem_map_file, release the mapping with filesystem_unmap_file.
+// Directories can be watched for changes, filesystem_watch_poll is non-blocking and reports each file written or moved
+// into a watched directory as "directory/name", a null path means events were dropped and the caller should rescan.
+// filesystem_watch_wait blocks until events are pending or the timeout expires, a watcher can be polled on one thread
+// while directories are added to it from another.
+// Directory watching is only implemented with inotify (linux), other platforms return PEN_ERR_FAILED from create.
 
 // Implemented with:
 //      win32 (windows)
@@ -28,6 +34,8 @@ namespace pen
 
     bool       filesystem_file_exists(const c8* filename);
     pen_error  filesystem_read_file_to_buffer(const c8* filename, void** p_buffer, u32& buffer_size);
+    pen_error  filesystem_map_file(const c8* filename, void** p_mapped, size_t& mapped_size);
+    void       filesystem_unmap_file(void* mapped, size_t mapped_size);
     pen_error  filesystem_getmtime(const c8* filename, u32& mtime_out);
     void       filesystem_toggle_hidden_files();
     pen_error  filesystem_enum_volumes(fs_tree_node& results);
@@ -38,4 +46,12 @@ namespace pen
     const c8** filesystem_get_user_directory(s32& directory_depth); // returns array of directories like the above
     s32        filesystem_exclude_slash_depth();
 
+    // directory watching
+    typedef void (*watch_callback)(const c8* path, void* user_data);
+    pen_error filesystem_watch_create(u32& watcher_out);
+    pen_error filesystem_watch_add_directory(u32 watcher, const c8* directory); // "" watches the working directory
+    pen_error filesystem_watch_poll(u32 watcher, watch_callback callback, void* user_data);
+    pen_error filesystem_watch_wait(u32 watcher, u32 timeout_ms); // PEN_ERR_OK when events are pending
+    void      filesystem_watch_destroy(u32 watcher);
+
 } // namespace pen
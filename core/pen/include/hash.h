@@ -8,6 +8,8 @@
 
 #include "types.h"
 
+#include <type_traits>
+
 #include "str/Str.h"
 
 namespace pen
@@ -48,8 +50,19 @@ namespace pen
     uint32_t hashMurmur2A(char* _data);
 
     typedef HashMurmur2A hash_murmur;
+
+    // constexpr murmur2A, bit identical to hashMurmur2A(const char*) so literals can fold at compile time
+    constexpr uint32_t hash_constexpr(const c8* str);
+
+    // thread safe interned name table, allows a hash_id to be mapped back to the string it was made from.
+    // names are copied into the table and live for the duration of the program, they are never freed.
+    // colliding names are stored separately so hash_intern_str always returns text equal to its input.
+    hash_id   hash_intern(const c8* name); // returns PEN_HASH(name)
+    const c8* hash_intern_str(const c8* name); // returns the interned copy of name
+    const c8* hash_name(hash_id id); // nullptr if id was never interned, the first name interned on collision
 } // namespace pen
 
 #define _hash_h
 #define PEN_HASH(V) pen::hashMurmur2A(V)
+#define PEN_HASHC(V) (std::integral_constant<hash_id, pen::hash_constexpr(V)>::value) // string literals only
 #include "hash.inl"
@@ -164,4 +164,49 @@ namespace pen
     {
         return hashMurmur2A(s.c_str());
     }
+
+    // c++11 constexpr functions are single expressions, so the streaming hash above is unrolled into recursion.
+    namespace murmur_constexpr
+    {
+        constexpr uint32_t mix_k(uint32_t k)
+        {
+            return ((k * 0x5bd1e995) ^ ((k * 0x5bd1e995) >> 24)) * 0x5bd1e995;
+        }
+
+        constexpr uint32_t mmix(uint32_t h, uint32_t k)
+        {
+            return (h * 0x5bd1e995) ^ mix_k(k);
+        }
+
+        constexpr uint32_t read4(const c8* s, uint32_t i)
+        {
+            return (uint32_t)(uint8_t)s[i] | (uint32_t)(uint8_t)s[i + 1] << 8 | (uint32_t)(uint8_t)s[i + 2] << 16 |
+                   (uint32_t)(uint8_t)s[i + 3] << 24;
+        }
+
+        constexpr uint32_t tail(const c8* s, uint32_t i, uint32_t rem)
+        {
+            return rem == 0 ? 0 : (uint32_t)(uint8_t)s[i] | (tail(s, i + 1, rem - 1) << 8);
+        }
+
+        constexpr uint32_t length(const c8* s, uint32_t i = 0)
+        {
+            return s[i] == 0 ? i : length(s, i + 1);
+        }
+
+        constexpr uint32_t blocks(const c8* s, uint32_t i, uint32_t len, uint32_t h)
+        {
+            return len - i >= 4 ? blocks(s, i + 4, len, mmix(h, read4(s, i))) : mmix(mmix(h, tail(s, i, len - i)), len);
+        }
+
+        constexpr uint32_t avalanche(uint32_t h)
+        {
+            return ((h ^ (h >> 13)) * 0x5bd1e995) ^ (((h ^ (h >> 13)) * 0x5bd1e995) >> 15);
+        }
+    } // namespace murmur_constexpr
+
+    constexpr uint32_t hash_constexpr(const c8* str)
+    {
+        return murmur_constexpr::avalanche(murmur_constexpr::blocks(str, 0, murmur_constexpr::length(str), 0));
+    }
 } // namespace pen
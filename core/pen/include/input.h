@@ -94,6 +94,11 @@ namespace pen
     void input_set_mouse_pos(f32 x, f32 y);
     void input_set_mouse_wheel(f32 wheel);
 
+    // os update stamps the time it finished polling input, the renderer measures input to present latency from it.
+    // platforms with event driven input never stamp and latency falls back to the user thread frame start.
+    void input_set_poll_time(f64 time_ms);
+    f64  input_get_poll_time();
+
     void input_gamepad_init();
     void input_gamepad_shutdown();
     u32  input_get_num_gamepads();
@@ -5,6 +5,9 @@
 // Minimalist memory api wrapping up malloc and free.
 // It provides some very minor portability solutions between win32 and osx and linux.
 // Mostly it is here to intercept allocs, so at a later date custom allocation or tracking schemes could be used.
+// Build with PEN_MEMORY_TRACKING=1 to tag allocations by subsystem and track live bytes, peaks, per frame counts and leaks.
+// With tracking enabled every pointer passed to memory_free or memory_realloc must have come from memory_alloc.
+// Build with PEN_MEMORY_SIZE_CLASSES=1 to replace malloc with a thread caching size class allocator, 0 keeps malloc.
 
 #pragma once
 
@@ -12,6 +15,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifndef PEN_MEMORY_TRACKING
+#define PEN_MEMORY_TRACKING 0
+#endif
+
+#ifndef PEN_MEMORY_SIZE_CLASSES
+#define PEN_MEMORY_SIZE_CLASSES 0
+#endif
+
 #ifdef __linux__
 #include <string.h> //memcpy
 #define THROW_BAD_ALLOC
@@ -32,6 +43,32 @@
 
 namespace pen
 {
+    namespace e_mem_tag
+    {
+        enum mem_tag_t
+        {
+            general,
+            renderer,
+            ecs,
+            physics,
+            audio,
+            pmfx,
+            dev_ui,
+            count
+        };
+    }
+    typedef e_mem_tag::mem_tag_t mem_tag;
+
+    struct memory_tag_stats
+    {
+        size_t live_bytes;
+        size_t peak_bytes;
+        size_t budget_bytes; // 0 = no budget
+        u32    live_allocs;
+        u32    frame_allocs; // allocations made during the last completed frame
+        u32    total_allocs;
+    };
+
     // Functions
 
     void* memory_alloc(size_t size_bytes);
@@ -41,26 +78,98 @@ namespace pen
     void  memory_free_align(void* mem);
     void  memory_zero(void* dest, size_t size_bytes);
 
+    // Tracking, these are no-ops unless PEN_MEMORY_TRACKING is enabled.
+    // Allocations are attributed to the calling thread's current tag and counters are lock free atomics per tag,
+    // frees are attributed to the tag that made the allocation regardless of which thread frees it.
+
+    mem_tag   memory_set_thread_tag(mem_tag tag); // returns the previous tag
+    void      memory_set_budget(mem_tag tag, size_t budget_bytes);
+    void      memory_get_tag_stats(mem_tag tag, memory_tag_stats& stats);
+    const c8* memory_tag_name(mem_tag tag);
+    void      memory_new_frame(); // latches per frame counts and warns about tags over budget
+    void      memory_report_leaks();
+
+    struct memory_tag_scope
+    {
+        mem_tag prev;
+
+        memory_tag_scope(mem_tag tag)
+        {
+            prev = memory_set_thread_tag(tag);
+        }
+
+        ~memory_tag_scope()
+        {
+            memory_set_thread_tag(prev);
+        }
+    };
+
+#if PEN_MEMORY_TRACKING
+#define PEN_MEMORY_TAG_SCOPE(tag) pen::memory_tag_scope _memory_tag_scope(pen::e_mem_tag::tag)
+    void* memory_tracked_alloc(size_t size_bytes, size_t alignment);
+    void* memory_tracked_realloc(void* mem, size_t size_bytes);
+    void  memory_tracked_free(void* mem);
+#else
+#define PEN_MEMORY_TAG_SCOPE(tag)
+#endif
+
+#if PEN_MEMORY_SIZE_CLASSES
+    // Small allocs are served from per thread free lists of size classes carved from os mapped spans, frees from other
+    // threads are returned to the owning thread with a lock free list. Large allocs are mapped directly.
+    void*  memory_sc_alloc(size_t size_bytes, size_t alignment);
+    void*  memory_sc_realloc(void* mem, size_t size_bytes);
+    void   memory_sc_free(void* mem);
+    size_t memory_sc_usable_size(void* mem);
+#endif
+
     // Implementation
 
     inline void* memory_alloc(size_t size_bytes)
     {
+#if PEN_MEMORY_TRACKING
+        return memory_tracked_alloc(size_bytes, 0);
+#elif PEN_MEMORY_SIZE_CLASSES
+        return memory_sc_alloc(size_bytes, 0);
+#else
         return malloc(size_bytes);
+#endif
     }
 
     inline void* memory_calloc(size_t count, size_t size_bytes)
     {
+#if PEN_MEMORY_TRACKING
+        void* mem = memory_tracked_alloc(count * size_bytes, 0);
+        memset(mem, 0x00, count * size_bytes);
+        return mem;
+#elif PEN_MEMORY_SIZE_CLASSES
+        void* mem = memory_sc_alloc(count * size_bytes, 0);
+        memset(mem, 0x00, count * size_bytes);
+        return mem;
+#else
         return calloc(count, size_bytes);
+#endif
     }
 
     inline void* memory_realloc(void* mem, size_t size_bytes)
     {
+#if PEN_MEMORY_TRACKING
+        return memory_tracked_realloc(mem, size_bytes);
+#elif PEN_MEMORY_SIZE_CLASSES
+        return memory_sc_realloc(mem, size_bytes);
+#else
         return realloc(mem, size_bytes);
+#endif
     }
 
     inline void memory_free(void* mem)
     {
+#if PEN_MEMORY_TRACKING
+        memory_tracked_free(mem);
+#elif PEN_MEMORY_SIZE_CLASSES
+        memory_sc_free(mem);
+#else
         free(mem);
+#endif
     }
 
     inline void memory_zero(void* dest, size_t size_bytes)
@@ -70,15 +179,27 @@ namespace pen
 
     inline void* memory_alloc_align(size_t size_bytes, size_t alignment)
     {
+#if PEN_MEMORY_TRACKING
+        return memory_tracked_alloc(size_bytes, alignment);
+#elif PEN_MEMORY_SIZE_CLASSES
+        return memory_sc_alloc(size_bytes, alignment);
+#else
         void* mem;
         PEN_MEM_ALIGN_ALLOC(mem, alignment, size_bytes);
 
         return mem;
+#endif
     }
 
     inline void memory_free_align(void* mem)
     {
+#if PEN_MEMORY_TRACKING
+        memory_tracked_free(mem);
+#elif PEN_MEMORY_SIZE_CLASSES
+        memory_sc_free(mem);
+#else
         PEN_MEM_ALIGN_FREE(mem);
+#endif
     }
 } // namespace pen
 
@@ -0,0 +1,168 @@
+// name_str.h
+// Copyright 2014 - 2019 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Fixed size string for entity and resource names which can live inside component arrays.
+// Short names are stored in place, longer names point to a copy in the hash_intern table so a name_str never owns
+// heap memory: it can be memcpy'd, realloc'd or zeroed (zeroed memory is an empty string) without fix up.
+// Interned long names are never freed, so setting many unique long names grows the table for the program lifetime.
+
+#pragma once
+
+#include "hash.h"
+#include "pen_string.h"
+
+#include "str/Str.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <type_traits>
+
+namespace pen
+{
+    struct name_str
+    {
+        static const u32 k_size = 32;
+        static const u32 k_max_inline = k_size - 2; // last byte flags an interned pointer
+
+        c8 buf[k_size] = {};
+
+        name_str() = default;
+        name_str(const c8* src);
+
+        const c8* c_str() const;
+        bool      empty() const;
+        u32       length() const;
+        bool      is_interned() const;
+
+        void set(const c8* src); // nullptr clears
+        void setf(const c8* fmt, ...);
+        void append(const c8* src);
+        void appendf(const c8* fmt, ...);
+        void clear();
+
+        name_str& operator=(const c8* rhs);
+        name_str& operator=(const Str& rhs);
+        bool      operator==(const c8* rhs) const;
+        bool      operator!=(const c8* rhs) const;
+    };
+    static_assert(std::is_trivially_copyable<name_str>::value, "name_str must be safe to memcpy");
+
+    template <>
+    uint32_t hashMurmur2A(const name_str& s);
+
+    // Implementation
+
+    inline name_str::name_str(const c8* src)
+    {
+        set(src);
+    }
+
+    inline const c8* name_str::c_str() const
+    {
+        if (!buf[k_size - 1])
+            return buf;
+
+        const c8* p;
+        memcpy(&p, buf, sizeof(p));
+        return p;
+    }
+
+    inline bool name_str::empty() const
+    {
+        return c_str()[0] == '\0';
+    }
+
+    inline u32 name_str::length() const
+    {
+        return (u32)strlen(c_str());
+    }
+
+    inline bool name_str::is_interned() const
+    {
+        return buf[k_size - 1] != 0;
+    }
+
+    inline void name_str::clear()
+    {
+        memset(buf, 0x0, k_size);
+    }
+
+    inline void name_str::set(const c8* src)
+    {
+        clear();
+
+        if (!src)
+            return;
+
+        u32 len = (u32)strlen(src);
+        if (len <= k_max_inline)
+        {
+            memcpy(buf, src, len);
+            return;
+        }
+
+        const c8* p = hash_intern_str(src);
+        memcpy(buf, &p, sizeof(p));
+        buf[k_size - 1] = 1;
+    }
+
+    inline void name_str::setf(const c8* fmt, ...)
+    {
+        c8      tmp[1024];
+        va_list va;
+        va_start(va, fmt);
+        string_format_va(tmp, sizeof(tmp), fmt, va);
+        va_end(va);
+        set(tmp);
+    }
+
+    inline void name_str::append(const c8* src)
+    {
+        if (!src)
+            return;
+
+        // src may point into our own buffer
+        c8 tmp[1024];
+        string_format(tmp, sizeof(tmp), "%s%s", c_str(), src);
+        set(tmp);
+    }
+
+    inline void name_str::appendf(const c8* fmt, ...)
+    {
+        c8      tmp[1024];
+        va_list va;
+        va_start(va, fmt);
+        string_format_va(tmp, sizeof(tmp), fmt, va);
+        va_end(va);
+        append(tmp);
+    }
+
+    inline name_str& name_str::operator=(const c8* rhs)
+    {
+        set(rhs);
+        return *this;
+    }
+
+    inline name_str& name_str::operator=(const Str& rhs)
+    {
+        set(rhs.c_str());
+        return *this;
+    }
+
+    inline bool name_str::operator==(const c8* rhs) const
+    {
+        return strcmp(c_str(), rhs) == 0;
+    }
+
+    inline bool name_str::operator!=(const c8* rhs) const
+    {
+        return strcmp(c_str(), rhs) != 0;
+    }
+
+    template <>
+    inline uint32_t hashMurmur2A(const name_str& s)
+    {
+        return hashMurmur2A(s.c_str());
+    }
+} // namespace pen
@@ -0,0 +1,69 @@
+// renderer_null.h
+// Copyright 2014 - 2019 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Headless renderer backend which implements pen::direct without a device.
+// Resources are tracked by slot so that commands can be validated against what was created, per frame counters are
+// gathered for draws, state changes and uploads and the command stream can optionally be written to a binary trace.
+
+#pragma once
+
+#include "types.h"
+
+namespace pen
+{
+    struct null_renderer_frame_stats
+    {
+        u64 frame;
+        u32 commands;
+        u32 draws;
+        u32 dispatches;
+        u32 state_changes;      // binds which changed the currently bound state
+        u32 redundant_state;    // binds of the already bound state
+        u32 bytes_uploaded;     // buffer updates plus initial buffer and texture data
+        u32 resources_created;
+        u32 resources_released;
+        u32 validation_errors;
+    };
+
+    namespace e_null_trace_cmd
+    {
+        enum null_trace_cmd_t
+        {
+            frame,
+            create,
+            release,
+            bind,
+            update,
+            draw,
+            dispatch,
+            clear,
+            present
+        };
+    }
+    typedef e_null_trace_cmd::null_trace_cmd_t null_trace_cmd;
+
+    // trace files start with a header followed by packed records, record payloads are null_trace_cmd specific
+    // u32 args, the final present record of each frame carries the null_renderer_frame_stats of that frame.
+    static const u32 k_null_trace_magic = PEN_FOURCC('P', 'N', 'T', 'R');
+    static const u32 k_null_trace_version = 1;
+
+    struct null_trace_header
+    {
+        u32 magic;
+        u32 version;
+    };
+
+    struct null_trace_record
+    {
+        u8  cmd;      // null_trace_cmd
+        u8  sub_type; // resource type for create / release / bind
+        u16 num_args; // number of u32 args which follow
+    };
+
+    // call before renderer_init to record every command the backend receives, filename nullptr disables
+    void null_renderer_set_trace_file(const c8* filename);
+
+    // stats of the last presented frame, safe to call from any thread
+    null_renderer_frame_stats null_renderer_get_frame_stats();
+} // namespace pen
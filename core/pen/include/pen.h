@@ -52,6 +52,7 @@ namespace pen
         const c8*        window_title = "pen_app";
         pen_create_flags flags = e_pen_create_flags::renderer;
         u32              max_renderer_commands = 1 << 16; // space for max commands in cmd buffer
+        u32              max_frames_in_flight = 1;        // frames the user thread can submit ahead of present
         void* (*user_thread_function)(void*) = nullptr;
         void* user_data = nullptr;
     };
@@ -29,7 +29,7 @@ namespace pen
     inline c8* sub_string(const c8* src, u32 length)
     {
         u32 padded_length = length + 1;
-        c8* new_string = (c8*)malloc(padded_length);
+        c8* new_string = (c8*)pen::memory_alloc(padded_length);
         memcpy(new_string, src, length);
         new_string[length] = '\0';
 
@@ -316,6 +316,7 @@ namespace pen
         u32 block_size;
         u32 data_size;
         void (*call_back_function)(void*, u32, u32, u32);
+        u32 max_latency; // frames the callback may be deferred waiting on the gpu, 0 blocks until the data is ready
     };
 
     enum e_texture_bind_flags
@@ -375,11 +376,47 @@ namespace pen
     const renderer_info& renderer_get_info();
 
     // setup / hook functions
-    void renderer_init(void* user_data, bool wait_for_jobs, u32 max_commands);
+    // max_frames_in_flight is the number of frames the user thread can submit which the render thread has not yet
+    // presented, renderer_consume_cmd_buffer blocks while the limit is reached. 1 waits for each frame to present.
+    void renderer_init(void* user_data, bool wait_for_jobs, u32 max_commands, u32 max_frames_in_flight = 1);
     bool renderer_dispatch();
     void renderer_test_run();
     void renderer_test_enable();
 
+    // command stream capture, writes every command the render thread executes along with its payloads for num_frames.
+    // captures are only self contained when started before renderer_init or before the app creates any resources,
+    // the replay process recreates the renderers internal resources itself through renderer_init.
+    struct renderer_capture_info
+    {
+        u32  num_frames;
+        u32  num_commands;
+        u32  max_frame_commands;
+        u32  window_width;
+        u32  window_height;
+        bool compatible; // captures are tied to the renderer_cmd layout of the build which wrote them
+    };
+
+    void renderer_capture_begin(const c8* filename, u32 num_frames);
+    bool renderer_capture_read_info(const c8* filename, renderer_capture_info& info);
+
+    // submits a capture from the user thread and times each command on the render thread, logs per command type
+    // timing histograms on completion and optionally writes them as csv. the caller must not have created resources.
+    bool renderer_capture_replay(const c8* filename, const c8* report_filename = nullptr);
+
+    // frame pacing and latency, latency is from the os update input poll read by a frame (the last poll before
+    // renderer_consume_cmd_buffer returns) until the render thread presents it.
+    struct renderer_present_stats
+    {
+        f32 cpu_ms;         // render thread time between presents
+        f32 gpu_ms;
+        f32 latency_ms;     // last presented frame
+        f32 latency_avg_ms; // over the last k_latency_history frames
+        f32 latency_max_ms;
+        f32 pacing_wait_ms; // time the user thread last blocked waiting for frames in flight
+        u32 max_frames_in_flight;
+    };
+    void renderer_get_present_time(renderer_present_stats& stats);
+
     // public-api will buffer all commands for dispatch on dedicated thread
     void       renderer_new_frame();
     void       renderer_set_current_ctx(render_ctx ctx);
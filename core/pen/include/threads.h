@@ -29,6 +29,7 @@ namespace pen
         semaphore*          p_sem_continue = nullptr;
         semaphore*          p_sem_exit = nullptr;
         semaphore*          p_sem_terminated = nullptr;
+        semaphore*          p_sem_wake = nullptr; // optional, posted after exit for threads which block waiting for work
         completion_callback p_completion_callback = nullptr;
 
         f32 thread_time;
@@ -142,6 +142,37 @@ inline f16 float_to_half(f32 f)
     return v.ui | sign;
 }
 
+inline f32 half_to_float(f16 h)
+{
+    union bits {
+        uint32_t ui;
+        float    f;
+    };
+
+    static const bits     magic = {113 << 23};
+    static const uint32_t shifted_exp = 0x7c00 << 13; // exponent mask after shift
+
+    bits o;
+    o.ui = (h & 0x7fff) << 13; // exponent / mantissa bits
+    uint32_t exp = shifted_exp & o.ui;
+    o.ui += (127 - 15) << 23; // exponent adjust
+
+    if (exp == shifted_exp)
+    {
+        // inf / nan
+        o.ui += (128 - 16) << 23;
+    }
+    else if (exp == 0)
+    {
+        // zero / subnormal
+        o.ui += 1 << 23;
+        o.f -= magic.f;
+    }
+
+    o.ui |= (h & 0x8000) << 16; // sign
+    return o.f;
+}
+
 // Minimal amount of macros that are handy to have evrywhere
 // For making texture formats ('D' 'X' 'T' '1') etc
 #define PEN_FOURCC(ch0, ch1, ch2, ch3)                                                                                       \
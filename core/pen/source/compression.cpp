@@ -0,0 +1,195 @@
+// compression.cpp
+// Copyright 2014 - 2019 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+#include "compression.h"
+#include "memory.h"
+
+namespace
+{
+    const u32 k_min_match = 4;
+    const u32 k_last_literals = 5;  // last 5 bytes of a block are always literals
+    const u32 k_match_find_limit = 12; // last match must start 12 bytes before the end of a block
+    const u32 k_max_offset = 65535;
+    const u32 k_hash_log = 12;
+    const u32 k_run_mask = 15;
+
+    pen_inline u32 read_u32(const u8* p)
+    {
+        u32 v;
+        memcpy(&v, p, sizeof(u32));
+        return v;
+    }
+
+    pen_inline u32 hash_sequence(u32 sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - k_hash_log);
+    }
+
+    pen_inline u8* write_length(u8* op, u32 len)
+    {
+        while (len >= 255)
+        {
+            *op++ = 255;
+            len -= 255;
+        }
+        *op++ = (u8)len;
+        return op;
+    }
+} // namespace
+
+namespace pen
+{
+    u32 compress_lz4_bound(u32 src_size)
+    {
+        return src_size + (src_size / 255) + 16;
+    }
+
+    u32 compress_lz4(const void* src, u32 src_size, void* dst, u32 dst_capacity)
+    {
+        if (dst_capacity < compress_lz4_bound(src_size))
+            return 0;
+
+        const u8* base = (const u8*)src;
+        const u8* ip = base;
+        const u8* anchor = base;
+        const u8* iend = base + src_size;
+        const u8* match_limit = iend - k_last_literals;
+        u8*       op = (u8*)dst;
+
+        if (src_size > k_match_find_limit)
+        {
+            const u8* mf_limit = iend - k_match_find_limit;
+
+            u32 table[1 << k_hash_log];
+            memset(table, 0x0, sizeof(table));
+
+            while (ip < mf_limit)
+            {
+                u32       sequence = read_u32(ip);
+                u32       h = hash_sequence(sequence);
+                const u8* ref = base + table[h];
+                table[h] = (u32)(ip - base);
+
+                if (ref >= ip || (u32)(ip - ref) > k_max_offset || read_u32(ref) != sequence)
+                {
+                    ++ip;
+                    continue;
+                }
+
+                // extend the match forward
+                const u8* mp = ip + k_min_match;
+                const u8* rp = ref + k_min_match;
+                while (mp < match_limit && *mp == *rp)
+                {
+                    ++mp;
+                    ++rp;
+                }
+
+                u32 num_literals = (u32)(ip - anchor);
+                u32 match_len = (u32)(mp - ip) - k_min_match;
+                u16 offset = (u16)(ip - ref);
+
+                // token, literals, offset, match length
+                u8* token = op++;
+                *token = (u8)(min<u32>(num_literals, k_run_mask) << 4);
+                if (num_literals >= k_run_mask)
+                    op = write_length(op, num_literals - k_run_mask);
+
+                memcpy(op, anchor, num_literals);
+                op += num_literals;
+
+                *op++ = (u8)(offset & 0xff);
+                *op++ = (u8)(offset >> 8);
+
+                *token |= (u8)min<u32>(match_len, k_run_mask);
+                if (match_len >= k_run_mask)
+                    op = write_length(op, match_len - k_run_mask);
+
+                ip = mp;
+                anchor = ip;
+            }
+        }
+
+        // remaining literals
+        u32 num_literals = (u32)(iend - anchor);
+        u8* token = op++;
+        *token = (u8)(min<u32>(num_literals, k_run_mask) << 4);
+        if (num_literals >= k_run_mask)
+            op = write_length(op, num_literals - k_run_mask);
+
+        memcpy(op, anchor, num_literals);
+        op += num_literals;
+
+        return (u32)(op - (u8*)dst);
+    }
+
+    u32 decompress_lz4(const void* src, u32 src_size, void* dst, u32 dst_size)
+    {
+        const u8* ip = (const u8*)src;
+        const u8* iend = ip + src_size;
+        u8*       op = (u8*)dst;
+        u8*       oend = op + dst_size;
+
+        while (ip < iend)
+        {
+            u32 token = *ip++;
+
+            // literals
+            u32 num_literals = token >> 4;
+            if (num_literals == k_run_mask)
+            {
+                u32 s = 255;
+                while (s == 255 && ip < iend)
+                {
+                    s = *ip++;
+                    num_literals += s;
+                }
+            }
+
+            if ((u32)(iend - ip) < num_literals || (u32)(oend - op) < num_literals)
+                return 0;
+
+            memcpy(op, ip, num_literals);
+            ip += num_literals;
+            op += num_literals;
+
+            // the last sequence has no match
+            if (ip >= iend)
+                break;
+
+            if (iend - ip < 2)
+                return 0;
+
+            u32 offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+
+            if (offset == 0 || (u32)(op - (u8*)dst) < offset)
+                return 0;
+
+            u32 match_len = token & k_run_mask;
+            if (match_len == k_run_mask)
+            {
+                u32 s = 255;
+                while (s == 255 && ip < iend)
+                {
+                    s = *ip++;
+                    match_len += s;
+                }
+            }
+            match_len += k_min_match;
+
+            if ((u32)(oend - op) < match_len)
+                return 0;
+
+            // matches can overlap the output so copy bytewise
+            const u8* mp = op - offset;
+            for (u32 i = 0; i < match_len; ++i)
+                op[i] = mp[i];
+
+            op += match_len;
+        }
+
+        return (u32)(op - (u8*)dst);
+    }
+} // namespace pen
@@ -0,0 +1,152 @@
+// hash.cpp
+// Copyright 2014 - 2019 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+#include "hash.h"
+#include "console.h"
+#include "memory.h"
+#include "threads.h"
+
+#include <string.h>
+
+namespace
+{
+    // open addressed table of hash -> interned string, strings are packed into blocks which are never freed
+    struct intern_entry
+    {
+        hash_id   id;
+        const c8* name;
+    };
+
+    static const u32 k_intern_block_size = 64 * 1024;
+
+    struct intern_table
+    {
+        intern_entry* entries = nullptr;
+        u32           capacity = 0;
+        u32           count = 0;
+        c8*           block = nullptr;
+        u32           block_pos = 0;
+    };
+
+    intern_table s_intern;
+
+    pen::mutex* intern_mutex()
+    {
+        static pen::mutex* m = pen::mutex_create();
+        return m;
+    }
+
+    // id 0 marks an empty slot, the name pointer tells them apart from a real hash of 0.
+    // names which collide get their own slot further along the probe sequence, so when name is passed the
+    // entry must match the text as well as the id, otherwise the first entry with the id is returned
+    intern_entry* intern_find(hash_id id, const c8* name = nullptr)
+    {
+        if (s_intern.capacity == 0)
+            return nullptr;
+
+        u32 mask = s_intern.capacity - 1;
+        for (u32 i = id & mask;; i = (i + 1) & mask)
+        {
+            intern_entry& e = s_intern.entries[i];
+            if (!e.name)
+                return &e;
+
+            if (e.id == id && (!name || strcmp(e.name, name) == 0))
+                return &e;
+        }
+    }
+
+    void intern_grow()
+    {
+        intern_entry* old = s_intern.entries;
+        u32           old_capacity = s_intern.capacity;
+
+        s_intern.capacity = old_capacity ? old_capacity * 2 : 1024;
+        s_intern.entries = (intern_entry*)pen::memory_calloc(s_intern.capacity, sizeof(intern_entry));
+
+        for (u32 i = 0; i < old_capacity; ++i)
+            if (old[i].name)
+                *intern_find(old[i].id, old[i].name) = old[i];
+
+        pen::memory_free(old);
+    }
+
+    const c8* intern_copy(const c8* name, u32 len)
+    {
+        // long names get a block of their own
+        if (len + 1 > k_intern_block_size / 4)
+        {
+            c8* copy = (c8*)pen::memory_alloc(len + 1);
+            memcpy(copy, name, len + 1);
+            return copy;
+        }
+
+        if (!s_intern.block || s_intern.block_pos + len + 1 > k_intern_block_size)
+        {
+            s_intern.block = (c8*)pen::memory_alloc(k_intern_block_size);
+            s_intern.block_pos = 0;
+        }
+
+        c8* copy = s_intern.block + s_intern.block_pos;
+        memcpy(copy, name, len + 1);
+        s_intern.block_pos += len + 1;
+        return copy;
+    }
+
+    const c8* intern(const c8* name, hash_id& id)
+    {
+        u32 len = (u32)strlen(name);
+        id = pen::hashMurmur2A(name, len);
+
+        pen::mutex_lock(intern_mutex());
+
+        if ((s_intern.count + 1) * 2 > s_intern.capacity)
+            intern_grow();
+
+        intern_entry* e = intern_find(id, name);
+        if (!e->name)
+        {
+            // the first name interned with this id keeps it for hash_name
+            const c8* other = intern_find(id)->name;
+            if (other)
+                PEN_LOG("hash collision: %s and %s both hash to %08x", other, name, id);
+
+            e->id = id;
+            e->name = intern_copy(name, len);
+            s_intern.count++;
+        }
+
+        const c8* interned = e->name;
+        pen::mutex_unlock(intern_mutex());
+
+        return interned;
+    }
+} // namespace
+
+namespace pen
+{
+    hash_id hash_intern(const c8* name)
+    {
+        hash_id id;
+        intern(name, id);
+        return id;
+    }
+
+    const c8* hash_intern_str(const c8* name)
+    {
+        hash_id id;
+        return intern(name, id);
+    }
+
+    const c8* hash_name(hash_id id)
+    {
+        pen::mutex_lock(intern_mutex());
+
+        intern_entry* e = intern_find(id);
+        const c8*     name = e ? e->name : nullptr;
+
+        pen::mutex_unlock(intern_mutex());
+        return name;
+    }
+} // namespace pen
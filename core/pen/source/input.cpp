@@ -23,8 +23,24 @@ namespace
     u8                    s_unicode_state[PK_COUNT];
     pen::mouse_state      s_mouse_state = {0};
     std::atomic<bool>     s_show_cursor = {true};
+    std::atomic<f64>      s_poll_time = {0.0};
     Str                   s_unicode_text_input;
-    pen::ring_buffer<Str> s_unicode_ring;
+
+    // the os thread produces unicode input and the user thread consumes it, the ring is created inside a function
+    // local static so whichever thread gets there first creates it and the other waits on the initialisation
+    struct unicode_ring : pen::ring_buffer<Str>
+    {
+        unicode_ring()
+        {
+            create(128);
+        }
+    };
+
+    pen::ring_buffer<Str>& get_unicode_ring()
+    {
+        static unicode_ring s_unicode_ring;
+        return s_unicode_ring;
+    }
 
     std::map<u16, const c8*> k_key_names = {{PK_0, "0"},
                                             {PK_1, "1"},
@@ -132,18 +148,17 @@ namespace pen
 {
     void input_add_unicode_input(const c8* utf8)
     {
-        if (s_unicode_ring.data == nullptr)
-            s_unicode_ring.create(128);
-
-        s_unicode_ring.put(Str(utf8));
+        // drop input rather than stall the os thread if nobody is reading it
+        get_unicode_ring().try_put(Str(utf8));
     }
 
     Str input_get_unicode_input()
     {
-        Str inputs = "";
+        Str                    inputs = "";
+        pen::ring_buffer<Str>& ring = get_unicode_ring();
         for (;;)
         {
-            Str* s = s_unicode_ring.get();
+            Str* s = ring.get();
             if (!s)
                 break;
 
@@ -204,6 +219,16 @@ namespace pen
         s_mouse_state.wheel += wheel;
     }
 
+    void input_set_poll_time(f64 time_ms)
+    {
+        s_poll_time = time_ms;
+    }
+
+    f64 input_get_poll_time()
+    {
+        return s_poll_time;
+    }
+
     bool input_is_key_down(u32 key_index)
     {
         return s_keyboard_state[key_index];
@@ -122,7 +122,8 @@ namespace
 - (instancetype)initWithView:(nonnull MTKView*)view
 {
     [super init];
-    pen::renderer_init((void*)view, false, s_context.creation_params.max_renderer_commands);
+    pen::renderer_init((void*)view, false, s_context.creation_params.max_renderer_commands,
+                       s_context.creation_params.max_frames_in_flight);
     return self;
 }
 - (void)mtkView:(nonnull MTKView*)view drawableSizeWillChange:(CGSize)size
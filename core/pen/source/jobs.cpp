@@ -53,6 +53,9 @@ namespace pen
         for (s32 i = s_num_active_threads - 1; i >= 0; --i)
         {
             pen::semaphore_post(s_jt[i].p_sem_exit, 1);
+            if (s_jt[i].p_sem_wake)
+                pen::semaphore_post(s_jt[i].p_sem_wake, 1);
+
             if (pen::semaphore_try_wait(s_jt[i].p_sem_terminated))
             {
                 s_num_active_threads--;
@@ -1,7 +1,11 @@
 // os.cpp
 // Copyright 2014 - 2019 Alex Dixon.
 // License: https://github.com/polymonster/pmtech/blob/master/license.md
+#ifndef PEN_RENDERER_NULL
 #include "GL/glew.h"
+#else
+#include "renderer_null.h"
+#endif
 
 #include "console.h"
 #include "hash.h"
@@ -21,9 +25,13 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#ifndef PEN_RENDERER_NULL
 #include <GL/glx.h>
 #include <GL/glxext.h>
+#endif
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
 
 using namespace pen;
 
@@ -31,6 +39,7 @@ using namespace pen;
 window_creation_params pen_window;
 pen::user_info         pen_user_info;
 
+#ifndef PEN_RENDERER_NULL
 // glx / gl stuff
 #define GLX_CONTEXT_MAJOR_VERSION_ARB 0x2091
 #define GLX_CONTEXT_MINOR_VERSION_ARB 0x2092
@@ -48,9 +57,11 @@ static int visual_attribs[] = {GLX_X_RENDERABLE, True, GLX_DRAWABLE_TYPE, GLX_WI
                                None};
 
 GLXContext _gl_context = 0;
-Display*   _display;
-Window     _window;
+#endif
+Display* _display;
+Window   _window;
 
+#ifndef PEN_RENDERER_NULL
 // externs for the gl implementation
 void pen_make_gl_context_current()
 {
@@ -61,6 +72,7 @@ void pen_gl_swap_buffers()
 {
     glXSwapBuffers(_display, _window);
 }
+#endif
 
 namespace
 {
@@ -89,6 +101,43 @@ namespace
         return 0;
     }
 
+    void renderer_args(int argc, char** argv)
+    {
+        for (s32 i = 1; i < argc; ++i)
+        {
+            if (strcmp(argv[i], "-test") == 0)
+            {
+                pen::renderer_test_enable();
+            }
+            else if (strcmp(argv[i], "-capture") == 0 && i + 2 < argc)
+            {
+                pen::renderer_capture_begin(argv[i + 1], atoi(argv[i + 2]));
+                i += 2;
+            }
+#ifdef PEN_RENDERER_NULL
+            else if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc)
+            {
+                pen::null_renderer_set_trace_file(argv[++i]);
+            }
+#endif
+        }
+    }
+
+#ifdef PEN_RENDERER_NULL
+    int pen_run_headless(int argc, char** argv)
+    {
+        // no display or context, the null renderer only needs the command line
+        renderer_args(argc, argv);
+
+        // inits renderer and loops in wait for jobs, calling os update
+        renderer_init(nullptr, true, s_creation_params.max_renderer_commands, s_creation_params.max_frames_in_flight);
+
+        // exit, kill other threads and wait
+        pen::jobs_terminate_all();
+
+        return s_error_code;
+    }
+#else
     int pen_run_windowed(int argc, char** argv)
     {
         Visual*              visual;
@@ -219,16 +268,10 @@ namespace
 
         s_windowed = true;
 
-        if(argc > 1)
-        {
-            if(strcmp(argv[1],"-test") == 0)
-            {
-                pen::renderer_test_enable();
-            }
-        }
+        renderer_args(argc, argv);
 
         // inits renderer and loops in wait for jobs, calling os update
-        renderer_init(nullptr, true, s_creation_params.max_renderer_commands);
+        renderer_init(nullptr, true, s_creation_params.max_renderer_commands, s_creation_params.max_frames_in_flight);
 
         // exit, kill other threads and wait
         pen::jobs_terminate_all();
@@ -238,6 +281,7 @@ namespace
 
         return s_error_code;
     }
+#endif
 
     int pen_run_console_app()
     {
@@ -508,6 +552,7 @@ namespace
         pen::input_set_mouse_pos((f32)win_x, (f32)win_y);
 
         pen::input_gamepad_update();
+        pen::input_set_poll_time(pen::get_time_ms());
     }
 } // namespace
 
@@ -527,7 +572,11 @@ int main(int argc, char* argv[])
 
     if (pc.flags & e_pen_create_flags::renderer)
     {
+#ifdef PEN_RENDERER_NULL
+        pen_run_headless(argc, argv);
+#else
         pen_run_windowed(argc, argv);
+#endif
     }
     else
     {
@@ -3,6 +3,692 @@
 // License: https://github.com/polymonster/pmtech/blob/master/license.md
 
 #include "memory.h"
+#include "console.h"
+
+#include <atomic>
+
+#if PEN_MEMORY_SIZE_CLASSES
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#include <new>
+
+namespace
+{
+    // size classes step by 16 bytes up to 128, then split each power of 2 into 4 up to 32k
+    static const size_t k_class_step = 16;
+    static const size_t k_class_linear_max = 128;
+    static const size_t k_max_small = 32 * 1024;
+    static const u32    k_num_classes = 8 + 8 * 4;
+    static const size_t k_span_size = 256 * 1024; // spans and large blocks are aligned to this to find their header
+    static const size_t k_span_header_size = 64;
+    static const size_t k_region_spans = 16;
+    static const size_t k_os_granularity = 64 * 1024; // covers 4k, 16k pages and windows allocation granularity
+    static const u32    k_large_cache_slots = 32;
+    static const size_t k_large_cache_max_bytes = 32 * 1024 * 1024;
+
+    namespace e_block
+    {
+        enum block_kind_t
+        {
+            span,
+            large
+        };
+    }
+
+    struct heap;
+
+    // lives at the aligned base of every span and large block
+    struct block_header
+    {
+        u32    kind;
+        u32    size_class;
+        size_t size;     // object size for spans, usable size for large blocks
+        size_t map_size; // os mapping size for large blocks
+        heap*  owner;
+        u8*    bump; // next never allocated object in a span
+        u8*    end;
+    };
+    static_assert(sizeof(block_header) <= k_span_header_size, "block_header must fit before the first object");
+
+    // one per thread, reused by new threads once its thread exits
+    struct heap
+    {
+        void*              free_list[k_num_classes];
+        block_header*      active_span[k_num_classes];
+        std::atomic<void*> remote_free; // objects freed by other threads, drained by the owner
+        std::atomic<u32>   in_use;
+        heap*              next;
+    };
+
+    struct thread_heap
+    {
+        heap* h = nullptr;
+
+        ~thread_heap()
+        {
+            if (h)
+                h->in_use.store(0, std::memory_order_release);
+            h = nullptr;
+        }
+    };
+
+    thread_local thread_heap s_thread_heap;
+    std::atomic<heap*>       s_heaps;
+
+    // spans and heaps are carved from os regions under a spin lock, only hit once per span
+    std::atomic<u32> s_region_lock;
+    u8*              s_region_pos;
+    u8*              s_region_end;
+    u8*              s_heap_pos;
+    u8*              s_heap_end;
+
+    // freed large blocks are kept for reuse under the region lock, otherwise buffers growing and shrinking past
+    // k_max_small pay for a map and unmap every time
+    block_header* s_large_cache[k_large_cache_slots];
+    u32           s_large_cache_count;
+    size_t        s_large_cache_bytes;
+
+    size_t align_up(size_t v, size_t a)
+    {
+        return (v + a - 1) & ~(a - 1);
+    }
+
+    u8* os_map_aligned(size_t size, size_t alignment)
+    {
+#ifdef _WIN32
+        for (;;)
+        {
+            // reserve enough to find an aligned address, release and map there. retry if another thread took it
+            u8* p = (u8*)VirtualAlloc(nullptr, size + alignment, MEM_RESERVE, PAGE_NOACCESS);
+            if (!p)
+                return nullptr;
+
+            u8* aligned = (u8*)align_up((size_t)p, alignment);
+            VirtualFree(p, 0, MEM_RELEASE);
+
+            u8* r = (u8*)VirtualAlloc(aligned, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if (r)
+                return r;
+        }
+#else
+        size_t map_size = size + alignment;
+        u8*    p = (u8*)mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (p == (u8*)MAP_FAILED)
+            return nullptr;
+
+        // trim the unaligned head and tail
+        u8*    aligned = (u8*)align_up((size_t)p, alignment);
+        size_t head = aligned - p;
+        size_t tail = map_size - head - size;
+
+        if (head)
+            munmap(p, head);
+
+        if (tail)
+            munmap(aligned + size, tail);
+
+        return aligned;
+#endif
+    }
+
+    void os_unmap(void* mem, size_t size)
+    {
+#ifdef _WIN32
+        VirtualFree(mem, 0, MEM_RELEASE);
+#else
+        munmap(mem, size);
+#endif
+    }
+
+    void region_lock()
+    {
+        u32 expected = 0;
+        while (!s_region_lock.compare_exchange_weak(expected, 1, std::memory_order_acquire))
+            expected = 0;
+    }
+
+    void region_unlock()
+    {
+        s_region_lock.store(0, std::memory_order_release);
+    }
+
+    u8* region_alloc_span()
+    {
+        if (s_region_pos == s_region_end)
+        {
+            s_region_pos = os_map_aligned(k_span_size * k_region_spans, k_span_size);
+            if (!s_region_pos)
+                return nullptr;
+
+            s_region_end = s_region_pos + k_span_size * k_region_spans;
+        }
+
+        u8* span = s_region_pos;
+        s_region_pos += k_span_size;
+        return span;
+    }
+
+    u32 size_class(size_t size)
+    {
+        if (size <= k_class_linear_max)
+            return size <= k_class_step ? 0 : (u32)((size - 1) / k_class_step);
+
+        // 2^p < size <= 2^(p + 1)
+        u32 p = 7;
+        while (((size_t)1 << (p + 1)) < size)
+            ++p;
+
+        size_t base = (size_t)1 << p;
+        return 8 + (p - 7) * 4 + (u32)((size - base - 1) / (base / 4));
+    }
+
+    size_t class_size(u32 c)
+    {
+        if (c < 8)
+            return (c + 1) * k_class_step;
+
+        size_t base = (size_t)1 << (7 + (c - 8) / 4);
+        return base + ((c - 8) % 4 + 1) * (base / 4);
+    }
+
+    block_header* get_block_header(void* mem)
+    {
+        return (block_header*)((size_t)mem & ~(k_span_size - 1));
+    }
+
+    heap* acquire_heap()
+    {
+        // adopt a heap left behind by an exited thread, its spans and free lists come with it
+        for (heap* h = s_heaps.load(std::memory_order_acquire); h; h = h->next)
+        {
+            u32 expected = 0;
+            if (h->in_use.compare_exchange_strong(expected, 1, std::memory_order_acquire))
+                return h;
+        }
+
+        region_lock();
+
+        size_t heap_size = align_up(sizeof(heap), 64);
+        if (s_heap_pos + heap_size > s_heap_end)
+        {
+            s_heap_pos = region_alloc_span();
+            s_heap_end = s_heap_pos ? s_heap_pos + k_span_size : nullptr;
+        }
+
+        heap* h = nullptr;
+        if (s_heap_pos)
+        {
+            h = new (s_heap_pos) heap();
+            s_heap_pos += heap_size;
+        }
+
+        region_unlock();
+
+        if (!h)
+            return nullptr;
+
+        h->in_use.store(1, std::memory_order_relaxed);
+
+        heap* head = s_heaps.load(std::memory_order_relaxed);
+        do
+        {
+            h->next = head;
+        } while (!s_heaps.compare_exchange_weak(head, h, std::memory_order_release, std::memory_order_relaxed));
+
+        return h;
+    }
+
+    heap* get_heap()
+    {
+        thread_heap& th = s_thread_heap;
+        if (!th.h)
+            th.h = acquire_heap();
+
+        return th.h;
+    }
+
+    void drain_remote_frees(heap* h)
+    {
+        void* list = h->remote_free.exchange(nullptr, std::memory_order_acquire);
+        while (list)
+        {
+            void* next = *(void**)list;
+            u32   c = get_block_header(list)->size_class;
+
+            *(void**)list = h->free_list[c];
+            h->free_list[c] = list;
+            list = next;
+        }
+    }
+
+    block_header* new_span(heap* h, u32 c)
+    {
+        region_lock();
+        u8* base = region_alloc_span();
+        region_unlock();
+
+        if (!base)
+            return nullptr;
+
+        block_header* span = (block_header*)base;
+        span->kind = e_block::span;
+        span->size_class = c;
+        span->size = class_size(c);
+        span->map_size = 0;
+        span->owner = h;
+        span->bump = base + k_span_header_size;
+        span->end = base + k_span_size;
+        return span;
+    }
+
+    void* small_alloc(u32 c)
+    {
+        heap* h = get_heap();
+        if (!h)
+            return nullptr;
+
+        if (!h->free_list[c] && h->remote_free.load(std::memory_order_relaxed))
+            drain_remote_frees(h);
+
+        void* mem = h->free_list[c];
+        if (mem)
+        {
+            h->free_list[c] = *(void**)mem;
+            return mem;
+        }
+
+        block_header* span = h->active_span[c];
+        if (!span || span->bump + span->size > span->end)
+        {
+            span = new_span(h, c);
+            if (!span)
+                return nullptr;
+
+            h->active_span[c] = span;
+        }
+
+        mem = span->bump;
+        span->bump += span->size;
+        return mem;
+    }
+
+    block_header* large_cache_take(size_t map_size)
+    {
+        // best fit, but do not hand out more than twice what was asked for
+        region_lock();
+
+        u32 best = k_large_cache_slots;
+        for (u32 i = 0; i < s_large_cache_count; ++i)
+        {
+            size_t cached = s_large_cache[i]->map_size;
+            if (cached < map_size || cached > map_size * 2)
+                continue;
+
+            if (best == k_large_cache_slots || cached < s_large_cache[best]->map_size)
+                best = i;
+        }
+
+        block_header* block = nullptr;
+        if (best != k_large_cache_slots)
+        {
+            block = s_large_cache[best];
+            s_large_cache[best] = s_large_cache[--s_large_cache_count];
+            s_large_cache_bytes -= block->map_size;
+        }
+
+        region_unlock();
+        return block;
+    }
+
+    bool large_cache_give(block_header* block)
+    {
+        region_lock();
+
+        bool cached = false;
+        if (s_large_cache_count < k_large_cache_slots &&
+            s_large_cache_bytes + block->map_size <= k_large_cache_max_bytes)
+        {
+            s_large_cache[s_large_cache_count++] = block;
+            s_large_cache_bytes += block->map_size;
+            cached = true;
+        }
+
+        region_unlock();
+        return cached;
+    }
+
+    void* large_alloc(size_t size, size_t alignment)
+    {
+        size_t offset = alignment > k_span_header_size ? alignment : k_span_header_size;
+        size_t map_size = align_up(size + offset, k_os_granularity);
+
+        u8* base = (u8*)large_cache_take(map_size);
+        if (base)
+            map_size = ((block_header*)base)->map_size;
+        else
+            base = os_map_aligned(map_size, k_span_size);
+
+        if (!base)
+            return nullptr;
+
+        block_header* block = (block_header*)base;
+        block->kind = e_block::large;
+        block->size_class = 0;
+        block->size = map_size - offset;
+        block->map_size = map_size;
+        block->owner = nullptr;
+        return base + offset;
+    }
+} // namespace
+
+namespace pen
+{
+    void* memory_sc_alloc(size_t size_bytes, size_t alignment)
+    {
+        // 16 byte alignment is natural, up to 64 is found by picking a class whose size is a multiple of it
+        if (alignment <= k_class_step)
+            alignment = 0;
+
+        if (size_bytes <= k_max_small && alignment <= k_span_header_size)
+        {
+            u32 c = size_class(size_bytes);
+            if (alignment)
+                while (c < k_num_classes && class_size(c) % alignment)
+                    ++c;
+
+            if (c < k_num_classes)
+                return small_alloc(c);
+        }
+
+        PEN_ASSERT(alignment < k_span_size);
+        return large_alloc(size_bytes, alignment);
+    }
+
+    void memory_sc_free(void* mem)
+    {
+        if (!mem)
+            return;
+
+        block_header* block = get_block_header(mem);
+        if (block->kind == e_block::large)
+        {
+            if (!large_cache_give(block))
+                os_unmap(block, block->map_size);
+            return;
+        }
+
+        heap* owner = block->owner;
+        if (owner == s_thread_heap.h)
+        {
+            *(void**)mem = owner->free_list[block->size_class];
+            owner->free_list[block->size_class] = mem;
+            return;
+        }
+
+        // cross thread free, push onto the owners remote list
+        void* head = owner->remote_free.load(std::memory_order_relaxed);
+        do
+        {
+            *(void**)mem = head;
+        } while (!owner->remote_free.compare_exchange_weak(head, mem, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    size_t memory_sc_usable_size(void* mem)
+    {
+        return get_block_header(mem)->size;
+    }
+
+    void* memory_sc_realloc(void* mem, size_t size_bytes)
+    {
+        if (!mem)
+            return memory_sc_alloc(size_bytes, 0);
+
+        if (size_bytes == 0)
+        {
+            memory_sc_free(mem);
+            return nullptr;
+        }
+
+        // keep the block if it fits and shrinking would not free at least half of it
+        size_t usable = memory_sc_usable_size(mem);
+        if (size_bytes <= usable && size_bytes > usable / 2)
+            return mem;
+
+        void* new_mem = memory_sc_alloc(size_bytes, 0);
+        if (new_mem)
+        {
+            memcpy(new_mem, mem, usable < size_bytes ? usable : size_bytes);
+            memory_sc_free(mem);
+        }
+
+        return new_mem;
+    }
+} // namespace pen
+#endif
+
+#if PEN_MEMORY_TRACKING
+namespace
+{
+    // sits directly before every tracked allocation
+    struct alloc_header
+    {
+        size_t size;
+        u32    tag;
+        u32    offset; // from the base allocation to the user pointer
+    };
+    static_assert(sizeof(alloc_header) <= 16, "alloc_header must fit in the minimum alignment");
+
+    static const size_t k_min_align = 16;
+
+    // padded so tags hit by different threads do not share cache lines
+    struct alignas(64) tag_counters
+    {
+        std::atomic<size_t> live_bytes;
+        std::atomic<size_t> peak_bytes;
+        std::atomic<size_t> budget_bytes;
+        std::atomic<u32>    live_allocs;
+        std::atomic<u32>    frame_allocs;
+        std::atomic<u32>    last_frame_allocs;
+        std::atomic<u32>    total_allocs;
+        bool                over_budget;
+    };
+
+    tag_counters              s_tags[pen::e_mem_tag::count];
+    thread_local pen::mem_tag s_thread_tag = pen::e_mem_tag::general;
+
+    void track_alloc(u32 tag, size_t size)
+    {
+        tag_counters& tc = s_tags[tag];
+
+        size_t live = tc.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        size_t peak = tc.peak_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !tc.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+            ;
+
+        tc.live_allocs.fetch_add(1, std::memory_order_relaxed);
+        tc.frame_allocs.fetch_add(1, std::memory_order_relaxed);
+        tc.total_allocs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void track_free(u32 tag, size_t size)
+    {
+        tag_counters& tc = s_tags[tag];
+        tc.live_bytes.fetch_sub(size, std::memory_order_relaxed);
+        tc.live_allocs.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    alloc_header* get_header(void* mem)
+    {
+        return (alloc_header*)((u8*)mem - sizeof(alloc_header));
+    }
+
+    // reports anything still live once static destruction reaches this translation unit
+    struct leak_reporter
+    {
+        ~leak_reporter()
+        {
+            pen::memory_report_leaks();
+        }
+    };
+    leak_reporter s_leak_reporter;
+} // namespace
+#endif
+
+namespace pen
+{
+#if PEN_MEMORY_TRACKING
+    void* memory_tracked_alloc(size_t size_bytes, size_t alignment)
+    {
+        // aligned allocs pad by their alignment so the user pointer stays aligned with the header in front
+        size_t pad = alignment > k_min_align ? alignment : k_min_align;
+
+        void* base = nullptr;
+#if PEN_MEMORY_SIZE_CLASSES
+        base = memory_sc_alloc(size_bytes + pad, pad);
+#else
+        PEN_MEM_ALIGN_ALLOC(base, pad, size_bytes + pad);
+#endif
+        if (!base)
+            return nullptr;
+
+        u8*           mem = (u8*)base + pad;
+        alloc_header* hdr = get_header(mem);
+        hdr->size = size_bytes;
+        hdr->tag = s_thread_tag;
+        hdr->offset = (u32)pad;
+
+        track_alloc(hdr->tag, size_bytes);
+        return mem;
+    }
+
+    void* memory_tracked_realloc(void* mem, size_t size_bytes)
+    {
+        if (!mem)
+            return memory_tracked_alloc(size_bytes, 0);
+
+        if (size_bytes == 0)
+        {
+            memory_tracked_free(mem);
+            return nullptr;
+        }
+
+        // base allocations are aligned so cannot be passed to realloc on all platforms
+        alloc_header* hdr = get_header(mem);
+        void*         new_mem = memory_tracked_alloc(size_bytes, 0);
+        if (new_mem)
+        {
+            memcpy(new_mem, mem, hdr->size < size_bytes ? hdr->size : size_bytes);
+            memory_tracked_free(mem);
+        }
+
+        return new_mem;
+    }
+
+    void memory_tracked_free(void* mem)
+    {
+        if (!mem)
+            return;
+
+        alloc_header* hdr = get_header(mem);
+        track_free(hdr->tag, hdr->size);
+
+#if PEN_MEMORY_SIZE_CLASSES
+        memory_sc_free((u8*)mem - hdr->offset);
+#else
+        PEN_MEM_ALIGN_FREE((u8*)mem - hdr->offset);
+#endif
+    }
+
+    mem_tag memory_set_thread_tag(mem_tag tag)
+    {
+        mem_tag prev = s_thread_tag;
+        s_thread_tag = tag;
+        return prev;
+    }
+
+    void memory_set_budget(mem_tag tag, size_t budget_bytes)
+    {
+        s_tags[tag].budget_bytes = budget_bytes;
+    }
+
+    void memory_get_tag_stats(mem_tag tag, memory_tag_stats& stats)
+    {
+        tag_counters& tc = s_tags[tag];
+        stats.live_bytes = tc.live_bytes.load(std::memory_order_relaxed);
+        stats.peak_bytes = tc.peak_bytes.load(std::memory_order_relaxed);
+        stats.budget_bytes = tc.budget_bytes.load(std::memory_order_relaxed);
+        stats.live_allocs = tc.live_allocs.load(std::memory_order_relaxed);
+        stats.frame_allocs = tc.last_frame_allocs.load(std::memory_order_relaxed);
+        stats.total_allocs = tc.total_allocs.load(std::memory_order_relaxed);
+    }
+
+    void memory_new_frame()
+    {
+        for (u32 i = 0; i < e_mem_tag::count; ++i)
+        {
+            tag_counters& tc = s_tags[i];
+            tc.last_frame_allocs = tc.frame_allocs.exchange(0, std::memory_order_relaxed);
+
+            // warn once each time a tag goes over budget
+            size_t budget = tc.budget_bytes.load(std::memory_order_relaxed);
+            size_t live = tc.live_bytes.load(std::memory_order_relaxed);
+            bool   over = budget && live > budget;
+            if (over && !tc.over_budget)
+            {
+                output_debug("[memory] %s over budget: %llu / %llu bytes", memory_tag_name((mem_tag)i),
+                             (unsigned long long)live, (unsigned long long)budget);
+            }
+            tc.over_budget = over;
+        }
+    }
+
+    void memory_report_leaks()
+    {
+        for (u32 i = 0; i < e_mem_tag::count; ++i)
+        {
+            tag_counters& tc = s_tags[i];
+            u32           live_allocs = tc.live_allocs.load(std::memory_order_relaxed);
+            if (live_allocs == 0)
+                continue;
+
+            output_debug("[memory] leak: %s has %u allocations, %llu bytes still live", memory_tag_name((mem_tag)i),
+                         live_allocs, (unsigned long long)tc.live_bytes.load(std::memory_order_relaxed));
+        }
+    }
+#else
+    mem_tag memory_set_thread_tag(mem_tag tag)
+    {
+        return e_mem_tag::general;
+    }
+
+    void memory_set_budget(mem_tag tag, size_t budget_bytes)
+    {
+    }
+
+    void memory_get_tag_stats(mem_tag tag, memory_tag_stats& stats)
+    {
+        memset(&stats, 0x0, sizeof(memory_tag_stats));
+    }
+
+    void memory_new_frame()
+    {
+    }
+
+    void memory_report_leaks()
+    {
+    }
+#endif
+
+    const c8* memory_tag_name(mem_tag tag)
+    {
+        static const c8* k_tag_names[] = {"general", "renderer", "ecs", "physics", "audio", "pmfx", "dev_ui"};
+        static_assert(PEN_ARRAY_SIZE(k_tag_names) == e_mem_tag::count, "mismatched tag names");
+        return k_tag_names[tag];
+    }
+} // namespace pen
 
 // C++ standard says these must be in cpp file and not inline in header ;_;
 
@@ -0,0 +1,857 @@
+// renderer_null.cpp
+// Copyright 2014 - 2019 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Headless backend, no device calls are made. Every pen::direct entry validates its handles against what the backend
+// has seen created, counts work per frame and optionally appends a record to the trace file.
+
+#include "renderer_null.h"
+#include "console.h"
+#include "data_struct.h"
+#include "memory.h"
+#include "renderer.h"
+#include "renderer_shared.h"
+#include "threads.h"
+
+#include <initializer_list>
+#include <stdio.h>
+#include <string.h>
+
+extern pen::window_creation_params pen_window;
+using namespace pen;
+
+namespace
+{
+    namespace e_null_res
+    {
+        enum null_res_t
+        {
+            none,
+            clear_state,
+            shader,
+            input_layout,
+            shader_program,
+            buffer,
+            texture,
+            sampler,
+            raster_state,
+            blend_state,
+            depth_stencil_state,
+            render_target,
+            COUNT
+        };
+    }
+    typedef e_null_res::null_res_t null_res;
+
+    const c8* k_null_res_names[] = {"none",    "clear_state",  "shader",      "input_layout",        "shader_program",
+                                    "buffer",  "texture",      "sampler",     "raster_state",        "blend_state",
+                                    "depth_stencil_state",     "render_target"};
+    static_assert(PEN_ARRAY_SIZE(k_null_res_names) == e_null_res::COUNT, "mismatched null resource names");
+
+    struct null_resource
+    {
+        u32 type;
+        u32 sub_type; // shader type or buffer bind flags
+        u32 size;     // buffer size in bytes
+        u32 width;
+        u32 height;
+        u32 format;
+        f32 clear_colour[4];
+    };
+
+    static const u32 k_max_units = 32;
+    static const u32 k_max_vertex_buffers = 8;
+    static const u32 k_max_shader_types = PEN_SHADER_TYPE_CS + 1;
+
+    struct null_state
+    {
+        u32 shader[k_max_shader_types];
+        u32 input_layout;
+        u32 vertex_buffer[k_max_vertex_buffers];
+        u32 index_buffer;
+        u32 constant_buffer[k_max_units];
+        u32 structured_buffer[k_max_units];
+        u32 texture[k_max_units];
+        u32 sampler[k_max_units];
+        u32 raster_state;
+        u32 blend_state;
+        u32 depth_stencil_state;
+        u32 stencil_ref;
+        u32 colour_target;
+        u32 depth_target;
+    };
+
+    res_pool<null_resource>   _res_pool;
+    null_state                s_state;
+    null_renderer_frame_stats s_frame;
+    null_renderer_frame_stats s_last_frame;
+    pen::mutex*               s_stats_mutex = nullptr;
+    renderer_info             s_renderer_info;
+    f32                       s_backbuffer_colour[4];
+
+    // trace
+    const c8* s_trace_filename = nullptr;
+    FILE*     s_trace_file = nullptr;
+    u8*       s_trace_buffer = nullptr;
+
+    void trace(null_trace_cmd cmd, u32 sub_type, std::initializer_list<u32> args)
+    {
+        if (!s_trace_file)
+            return;
+
+        null_trace_record rec;
+        rec.cmd = (u8)cmd;
+        rec.sub_type = (u8)sub_type;
+        rec.num_args = (u16)args.size();
+
+        u32 size = sizeof(rec) + rec.num_args * sizeof(u32);
+        u8* p = sb_add(s_trace_buffer, size);
+        memcpy(p, &rec, sizeof(rec));
+        p += sizeof(rec);
+
+        for (u32 a : args)
+        {
+            memcpy(p, &a, sizeof(u32));
+            p += sizeof(u32);
+        }
+    }
+
+    void trace_flush()
+    {
+        if (!s_trace_file || !s_trace_buffer)
+            return;
+
+        fwrite(s_trace_buffer, 1, sb_count(s_trace_buffer), s_trace_file);
+        fflush(s_trace_file);
+        stb__sbn(s_trace_buffer) = 0;
+    }
+
+    bool validate(u32 slot, null_res type, const c8* func)
+    {
+        if (slot < _res_pool._capacity && _res_pool[slot].type == type)
+            return true;
+
+        u32 actual = slot < _res_pool._capacity ? _res_pool[slot].type : e_null_res::none;
+        PEN_LOG("[null renderer] %s: slot %i is %s, expected %s", func, slot, k_null_res_names[actual],
+                k_null_res_names[type]);
+
+        s_frame.validation_errors++;
+        return false;
+    }
+
+    // 0 and PEN_INVALID_HANDLE unbind
+    bool validate_bind(u32 slot, null_res type, const c8* func)
+    {
+        if (!is_valid_non_null(slot))
+            return true;
+
+        return validate(slot, type, func);
+    }
+
+    void bind(u32& bound, u32 slot, null_res type)
+    {
+        if (bound == slot)
+        {
+            s_frame.redundant_state++;
+            return;
+        }
+
+        bound = slot;
+        s_frame.state_changes++;
+        trace(e_null_trace_cmd::bind, type, {slot});
+    }
+
+    null_resource& create(u32 slot, null_res type)
+    {
+        _res_pool.grow(slot);
+
+        null_resource& res = _res_pool[slot];
+        if (res.type != e_null_res::none)
+        {
+            PEN_LOG("[null renderer] create %s: slot %i is still in use as %s", k_null_res_names[type], slot,
+                    k_null_res_names[res.type]);
+            s_frame.validation_errors++;
+        }
+
+        memset(&res, 0x0, sizeof(null_resource));
+        res.type = type;
+
+        s_frame.resources_created++;
+        trace(e_null_trace_cmd::create, type, {slot});
+        return res;
+    }
+
+    void release(u32 slot, null_res type, const c8* func)
+    {
+        if (!validate(slot, type, func))
+            return;
+
+        _res_pool[slot].type = e_null_res::none;
+
+        s_frame.resources_released++;
+        trace(e_null_trace_cmd::release, type, {slot});
+    }
+
+    void upload(u32 bytes)
+    {
+        s_frame.bytes_uploaded += bytes;
+    }
+
+    void validate_draw(const c8* func)
+    {
+        if (!is_valid_non_null(s_state.shader[PEN_SHADER_TYPE_VS]))
+        {
+            PEN_LOG("[null renderer] %s: no vertex shader bound", func);
+            s_frame.validation_errors++;
+        }
+    }
+
+    void reset_state()
+    {
+        memset(&s_state, 0x0, sizeof(s_state));
+        s_state.colour_target = PEN_BACK_BUFFER_COLOUR;
+        s_state.depth_target = PEN_BACK_BUFFER_DEPTH;
+    }
+} // namespace
+
+namespace pen
+{
+    a_u64 g_gpu_total;
+
+    void null_renderer_set_trace_file(const c8* filename)
+    {
+        s_trace_filename = filename;
+    }
+
+    null_renderer_frame_stats null_renderer_get_frame_stats()
+    {
+        null_renderer_frame_stats stats = {};
+        if (!s_stats_mutex)
+            return stats;
+
+        pen::mutex_lock(s_stats_mutex);
+        stats = s_last_frame;
+        pen::mutex_unlock(s_stats_mutex);
+        return stats;
+    }
+
+    u32 direct::renderer_initialise(void*, u32 bb_res, u32 bb_depth_res)
+    {
+        _res_pool.init(2048);
+        s_stats_mutex = pen::mutex_create();
+
+        s_renderer_info.api_version = "null";
+        s_renderer_info.shader_version = renderer_get_shader_platform();
+        s_renderer_info.renderer = "headless";
+        s_renderer_info.vendor = "pmtech";
+        s_renderer_info.renderer_cmd = "-renderer null";
+
+        // claim everything, nothing is executed so any feature path can be validated
+        s_renderer_info.caps = PEN_CAPS_TEXTURE_MULTISAMPLE | PEN_CAPS_DEPTH_CLAMP | PEN_CAPS_COMPUTE |
+                               PEN_CAPS_TEXTURE_CUBE_ARRAY | PEN_CAPS_TEX_FORMAT_BC1 | PEN_CAPS_TEX_FORMAT_BC2 |
+                               PEN_CAPS_TEX_FORMAT_BC3 | PEN_CAPS_TEX_FORMAT_BC4 | PEN_CAPS_TEX_FORMAT_BC5 |
+                               PEN_CAPS_TEX_FORMAT_BC6 | PEN_CAPS_TEX_FORMAT_BC7;
+
+        if (renderer_viewport_vup())
+            s_renderer_info.caps |= PEN_CAPS_VUP;
+
+        if (s_trace_filename)
+        {
+            s_trace_file = fopen(s_trace_filename, "wb");
+            if (s_trace_file)
+            {
+                null_trace_header header = {k_null_trace_magic, k_null_trace_version};
+                fwrite(&header, sizeof(header), 1, s_trace_file);
+            }
+            else
+            {
+                PEN_LOG("[null renderer] failed to open trace file %s", s_trace_filename);
+            }
+        }
+
+        // backbuffer
+        null_resource& bb = create(bb_res, e_null_res::render_target);
+        bb.width = pen_window.width;
+        bb.height = pen_window.height;
+        bb.format = PEN_TEX_FORMAT_RGBA8_UNORM;
+
+        null_resource& bbd = create(bb_depth_res, e_null_res::render_target);
+        bbd.width = pen_window.width;
+        bbd.height = pen_window.height;
+        bbd.format = PEN_TEX_FORMAT_D24_UNORM_S8_UINT;
+
+        reset_state();
+        return PEN_ERR_OK;
+    }
+
+    void direct::renderer_shutdown()
+    {
+        trace_flush();
+
+        if (s_trace_file)
+            fclose(s_trace_file);
+
+        s_trace_file = nullptr;
+        sb_free(s_trace_buffer);
+        s_trace_buffer = nullptr;
+    }
+
+    const renderer_info& renderer_get_info()
+    {
+        return s_renderer_info;
+    }
+
+    const c8* renderer_get_shader_platform()
+    {
+        // use the shaders built for the host platform so pmfx and shader loading paths run as normal
+#if PEN_PLATFORM_WIN32
+        return "hlsl";
+#elif PEN_PLATFORM_OSX || PEN_PLATFORM_IOS
+        return "metal";
+#else
+        return "glsl";
+#endif
+    }
+
+    bool renderer_viewport_vup()
+    {
+#if PEN_PLATFORM_WIN32 || PEN_PLATFORM_OSX || PEN_PLATFORM_IOS
+        return false;
+#else
+        return true;
+#endif
+    }
+
+    bool renderer_depth_0_to_1()
+    {
+        return !renderer_viewport_vup();
+    }
+
+    void direct::renderer_sync()
+    {
+    }
+
+    void direct::renderer_retain()
+    {
+    }
+
+    void direct::renderer_new_frame()
+    {
+        _renderer_new_frame();
+        trace(e_null_trace_cmd::frame, 0, {(u32)_renderer_frame_index()});
+    }
+
+    void direct::renderer_end_frame()
+    {
+    }
+
+    void direct::renderer_present()
+    {
+        s_frame.frame = _renderer_frame_index();
+        s_frame.commands++;
+
+        if (s_trace_file)
+        {
+            // stats are packed as u32 args after the frame index
+            const null_renderer_frame_stats& f = s_frame;
+            trace(e_null_trace_cmd::present, 0,
+                  {(u32)f.frame, f.commands, f.draws, f.dispatches, f.state_changes, f.redundant_state,
+                   f.bytes_uploaded, f.resources_created, f.resources_released, f.validation_errors});
+            trace_flush();
+        }
+
+        pen::mutex_lock(s_stats_mutex);
+        s_last_frame = s_frame;
+        pen::mutex_unlock(s_stats_mutex);
+
+        memset(&s_frame, 0x0, sizeof(s_frame));
+        reset_state();
+
+        _renderer_end_frame();
+    }
+
+    // clears
+    void direct::renderer_create_clear_state(const clear_state& cs, u32 resource_slot)
+    {
+        s_frame.commands++;
+        null_resource& res = create(resource_slot, e_null_res::clear_state);
+        res.clear_colour[0] = cs.r;
+        res.clear_colour[1] = cs.g;
+        res.clear_colour[2] = cs.b;
+        res.clear_colour[3] = cs.a;
+        res.sub_type = cs.flags;
+    }
+
+    void direct::renderer_clear(u32 clear_state_index, u32 colour_slice, u32 depth_slice)
+    {
+        s_frame.commands++;
+        if (!validate(clear_state_index, e_null_res::clear_state, "clear"))
+            return;
+
+        const null_resource& cs = _res_pool[clear_state_index];
+        if (s_state.colour_target == PEN_BACK_BUFFER_COLOUR && (cs.sub_type & PEN_CLEAR_COLOUR_BUFFER))
+            memcpy(s_backbuffer_colour, cs.clear_colour, sizeof(s_backbuffer_colour));
+
+        trace(e_null_trace_cmd::clear, 0, {clear_state_index, colour_slice, depth_slice});
+    }
+
+    void direct::renderer_clear_texture(u32 clear_state_index, u32 texture)
+    {
+        s_frame.commands++;
+        validate(clear_state_index, e_null_res::clear_state, "clear_texture");
+        trace(e_null_trace_cmd::clear, 1, {clear_state_index, texture});
+    }
+
+    // shaders
+    void direct::renderer_load_shader(const pen::shader_load_params& params, u32 resource_slot)
+    {
+        s_frame.commands++;
+        null_resource& res = create(resource_slot, e_null_res::shader);
+        res.sub_type = params.type;
+        res.size = params.byte_code_size;
+    }
+
+    void direct::renderer_set_shader(u32 shader_index, u32 shader_type)
+    {
+        s_frame.commands++;
+        PEN_ASSERT(shader_type < k_max_shader_types);
+
+        if (validate_bind(shader_index, e_null_res::shader, "set_shader") && is_valid_non_null(shader_index))
+        {
+            u32 loaded_type = _res_pool[shader_index].sub_type;
+            if (loaded_type != shader_type)
+            {
+                PEN_LOG("[null renderer] set_shader: slot %i was loaded as type %i and bound as %i", shader_index,
+                        loaded_type, shader_type);
+                s_frame.validation_errors++;
+            }
+        }
+
+        bind(s_state.shader[shader_type], shader_index, e_null_res::shader);
+    }
+
+    void direct::renderer_create_input_layout(const input_layout_creation_params& params, u32 resource_slot)
+    {
+        s_frame.commands++;
+        null_resource& res = create(resource_slot, e_null_res::input_layout);
+        res.size = params.num_elements;
+    }
+
+    void direct::renderer_set_input_layout(u32 layout_index)
+    {
+        s_frame.commands++;
+        validate_bind(layout_index, e_null_res::input_layout, "set_input_layout");
+        bind(s_state.input_layout, layout_index, e_null_res::input_layout);
+    }
+
+    void direct::renderer_link_shader_program(const shader_link_params& params, u32 resource_slot)
+    {
+        s_frame.commands++;
+        if (is_valid_non_null(params.compute_shader))
+        {
+            validate(params.compute_shader, e_null_res::shader, "link_shader_program cs");
+        }
+        else
+        {
+            validate(params.vertex_shader, e_null_res::shader, "link_shader_program vs");
+            validate_bind(params.pixel_shader, e_null_res::shader, "link_shader_program ps");
+        }
+
+        create(resource_slot, e_null_res::shader_program);
+    }
+
+    // buffers
+    void direct::renderer_create_buffer(const buffer_creation_params& params, u32 resource_slot)
+    {
+        s_frame.commands++;
+        null_resource& res = create(resource_slot, e_null_res::buffer);
+        res.sub_type = params.bind_flags;
+        res.size = params.buffer_size;
+
+        if (params.data)
+            upload(params.buffer_size);
+    }
+
+    void direct::renderer_set_vertex_buffers(u32* buffer_indices, u32 num_buffers, u32 start_slot, const u32* strides,
+                                             const u32* offsets)
+    {
+        s_frame.commands++;
+        for (u32 i = 0; i < num_buffers; ++i)
+        {
+            u32 slot = start_slot + i;
+            if (slot >= k_max_vertex_buffers)
+                break;
+
+            validate_bind(buffer_indices[i], e_null_res::buffer, "set_vertex_buffers");
+            bind(s_state.vertex_buffer[slot], buffer_indices[i], e_null_res::buffer);
+        }
+    }
+
+    void direct::renderer_set_index_buffer(u32 buffer_index, u32 format, u32 offset)
+    {
+        s_frame.commands++;
+        validate_bind(buffer_index, e_null_res::buffer, "set_index_buffer");
+        bind(s_state.index_buffer, buffer_index, e_null_res::buffer);
+    }
+
+    void direct::renderer_set_constant_buffer(u32 buffer_index, u32 unit, u32 flags)
+    {
+        s_frame.commands++;
+        validate_bind(buffer_index, e_null_res::buffer, "set_constant_buffer");
+        bind(s_state.constant_buffer[unit % k_max_units], buffer_index, e_null_res::buffer);
+    }
+
+    void direct::renderer_set_structured_buffer(u32 buffer_index, u32 unit, u32 flags)
+    {
+        s_frame.commands++;
+        validate_bind(buffer_index, e_null_res::buffer, "set_structured_buffer");
+        bind(s_state.structured_buffer[unit % k_max_units], buffer_index, e_null_res::buffer);
+    }
+
+    void direct::renderer_update_buffer(u32 buffer_index, const void* data, u32 data_size, u32 offset)
+    {
+        s_frame.commands++;
+        if (!validate(buffer_index, e_null_res::buffer, "update_buffer"))
+            return;
+
+        const null_resource& res = _res_pool[buffer_index];
+        if (offset + data_size > res.size)
+        {
+            PEN_LOG("[null renderer] update_buffer: slot %i write of %i bytes at offset %i overflows size %i",
+                    buffer_index, data_size, offset, res.size);
+            s_frame.validation_errors++;
+        }
+
+        upload(data_size);
+        trace(e_null_trace_cmd::update, e_null_res::buffer, {buffer_index, data_size, offset});
+    }
+
+    // textures
+    void direct::renderer_create_texture(const texture_creation_params& tcp, u32 resource_slot)
+    {
+        s_frame.commands++;
+        null_resource& res = create(resource_slot, e_null_res::texture);
+        res.width = tcp.width;
+        res.height = tcp.height;
+        res.format = tcp.format;
+
+        if (tcp.data)
+            upload(tcp.data_size);
+    }
+
+    void direct::renderer_create_sampler(const sampler_creation_params& scp, u32 resource_slot)
+    {
+        s_frame.commands++;
+        create(resource_slot, e_null_res::sampler);
+    }
+
+    void direct::renderer_set_texture(u32 texture_index, u32 sampler_index, u32 unit, u32 bind_flags)
+    {
+        s_frame.commands++;
+        if (is_valid_non_null(texture_index))
+        {
+            u32 type = texture_index < _res_pool._capacity ? _res_pool[texture_index].type : e_null_res::none;
+            if (type != e_null_res::render_target)
+                validate(texture_index, e_null_res::texture, "set_texture");
+        }
+
+        validate_bind(sampler_index, e_null_res::sampler, "set_texture sampler");
+
+        unit %= k_max_units;
+        bind(s_state.texture[unit], texture_index, e_null_res::texture);
+        bind(s_state.sampler[unit], sampler_index, e_null_res::sampler);
+    }
+
+    // rasterizer
+    void direct::renderer_create_raster_state(const raster_state_creation_params& rscp, u32 resource_slot)
+    {
+        s_frame.commands++;
+        create(resource_slot, e_null_res::raster_state);
+    }
+
+    void direct::renderer_set_raster_state(u32 raster_state_index)
+    {
+        s_frame.commands++;
+        validate_bind(raster_state_index, e_null_res::raster_state, "set_raster_state");
+        bind(s_state.raster_state, raster_state_index, e_null_res::raster_state);
+    }
+
+    void direct::renderer_set_viewport(const viewport& vp)
+    {
+        s_frame.commands++;
+        s_frame.state_changes++;
+    }
+
+    void direct::renderer_set_scissor_rect(const rect& r)
+    {
+        s_frame.commands++;
+        s_frame.state_changes++;
+    }
+
+    // blending
+    void direct::renderer_create_blend_state(const blend_creation_params& bcp, u32 resource_slot)
+    {
+        s_frame.commands++;
+        create(resource_slot, e_null_res::blend_state);
+    }
+
+    void direct::renderer_set_blend_state(u32 blend_state_index)
+    {
+        s_frame.commands++;
+        validate_bind(blend_state_index, e_null_res::blend_state, "set_blend_state");
+        bind(s_state.blend_state, blend_state_index, e_null_res::blend_state);
+    }
+
+    // depth stencil state
+    void direct::renderer_create_depth_stencil_state(const depth_stencil_creation_params& dscp, u32 resource_slot)
+    {
+        s_frame.commands++;
+        create(resource_slot, e_null_res::depth_stencil_state);
+    }
+
+    void direct::renderer_set_depth_stencil_state(u32 depth_stencil_state)
+    {
+        s_frame.commands++;
+        validate_bind(depth_stencil_state, e_null_res::depth_stencil_state, "set_depth_stencil_state");
+        bind(s_state.depth_stencil_state, depth_stencil_state, e_null_res::depth_stencil_state);
+    }
+
+    void direct::renderer_set_stencil_ref(u8 ref)
+    {
+        s_frame.commands++;
+        bind(s_state.stencil_ref, ref, e_null_res::none);
+    }
+
+    // draw calls
+    void direct::renderer_draw(u32 vertex_count, u32 start_vertex, u32 primitive_topology)
+    {
+        s_frame.commands++;
+        s_frame.draws++;
+        validate_draw("draw");
+        trace(e_null_trace_cmd::draw, 0, {vertex_count, start_vertex, primitive_topology});
+    }
+
+    void direct::renderer_draw_indexed(u32 index_count, u32 start_index, u32 base_vertex, u32 primitive_topology)
+    {
+        s_frame.commands++;
+        s_frame.draws++;
+        validate_draw("draw_indexed");
+
+        if (!is_valid_non_null(s_state.index_buffer))
+        {
+            PEN_LOG("[null renderer] draw_indexed: no index buffer bound");
+            s_frame.validation_errors++;
+        }
+
+        trace(e_null_trace_cmd::draw, 1, {index_count, start_index, base_vertex, primitive_topology});
+    }
+
+    void direct::renderer_draw_indexed_instanced(u32 instance_count, u32 start_instance, u32 index_count, u32 start_index,
+                                                 u32 base_vertex, u32 primitive_topology)
+    {
+        s_frame.commands++;
+        s_frame.draws++;
+        validate_draw("draw_indexed_instanced");
+        trace(e_null_trace_cmd::draw, 2,
+              {instance_count, start_instance, index_count, start_index, base_vertex, primitive_topology});
+    }
+
+    void direct::renderer_draw_auto()
+    {
+        s_frame.commands++;
+        s_frame.draws++;
+        trace(e_null_trace_cmd::draw, 3, {});
+    }
+
+    void direct::renderer_dispatch_compute(uint3 grid, uint3 num_threads)
+    {
+        s_frame.commands++;
+        s_frame.dispatches++;
+
+        if (!is_valid_non_null(s_state.shader[PEN_SHADER_TYPE_CS]))
+        {
+            PEN_LOG("[null renderer] dispatch_compute: no compute shader bound");
+            s_frame.validation_errors++;
+        }
+
+        trace(e_null_trace_cmd::dispatch, 0, {grid.x, grid.y, grid.z, num_threads.x, num_threads.y, num_threads.z});
+    }
+
+    // render targets
+    void direct::renderer_create_render_target(const texture_creation_params& tcp, u32 resource_slot, bool track)
+    {
+        s_frame.commands++;
+        PEN_ASSERT(tcp.width != 0 && tcp.height != 0);
+
+        texture_creation_params _tcp = _renderer_tcp_resolve_ratio(tcp);
+
+        if (track)
+            _renderer_track_managed_render_target(tcp, resource_slot);
+
+        null_resource& res = create(resource_slot, e_null_res::render_target);
+        res.width = _tcp.width;
+        res.height = _tcp.height;
+        res.format = _tcp.format;
+    }
+
+    void direct::renderer_set_targets(const u32* const colour_targets, u32 num_colour_targets, u32 depth_target,
+                                      u32 colour_slice, u32 depth_slice)
+    {
+        s_frame.commands++;
+        for (u32 i = 0; i < num_colour_targets; ++i)
+            validate_bind(colour_targets[i], e_null_res::render_target, "set_targets colour");
+
+        validate_bind(depth_target, e_null_res::render_target, "set_targets depth");
+
+        u32 colour = num_colour_targets > 0 ? colour_targets[0] : PEN_INVALID_HANDLE;
+        bind(s_state.colour_target, colour, e_null_res::render_target);
+        bind(s_state.depth_target, depth_target, e_null_res::render_target);
+    }
+
+    void direct::renderer_set_resolve_targets(u32 colour_target, u32 depth_target)
+    {
+        s_frame.commands++;
+        validate_bind(colour_target, e_null_res::render_target, "set_resolve_targets colour");
+        validate_bind(depth_target, e_null_res::render_target, "set_resolve_targets depth");
+    }
+
+    void direct::renderer_set_stream_out_target(u32 buffer_index)
+    {
+        s_frame.commands++;
+        validate_bind(buffer_index, e_null_res::buffer, "set_stream_out_target");
+    }
+
+    void direct::renderer_resolve_target(u32 target, e_msaa_resolve_type type, resolve_resources res)
+    {
+        s_frame.commands++;
+        validate(target, e_null_res::render_target, "resolve_target");
+    }
+
+    // resource
+    void direct::renderer_read_back_resource(const resource_read_back_params& rrbp)
+    {
+        s_frame.commands++;
+
+        // nothing is rasterised, the backbuffer reads back as its last clear colour and other resources as zero
+        u8* data = (u8*)pen::memory_alloc(rrbp.data_size);
+        memset(data, 0x0, rrbp.data_size);
+
+        if (rrbp.resource_index == PEN_BACK_BUFFER_COLOUR && rrbp.block_size == 4)
+        {
+            u8 rgba[4];
+            for (u32 c = 0; c < 4; ++c)
+                rgba[c] = (u8)(min(max(s_backbuffer_colour[c], 0.0f), 1.0f) * 255.0f + 0.5f);
+
+            if (rrbp.format == PEN_TEX_FORMAT_BGRA8_UNORM)
+                std::swap(rgba[0], rgba[2]);
+
+            for (u32 i = 0; i + 4 <= rrbp.data_size; i += 4)
+                memcpy(&data[i], rgba, 4);
+        }
+        else if (rrbp.resource_index != PEN_BACK_BUFFER_COLOUR)
+        {
+            u32 type = rrbp.resource_index < _res_pool._capacity ? _res_pool[rrbp.resource_index].type : e_null_res::none;
+            if (type != e_null_res::render_target)
+                validate(rrbp.resource_index, e_null_res::texture, "read_back_resource");
+        }
+
+        rrbp.call_back_function(data, rrbp.row_pitch, rrbp.depth_pitch, rrbp.block_size);
+        pen::memory_free(data);
+    }
+
+    // perf
+    void direct::renderer_push_perf_marker(const c8* name)
+    {
+    }
+
+    void direct::renderer_pop_perf_marker()
+    {
+    }
+
+    // cleanup
+    void direct::renderer_replace_resource(u32 dest, u32 src, e_renderer_resource type)
+    {
+        s_frame.commands++;
+        switch (type)
+        {
+            case RESOURCE_TEXTURE:
+                release(dest, e_null_res::texture, "replace_resource texture");
+                break;
+            case RESOURCE_BUFFER:
+                release(dest, e_null_res::buffer, "replace_resource buffer");
+                break;
+            case RESOURCE_VERTEX_SHADER:
+            case RESOURCE_PIXEL_SHADER:
+                release(dest, e_null_res::shader, "replace_resource shader");
+                break;
+            case RESOURCE_RENDER_TARGET:
+                release(dest, e_null_res::render_target, "replace_resource render_target");
+                break;
+            default:
+                break;
+        }
+
+        _res_pool[dest] = _res_pool[src];
+    }
+
+    void direct::renderer_release_shader(u32 shader_index, u32 shader_type)
+    {
+        s_frame.commands++;
+        release(shader_index, e_null_res::shader, "release_shader");
+    }
+
+    void direct::renderer_release_clear_state(u32 clear_state)
+    {
+        s_frame.commands++;
+        release(clear_state, e_null_res::clear_state, "release_clear_state");
+    }
+
+    void direct::renderer_release_buffer(u32 buffer_index)
+    {
+        s_frame.commands++;
+        release(buffer_index, e_null_res::buffer, "release_buffer");
+    }
+
+    void direct::renderer_release_texture(u32 texture_index)
+    {
+        s_frame.commands++;
+        release(texture_index, e_null_res::texture, "release_texture");
+    }
+
+    void direct::renderer_release_sampler(u32 sampler)
+    {
+        s_frame.commands++;
+        release(sampler, e_null_res::sampler, "release_sampler");
+    }
+
+    void direct::renderer_release_raster_state(u32 raster_state_index)
+    {
+        s_frame.commands++;
+        release(raster_state_index, e_null_res::raster_state, "release_raster_state");
+    }
+
+    void direct::renderer_release_blend_state(u32 blend_state)
+    {
+        s_frame.commands++;
+        release(blend_state, e_null_res::blend_state, "release_blend_state");
+    }
+
+    void direct::renderer_release_render_target(u32 render_target)
+    {
+        s_frame.commands++;
+        _renderer_untrack_managed_render_target(render_target);
+        release(render_target, e_null_res::render_target, "release_render_target");
+    }
+
+    void direct::renderer_release_input_layout(u32 input_layout)
+    {
+        s_frame.commands++;
+        release(input_layout, e_null_res::input_layout, "release_input_layout");
+    }
+
+    void direct::renderer_release_depth_stencil_state(u32 depth_stencil_state)
+    {
+        s_frame.commands++;
+        release(depth_stencil_state, e_null_res::depth_stencil_state, "release_depth_stencil_state");
+    }
+} // namespace pen
@@ -72,6 +72,10 @@
 #define MAX_SHADER_TEXTURES 32
 #define INVALID_LOC 255
 
+#if defined(GL_MAP_PERSISTENT_BIT) && defined(GLEW_ARB_buffer_storage)
+#define PEN_GL_PERSISTENT_MAP 1
+#endif
+
 // these are required for platform specific gl implementation calls.
 extern void pen_make_gl_context_current();
 extern void pen_gl_swap_buffers();
@@ -772,7 +776,6 @@ namespace
     struct input_layout
     {
         vertex_attribute* attributes;
-        GLuint            vertex_array_handle = 0;
         GLuint            vb_handle = 0;
     };
 
@@ -830,11 +833,100 @@ namespace
         u32    cs;
         GLuint program;
         GLuint vflip_uniform;
+        f32    v_flip; // last value set, 0 until the first bind
         u8     uniform_block_location[MAX_UNIFORM_BUFFERS];
         u8     texture_location[MAX_SHADER_TEXTURES];
     };
     shader_program* s_shader_programs = nullptr;
 
+    // open addressed map of the shaders a program was linked from to its index in s_shader_programs
+    struct program_key
+    {
+        u32 vs;
+        u32 ps;
+        u32 so;
+        u32 cs;
+    };
+
+    struct program_lookup
+    {
+        program_key key;
+        u32         index; // PEN_INVALID_HANDLE for empty
+    };
+    program_lookup* s_program_lookup = nullptr;
+    u32             s_program_lookup_capacity = 0;
+    u32             s_program_lookup_count = 0;
+
+    // vertex array objects are cached per input layout and vertex buffer binding, so draws which repeat a binding
+    // only bind the vao instead of re-specifying every attribute
+    struct vao_key
+    {
+        u32 input_layout;
+        u32 num_buffers;
+        u32 base_vertex;
+        u32 buffer[MAX_VERTEX_BUFFERS]; // gl handles, names are reused so entries are evicted on release
+        u32 stride[MAX_VERTEX_BUFFERS];
+        u32 offset[MAX_VERTEX_BUFFERS];
+    };
+
+    struct vao_lookup
+    {
+        vao_key key;
+        GLuint  vao; // 0 for empty
+    };
+    vao_lookup* s_vao_lookup = nullptr;
+    u32         s_vao_lookup_capacity = 0;
+    u32         s_vao_lookup_count = 0;
+    vao_key     s_vao_binding = {}; // key of the currently bound vao
+
+    // webgl has no base vertex draws so base_vertex is baked into the attribute offsets and part of the key, every
+    // distinct base vertex drawn makes a new vao. the cache is trimmed when it reaches this many entries
+    static const u32 k_vao_lookup_max = 2048;
+
+    // shaders are compiled on first link, so programs which can be restored from the program cache never compile
+    struct shader_source
+    {
+        c8*     byte_code;
+        u32     byte_code_size;
+        hash_id hash;
+    };
+    shader_source* s_shader_sources = nullptr; // indexed by gl shader handle
+
+#if defined(GL_PROGRAM_BINARY_LENGTH) && !defined(PEN_WEBGL)
+#define PEN_GL_PROGRAM_BINARY 1
+#endif
+
+    // linked program binaries persist between runs keyed by a hash of the shader sources, entries are appended to
+    // the cache file as programs are linked and the whole cache is invalidated when the driver changes.
+    // records superseded by a later link or rejected by the driver are stale, the file is rewritten from memory once
+    // enough of them pile up
+    struct program_binary
+    {
+        hash_id hash;
+        u32     format;
+        u32     size;
+        void*   data; // nullptr once rejected by the driver
+    };
+
+    struct program_cache_header
+    {
+        u32     magic;
+        u32     version;
+        hash_id id_driver;
+    };
+
+    static const u32 k_program_cache_magic = 0x43504d50; // PMPC
+    static const u32 k_program_cache_version = 1;
+    static const u32 k_program_cache_max_stale = 32;
+
+    program_binary*      s_program_binaries = nullptr;
+    u32*                 s_program_binary_lookup = nullptr; // open addressed index into s_program_binaries by hash
+    u32                  s_program_binary_lookup_capacity = 0;
+    u32                  s_program_cache_stale = 0; // records in the file which are no longer used
+    program_cache_header s_program_cache_header;
+    Str                  s_program_cache_filename;
+    bool                 s_program_cache_enabled = false;
+
     struct gl_sampler : public sampler_creation_params
     {
         u32 min_filter;
@@ -848,6 +940,64 @@ namespace
         bool compare;
     };
 
+    // dynamic buffers are streamed: every update writes the next region of a larger gl buffer so the cpu never waits
+    // on the gpu reading an earlier update (matching d3d map discard). regions are recycled once the fence of the frame
+    // which wrote them has passed. with arb_buffer_storage the buffer is persistently mapped and grows when a frame
+    // uses every region, otherwise writes are unsynchronised and the buffer is orphaned when it wraps.
+    static const u32 k_stream_fences = 4;
+    static const u32 k_stream_initial_regions = 3;
+
+    struct stream_buffer
+    {
+        GLuint target;
+        u32    size;
+        u32    region_size; // size aligned to the uniform buffer offset alignment
+        u32    num_regions;
+        u32    region;       // region written by the last update
+        u64*   region_frame; // frame each region was last written in
+        u8*    mapped;       // persistent mapping, null when orphaning
+        u32    bound_units;  // mask of uniform buffer units bound to this buffer
+    };
+
+    struct stream_ctx
+    {
+        GLsync         fences[k_stream_fences] = {};
+        u64            frame = 1; // region_frame 0 is never in flight
+        u64            completed_frame = 0;
+        u32            alignment = 256;
+        bool           enabled = false;
+        bool           persistent = false;
+        stream_buffer* units[MAX_UNIFORM_BUFFERS] = {};
+    };
+    stream_ctx s_stream;
+
+    // read backs are copied into a pixel pack buffer and fenced, the callback is made once the fence has passed or the
+    // request has waited max_latency frames so the render thread does not stall waiting for the gpu to drain
+    struct read_back_buffer
+    {
+        GLuint pbo;
+        u32    size;
+    };
+
+    struct read_back_request
+    {
+        resource_read_back_params rrbp;
+        read_back_buffer          buffer;
+        GLsync                    fence;
+        u64                       frame;
+        bool                      flip;
+    };
+
+    read_back_request* s_read_backs = nullptr;
+    read_back_buffer*  s_read_back_pool = nullptr; // unused pack buffers
+    u64                s_read_back_frame = 0;
+
+    struct gl_buffer
+    {
+        GLuint         handle; // aliases resource_allocation::handle
+        stream_buffer* stream; // null unless the buffer is streamed
+    };
+
     struct resource_allocation
     {
         u8     asigned_flag;
@@ -859,6 +1009,7 @@ namespace
             depth_stencil_creation_params* depth_stencil;
             blend_creation_params*         blend_state;
             GLuint                         handle;
+            gl_buffer                      buffer;
             texture_info                   texture;
             ::render_target                render_target;
             ::shader_program*              shader_program;
@@ -888,78 +1039,858 @@ namespace
         u32  index_format = GL_UNSIGNED_SHORT;
         u32  depth_stencil_state;
         u8   stencil_ref;
+        u32  program = 0; // gl handles currently bound
+        u32  vao = 0;
     };
 
-    active_state  s_state;
-    active_state  s_live_state;
-    viewport      s_current_vp;
-    context_state s_ctx;
+    active_state  s_state;
+    active_state  s_live_state;
+    viewport      s_current_vp;
+    context_state s_ctx;
+
+    void _clear_resource_table()
+    {
+        // reserve resource 0 for NULL binding.
+        _res_pool[0].asigned_flag |= 0xff;
+    }
+
+    // support for gles to allow almost correct wireframe, by using line strip
+    u32 _gles_wireframe(u32 primitve_topology)
+    {
+        if (primitve_topology != GL_LINES && primitve_topology != GL_LINE_STRIP)
+            if (_res_pool[s_state.raster_state].raster_state.gles_wireframe)
+                return GL_LINE_STRIP;
+        return primitve_topology;
+    }
+#ifdef PEN_GLES3
+#define PEN_GLES_WIREFRAME_TOPOLOGY(pt) _gles_wireframe(pt)
+#else
+#define PEN_GLES_WIREFRAME_TOPOLOGY(pt) pt
+#endif
+
+    void _set_depth_stencil_state(u32 dss, u8 ref)
+    {
+        resource_allocation& res = _res_pool[dss];
+        if (!res.depth_stencil)
+            return;
+
+        // depth
+        if (res.depth_stencil->depth_enable)
+        {
+            CHECK_CALL(glEnable(GL_DEPTH_TEST));
+        }
+        else
+        {
+            CHECK_CALL(glDisable(GL_DEPTH_TEST));
+        }
+
+        CHECK_CALL(glDepthFunc(res.depth_stencil->depth_func));
+        CHECK_CALL(glDepthMask(res.depth_stencil->depth_write_mask));
+
+        // stencil
+        if (res.depth_stencil->stencil_enable)
+        {
+            CHECK_CALL(glEnable(GL_STENCIL_TEST));
+            CHECK_CALL(glStencilMask(res.depth_stencil->stencil_write_mask));
+
+            // front
+            CHECK_CALL(glStencilOpSeparate(GL_FRONT, res.depth_stencil->front_face.stencil_failop,
+                                           res.depth_stencil->front_face.stencil_depth_failop,
+                                           res.depth_stencil->front_face.stencil_passop));
+
+            CHECK_CALL(glStencilFuncSeparate(GL_FRONT, res.depth_stencil->front_face.stencil_func, ref,
+                                             res.depth_stencil->stencil_read_mask));
+
+            // back
+            CHECK_CALL(glStencilOpSeparate(GL_BACK, res.depth_stencil->back_face.stencil_failop,
+                                           res.depth_stencil->back_face.stencil_depth_failop,
+                                           res.depth_stencil->back_face.stencil_passop));
+
+            CHECK_CALL(glStencilFuncSeparate(GL_BACK, res.depth_stencil->back_face.stencil_func, ref,
+                                             res.depth_stencil->stencil_read_mask));
+        }
+        else
+        {
+            CHECK_CALL(glDisable(GL_STENCIL_TEST));
+        }
+    }
+
+    void _compile_shader_internal(GLuint handle)
+    {
+        if (handle >= (GLuint)sb_count(s_shader_sources) || !s_shader_sources[handle].byte_code)
+            return;
+
+        shader_source& src = s_shader_sources[handle];
+
+        CHECK_CALL(glShaderSource(handle, 1, (const c8**)&src.byte_code, (s32*)&src.byte_code_size));
+        CHECK_CALL(glCompileShader(handle));
+
+        // Check compilation status
+        GLint result = GL_FALSE;
+        int   info_log_length;
+
+        CHECK_CALL(glGetShaderiv(handle, GL_COMPILE_STATUS, &result));
+        CHECK_CALL(glGetShaderiv(handle, GL_INFO_LOG_LENGTH, &info_log_length));
+
+        if (info_log_length > 0)
+        {
+            // print line by line
+            char* lc = src.byte_code;
+            int   line = 2;
+            while (*lc != '\0')
+            {
+                Str str_line = "";
+
+                while (*lc != '\n' && *lc != '\0')
+                {
+                    str_line.append(*lc);
+                    ++lc;
+                }
+
+                PEN_LOG("%i: %s", line, str_line.c_str());
+                ++line;
+
+                if (*lc == '\0')
+                    break;
+
+                ++lc;
+
+                if (lc >= (src.byte_code + src.byte_code_size))
+                    break;
+            }
+
+            char* info_log_buf = (char*)memory_alloc(info_log_length + 1);
+
+            CHECK_CALL(glGetShaderInfoLog(handle, info_log_length, NULL, &info_log_buf[0]));
+            PEN_LOG(info_log_buf);
+
+            memory_free(info_log_buf);
+        }
+
+        memory_free(src.byte_code);
+        src.byte_code = nullptr;
+    }
+
+    void _attach_shader_internal(GLuint program_id, GLuint handle)
+    {
+        _compile_shader_internal(handle);
+        CHECK_CALL(glAttachShader(program_id, handle));
+    }
+
+    hash_id _shader_source_hash(GLuint handle)
+    {
+        if (handle == 0 || handle >= (GLuint)sb_count(s_shader_sources))
+            return 0;
+
+        return s_shader_sources[handle].hash;
+    }
+
+    hash_id _program_cache_key(u32 vs, u32 ps, u32 so, u32 cs, const shader_link_params* params)
+    {
+        hash_murmur hm;
+        hm.begin();
+        hm.add(_shader_source_hash(vs));
+        hm.add(_shader_source_hash(ps));
+        hm.add(_shader_source_hash(so));
+        hm.add(_shader_source_hash(cs));
+
+        if (params && so)
+            for (u32 i = 0; i < params->num_stream_out_names; ++i)
+                hm.add(params->stream_out_names[i], string_length(params->stream_out_names[i]));
+
+        return hm.end();
+    }
+
+    u32* _program_binary_slot(hash_id key)
+    {
+        u32 mask = s_program_binary_lookup_capacity - 1;
+        for (u32 i = key & mask;; i = (i + 1) & mask)
+        {
+            u32& slot = s_program_binary_lookup[i];
+            if (slot == PEN_INVALID_HANDLE || s_program_binaries[slot].hash == key)
+                return &slot;
+        }
+    }
+
+    program_binary* _program_binary_find(hash_id key)
+    {
+        if (s_program_binary_lookup_capacity == 0)
+            return nullptr;
+
+        u32 index = *_program_binary_slot(key);
+        if (index == PEN_INVALID_HANDLE)
+            return nullptr;
+
+        return &s_program_binaries[index];
+    }
+
+    void _program_binary_insert(const program_binary& pb)
+    {
+        u32 num_binaries = sb_count(s_program_binaries);
+        if ((num_binaries + 1) * 2 > s_program_binary_lookup_capacity)
+        {
+            memory_free(s_program_binary_lookup);
+
+            s_program_binary_lookup_capacity = std::max<u32>(s_program_binary_lookup_capacity * 2, 64);
+            s_program_binary_lookup = (u32*)memory_alloc(s_program_binary_lookup_capacity * sizeof(u32));
+            memset(s_program_binary_lookup, 0xff, s_program_binary_lookup_capacity * sizeof(u32));
+
+            for (u32 i = 0; i < num_binaries; ++i)
+                *_program_binary_slot(s_program_binaries[i].hash) = i;
+        }
+
+        u32* slot = _program_binary_slot(pb.hash);
+        if (*slot == PEN_INVALID_HANDLE)
+        {
+            *slot = num_binaries;
+            sb_push(s_program_binaries, pb);
+            return;
+        }
+
+        // a later record for the same key replaces the earlier one, which is left behind in the file
+        program_binary& existing = s_program_binaries[*slot];
+        if (existing.data)
+        {
+            memory_free(existing.data);
+            s_program_cache_stale++;
+        }
+
+        existing = pb;
+    }
+
+    void _program_cache_write()
+    {
+        FILE* fp = fopen(s_program_cache_filename.c_str(), "wb");
+        if (!fp)
+            return;
+
+        fwrite(&s_program_cache_header, sizeof(program_cache_header), 1, fp);
+
+        u32 num_binaries = sb_count(s_program_binaries);
+        for (u32 i = 0; i < num_binaries; ++i)
+        {
+            program_binary& pb = s_program_binaries[i];
+            if (!pb.data)
+                continue;
+
+            fwrite(&pb.hash, sizeof(u32), 1, fp);
+            fwrite(&pb.format, sizeof(u32), 1, fp);
+            fwrite(&pb.size, sizeof(u32), 1, fp);
+            fwrite(pb.data, 1, pb.size, fp);
+        }
+
+        fclose(fp);
+        s_program_cache_stale = 0;
+    }
+
+    void _program_cache_init(const Str& driver)
+    {
+#if PEN_GL_PROGRAM_BINARY
+        GLint num_formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+        if (num_formats <= 0)
+            return;
+
+        s_program_cache_enabled = true;
+        s_program_cache_filename = pen::window_get_title();
+        s_program_cache_filename.append("_program_cache.bin");
+
+        s_program_cache_header = {k_program_cache_magic, k_program_cache_version, PEN_HASH(driver.c_str())};
+
+        FILE* fp = fopen(s_program_cache_filename.c_str(), "rb");
+        if (fp)
+        {
+            program_cache_header header = {};
+
+            bool valid = fread(&header, sizeof(header), 1, fp) == 1;
+            valid &= memcmp(&header, &s_program_cache_header, sizeof(program_cache_header)) == 0;
+
+            while (valid)
+            {
+                program_binary pb;
+                if (fread(&pb.hash, sizeof(u32), 1, fp) != 1 || fread(&pb.format, sizeof(u32), 1, fp) != 1 ||
+                    fread(&pb.size, sizeof(u32), 1, fp) != 1)
+                    break;
+
+                pb.data = memory_alloc(pb.size);
+                if (fread(pb.data, 1, pb.size, fp) != pb.size)
+                {
+                    // truncated record, appending after it would misalign everything that follows
+                    memory_free(pb.data);
+                    s_program_cache_stale++;
+                    break;
+                }
+
+                _program_binary_insert(pb);
+            }
+
+            fclose(fp);
+
+            if (valid && s_program_cache_stale == 0)
+                return;
+        }
+
+        // new cache, the driver changed and the old binaries are no longer valid, or stale records to compact
+        _program_cache_write();
+#endif
+    }
+
+    bool _program_cache_restore(GLuint program_id, hash_id key)
+    {
+#if PEN_GL_PROGRAM_BINARY
+        if (!s_program_cache_enabled)
+            return false;
+
+        program_binary* pb = _program_binary_find(key);
+        if (!pb || !pb->data)
+            return false;
+
+        CHECK_CALL(glProgramBinary(program_id, pb->format, pb->data, pb->size));
+
+        // binaries can be rejected by the driver, fall back to a full compile and link
+        GLint result = GL_FALSE;
+        CHECK_CALL(glGetProgramiv(program_id, GL_LINK_STATUS, &result));
+        if (result == GL_TRUE)
+            return true;
+
+        memory_free(pb->data);
+        pb->data = nullptr;
+        pb->size = 0;
+        s_program_cache_stale++;
+#endif
+        return false;
+    }
+
+    void _program_cache_store(GLuint program_id, hash_id key)
+    {
+#if PEN_GL_PROGRAM_BINARY
+        if (!s_program_cache_enabled)
+            return;
+
+        GLint size = 0;
+        CHECK_CALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &size));
+        if (size <= 0)
+            return;
+
+        program_binary pb;
+        pb.hash = key;
+        pb.size = (u32)size;
+        pb.data = memory_alloc(pb.size);
+
+        GLenum format = 0;
+        CHECK_CALL(glGetProgramBinary(program_id, size, nullptr, &format, pb.data));
+        pb.format = format;
+
+        _program_binary_insert(pb);
+
+        if (s_program_cache_stale >= k_program_cache_max_stale)
+        {
+            _program_cache_write();
+            return;
+        }
+
+        FILE* fp = fopen(s_program_cache_filename.c_str(), "ab");
+        if (fp)
+        {
+            fwrite(&pb.hash, sizeof(u32), 1, fp);
+            fwrite(&pb.format, sizeof(u32), 1, fp);
+            fwrite(&pb.size, sizeof(u32), 1, fp);
+            fwrite(pb.data, 1, pb.size, fp);
+            fclose(fp);
+        }
+#endif
+    }
+
+    program_key _program_key(u32 vs, u32 ps, u32 so, u32 cs)
+    {
+        // stream out and compute programs are identified by their so or cs shader alone
+        if (so)
+            return {0, 0, so, 0};
+
+        if (cs)
+            return {0, 0, 0, cs};
+
+        return {vs, ps, 0, 0};
+    }
+
+    program_lookup* _program_lookup_slot(const program_key& key)
+    {
+        u32 mask = s_program_lookup_capacity - 1;
+        for (u32 i = PEN_HASH(key) & mask;; i = (i + 1) & mask)
+        {
+            program_lookup& pl = s_program_lookup[i];
+            if (pl.index == PEN_INVALID_HANDLE || memcmp(&pl.key, &key, sizeof(program_key)) == 0)
+                return &pl;
+        }
+    }
+
+    void _program_lookup_insert(const program_key& key, u32 index)
+    {
+        if ((s_program_lookup_count + 1) * 2 > s_program_lookup_capacity)
+        {
+            program_lookup* old = s_program_lookup;
+            u32             old_capacity = s_program_lookup_capacity;
+
+            s_program_lookup_capacity = std::max<u32>(old_capacity * 2, 64);
+            s_program_lookup = (program_lookup*)memory_alloc(s_program_lookup_capacity * sizeof(program_lookup));
+            memset(s_program_lookup, 0xff, s_program_lookup_capacity * sizeof(program_lookup));
+
+            for (u32 i = 0; i < old_capacity; ++i)
+                if (old[i].index != PEN_INVALID_HANDLE)
+                    *_program_lookup_slot(old[i].key) = old[i];
+
+            memory_free(old);
+        }
+
+        program_lookup* pl = _program_lookup_slot(key);
+        if (pl->index == PEN_INVALID_HANDLE)
+            s_program_lookup_count++;
+
+        // later links replace earlier ones, an explicit link with reflection info replaces an on the fly one
+        pl->key = key;
+        pl->index = index;
+    }
+
+    shader_program* _program_lookup_find(u32 vs, u32 ps, u32 so, u32 cs)
+    {
+        if (s_program_lookup_count == 0)
+            return nullptr;
+
+        program_lookup* pl = _program_lookup_slot(_program_key(vs, ps, so, cs));
+        if (pl->index == PEN_INVALID_HANDLE)
+            return nullptr;
+
+        return &s_shader_programs[pl->index];
+    }
+
+    void _program_lookup_evict_shader(GLuint shader)
+    {
+        if (s_program_lookup_count == 0)
+            return;
+
+        // shader names are reused once deleted, so programs linked from them must not be found again, failed links
+        // no longer know their shaders and are dropped too, they will be re-linked on demand
+        u32 num_programs = sb_count(s_shader_programs);
+        for (u32 i = 0; i < num_programs; ++i)
+        {
+            shader_program& sp = s_shader_programs[i];
+            if (!sp.program)
+                continue;
+
+            bool failed = !sp.vs && !sp.ps && !sp.so && !sp.cs;
+            if (!failed && sp.vs != shader && sp.ps != shader && sp.so != shader && sp.cs != shader)
+                continue;
+
+            if (s_state.program == sp.program)
+                s_state.program = 0;
+
+            CHECK_CALL(glDeleteProgram(sp.program));
+            sp = {};
+        }
+
+        // rebuild without the deleted programs
+        memset(s_program_lookup, 0xff, s_program_lookup_capacity * sizeof(program_lookup));
+        s_program_lookup_count = 0;
+
+        for (u32 i = 0; i < num_programs; ++i)
+        {
+            shader_program& sp = s_shader_programs[i];
+            if (sp.program)
+                _program_lookup_insert(_program_key(sp.vs, sp.ps, sp.so, sp.cs), i);
+        }
+    }
+
+    void _use_program(GLuint program)
+    {
+        if (s_state.program == program)
+            return;
+
+        CHECK_CALL(glUseProgram(program));
+        s_state.program = program;
+    }
+
+    vao_lookup* _vao_lookup_slot(const vao_key& key)
+    {
+        u32 mask = s_vao_lookup_capacity - 1;
+        for (u32 i = PEN_HASH(key) & mask;; i = (i + 1) & mask)
+        {
+            vao_lookup& vl = s_vao_lookup[i];
+            if (vl.vao == 0 || memcmp(&vl.key, &key, sizeof(vao_key)) == 0)
+                return &vl;
+        }
+    }
+
+    void _vao_lookup_grow()
+    {
+        vao_lookup* old = s_vao_lookup;
+        u32         old_capacity = s_vao_lookup_capacity;
+
+        s_vao_lookup_capacity = std::max<u32>(old_capacity * 2, 256);
+        s_vao_lookup = (vao_lookup*)memory_calloc(s_vao_lookup_capacity, sizeof(vao_lookup));
+
+        for (u32 i = 0; i < old_capacity; ++i)
+            if (old[i].vao)
+                *_vao_lookup_slot(old[i].key) = old[i];
+
+        memory_free(old);
+    }
+
+    template <typename T>
+    void _vao_lookup_remove(T match)
+    {
+        u32 evicted = 0;
+        for (u32 i = 0; i < s_vao_lookup_capacity; ++i)
+        {
+            vao_lookup& vl = s_vao_lookup[i];
+            if (!vl.vao || !match(vl.key))
+                continue;
+
+            if (s_state.vao == vl.vao)
+            {
+                CHECK_CALL(glBindVertexArray(0));
+                s_state.vao = 0;
+            }
+
+            CHECK_CALL(glDeleteVertexArrays(1, &vl.vao));
+            vl.vao = 0;
+            evicted++;
+        }
+
+        if (evicted == 0)
+            return;
+
+        // re-insert the remainder so probe sequences are not broken by the holes
+        vao_lookup* old = s_vao_lookup;
+        s_vao_lookup = (vao_lookup*)memory_calloc(s_vao_lookup_capacity, sizeof(vao_lookup));
+
+        for (u32 i = 0; i < s_vao_lookup_capacity; ++i)
+            if (old[i].vao)
+                *_vao_lookup_slot(old[i].key) = old[i];
+
+        memory_free(old);
+        s_vao_lookup_count -= evicted;
+    }
+
+    void _vao_lookup_evict(u32 input_layout, GLuint buffer)
+    {
+        // deleted buffer names are reused and a vao keeps the old buffer alive, so drop any vao which references it
+        _vao_lookup_remove([=](const vao_key& key) {
+            bool match = input_layout && key.input_layout == input_layout;
+            for (u32 b = 0; b < key.num_buffers; ++b)
+                match |= buffer && key.buffer[b] == buffer;
+
+            return match;
+        });
+    }
+
+    void _vao_lookup_trim()
+    {
+        // base vertex entries are the ones which multiply, if the cache is still mostly full start again
+        _vao_lookup_remove([](const vao_key& key) { return key.base_vertex != 0; });
+
+        if (s_vao_lookup_count * 2 >= k_vao_lookup_max)
+            _vao_lookup_remove([](const vao_key&) { return true; });
+    }
+
+    void _wait_sync(GLsync fence)
+    {
+        for (;;)
+        {
+            GLenum r = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            if (r != GL_TIMEOUT_EXPIRED)
+                break;
+        }
+    }
+
+    bool _sync_passed(GLsync fence)
+    {
+        GLenum r = glClientWaitSync(fence, 0, 0);
+        return r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED;
+    }
+
+    void _stream_wait(u64 frame)
+    {
+        // fences complete in order so waiting on a frame completes all before it
+        while (s_stream.completed_frame < frame)
+        {
+            u64     f = s_stream.completed_frame + 1;
+            GLsync& fence = s_stream.fences[f % k_stream_fences];
+
+            if (fence)
+            {
+                _wait_sync(fence);
+                CHECK_CALL(glDeleteSync(fence));
+                fence = nullptr;
+            }
+
+            s_stream.completed_frame = f;
+        }
+    }
+
+    void _stream_end_frame()
+    {
+        // keep at most k_stream_fences frames in flight, slot is still in use by the frame k_stream_fences ago
+        u32 fi = s_stream.frame % k_stream_fences;
+        if (s_stream.fences[fi])
+            _stream_wait(s_stream.frame - k_stream_fences);
+
+        s_stream.fences[fi] = CHECK_CALL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+        // retire frames which have already passed without blocking
+        while (s_stream.completed_frame < s_stream.frame)
+        {
+            GLsync& fence = s_stream.fences[(s_stream.completed_frame + 1) % k_stream_fences];
+            if (fence)
+            {
+                if (!_sync_passed(fence))
+                    break;
+
+                CHECK_CALL(glDeleteSync(fence));
+                fence = nullptr;
+            }
+
+            s_stream.completed_frame++;
+        }
+
+        s_stream.frame++;
+    }
+
+    void _stream_storage(stream_buffer* sb, GLuint& handle)
+    {
+        u32 capacity = sb->region_size * sb->num_regions;
+
+        CHECK_CALL(glGenBuffers(1, &handle));
+        CHECK_CALL(glBindBuffer(sb->target, handle));
+
+        sb->mapped = nullptr;
+
+#if PEN_GL_PERSISTENT_MAP
+        if (s_stream.persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            CHECK_CALL(glBufferStorage(sb->target, capacity, nullptr, flags));
+            sb->mapped = (u8*)CHECK_CALL(glMapBufferRange(sb->target, 0, capacity, flags));
+        }
+        else
+#endif
+        {
+            CHECK_CALL(glBufferData(sb->target, capacity, nullptr, GL_STREAM_DRAW));
+        }
+
+        for (u32 i = 0; i < sb->num_regions; ++i)
+            sb->region_frame[i] = 0;
+    }
+
+    u32 _stream_offset(const resource_allocation& res)
+    {
+        stream_buffer* sb = res.buffer.stream;
+        if (!sb)
+            return 0;
+
+        return sb->region * sb->region_size;
+    }
+
+    void _stream_bind_unit(u32 unit, const resource_allocation* res)
+    {
+        stream_buffer*& bound = s_stream.units[unit];
+        if (bound)
+            bound->bound_units &= ~(1u << unit);
+
+        bound = res ? res->buffer.stream : nullptr;
+        if (!bound)
+            return;
+
+        bound->bound_units |= 1u << unit;
+        CHECK_CALL(glBindBufferRange(GL_UNIFORM_BUFFER, unit, res->handle, _stream_offset(*res), bound->size));
+    }
+
+    void _stream_create(resource_allocation& res, GLuint target, u32 size)
+    {
+        stream_buffer* sb = (stream_buffer*)memory_alloc(sizeof(stream_buffer));
+        sb->target = target;
+        sb->size = size;
+        sb->region_size = (size + s_stream.alignment - 1) & ~(s_stream.alignment - 1);
+        sb->num_regions = k_stream_initial_regions;
+        sb->region = 0;
+        sb->region_frame = nullptr;
+        sb->bound_units = 0;
+        sb_add(sb->region_frame, sb->num_regions);
+
+        _stream_storage(sb, res.buffer.handle);
+        res.buffer.stream = sb;
+    }
+
+    void _stream_update(resource_allocation& res, const void* data, u32 data_size, u32 offset)
+    {
+        stream_buffer* sb = res.buffer.stream;
+        PEN_ASSERT(offset + data_size <= sb->size);
+
+        u32 next = (sb->region + 1) % sb->num_regions;
+        u64 written = sb->region_frame[next];
+
+        if (written > s_stream.completed_frame)
+        {
+            if (!sb->mapped)
+            {
+                // orphan, the driver keeps the old storage alive for the gpu and hands us fresh memory
+                CHECK_CALL(glBindBuffer(sb->target, res.handle));
+                CHECK_CALL(glBufferData(sb->target, sb->region_size * sb->num_regions, nullptr, GL_STREAM_DRAW));
+
+                for (u32 i = 0; i < sb->num_regions; ++i)
+                    sb->region_frame[i] = 0;
+
+                next = 0;
+            }
+            else if (written == s_stream.frame)
+            {
+                // every region has been written this frame, double up. the old buffer can be deleted while the gpu
+                // still reads it but its name may be reused so drop any vertex arrays which reference it
+                GLuint old = res.handle;
+                _vao_lookup_evict(0, old);
+                CHECK_CALL(glDeleteBuffers(1, &old));
+
+                sb_add(sb->region_frame, sb->num_regions);
+                sb->num_regions *= 2;
+
+                _stream_storage(sb, res.buffer.handle);
+                next = 0;
+            }
+            else
+            {
+                _stream_wait(written);
+            }
+        }
+
+        sb->region = next;
+        sb->region_frame[next] = s_stream.frame;
+
+        u32 region_offset = next * sb->region_size;
+        if (sb->mapped)
+        {
+            memcpy(sb->mapped + region_offset + offset, data, data_size);
+        }
+        else
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+
+            CHECK_CALL(glBindBuffer(sb->target, res.handle));
+            void* mapped_data = CHECK_CALL(glMapBufferRange(sb->target, region_offset + offset, data_size, flags));
+
+            if (mapped_data)
+                memcpy(mapped_data, data, data_size);
+
+            CHECK_CALL(glUnmapBuffer(sb->target));
+        }
+
+        // bindings persist across updates as they do with d3d, so move any bound ranges on to the new region
+        for (u32 unit = 0; sb->bound_units && unit < MAX_UNIFORM_BUFFERS; ++unit)
+        {
+            if (sb->bound_units & (1u << unit))
+            {
+                CHECK_CALL(glBindBufferRange(GL_UNIFORM_BUFFER, unit, res.handle, region_offset, sb->size));
+            }
+        }
+    }
 
-    void _clear_resource_table()
+    void _stream_release(resource_allocation& res)
     {
-        // reserve resource 0 for NULL binding.
-        _res_pool[0].asigned_flag |= 0xff;
+        stream_buffer* sb = res.buffer.stream;
+        if (!sb)
+            return;
+
+        for (u32 i = 0; i < MAX_UNIFORM_BUFFERS; ++i)
+            if (s_stream.units[i] == sb)
+                s_stream.units[i] = nullptr;
+
+        sb_free(sb->region_frame);
+        memory_free(sb);
+        res.buffer.stream = nullptr;
     }
 
-    // support for gles to allow almost correct wireframe, by using line strip
-    u32 _gles_wireframe(u32 primitve_topology)
+    read_back_buffer _read_back_alloc(u32 size)
     {
-        if (primitve_topology != GL_LINES && primitve_topology != GL_LINE_STRIP)
-            if (_res_pool[s_state.raster_state].raster_state.gles_wireframe)
-                return GL_LINE_STRIP;
-        return primitve_topology;
+        u32 num_free = sb_count(s_read_back_pool);
+        for (u32 i = 0; i < num_free; ++i)
+        {
+            if (s_read_back_pool[i].size < size)
+                continue;
+
+            read_back_buffer rbb = s_read_back_pool[i];
+            s_read_back_pool[i] = s_read_back_pool[num_free - 1];
+            stb__sbn(s_read_back_pool)--;
+            return rbb;
+        }
+
+        read_back_buffer rbb;
+        rbb.size = size;
+
+        CHECK_CALL(glGenBuffers(1, &rbb.pbo));
+        CHECK_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, rbb.pbo));
+        CHECK_CALL(glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ));
+
+        return rbb;
     }
-#ifdef PEN_GLES3
-#define PEN_GLES_WIREFRAME_TOPOLOGY(pt) _gles_wireframe(pt)
-#else
-#define PEN_GLES_WIREFRAME_TOPOLOGY(pt) pt
-#endif
 
-    void _set_depth_stencil_state(u32 dss, u8 ref)
+    void _read_back_complete(read_back_request& rb)
     {
-        resource_allocation& res = _res_pool[dss];
-        if (!res.depth_stencil)
-            return;
+        // blocks if the request has run out of latency before the gpu got to it
+        _wait_sync(rb.fence);
+        CHECK_CALL(glDeleteSync(rb.fence));
 
-        // depth
-        if (res.depth_stencil->depth_enable)
+        const resource_read_back_params& rrbp = rb.rrbp;
+
+        CHECK_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.buffer.pbo));
+        u8* data = (u8*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rrbp.data_size, GL_MAP_READ_BIT);
+
+        if (data && rb.flip)
         {
-            CHECK_CALL(glEnable(GL_DEPTH_TEST));
+            // back buffer rows are bottom up
+            u8* flipped = (u8*)memory_alloc(rrbp.data_size);
+            u8* flip_pos = flipped + rrbp.depth_pitch - rrbp.row_pitch;
+            u8* data_pos = data;
+            for (u32 i = 0; i < rrbp.depth_pitch; i += rrbp.row_pitch)
+            {
+                memcpy(flip_pos, data_pos, rrbp.row_pitch);
+                flip_pos -= rrbp.row_pitch;
+                data_pos += rrbp.row_pitch;
+            }
+
+            rrbp.call_back_function(flipped, rrbp.row_pitch, rrbp.depth_pitch, rrbp.block_size);
+            memory_free(flipped);
         }
-        else
+        else if (data)
         {
-            CHECK_CALL(glDisable(GL_DEPTH_TEST));
+            rrbp.call_back_function(data, rrbp.row_pitch, rrbp.depth_pitch, rrbp.block_size);
         }
-
-        CHECK_CALL(glDepthFunc(res.depth_stencil->depth_func));
-        CHECK_CALL(glDepthMask(res.depth_stencil->depth_write_mask));
-
-        // stencil
-        if (res.depth_stencil->stencil_enable)
+        else
         {
-            CHECK_CALL(glEnable(GL_STENCIL_TEST));
-            CHECK_CALL(glStencilMask(res.depth_stencil->stencil_write_mask));
+            PEN_LOG("read back of resource %i failed to map", rrbp.resource_index);
+        }
 
-            // front
-            CHECK_CALL(glStencilOpSeparate(GL_FRONT, res.depth_stencil->front_face.stencil_failop,
-                                           res.depth_stencil->front_face.stencil_depth_failop,
-                                           res.depth_stencil->front_face.stencil_passop));
+        CHECK_CALL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        CHECK_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
 
-            CHECK_CALL(glStencilFuncSeparate(GL_FRONT, res.depth_stencil->front_face.stencil_func, ref,
-                                             res.depth_stencil->stencil_read_mask));
+        sb_push(s_read_back_pool, rb.buffer);
+    }
 
-            // back
-            CHECK_CALL(glStencilOpSeparate(GL_BACK, res.depth_stencil->back_face.stencil_failop,
-                                           res.depth_stencil->back_face.stencil_depth_failop,
-                                           res.depth_stencil->back_face.stencil_passop));
+    void _read_back_end_frame()
+    {
+        s_read_back_frame++;
 
-            CHECK_CALL(glStencilFuncSeparate(GL_BACK, res.depth_stencil->back_face.stencil_func, ref,
-                                             res.depth_stencil->stencil_read_mask));
-        }
-        else
+        u32 num_requests = sb_count(s_read_backs);
+        u32 pending = 0;
+        for (u32 i = 0; i < num_requests; ++i)
         {
-            CHECK_CALL(glDisable(GL_STENCIL_TEST));
+            read_back_request& rb = s_read_backs[i];
+
+            if (_sync_passed(rb.fence) || s_read_back_frame - rb.frame >= rb.rrbp.max_latency)
+                _read_back_complete(rb);
+            else
+                s_read_backs[pending++] = rb;
         }
+
+        if (s_read_backs)
+            stb__sbn(s_read_backs) = pending;
     }
 
     u32 _link_program_internal(u32 vs, u32 ps, u32 cs, const shader_link_params* params = nullptr)
@@ -970,44 +1901,58 @@ namespace
 
         if (params)
         {
-            // this path is for a proper link with reflection info
             vs = _res_pool[params->vertex_shader].handle;
             ps = _res_pool[params->pixel_shader].handle;
             so = _res_pool[params->stream_out_shader].handle;
+        }
 
-            if (vs)
-            {
-                CHECK_CALL(glAttachShader(program_id, vs));
-            }
-
-            if (ps)
-            {
-                CHECK_CALL(glAttachShader(program_id, ps));
-            }
+        program_key lookup_key = _program_key(vs, ps, so, cs);
+        hash_id     cache_key = _program_cache_key(vs, ps, so, cs, params);
+        bool        restored = _program_cache_restore(program_id, cache_key);
 
-            if (so)
-            {
-                CHECK_CALL(glAttachShader(program_id, so));
-                CHECK_CALL(glTransformFeedbackVaryings(program_id, params->num_stream_out_names,
-                                                       (const c8**)params->stream_out_names, GL_INTERLEAVED_ATTRIBS));
-            }
-        }
-        else
+        if (!restored)
         {
-            if (vs && ps)
+            if (params)
             {
-                // on the fly link for bound vs and ps which have not been explicity linked
-                // to emulate d3d behaviour of set vs set ps etc
-                CHECK_CALL(glAttachShader(program_id, vs));
-                CHECK_CALL(glAttachShader(program_id, ps));
+                // this path is for a proper link with reflection info
+                if (vs)
+                {
+                    _attach_shader_internal(program_id, vs);
+                }
+
+                if (ps)
+                {
+                    _attach_shader_internal(program_id, ps);
+                }
+
+                if (so)
+                {
+                    _attach_shader_internal(program_id, so);
+                    CHECK_CALL(glTransformFeedbackVaryings(program_id, params->num_stream_out_names,
+                                                           (const c8**)params->stream_out_names, GL_INTERLEAVED_ATTRIBS));
+                }
             }
-            else if (cs)
+            else
             {
-                CHECK_CALL(glAttachShader(program_id, cs));
+                if (vs && ps)
+                {
+                    // on the fly link for bound vs and ps which have not been explicity linked
+                    // to emulate d3d behaviour of set vs set ps etc
+                    _attach_shader_internal(program_id, vs);
+                    _attach_shader_internal(program_id, ps);
+                }
+                else if (cs)
+                {
+                    _attach_shader_internal(program_id, cs);
+                }
             }
-        }
 
-        CHECK_CALL(glLinkProgram(program_id));
+#if PEN_GL_PROGRAM_BINARY
+            if (s_program_cache_enabled)
+                CHECK_CALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+#endif
+            CHECK_CALL(glLinkProgram(program_id));
+        }
 
         // Check the program
         GLint result = GL_FALSE;
@@ -1033,6 +1978,10 @@ namespace
             cs = 0;
             ps = 0;
         }
+        else if (!restored)
+        {
+            _program_cache_store(program_id, cache_key);
+        }
 
         shader_program program;
         program.vs = vs;
@@ -1041,6 +1990,7 @@ namespace
         program.cs = cs;
         program.program = program_id;
         program.vflip_uniform = glGetUniformLocation(program.program, "v_flip");
+        program.v_flip = 0.0f;
 
         for (s32 i = 0; i < MAX_UNIFORM_BUFFERS; ++i)
         {
@@ -1049,7 +1999,11 @@ namespace
         }
 
         sb_push(s_shader_programs, program);
-        return sb_count(s_shader_programs) - 1;
+
+        // failed links are kept under the requested key so they are not re-linked on every draw
+        u32 index = sb_count(s_shader_programs) - 1;
+        _program_lookup_insert(lookup_key, index);
+        return index;
     }
 } // namespace
 
@@ -1168,6 +2122,11 @@ namespace pen
         pen_gl_swap_buffers();
         _renderer_end_frame();
 
+        if (s_stream.enabled)
+            _stream_end_frame();
+
+        _read_back_end_frame();
+
         s_state = {};
 
 // gpu counters
@@ -1194,48 +2153,25 @@ namespace pen
 
         res.handle = CHECK_CALL(glCreateShader(internal_type));
 
-        CHECK_CALL(glShaderSource(res.handle, 1, (const c8**)&params.byte_code, (s32*)&params.byte_code_size));
-        CHECK_CALL(glCompileShader(res.handle));
-
-        // Check compilation status
-        GLint result = GL_FALSE;
-        int   info_log_length;
-
-        CHECK_CALL(glGetShaderiv(res.handle, GL_COMPILE_STATUS, &result));
-        CHECK_CALL(glGetShaderiv(res.handle, GL_INFO_LOG_LENGTH, &info_log_length));
-
-        if (info_log_length > 0)
-        {
-            // print line by line
-            char* lc = (char*)params.byte_code;
-            int   line = 2;
-            while (*lc != '\0')
-            {
-                Str str_line = "";
-
-                while (*lc != '\n' && *lc != '\0')
-                {
-                    str_line.append(*lc);
-                    ++lc;
-                }
-
-                PEN_LOG("%i: %s", line, str_line.c_str());
-                ++line;
-
-                if (*lc == '\0')
-                    break;
-
-                ++lc;
+        // keep the source to compile on first link
+        u32 num_sources = sb_count(s_shader_sources);
+        if (res.handle >= num_sources)
+            memset(sb_add(s_shader_sources, res.handle + 1 - num_sources), 0x0,
+                   sizeof(shader_source) * (res.handle + 1 - num_sources));
 
-                if (lc >= ((char*)params.byte_code + params.byte_code_size))
-                    break;
-            }
+        shader_source& src = s_shader_sources[res.handle];
+        memory_free(src.byte_code);
 
-            char* info_log_buf = (char*)memory_alloc(info_log_length + 1);
+        src.byte_code = (c8*)memory_alloc(params.byte_code_size + 1);
+        memcpy(src.byte_code, params.byte_code, params.byte_code_size);
+        src.byte_code[params.byte_code_size] = '\0';
+        src.byte_code_size = params.byte_code_size;
 
-            CHECK_CALL(glGetShaderInfoLog(res.handle, info_log_length, NULL, &info_log_buf[0]));
-            PEN_LOG(info_log_buf);
-        }
+        hash_murmur hm;
+        hm.begin();
+        hm.add(internal_type);
+        hm.add(params.byte_code, params.byte_code_size);
+        src.hash = hm.end();
     }
 
     void direct::renderer_set_shader(u32 shader_index, u32 shader_type)
@@ -1274,11 +2210,24 @@ namespace pen
         u32 usage = to_gl_usage(params.usage_flags);
         u32 gl_bind = to_gl_bind_flags(params.bind_flags);
 
+        res.type = gl_bind;
+        res.buffer.stream = nullptr;
+
+        // buffers the gpu writes to are not streamed, each region would only see some of its writes
+        u32 gpu_write = PEN_STREAM_OUT_VERTEX_BUFFER | PEN_BIND_SHADER_WRITE;
+        if (s_stream.enabled && params.usage_flags == PEN_USAGE_DYNAMIC && !(params.bind_flags & gpu_write))
+        {
+            _stream_create(res, gl_bind, params.buffer_size);
+
+            if (params.data)
+                _stream_update(res, params.data, params.buffer_size, 0);
+
+            return;
+        }
+
         CHECK_CALL(glGenBuffers(1, &res.handle));
         CHECK_CALL(glBindBuffer(gl_bind, res.handle));
         CHECK_CALL(glBufferData(gl_bind, params.buffer_size, params.data, usage));
-
-        res.type = gl_bind;
     }
 
     void direct::renderer_link_shader_program(const shader_link_params& params, u32 resource_slot)
@@ -1294,7 +2243,7 @@ namespace pen
             return;
 
         GLuint prog = linked_program->program;
-        glUseProgram(linked_program->program);
+        _use_program(prog);
 
         // build lookup tables for uniform buffers and texture samplers
         for (u32 i = 0; i < params.num_constants; ++i)
@@ -1327,9 +2276,9 @@ namespace pen
                     loc = CHECK_CALL(glGetUniformLocation(prog, constant.name));
                     if (loc != -1)
                     {
+                        // sampler units are program state, set once here instead of on every bind
                         linked_program->texture_location[constant.location] = loc;
-                        if (loc != -1 && loc != constant.location)
-                            CHECK_CALL(glUniform1i(loc, constant.location));
+                        CHECK_CALL(glUniform1i(loc, constant.location));
                     }
                 }
                 break;
@@ -1355,16 +2304,7 @@ namespace pen
 #if GL_ARB_compute_shader
         // look for linked cs program
         u32             cs = _res_pool[s_live_state.compute_shader].handle;
-        shader_program* linked_program = nullptr;
-        u32             num_shaders = sb_count(s_shader_programs);
-        for (s32 i = 0; i < num_shaders; ++i)
-        {
-            if (s_shader_programs[i].cs == cs)
-            {
-                linked_program = &s_shader_programs[i];
-                break;
-            }
-        }
+        shader_program* linked_program = _program_lookup_find(0, 0, 0, cs);
 
         // link if we need to on the fly
         if (linked_program == nullptr)
@@ -1373,7 +2313,7 @@ namespace pen
             linked_program = &s_shader_programs[index];
         }
 
-        glUseProgram(linked_program->program);
+        _use_program(linked_program->program);
         CHECK_CALL(glDispatchCompute(grid.x / num_threads.x, grid.y / num_threads.y, grid.z / num_threads.z));
         glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
         glBindImageTexture(0, 0, 0, 0, 0, 0, 0);
@@ -1440,19 +2380,8 @@ namespace pen
             s_state.pixel_shader = s_live_state.pixel_shader;
             s_state.stream_out_shader = s_live_state.stream_out_shader;
 
-            shader_program* linked_program = nullptr;
-
-            u32 so_handle = _res_pool[s_state.stream_out_shader].handle;
-
-            u32 num_shaders = sb_count(s_shader_programs);
-            for (s32 i = 0; i < num_shaders; ++i)
-            {
-                if (s_shader_programs[i].so == so_handle)
-                {
-                    linked_program = &s_shader_programs[i];
-                    break;
-                }
-            }
+            u32             so_handle = _res_pool[s_state.stream_out_shader].handle;
+            shader_program* linked_program = _program_lookup_find(0, 0, so_handle, 0);
 
             if (linked_program == nullptr)
             {
@@ -1460,12 +2389,7 @@ namespace pen
                 PEN_ASSERT(0);
             }
 
-            CHECK_CALL(glUseProgram(linked_program->program));
-
-            // constant buffers and texture locations
-            for (s32 i = 0; i < MAX_UNIFORM_BUFFERS; ++i)
-                if (linked_program->texture_location[i] != INVALID_LOC)
-                    CHECK_CALL(glUniform1i(linked_program->texture_location[i], i));
+            _use_program(linked_program->program);
 
             CHECK_CALL(glEnable(GL_RASTERIZER_DISCARD));
         }
@@ -1479,20 +2403,10 @@ namespace pen
                 s_state.stream_out_shader = s_live_state.stream_out_shader;
                 s_state.v_flip = s_live_state.v_flip;
 
-                shader_program* linked_program = nullptr;
-
                 auto vs_handle = _res_pool[s_state.vertex_shader].handle;
                 auto ps_handle = _res_pool[s_state.pixel_shader].handle;
 
-                u32 num_shaders = sb_count(s_shader_programs);
-                for (s32 i = 0; i < num_shaders; ++i)
-                {
-                    if (s_shader_programs[i].vs == vs_handle && s_shader_programs[i].ps == ps_handle)
-                    {
-                        linked_program = &s_shader_programs[i];
-                        break;
-                    }
-                }
+                shader_program* linked_program = _program_lookup_find(vs_handle, ps_handle, 0, 0);
 
                 if (linked_program == nullptr)
                 {
@@ -1500,19 +2414,18 @@ namespace pen
                     linked_program = &s_shader_programs[index];
                 }
 
-                CHECK_CALL(glUseProgram(linked_program->program));
-
-                // constant buffers and texture locations
-                for (s32 i = 0; i < MAX_UNIFORM_BUFFERS; ++i)
-                    if (linked_program->texture_location[i] != INVALID_LOC)
-                        CHECK_CALL(glUniform1i(linked_program->texture_location[i], i));
+                _use_program(linked_program->program);
 
                 // we need to flip all geometry that is rendered into render targets to be consistent with d3d
                 float v_flip = 1.0f;
                 if (!s_live_state.backbuffer_bound)
                     v_flip = -1.0f;
 
-                glUniform1f(linked_program->vflip_uniform, v_flip);
+                if (linked_program->v_flip != v_flip)
+                {
+                    CHECK_CALL(glUniform1f(linked_program->vflip_uniform, v_flip));
+                    linked_program->v_flip = v_flip;
+                }
             }
         }
 
@@ -1520,41 +2433,77 @@ namespace pen
         if (s_live_state.input_layout)
         {
             auto* input_res = _res_pool[s_live_state.input_layout].input_layout;
-            if (input_res->vertex_array_handle == 0)
-            {
-                CHECK_CALL(glGenVertexArrays(1, &input_res->vertex_array_handle));
-            }
 
-            CHECK_CALL(glBindVertexArray(input_res->vertex_array_handle));
+            vao_key key = {};
+            key.input_layout = s_live_state.input_layout;
+            key.num_buffers = s_live_state.num_bound_vertex_buffers;
+            key.base_vertex = s_state.base_vertex;
 
             for (s32 v = 0; v < s_live_state.num_bound_vertex_buffers; ++v)
             {
                 s_state.vertex_buffer[v] = s_live_state.vertex_buffer[v];
                 s_state.vertex_buffer_stride[v] = s_live_state.vertex_buffer_stride[v];
+                s_state.vertex_buffer_offset[v] = s_live_state.vertex_buffer_offset[v];
 
-                auto& res = _res_pool[s_state.vertex_buffer[v]].handle;
-                CHECK_CALL(glBindBuffer(GL_ARRAY_BUFFER, res));
+                auto& vb = _res_pool[s_state.vertex_buffer[v]];
+                key.buffer[v] = vb.handle;
+                key.stride[v] = s_state.vertex_buffer_stride[v];
+                key.offset[v] = s_state.vertex_buffer_offset[v] + _stream_offset(vb);
+            }
+
+            if (!s_state.vao || memcmp(&key, &s_vao_binding, sizeof(vao_key)) != 0)
+            {
+                if ((s_vao_lookup_count + 1) * 2 > s_vao_lookup_capacity)
+                    _vao_lookup_grow();
 
-                u32 num_attribs = sb_count(input_res->attributes);
+                vao_lookup* vl = _vao_lookup_slot(key);
+                if (!vl->vao && s_vao_lookup_count >= k_vao_lookup_max)
+                {
+                    _vao_lookup_trim();
+                    vl = _vao_lookup_slot(key);
+                }
 
-                for (u32 a = 0; a < num_attribs; ++a)
+                if (!vl->vao)
                 {
-                    auto& attribute = input_res->attributes[a];
+                    // first time this binding is seen, specify the attributes into a new vao
+                    CHECK_CALL(glGenVertexArrays(1, &vl->vao));
+                    CHECK_CALL(glBindVertexArray(vl->vao));
+                    vl->key = key;
+                    s_vao_lookup_count++;
+                    s_state.vao = vl->vao;
+
+                    u32 num_attribs = sb_count(input_res->attributes);
+                    for (s32 v = 0; v < key.num_buffers; ++v)
+                    {
+                        CHECK_CALL(glBindBuffer(GL_ARRAY_BUFFER, key.buffer[v]));
+
+                        for (u32 a = 0; a < num_attribs; ++a)
+                        {
+                            auto& attribute = input_res->attributes[a];
 
-                    if (attribute.input_slot != v)
-                        continue;
+                            if (attribute.input_slot != v)
+                                continue;
 
-                    CHECK_CALL(glEnableVertexAttribArray(attribute.location));
+                            CHECK_CALL(glEnableVertexAttribArray(attribute.location));
 
-                    u32 base_vertex_offset = s_state.vertex_buffer_stride[v] * s_state.base_vertex;
+                            u32 base_offset = key.offset[v] + key.stride[v] * key.base_vertex;
 
-                    CHECK_CALL(glVertexAttribPointer(attribute.location, attribute.num_elements, attribute.type,
-                                                     attribute.type == GL_UNSIGNED_BYTE ? true : false,
-                                                     s_state.vertex_buffer_stride[v],
-                                                     (void*)(attribute.offset + base_vertex_offset)));
+                            CHECK_CALL(glVertexAttribPointer(attribute.location, attribute.num_elements, attribute.type,
+                                                             attribute.type == GL_UNSIGNED_BYTE ? true : false,
+                                                             key.stride[v], (void*)(size_t)(attribute.offset + base_offset)));
 
-                    CHECK_CALL(glVertexAttribDivisor(attribute.location, attribute.step_rate));
+                            CHECK_CALL(glVertexAttribDivisor(attribute.location, attribute.step_rate));
+                        }
+                    }
+                }
+
+                if (s_state.vao != vl->vao)
+                {
+                    CHECK_CALL(glBindVertexArray(vl->vao));
+                    s_state.vao = vl->vao;
                 }
+
+                s_vao_binding = key;
             }
         }
 
@@ -1666,7 +2615,7 @@ namespace pen
         GLuint res = _res_pool[s_state.index_buffer].handle;
         CHECK_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, res));
 
-        void* offset = (void*)(size_t)(start_index * 2);
+        void* offset = (void*)(size_t)(start_index * 2 + _stream_offset(_res_pool[s_state.index_buffer]));
 
         CHECK_CALL(glDrawElementsBaseVertex(primitive_topology, index_count, s_state.index_format, offset, base_vertex));
     }
@@ -1685,7 +2634,7 @@ namespace pen
         CHECK_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, res));
 
         // todo this needs to check index size 32 or 16 bit
-        void* offset = (void*)(size_t)(start_index * 2);
+        void* offset = (void*)(size_t)(start_index * 2 + _stream_offset(_res_pool[s_state.index_buffer]));
 
         CHECK_CALL(glDrawElementsInstancedBaseVertex(primitive_topology, index_count, s_state.index_format, offset,
                                                      instance_count, base_vertex));
@@ -2467,6 +3416,14 @@ namespace pen
     void direct::renderer_set_constant_buffer(u32 buffer_index, u32 unit, u32 flags)
     {
         resource_allocation& res = _res_pool[buffer_index];
+
+        if (res.buffer.stream)
+        {
+            _stream_bind_unit(unit, &res);
+            return;
+        }
+
+        _stream_bind_unit(unit, nullptr);
         CHECK_CALL(glBindBufferBase(GL_UNIFORM_BUFFER, unit, res.handle));
     }
 
@@ -2481,6 +3438,12 @@ namespace pen
         if (res.type == 0 || data_size == 0)
             return;
 
+        if (res.buffer.stream)
+        {
+            _stream_update(res, data, data_size, offset);
+            return;
+        }
+
         CHECK_CALL(glBindBuffer(res.type, res.handle));
 
 #ifndef PEN_GLES3
@@ -2508,6 +3471,14 @@ namespace pen
 #ifndef PEN_GLES3
         resource_allocation& res = _res_pool[rrbp.resource_index];
 
+        read_back_request rb;
+        rb.rrbp = rrbp;
+        rb.frame = s_read_back_frame;
+        rb.flip = false;
+        rb.buffer = _read_back_alloc(rrbp.data_size);
+
+        CHECK_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.buffer.pbo));
+
         GLuint t = res.type;
         if (rrbp.resource_index == PEN_BACK_BUFFER_COLOUR)
         {
@@ -2515,84 +3486,44 @@ namespace pen
             u32 w = rrbp.row_pitch / rrbp.block_size;
             u32 h = rrbp.depth_pitch / rrbp.row_pitch;
 
-#if 0
-            // this path is old, i cant remember if it even worked.
-            static u32 resolve_buffer = -1;
-            if (resolve_buffer == -1)
-            {
-                GLuint handle;
-                CHECK_CALL(glGenTextures(1, &handle));
-                CHECK_CALL(glBindTexture(0, handle));
-                CHECK_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
-
-                CHECK_CALL(glGenFramebuffers(1, &resolve_buffer));
-                CHECK_CALL(glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, handle, 0));
-            }
-
-            CHECK_CALL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolve_buffer));
-            CHECK_CALL(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
-            CHECK_CALL(glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_LINEAR));
-
-            CHECK_CALL(glBindFramebuffer(GL_FRAMEBUFFER, resolve_buffer));
-
-            void* data = memory_alloc(rrbp.data_size);
-            CHECK_CALL(glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data));
-
-            rrbp.call_back_function(data, rrbp.row_pitch, rrbp.depth_pitch, rrbp.block_size);
-
-            memory_free(data);
-
             CHECK_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-#else
-            // this path is test working on macos
-            u8* data = (u8*)memory_alloc(rrbp.data_size);
-
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-            CHECK_CALL(glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data));
-
-            // flip y coords
-            u8* flipped = (u8*)memory_alloc(rrbp.data_size);
-            u8* flip_pos = flipped + rrbp.depth_pitch - rrbp.row_pitch;
-            u8* data_pos = data;
-            for (u32 i = 0; i < rrbp.depth_pitch; i += rrbp.row_pitch)
-            {
-                memcpy(flip_pos, data_pos, rrbp.row_pitch);
-                flip_pos -= rrbp.row_pitch;
-                data_pos += rrbp.row_pitch;
-            }
-
-            rrbp.call_back_function(flipped, rrbp.row_pitch, rrbp.depth_pitch, rrbp.block_size);
-
-            memory_free(data);
-#endif
+            CHECK_CALL(glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+            rb.flip = true;
         }
         else if (t == RES_TEXTURE || t == RES_RENDER_TARGET || t == RES_RENDER_TARGET_MSAA)
         {
             u32 sized_format, format, type, attachment;
             to_gl_texture_format(rrbp.format, sized_format, format, type, attachment);
 
-            s32 target_handle = res.texture.handle;
-            if (t == RES_RENDER_TARGET || t == RES_RENDER_TARGET_MSAA)
-                target_handle = res.render_target.texture.handle;
-
             CHECK_CALL(glBindTexture(GL_TEXTURE_2D, res.texture.handle));
-
-            void* data = memory_alloc(rrbp.data_size);
-            CHECK_CALL(glGetTexImage(GL_TEXTURE_2D, 0, format, type, data));
-
-            rrbp.call_back_function(data, rrbp.row_pitch, rrbp.depth_pitch, rrbp.block_size);
-
-            memory_free(data);
+            CHECK_CALL(glGetTexImage(GL_TEXTURE_2D, 0, format, type, nullptr));
         }
         else if (t == GL_ELEMENT_ARRAY_BUFFER || t == GL_UNIFORM_BUFFER || t == GL_ARRAY_BUFFER)
         {
-            CHECK_CALL(glBindBuffer(t, res.handle));
-            void* map = glMapBuffer(t, GL_READ_ONLY);
+            // streamed buffers copy the region of the last update
+            CHECK_CALL(glBindBuffer(GL_COPY_READ_BUFFER, res.handle));
+            CHECK_CALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_PIXEL_PACK_BUFFER, _stream_offset(res), 0,
+                                           rrbp.data_size));
+        }
+        else
+        {
+            PEN_LOG("read back of resource %i is unsupported", rrbp.resource_index);
+            CHECK_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+            sb_push(s_read_back_pool, rb.buffer);
+            return;
+        }
 
-            rrbp.call_back_function(map, rrbp.row_pitch, rrbp.depth_pitch, rrbp.block_size);
+        CHECK_CALL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        rb.fence = CHECK_CALL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
 
-            CHECK_CALL(glUnmapBuffer(t));
+        // no latency is tolerated, wait for the result here
+        if (rrbp.max_latency == 0)
+        {
+            _read_back_complete(rb);
+            return;
         }
+
+        sb_push(s_read_backs, rb);
 #endif
     }
 
@@ -2637,6 +3568,14 @@ namespace pen
         resource_allocation& res = _res_pool[shader_index];
         CHECK_CALL(glDeleteShader(res.handle));
 
+        _program_lookup_evict_shader(res.handle);
+
+        if (res.handle < (GLuint)sb_count(s_shader_sources))
+        {
+            memory_free(s_shader_sources[res.handle].byte_code);
+            s_shader_sources[res.handle] = {};
+        }
+
         res.handle = 0;
     }
 
@@ -2645,6 +3584,9 @@ namespace pen
         resource_allocation& res = _res_pool[buffer_index];
         CHECK_CALL(glDeleteBuffers(1, &res.handle));
 
+        _vao_lookup_evict(0, res.handle);
+        _stream_release(res);
+
         res.handle = 0;
     }
 
@@ -2701,6 +3643,7 @@ namespace pen
     {
         resource_allocation& res = _res_pool[input_layout];
 
+        _vao_lookup_evict(input_layout, 0);
         memory_free(res.input_layout);
     }
 
@@ -2783,6 +3726,10 @@ namespace pen
 
         s_renderer_info.renderer_cmd = "-renderer opengl";
 
+        Str driver = str_gl_vendor;
+        driver.appendf("%s%s%s", str_gl_renderer.c_str(), str_gl_version.c_str(), str_glsl_version.c_str());
+        _program_cache_init(driver);
+
         // gles base fbo is not 0
         glGetIntegerv(GL_FRAMEBUFFER_BINDING, &s_backbuffer_fbo);
         s_renderer_info.caps |= PEN_CAPS_VUP;
@@ -2798,6 +3745,15 @@ namespace pen
             s_renderer_info.caps |= PEN_CAPS_TEXTURE_CUBE_ARRAY;
         if (major >= 4 && minor >= 6)
             s_renderer_info.caps |= PEN_CAPS_COMPUTE;
+
+        // webgl cannot map buffers so dynamic buffers are only streamed on desktop gl
+        GLint ubo_alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &ubo_alignment);
+        s_stream.alignment = std::max<u32>(ubo_alignment, 16);
+        s_stream.enabled = true;
+#if PEN_GL_PERSISTENT_MAP
+        s_stream.persistent = GLEW_ARB_buffer_storage;
+#endif
 #endif
         return PEN_ERR_OK;
     }
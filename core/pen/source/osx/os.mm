@@ -158,7 +158,8 @@ void pen_window_resize()
 
 void run()
 {
-    pen::renderer_init(_metal_view, false, s_ctx.creation_params.max_renderer_commands);
+    pen::renderer_init(_metal_view, false, s_ctx.creation_params.max_renderer_commands,
+                       s_ctx.creation_params.max_frames_in_flight);
 
     for (;;)
     {
@@ -268,7 +269,8 @@ void pen_window_resize()
 void run()
 {
     // enters render loop and wait for jobs, will call os_update
-    pen::renderer_init(nullptr, true, s_ctx.creation_params.max_renderer_commands);
+    pen::renderer_init(nullptr, true, s_ctx.creation_params.max_renderer_commands,
+                       s_ctx.creation_params.max_frames_in_flight);
 }
 #endif
 
@@ -691,6 +693,7 @@ namespace pen
             get_mouse_pos(x, y);
             pen::input_set_mouse_pos(x, y);
             input_gamepad_update();
+            input_set_poll_time(get_time_ms());
 
             // process commands
             os_cmd* cmd = s_cmd_buffer.get();
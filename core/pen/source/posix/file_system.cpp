@@ -6,11 +6,19 @@
 #include <fnmatch.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/mount.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#if PEN_PLATFORM_LINUX
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "data_struct.h"
 #include "file_system.h"
 #include "memory.h"
 #include "os.h"
@@ -60,6 +68,15 @@ namespace
         fwrite("\n", 1, 1, p_file);
         fclose(p_file);
     }
+
+    struct watched_directory
+    {
+        u32 watcher;
+        s32 wd;
+        c8* path;
+    };
+    watched_directory* s_watched_directories = nullptr;
+    pen::mutex*        s_watch_mutex = nullptr; // directories are added and events read on different threads
 } // namespace
 
 namespace pen
@@ -103,6 +120,46 @@ namespace pen
         return PEN_ERR_FILE_NOT_FOUND;
     }
 
+    pen_error filesystem_map_file(const c8* filename, void** p_mapped, size_t& mapped_size)
+    {
+        WRITE_FILE_DEPENDENCIES(filename);
+
+        const Str resource_name = os_path_for_resource(filename);
+
+        *p_mapped = nullptr;
+        mapped_size = 0;
+
+        int fd = open(resource_name.c_str(), O_RDONLY);
+        if (fd < 0)
+            return PEN_ERR_FILE_NOT_FOUND;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return PEN_ERR_FAILED;
+        }
+
+        void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        // the mapping holds its own reference to the file
+        close(fd);
+
+        if (mapped == MAP_FAILED)
+            return PEN_ERR_FAILED;
+
+        *p_mapped = mapped;
+        mapped_size = (size_t)st.st_size;
+
+        return PEN_ERR_OK;
+    }
+
+    void filesystem_unmap_file(void* mapped, size_t mapped_size)
+    {
+        if (mapped)
+            munmap(mapped, mapped_size);
+    }
+
     pen_error filesystem_enum_volumes(fs_tree_node& results)
     {
         static const c8* volumes_name = "Volumes";
@@ -334,4 +391,152 @@ namespace pen
         // directory depth 0 can be a slash
         return 0;
     }
+
+#if PEN_PLATFORM_LINUX
+    pen_error filesystem_watch_create(u32& watcher_out)
+    {
+        s32 fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+            return PEN_ERR_FAILED;
+
+        if (!s_watch_mutex)
+            s_watch_mutex = mutex_create();
+
+        watcher_out = (u32)fd;
+        return PEN_ERR_OK;
+    }
+
+    pen_error filesystem_watch_add_directory(u32 watcher, const c8* directory)
+    {
+        const c8* dir = directory[0] ? directory : ".";
+        s32       wd = inotify_add_watch((s32)watcher, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0)
+            return PEN_ERR_FILE_NOT_FOUND;
+
+        mutex_lock(s_watch_mutex);
+
+        // adding the same directory twice returns the existing wd
+        u32 num_dirs = sb_count(s_watched_directories);
+        for (u32 i = 0; i < num_dirs; ++i)
+        {
+            if (s_watched_directories[i].watcher == watcher && s_watched_directories[i].wd == wd)
+            {
+                mutex_unlock(s_watch_mutex);
+                return PEN_ERR_OK;
+            }
+        }
+
+        u32 len = strlen(directory);
+        c8* path = (c8*)memory_alloc(len + 1);
+        memcpy(path, directory, len + 1);
+
+        watched_directory wdir = {watcher, wd, path};
+        sb_push(s_watched_directories, wdir);
+
+        mutex_unlock(s_watch_mutex);
+        return PEN_ERR_OK;
+    }
+
+    pen_error filesystem_watch_poll(u32 watcher, watch_callback callback, void* user_data)
+    {
+        alignas(inotify_event) c8 buf[4096];
+        c8                        path[1024];
+
+        mutex_lock(s_watch_mutex);
+        u32 num_dirs = sb_count(s_watched_directories);
+
+        for (;;)
+        {
+            ssize_t len = read((s32)watcher, buf, sizeof(buf));
+            if (len <= 0)
+                break;
+
+            const c8* p = buf;
+            while (p < buf + len)
+            {
+                const inotify_event* ev = (const inotify_event*)p;
+                p += sizeof(inotify_event) + ev->len;
+
+                if (ev->mask & IN_Q_OVERFLOW)
+                {
+                    callback(nullptr, user_data);
+                    continue;
+                }
+
+                if (ev->len == 0)
+                    continue;
+
+                for (u32 i = 0; i < num_dirs; ++i)
+                {
+                    watched_directory& wdir = s_watched_directories[i];
+                    if (wdir.watcher != watcher || wdir.wd != ev->wd)
+                        continue;
+
+                    if (wdir.path[0])
+                        string_format(path, sizeof(path), "%s/%s", wdir.path, ev->name);
+                    else
+                        string_format(path, sizeof(path), "%s", ev->name);
+
+                    callback(path, user_data);
+                    break;
+                }
+            }
+        }
+
+        mutex_unlock(s_watch_mutex);
+        return PEN_ERR_OK;
+    }
+
+    pen_error filesystem_watch_wait(u32 watcher, u32 timeout_ms)
+    {
+        pollfd pfd = {(s32)watcher, POLLIN, 0};
+        if (poll(&pfd, 1, (s32)timeout_ms) > 0 && (pfd.revents & POLLIN))
+            return PEN_ERR_OK;
+
+        return PEN_ERR_FAILED;
+    }
+
+    void filesystem_watch_destroy(u32 watcher)
+    {
+        mutex_lock(s_watch_mutex);
+
+        u32 num_dirs = sb_count(s_watched_directories);
+        for (s32 i = num_dirs - 1; i >= 0; --i)
+        {
+            if (s_watched_directories[i].watcher != watcher)
+                continue;
+
+            memory_free(s_watched_directories[i].path);
+            s_watched_directories[i] = s_watched_directories[--stb__sbn(s_watched_directories)];
+        }
+
+        mutex_unlock(s_watch_mutex);
+        close((s32)watcher);
+    }
+#else
+    pen_error filesystem_watch_create(u32& watcher_out)
+    {
+        watcher_out = PEN_INVALID_HANDLE;
+        return PEN_ERR_FAILED;
+    }
+
+    pen_error filesystem_watch_add_directory(u32 watcher, const c8* directory)
+    {
+        return PEN_ERR_FAILED;
+    }
+
+    pen_error filesystem_watch_poll(u32 watcher, watch_callback callback, void* user_data)
+    {
+        return PEN_ERR_FAILED;
+    }
+
+    pen_error filesystem_watch_wait(u32 watcher, u32 timeout_ms)
+    {
+        return PEN_ERR_FAILED;
+    }
+
+    void filesystem_watch_destroy(u32 watcher)
+    {
+    }
+#endif
 } // namespace pen
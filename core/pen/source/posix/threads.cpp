@@ -4,16 +4,18 @@
 
 #include "threads.h"
 #include "console.h"
-#include "hash.h"
 #include "memory.h"
-#include "os.h"
-#include "pen_string.h"
 
+#include <atomic>
 #include <fcntl.h>
 #include <pthread.h>
-#include <semaphore.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 namespace pen
 {
     struct thread
@@ -26,8 +28,6 @@ namespace pen
         pthread_mutex_t handle;
     };
 
-    a_u32 semaphone_index = {0};
-
     pen::thread* thread_create(dispatch_thread thread_func, u32 stack_size, void* thread_params, thread_start_flags flags)
     {
         // allocate penthread handle
@@ -99,48 +99,155 @@ namespace pen
         usleep(microseconds);
     }
 
-#ifndef PEN_PLATFORM_WEB // posix semaphore implementation proper
+#ifndef PEN_PLATFORM_WEB // unnamed counting semaphore, spins briefly then sleeps on a futex or condition variable
+    namespace
+    {
+        static const u32 k_semaphore_spin_count = 1024;
+
+        u32 semaphore_spin_count()
+        {
+            // spinning on a single core only delays the thread we are waiting for
+            static const u32 s_spin_count = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? k_semaphore_spin_count : 0;
+            return s_spin_count;
+        }
+
+        pen_inline void cpu_relax()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+            __asm__ __volatile__("yield");
+#endif
+        }
+    } // namespace
+
     struct semaphore
     {
-        sem_t* handle;
+        std::atomic<s32> count; // futex word on linux
+        std::atomic<u32> waiters;
+        s32              max_count;
+#ifndef __linux__
+        pthread_mutex_t mutex;
+        pthread_cond_t  cond;
+#endif
     };
+
+#ifdef __linux__
+    namespace
+    {
+        void semaphore_sleep(semaphore* p_semaphore)
+        {
+            // returns immediately if the count is no longer 0
+            syscall(SYS_futex, &p_semaphore->count, FUTEX_WAIT_PRIVATE, 0, nullptr, nullptr, 0);
+        }
+
+        void semaphore_wake(semaphore* p_semaphore, u32 count)
+        {
+            syscall(SYS_futex, &p_semaphore->count, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+        }
+    } // namespace
+#else
+    namespace
+    {
+        void semaphore_sleep(semaphore* p_semaphore)
+        {
+            pthread_mutex_lock(&p_semaphore->mutex);
+
+            if (p_semaphore->count.load() == 0)
+                pthread_cond_wait(&p_semaphore->cond, &p_semaphore->mutex);
+
+            pthread_mutex_unlock(&p_semaphore->mutex);
+        }
+
+        void semaphore_wake(semaphore* p_semaphore, u32 count)
+        {
+            pthread_mutex_lock(&p_semaphore->mutex);
+
+            if (count == 1)
+                pthread_cond_signal(&p_semaphore->cond);
+            else
+                pthread_cond_broadcast(&p_semaphore->cond);
+
+            pthread_mutex_unlock(&p_semaphore->mutex);
+        }
+    } // namespace
+#endif
+
     pen::semaphore* semaphore_create(u32 initial_count, u32 max_count)
     {
         pen::semaphore* new_semaphore = (pen::semaphore*)pen::memory_alloc(sizeof(pen::semaphore));
 
-        c8 name_buf[32];
-        pen::string_format(&name_buf[0], 32, "sem%i%i", semaphone_index++, window_get_id());
+        new_semaphore->count = (s32)min<u32>(initial_count, max_count);
+        new_semaphore->waiters = 0;
+        new_semaphore->max_count = (s32)max_count;
 
-        sem_unlink(name_buf);
-        new_semaphore->handle = sem_open(name_buf, O_CREAT, 0, 0);
+#ifndef __linux__
+        pthread_mutex_init(&new_semaphore->mutex, nullptr);
+        pthread_cond_init(&new_semaphore->cond, nullptr);
+#endif
 
-        assert(!(new_semaphore->handle == (void*)-1));
         return new_semaphore;
     }
 
     void semaphore_destroy(semaphore* p_semaphore)
     {
-        sem_close(p_semaphore->handle);
+#ifndef __linux__
+        pthread_mutex_destroy(&p_semaphore->mutex);
+        pthread_cond_destroy(&p_semaphore->cond);
+#endif
         pen::memory_free(p_semaphore);
     }
 
-    bool semaphore_wait(semaphore* p_semaphore)
+    bool semaphore_try_wait(pen::semaphore* p_semaphore)
     {
-        sem_wait(p_semaphore->handle);
-        return true;
+        s32 count = p_semaphore->count.load(std::memory_order_relaxed);
+        while (count > 0)
+        {
+            if (p_semaphore->count.compare_exchange_weak(count, count - 1, std::memory_order_acquire))
+                return true;
+        }
+
+        return false;
     }
 
-    bool semaphore_try_wait(pen::semaphore* p_semaphore)
+    bool semaphore_wait(semaphore* p_semaphore)
     {
-        if (sem_trywait(p_semaphore->handle) == 0)
-            return true;
+        // most waits in the job and render thread handshakes are satisfied within a few microseconds
+        u32 spin_count = semaphore_spin_count();
+        for (u32 i = 0; i < spin_count; ++i)
+        {
+            if (semaphore_try_wait(p_semaphore))
+                return true;
 
-        return false;
+            cpu_relax();
+        }
+
+        for (;;)
+        {
+            if (semaphore_try_wait(p_semaphore))
+                return true;
+
+            p_semaphore->waiters.fetch_add(1);
+            semaphore_sleep(p_semaphore);
+            p_semaphore->waiters.fetch_sub(1);
+        }
     }
 
     void semaphore_post(semaphore* p_semaphore, u32 count)
     {
-        sem_post(p_semaphore->handle);
+        // saturate at max_count
+        s32 prev = p_semaphore->count.load(std::memory_order_relaxed);
+        s32 next;
+        do
+        {
+            next = min<s32>(prev + (s32)count, p_semaphore->max_count);
+            if (next <= prev)
+                return;
+
+        } while (!p_semaphore->count.compare_exchange_weak(prev, next));
+
+        if (p_semaphore->waiters.load() > 0)
+            semaphore_wake(p_semaphore, (u32)(next - prev));
     }
 #else // emscripten posix sem api emulation
     struct semaphore
@@ -7,6 +7,7 @@
 #include "console.h"
 #include "data_struct.h"
 #include "file_system.h"
+#include "input.h"
 #include "memory.h"
 #include "os.h"
 #include "pen.h"
@@ -92,9 +93,71 @@ namespace
         CMD_PUSH_PERF_MARKER,
         CMD_POP_PERF_MARKER,
         CMD_DISPATCH_COMPUTE,
-        CMD_SET_STENCIL_REF
+        CMD_SET_STENCIL_REF,
+        CMD_CAPTURE_BEGIN,
+        CMD_COUNT
     };
 
+    const c8* k_cmd_names[] = {"none",
+                               "new_frame",
+                               "clear",
+                               "clear_texture",
+                               "present",
+                               "load_shader",
+                               "set_shader",
+                               "link_shader",
+                               "create_input_layout",
+                               "set_input_layout",
+                               "create_buffer",
+                               "set_vertex_buffer",
+                               "set_index_buffer",
+                               "draw",
+                               "draw_indexed",
+                               "draw_indexed_instanced",
+                               "create_texture",
+                               "release_shader",
+                               "release_buffer",
+                               "release_texture_2d",
+                               "create_sampler",
+                               "set_texture",
+                               "create_raster_state",
+                               "set_raster_state",
+                               "set_viewport",
+                               "set_scissor_rect",
+                               "set_viewport_ratio",
+                               "set_scissor_rect_ratio",
+                               "release_raster_state",
+                               "create_blend_state",
+                               "set_blend_state",
+                               "set_constant_buffer",
+                               "set_structured_buffer",
+                               "update_buffer",
+                               "create_depth_stencil_state",
+                               "set_depth_stencil_state",
+                               "update_queries",
+                               "create_render_target",
+                               "set_targets",
+                               "release_blend_state",
+                               "release_render_target",
+                               "release_input_layout",
+                               "release_sampler",
+                               "release_program",
+                               "release_clear_state",
+                               "release_depth_stencil_state",
+                               "create_so_shader",
+                               "set_so_target",
+                               "resolve_target",
+                               "draw_auto",
+                               "map_resource",
+                               "replace_resource",
+                               "create_clear_state",
+                               "push_perf_marker",
+                               "pop_perf_marker",
+                               "dispatch_compute",
+                               "set_stencil_ref",
+                               "capture_begin"};
+    static_assert(PEN_ARRAY_SIZE(k_cmd_names) == CMD_COUNT, "mismatched renderer command names");
+
     struct set_shader_cmd
     {
         u32 shader_index;
@@ -201,6 +264,12 @@ namespace
         uint3 num_threads;
     };
 
+    struct capture_begin_params
+    {
+        c8* filename;
+        u32 num_frames;
+    };
+
     struct renderer_cmd
     {
         u32 command_index;
@@ -239,28 +308,452 @@ namespace
             c8*                              name;
             compute_dispatch_params          cs_dispatch;
             u8                               stencil_ref;
+            capture_begin_params             capture_begin;
+            f64                              input_time; // present, time input read by the frame was polled
         };
 
         renderer_cmd(){};
     };
 
+    static const u32 k_latency_history = 64;
+
     // front end render_ctx
     struct fe_render_ctx
     {
         pen::timer*               present_timer = nullptr;
         f64                       present_time = 0.0f;
         pen::resolve_resources    resolve_resources;
-        pen::semaphore*           consume_semaphore = nullptr;
         pen::semaphore*           continue_semaphore = nullptr;
+        pen::semaphore*           frame_semaphore = nullptr; // a count per frame the user thread may still submit
+        u32                       max_frames_in_flight = 1;
         pen::slot_resources       renderer_slot_resources;
         ring_buffer<renderer_cmd> cmd_buffer;
         ring_buffer<renderer_cmd> release_cmd_buffer;
         u32*                      free_slots = nullptr;
-        a_s32                     wait;
+
+        // pacing stats, input_time and pacing_wait are written by the user thread, latency by the render thread.
+        // stats_mutex guards latency, latency_frame and present_time which the render thread writes once per present
+        f64         input_time = 0.0;
+        f64         pacing_wait = 0.0;
+        f32         latency[k_latency_history] = {0};
+        u32         latency_frame = 0;
+        pen::mutex* stats_mutex = nullptr;
     };
     static fe_render_ctx* _ctx;
     static render_ctx     _main_ctx;
 
+    // command stream capture, each executed renderer_cmd is written raw followed by its out of line payloads as u32 size
+    // prefixed blocks (0 for nullptr). pointers inside the raw cmd are meaningless on load and are patched on replay.
+    static const u32 k_capture_magic = PEN_FOURCC('P', 'C', 'A', 'P');
+    static const u32 k_capture_version = 2;
+    static const u32 k_histogram_buckets = 32; // log2 ns
+
+    struct capture_header
+    {
+        u32 magic;
+        u32 version;
+        u32 cmd_size; // captures are only valid for builds with the same renderer_cmd layout
+        u32 num_frames;
+        u32 num_commands;
+        u32 max_frame_commands;
+        u32 window_width;
+        u32 window_height;
+    };
+
+    struct capture_ctx
+    {
+        FILE*                file = nullptr;
+        u8*                  buffer = nullptr;
+        capture_header       header;
+        u32                  frame_commands = 0;
+        u32                  frames_remaining = 0;
+        capture_begin_params request = {nullptr, 0}; // requested before renderer_init
+    };
+    static capture_ctx s_capture;
+
+    struct capture_reader
+    {
+        const u8* data;
+        size_t    size;
+        size_t    pos;
+        bool      error;
+        c8**      arena; // allocations which outlive exec_cmd, freed when the replay completes
+    };
+
+    struct replay_timing
+    {
+        a_bool enabled;
+        u32    count[CMD_COUNT];
+        f64    total_ns[CMD_COUNT];
+        u32    histogram[CMD_COUNT][k_histogram_buckets];
+    };
+    static replay_timing s_replay_timing;
+
+    void capture_write(const void* data, u32 size)
+    {
+        if (!data)
+            size = 0;
+
+        u8* p = sb_add(s_capture.buffer, sizeof(u32) + size);
+        memcpy(p, &size, sizeof(u32));
+        if (size)
+            memcpy(p + sizeof(u32), data, size);
+    }
+
+    void capture_write_string(const c8* str)
+    {
+        capture_write(str, str ? string_length(str) + 1 : 0);
+    }
+
+    void capture_flush()
+    {
+        if (!s_capture.buffer)
+            return;
+
+        fwrite(s_capture.buffer, 1, sb_count(s_capture.buffer), s_capture.file);
+        stb__sbn(s_capture.buffer) = 0;
+    }
+
+    void capture_end()
+    {
+        if (!s_capture.file)
+            return;
+
+        capture_flush();
+
+        // patch the header now the counts are known
+        fseek(s_capture.file, 0, SEEK_SET);
+        fwrite(&s_capture.header, sizeof(capture_header), 1, s_capture.file);
+        fclose(s_capture.file);
+
+        PEN_LOG("renderer capture complete: %i frames, %i commands", s_capture.header.num_frames,
+                s_capture.header.num_commands);
+
+        sb_free(s_capture.buffer);
+        s_capture.buffer = nullptr;
+        s_capture.file = nullptr;
+    }
+
+    void capture_start(const c8* filename, u32 num_frames)
+    {
+        capture_end();
+
+        s_capture.file = fopen(filename, "wb");
+        if (!s_capture.file)
+        {
+            PEN_LOG("renderer capture: failed to open %s", filename);
+            return;
+        }
+
+        capture_header& h = s_capture.header;
+        memset(&h, 0x0, sizeof(capture_header));
+        h.magic = k_capture_magic;
+        h.version = k_capture_version;
+        h.cmd_size = sizeof(renderer_cmd);
+        h.window_width = pen_window.width;
+        h.window_height = pen_window.height;
+        fwrite(&h, sizeof(capture_header), 1, s_capture.file);
+
+        s_capture.frame_commands = 0;
+        s_capture.frames_remaining = max<u32>(num_frames, 1);
+    }
+
+    void capture_cmd(const renderer_cmd& cmd)
+    {
+        u8* p = sb_add(s_capture.buffer, sizeof(renderer_cmd));
+        memcpy(p, &cmd, sizeof(renderer_cmd));
+
+        switch (cmd.command_index)
+        {
+            case CMD_LOAD_SHADER:
+            {
+                const shader_load_params& sl = cmd.shader_load;
+                u32 num_so = sl.so_decl_entries ? sl.so_num_entries : 0;
+                capture_write(sl.byte_code, sl.byte_code_size);
+                capture_write(sl.so_decl_entries, sizeof(stream_out_decl_entry) * num_so);
+                for (u32 i = 0; i < num_so; ++i)
+                    capture_write_string(sl.so_decl_entries[i].semantic_name);
+            }
+            break;
+            case CMD_LINK_SHADER:
+            {
+                const shader_link_params& lp = cmd.link_params;
+                capture_write(lp.constants, sizeof(constant_layout_desc) * lp.num_constants);
+                for (u32 i = 0; i < lp.num_constants; ++i)
+                    capture_write_string(lp.constants[i].name);
+
+                u32 num_so = lp.stream_out_names ? lp.num_stream_out_names : 0;
+                capture_write(lp.stream_out_names, sizeof(c8*) * num_so);
+                for (u32 i = 0; i < num_so; ++i)
+                    capture_write_string(lp.stream_out_names[i]);
+            }
+            break;
+            case CMD_CREATE_INPUT_LAYOUT:
+            {
+                const input_layout_creation_params& il = cmd.create_input_layout;
+                capture_write(il.vs_byte_code, il.vs_byte_code_size);
+                capture_write(il.input_layout, sizeof(input_layout_desc) * il.num_elements);
+                for (u32 i = 0; i < il.num_elements; ++i)
+                    capture_write_string(il.input_layout[i].semantic_name);
+            }
+            break;
+            case CMD_CREATE_BUFFER:
+                capture_write(cmd.create_buffer.data, cmd.create_buffer.buffer_size);
+                break;
+            case CMD_SET_VERTEX_BUFFER:
+            {
+                u32 size = sizeof(u32) * cmd.set_vertex_buffer.num_buffers;
+                capture_write(cmd.set_vertex_buffer.buffer_indices, size);
+                capture_write(cmd.set_vertex_buffer.strides, size);
+                capture_write(cmd.set_vertex_buffer.offsets, size);
+            }
+            break;
+            case CMD_CREATE_TEXTURE:
+                capture_write(cmd.create_texture.data, cmd.create_texture.data_size);
+                break;
+            case CMD_CREATE_BLEND_STATE:
+                capture_write(cmd.create_blend_state.render_targets,
+                              sizeof(render_target_blend) * cmd.create_blend_state.num_render_targets);
+                break;
+            case CMD_UPDATE_BUFFER:
+                capture_write(cmd.update_buffer.data, cmd.update_buffer.data_size);
+                break;
+            case CMD_CREATE_DEPTH_STENCIL_STATE:
+                capture_write(cmd.p_create_depth_stencil_state, sizeof(depth_stencil_creation_params));
+                break;
+            case CMD_PUSH_PERF_MARKER:
+                capture_write_string(cmd.name);
+                break;
+            default:
+                break;
+        }
+
+        s_capture.header.num_commands++;
+        s_capture.frame_commands++;
+
+        if (cmd.command_index == CMD_PRESENT)
+        {
+            capture_header& h = s_capture.header;
+            h.num_frames++;
+            h.max_frame_commands = max(h.max_frame_commands, s_capture.frame_commands);
+            s_capture.frame_commands = 0;
+
+            capture_flush();
+
+            if (--s_capture.frames_remaining == 0)
+                capture_end();
+        }
+    }
+
+    void* capture_read_block(capture_reader& r, u32& size)
+    {
+        size = 0;
+        if (r.error || r.pos + sizeof(u32) > r.size)
+        {
+            r.error = true;
+            return nullptr;
+        }
+
+        memcpy(&size, r.data + r.pos, sizeof(u32));
+        r.pos += sizeof(u32);
+
+        if (size == 0)
+            return nullptr;
+
+        if (r.pos + size > r.size)
+        {
+            r.error = true;
+            size = 0;
+            return nullptr;
+        }
+
+        void* block = memory_alloc(size);
+        memcpy(block, r.data + r.pos, size);
+        r.pos += size;
+        return block;
+    }
+
+    void* capture_read_block(capture_reader& r)
+    {
+        u32 size;
+        return capture_read_block(r, size);
+    }
+
+    // strings which exec_cmd does not free are owned by the reader arena
+    c8* capture_read_string(capture_reader& r, bool owned_by_cmd)
+    {
+        c8* str = (c8*)capture_read_block(r);
+        if (str && !owned_by_cmd)
+            sb_push(r.arena, str);
+        return str;
+    }
+
+    void replay_read_back_complete(void* data, u32 row_pitch, u32 depth_pitch, u32 block_size)
+    {
+        // read backs are executed for timing but the results are discarded
+    }
+
+    bool capture_read_cmd(capture_reader& r, renderer_cmd& cmd)
+    {
+        if (r.pos + sizeof(renderer_cmd) > r.size)
+        {
+            r.error = r.pos != r.size;
+            return false;
+        }
+
+        memcpy(&cmd, r.data + r.pos, sizeof(renderer_cmd));
+        r.pos += sizeof(renderer_cmd);
+
+        switch (cmd.command_index)
+        {
+            case CMD_LOAD_SHADER:
+            {
+                shader_load_params& sl = cmd.shader_load;
+                sl.byte_code = capture_read_block(r);
+                sl.so_decl_entries = (stream_out_decl_entry*)capture_read_block(r);
+                u32 num_so = sl.so_decl_entries ? sl.so_num_entries : 0;
+                for (u32 i = 0; i < num_so; ++i)
+                    sl.so_decl_entries[i].semantic_name = capture_read_string(r, false);
+            }
+            break;
+            case CMD_LINK_SHADER:
+            {
+                shader_link_params& lp = cmd.link_params;
+                lp.constants = (constant_layout_desc*)capture_read_block(r);
+                u32 num_constants = lp.constants ? lp.num_constants : 0;
+                for (u32 i = 0; i < num_constants; ++i)
+                    lp.constants[i].name = capture_read_string(r, true);
+
+                lp.stream_out_names = (c8**)capture_read_block(r);
+                u32 num_so = lp.stream_out_names ? lp.num_stream_out_names : 0;
+                for (u32 i = 0; i < num_so; ++i)
+                    lp.stream_out_names[i] = capture_read_string(r, true);
+            }
+            break;
+            case CMD_CREATE_INPUT_LAYOUT:
+            {
+                input_layout_creation_params& il = cmd.create_input_layout;
+                il.vs_byte_code = capture_read_block(r);
+                il.input_layout = (input_layout_desc*)capture_read_block(r);
+                u32 num_elements = il.input_layout ? il.num_elements : 0;
+                for (u32 i = 0; i < num_elements; ++i)
+                    il.input_layout[i].semantic_name = capture_read_string(r, false);
+            }
+            break;
+            case CMD_CREATE_BUFFER:
+                cmd.create_buffer.data = capture_read_block(r);
+                break;
+            case CMD_SET_VERTEX_BUFFER:
+                cmd.set_vertex_buffer.buffer_indices = (u32*)capture_read_block(r);
+                cmd.set_vertex_buffer.strides = (u32*)capture_read_block(r);
+                cmd.set_vertex_buffer.offsets = (u32*)capture_read_block(r);
+                break;
+            case CMD_CREATE_TEXTURE:
+                cmd.create_texture.data = capture_read_block(r);
+                break;
+            case CMD_CREATE_RENDER_TARGET:
+                cmd.create_render_target.data = nullptr;
+                break;
+            case CMD_CREATE_BLEND_STATE:
+                cmd.create_blend_state.render_targets = (render_target_blend*)capture_read_block(r);
+                break;
+            case CMD_UPDATE_BUFFER:
+                cmd.update_buffer.data = capture_read_block(r);
+                break;
+            case CMD_CREATE_DEPTH_STENCIL_STATE:
+                cmd.p_create_depth_stencil_state = (depth_stencil_creation_params*)capture_read_block(r);
+                break;
+            case CMD_PUSH_PERF_MARKER:
+                cmd.name = capture_read_string(r, false);
+                break;
+            case CMD_MAP_RESOURCE:
+                cmd.rrb_params.call_back_function = &replay_read_back_complete;
+                break;
+            default:
+                break;
+        }
+
+        return !r.error;
+    }
+
+    void replay_record(u32 command_index, f64 ns)
+    {
+        u32 bucket = 0;
+        u64 ins = (u64)ns;
+        while (ins > 1 && bucket < k_histogram_buckets - 1)
+        {
+            ins >>= 1;
+            ++bucket;
+        }
+
+        s_replay_timing.count[command_index]++;
+        s_replay_timing.total_ns[command_index] += ns;
+        s_replay_timing.histogram[command_index][bucket]++;
+    }
+
+    // upper bound of the bucket containing the percentile, in microseconds
+    f64 replay_percentile_us(u32 command_index, f64 pct)
+    {
+        u32 count = s_replay_timing.count[command_index];
+        u32 cumulative = 0;
+        for (u32 b = 0; b < k_histogram_buckets; ++b)
+        {
+            cumulative += s_replay_timing.histogram[command_index][b];
+            if ((f64)cumulative >= pct * (f64)count)
+                return (f64)(1ull << (b + 1)) / 1000.0;
+        }
+
+        return (f64)(1ull << k_histogram_buckets) / 1000.0;
+    }
+
+    void replay_report(const c8* report_filename, const capture_header& h)
+    {
+        PEN_LOG("renderer replay: %i frames, %i commands", h.num_frames, h.num_commands);
+        PEN_LOG("%-28s %8s %10s %10s %10s %10s", "command", "count", "total ms", "mean us", "p50 us", "p99 us");
+
+        FILE* report = report_filename ? fopen(report_filename, "w") : nullptr;
+        if (report)
+            fprintf(report, "command,count,total_ms,mean_us,p50_us,p99_us\n");
+
+        for (u32 c = 0; c < CMD_COUNT; ++c)
+        {
+            u32 count = s_replay_timing.count[c];
+            if (count == 0)
+                continue;
+
+            f64 total_ms = s_replay_timing.total_ns[c] / 1000.0 / 1000.0;
+            f64 mean_us = s_replay_timing.total_ns[c] / 1000.0 / (f64)count;
+            f64 p50 = replay_percentile_us(c, 0.5);
+            f64 p99 = replay_percentile_us(c, 0.99);
+
+            PEN_LOG("%-28s %8i %10.3f %10.3f %10.3f %10.3f", k_cmd_names[c], count, total_ms, mean_us, p50, p99);
+
+            // histogram of non empty log2 buckets, labelled by upper bound
+            Str hist = "    ";
+            for (u32 b = 0; b < k_histogram_buckets; ++b)
+            {
+                u32 n = s_replay_timing.histogram[c][b];
+                if (n == 0)
+                    continue;
+
+                f64 upper_ns = (f64)(1ull << (b + 1));
+                if (upper_ns < 1000.0)
+                    hist.appendf("<%.0fns:%i ", upper_ns, n);
+                else if (upper_ns < 1000.0 * 1000.0)
+                    hist.appendf("<%.1fus:%i ", upper_ns / 1000.0, n);
+                else
+                    hist.appendf("<%.1fms:%i ", upper_ns / 1000.0 / 1000.0, n);
+            }
+            PEN_LOG("%s", hist.c_str());
+
+            if (report)
+                fprintf(report, "%s,%i,%f,%f,%f,%f\n", k_cmd_names[c], count, total_ms, mean_us, p50, p99);
+        }
+
+        if (report)
+            fclose(report);
+    }
+
 } // namespace
 
 namespace pen
@@ -272,11 +765,47 @@ namespace pen
     {
         extern a_u64 g_gpu_total;
 
+        mutex_lock(_ctx->stats_mutex);
         cpu_ms = _ctx->present_time;
+        mutex_unlock(_ctx->stats_mutex);
+
         gpu_ms = (f64)g_gpu_total / 1000.0 / 1000.0;
     }
 
-    void exec_cmd(const renderer_cmd& cmd)
+    void renderer_get_present_time(renderer_present_stats& stats)
+    {
+        extern a_u64 g_gpu_total;
+
+        // snapshot under the lock so the ring and its frame count are from the same present
+        f32 latency[k_latency_history];
+
+        mutex_lock(_ctx->stats_mutex);
+        stats.cpu_ms = _ctx->present_time;
+        u32 frame = _ctx->latency_frame;
+        memcpy(latency, _ctx->latency, sizeof(latency));
+        mutex_unlock(_ctx->stats_mutex);
+
+        stats.gpu_ms = (f64)g_gpu_total / 1000.0 / 1000.0;
+
+        u32 count = std::min<u32>(frame, k_latency_history);
+
+        stats.latency_ms = frame ? latency[(frame - 1) % k_latency_history] : 0.0f;
+        stats.latency_avg_ms = 0.0f;
+        stats.latency_max_ms = 0.0f;
+        for (u32 i = 0; i < count; ++i)
+        {
+            stats.latency_avg_ms += latency[i];
+            stats.latency_max_ms = std::max(stats.latency_max_ms, latency[i]);
+        }
+
+        if (count)
+            stats.latency_avg_ms /= (f32)count;
+
+        stats.pacing_wait_ms = (f32)_ctx->pacing_wait;
+        stats.max_frames_in_flight = _ctx->max_frames_in_flight;
+    }
+
+    void exec_cmd_internal(const renderer_cmd& cmd)
     {
         //PEN_LOG("CMD %i", cmd.command_index);
 
@@ -292,11 +821,28 @@ namespace pen
                 direct::renderer_clear_texture(cmd.clear.clear_state, cmd.clear.texture_index);
                 break;
             case CMD_PRESENT:
+            {
                 direct::renderer_present();
+
+                f32 latency = (f32)(get_time_ms() - cmd.input_time);
                 end_frame_internal();
+
+                // published together so readers never see a partially written ring
+                mutex_lock(_ctx->stats_mutex);
+
+                // replayed presents carry times from the capturing process
+                if (!s_replay_timing.enabled)
+                {
+                    _ctx->latency[_ctx->latency_frame % k_latency_history] = latency;
+                    _ctx->latency_frame++;
+                }
+
                 _ctx->present_time = timer_elapsed_ms(_ctx->present_timer);
+                mutex_unlock(_ctx->stats_mutex);
+
                 timer_start(_ctx->present_timer);
-                break;
+            }
+            break;
 
             case CMD_LOAD_SHADER:
                 direct::renderer_load_shader(cmd.shader_load, cmd.resource_slot);
@@ -530,7 +1076,28 @@ namespace pen
             case CMD_SET_STENCIL_REF:
                 direct::renderer_set_stencil_ref(cmd.stencil_ref);
                 break;
+
+            case CMD_CAPTURE_BEGIN:
+                capture_start(cmd.capture_begin.filename, cmd.capture_begin.num_frames);
+                memory_free(cmd.capture_begin.filename);
+                break;
+        }
+    }
+
+    void exec_cmd(const renderer_cmd& cmd)
+    {
+        if (s_capture.file && cmd.command_index != CMD_CAPTURE_BEGIN)
+            capture_cmd(cmd);
+
+        if (!s_replay_timing.enabled)
+        {
+            exec_cmd_internal(cmd);
+            return;
         }
+
+        f64 start = get_time_ns();
+        exec_cmd_internal(cmd);
+        replay_record(cmd.command_index, get_time_ns() - start);
     }
 
     //
@@ -545,19 +1112,19 @@ namespace pen
     void renderer_consume_cmd_buffer()
     {
 #if !PEN_SINGLE_THREADED
-        while (_ctx->wait > 0)
-            pen::thread_sleep_ms(1);
-
-        if (_ctx->consume_semaphore)
-        {
-            semaphore_post(_ctx->consume_semaphore, 1);
-            semaphore_wait(_ctx->continue_semaphore);
-        }
+        // blocks until fewer than max_frames_in_flight submitted frames are waiting to be presented,
+        // the render thread signals frame_semaphore as each present completes.
+        f64 wait_start = get_time_ms();
+        semaphore_wait(_ctx->frame_semaphore);
+        _ctx->pacing_wait = get_time_ms() - wait_start;
 
         // sync on window surface
         direct::renderer_sync();
-        _ctx->wait++;
 #endif
+        // the frame reads input polled by the os thread at or after this time, falls back to the frame start
+        // on platforms which do not poll
+        f64 poll_time = input_get_poll_time();
+        _ctx->input_time = poll_time > 0.0 ? poll_time : get_time_ms();
     }
 
     void new_frame_internal()
@@ -598,8 +1165,7 @@ namespace pen
         }
 
         direct::renderer_end_frame();
-        semaphore_post(_ctx->continue_semaphore, 1);
-        _ctx->wait--;
+        semaphore_post(_ctx->frame_semaphore, 1);
     }
 
     void renderer_wait_for_jobs()
@@ -629,6 +1195,8 @@ namespace pen
 
     bool renderer_dispatch()
     {
+        PEN_MEMORY_TAG_SCOPE(renderer);
+
         // this function is invoked from mtk draw in view
         //if we start renderin  we need to wait for present to prevent command buffer being released before ending encoding
 
@@ -710,25 +1278,31 @@ namespace pen
         g_resolve_resources = ctx->resolve_resources;
     }
 
-    render_ctx renderer_create_context(u32 max_commands)
+    render_ctx renderer_create_context(u32 max_commands, u32 max_frames_in_flight)
     {
         fe_render_ctx* new_ctx = new fe_render_ctx();
-        new_ctx->cmd_buffer.create(max_commands);
-        new_ctx->release_cmd_buffer.create(1024);
+        // the render thread drains continuously so the user thread can wait, releases are held for frames so they grow
+        new_ctx->cmd_buffer.create(max_commands, e_ring_buffer_full::block);
+        new_ctx->release_cmd_buffer.create(1024, e_ring_buffer_full::grow);
         new_ctx->present_timer = timer_create();
         timer_start(new_ctx->present_timer);
         new_ctx->present_time = 0.0f;
-        new_ctx->consume_semaphore = semaphore_create(0, 1);
+        new_ctx->stats_mutex = mutex_create();
         new_ctx->continue_semaphore = semaphore_create(0, 1);
+
+        // the frame being submitted holds one of the counts
+        new_ctx->max_frames_in_flight = std::max<u32>(max_frames_in_flight, 1);
+        new_ctx->frame_semaphore = semaphore_create(new_ctx->max_frames_in_flight - 1, new_ctx->max_frames_in_flight);
+        new_ctx->input_time = get_time_ms();
         slot_resources_init(&new_ctx->renderer_slot_resources, 2048);
 
         return (render_ctx*)new_ctx;
     }
 
-    void renderer_init(void* user_data, bool wait_for_jobs, u32 max_commands)
+    void renderer_init(void* user_data, bool wait_for_jobs, u32 max_commands, u32 max_frames_in_flight)
     {
         // create main render context and bind it
-        _main_ctx = renderer_create_context(max_commands);
+        _main_ctx = renderer_create_context(max_commands, max_frames_in_flight);
         _ctx = (fe_render_ctx*)_main_ctx;
 
         // bb is backbuffer depth and colour
@@ -743,6 +1317,14 @@ namespace pen
 
         init_resolve_resources(_ctx);
 
+        // start up captures begin after the internal resources, a replay creates its own with renderer_init
+        if (s_capture.request.filename)
+        {
+            renderer_capture_begin(s_capture.request.filename, s_capture.request.num_frames);
+            memory_free(s_capture.request.filename);
+            s_capture.request.filename = nullptr;
+        }
+
         if (wait_for_jobs)
             renderer_wait_for_jobs();
     }
@@ -817,7 +1399,7 @@ namespace pen
                     ++diffs;
             }
 
-            free(file_data);
+            pen::memory_free(file_data);
         }
 
         // write result image
@@ -871,11 +1453,128 @@ namespace pen
         rrbp.depth_pitch = pen_window.width * pen_window.height * rrbp.block_size;
         rrbp.data_size = pen_window.width * pen_window.height * rrbp.block_size;
         rrbp.call_back_function = &renderer_test_read_complete;
+        rrbp.max_latency = 3;
 
         pen::renderer_read_back_resource(rrbp);
 
         ran = true;
     }
+
+    // command stream capture and replay
+    void renderer_capture_begin(const c8* filename, u32 num_frames)
+    {
+        u32 len = string_length(filename);
+        c8* fn = (c8*)memory_alloc(len + 1);
+        memcpy(fn, filename, len + 1);
+
+        if (!_ctx)
+        {
+            memory_free(s_capture.request.filename);
+            s_capture.request.filename = fn;
+            s_capture.request.num_frames = num_frames;
+            return;
+        }
+
+        renderer_cmd cmd;
+        cmd.command_index = CMD_CAPTURE_BEGIN;
+        cmd.capture_begin.filename = fn;
+        cmd.capture_begin.num_frames = num_frames;
+        add_cmd(cmd);
+    }
+
+    bool renderer_capture_read_info(const c8* filename, renderer_capture_info& info)
+    {
+        FILE* fp = fopen(filename, "rb");
+        if (!fp)
+            return false;
+
+        capture_header h;
+        size_t         read = fread(&h, sizeof(capture_header), 1, fp);
+        fclose(fp);
+
+        if (read != 1 || h.magic != k_capture_magic)
+            return false;
+
+        info.num_frames = h.num_frames;
+        info.num_commands = h.num_commands;
+        info.max_frame_commands = h.max_frame_commands;
+        info.window_width = h.window_width;
+        info.window_height = h.window_height;
+        info.compatible = h.version == k_capture_version && h.cmd_size == sizeof(renderer_cmd);
+        return true;
+    }
+
+    bool renderer_capture_replay(const c8* filename, const c8* report_filename)
+    {
+        void* file_data = nullptr;
+        u32   file_size = 0;
+        if (filesystem_read_file_to_buffer(filename, &file_data, file_size) != PEN_ERR_OK ||
+            file_size < sizeof(capture_header))
+        {
+            PEN_LOG("renderer replay: failed to read %s", filename);
+            memory_free(file_data);
+            return false;
+        }
+
+        capture_header h;
+        memcpy(&h, file_data, sizeof(capture_header));
+        if (h.magic != k_capture_magic || h.version != k_capture_version || h.cmd_size != sizeof(renderer_cmd))
+        {
+            PEN_LOG("renderer replay: %s is not a capture from this build", filename);
+            memory_free(file_data);
+            return false;
+        }
+
+        capture_reader r = {(const u8*)file_data, file_size, sizeof(capture_header), false, nullptr};
+
+        // timings are gathered on the render thread inside exec_cmd
+        memset(s_replay_timing.count, 0x0, sizeof(s_replay_timing.count));
+        memset(s_replay_timing.total_ns, 0x0, sizeof(s_replay_timing.total_ns));
+        memset(s_replay_timing.histogram, 0x0, sizeof(s_replay_timing.histogram));
+        s_replay_timing.enabled = true;
+
+        bool         presented = true;
+        renderer_cmd cmd;
+        while (capture_read_cmd(r, cmd))
+        {
+            add_cmd(cmd);
+
+            presented = cmd.command_index == CMD_PRESENT;
+            if (presented)
+                renderer_consume_cmd_buffer();
+        }
+
+        // captures cut short by app exit may not end on a present
+        if (!presented)
+        {
+            cmd.command_index = CMD_PRESENT;
+            add_cmd(cmd);
+            renderer_consume_cmd_buffer();
+        }
+
+#if !PEN_SINGLE_THREADED
+        // wait for the frames still in flight to finish executing
+        for (u32 i = 1; i < _ctx->max_frames_in_flight; ++i)
+            semaphore_wait(_ctx->frame_semaphore);
+
+        if (_ctx->max_frames_in_flight > 1)
+            semaphore_post(_ctx->frame_semaphore, _ctx->max_frames_in_flight - 1);
+#endif
+        s_replay_timing.enabled = false;
+
+        if (r.error)
+            PEN_LOG("renderer replay: %s is truncated or corrupt", filename);
+
+        replay_report(report_filename, h);
+
+        u32 num_arena = sb_count(r.arena);
+        for (u32 i = 0; i < num_arena; ++i)
+            memory_free(r.arena[i]);
+        sb_free(r.arena);
+        memory_free(file_data);
+
+        return !r.error;
+    }
 } // namespace pen
 
 namespace pen
@@ -933,9 +1632,11 @@ namespace pen
     void renderer_present()
     {
         pen::renderer_test_run();
+        pen::memory_new_frame();
 
         renderer_cmd cmd;
         cmd.command_index = CMD_PRESENT;
+        cmd.input_time = _ctx->input_time;
         add_cmd(cmd);
     }
 
@@ -122,6 +122,53 @@ namespace pen
         return PEN_ERR_FILE_NOT_FOUND;
     }
 
+    pen_error filesystem_map_file(const c8* filename, void** p_mapped, size_t& mapped_size)
+    {
+        c8* windir_filename = swap_slashes(filename);
+
+        *p_mapped = nullptr;
+        mapped_size = 0;
+
+        HANDLE file = CreateFileA(windir_filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, NULL);
+
+        pen::memory_free(windir_filename);
+
+        if (file == INVALID_HANDLE_VALUE)
+            return PEN_ERR_FILE_NOT_FOUND;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return PEN_ERR_FAILED;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+
+        if (!mapping)
+            return PEN_ERR_FAILED;
+
+        // the view holds its own reference to the mapping
+        void* mapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+
+        if (!mapped)
+            return PEN_ERR_FAILED;
+
+        *p_mapped = mapped;
+        mapped_size = (size_t)size.QuadPart;
+
+        return PEN_ERR_OK;
+    }
+
+    void filesystem_unmap_file(void* mapped, size_t mapped_size)
+    {
+        if (mapped)
+            UnmapViewOfFile(mapped);
+    }
+
     pen_error filesystem_enum_volumes(fs_tree_node& tree)
     {
         DWORD drive_bit_mask = GetLogicalDrives();
@@ -376,4 +423,29 @@ namespace pen
         return -1;
     }
 
+    pen_error filesystem_watch_create(u32& watcher_out)
+    {
+        // not implemented, the hot loader falls back to polling file mtimes
+        watcher_out = PEN_INVALID_HANDLE;
+        return PEN_ERR_FAILED;
+    }
+
+    pen_error filesystem_watch_add_directory(u32 watcher, const c8* directory)
+    {
+        return PEN_ERR_FAILED;
+    }
+
+    pen_error filesystem_watch_poll(u32 watcher, watch_callback callback, void* user_data)
+    {
+        return PEN_ERR_FAILED;
+    }
+
+    pen_error filesystem_watch_wait(u32 watcher, u32 timeout_ms)
+    {
+        return PEN_ERR_FAILED;
+    }
+
+    void filesystem_watch_destroy(u32 watcher)
+    {
+    }
 } // namespace pen
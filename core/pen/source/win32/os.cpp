@@ -159,7 +159,8 @@ namespace
         // renderer_init will enter a loop wait for rendering commands, and call os update
         HWND hwnd = (HWND)pen::window_get_primary_display_handle();
         create_ctx(hwnd);
-        pen::renderer_init((void*)&hwnd, true, s_ctx.creation_params.max_renderer_commands);
+        pen::renderer_init((void*)&hwnd, true, s_ctx.creation_params.max_renderer_commands,
+                           s_ctx.creation_params.max_frames_in_flight);
 
         return s_ctx.return_code;
     }
@@ -229,6 +230,7 @@ namespace pen
         }
 
         pen::input_gamepad_update();
+        pen::input_set_poll_time(pen::get_time_ms());
 
         if (s_ctx.terminate_app)
         {
@@ -157,12 +157,14 @@ namespace put
 
     void* audio_thread_function(void* params)
     {
+        PEN_MEMORY_TAG_SCOPE(audio);
+
         job_thread_params* job_params = (job_thread_params*)params;
         _audio_job_thread_info = job_params->job_info;
 
         // create resource slots
         pen::slot_resources_init(&_audio_slot_resources, 128);
-        _cmd_buffer.create(1024);
+        _cmd_buffer.create(1024, e_ring_buffer_full::grow); // drained once per frame
 
         direct::audio_system_initialise();
 
@@ -186,7 +186,7 @@ namespace put
             pen::renderer_update_buffer(vb_3d[VB_TRIS], &debug_3d_tris[0], sizeof(vertex_debug_3d) * tri_vert_3d_count);
             pen::renderer_update_buffer(vb_3d[VB_LINES], &debug_3d_verts[0], sizeof(vertex_debug_3d) * line_vert_3d_count);
 
-            static hash_id ID_DEBUG_3D = PEN_HASH("debug_3d");
+            static hash_id ID_DEBUG_3D = PEN_HASHC("debug_3d");
 
             pmfx::set_technique_perm(debug_shader, ID_DEBUG_3D);
             pen::renderer_set_constant_buffer(cb_3d_view, 1, pen::CBUFFER_BIND_VS); // gles on ios will crash if not set
@@ -214,7 +214,7 @@ namespace put
             pen::renderer_update_buffer(vb_2d[VB_TRIS], &debug_2d_tris[0], sizeof(vertex_debug_2d) * tri_vert_2d_count);
             pen::renderer_update_buffer(vb_2d[VB_LINES], &debug_2d_verts[0], sizeof(vertex_debug_2d) * line_vert_2d_count);
 
-            static hash_id ID_DEBUG_2D = PEN_HASH("debug_2d");
+            static hash_id ID_DEBUG_2D = PEN_HASHC("debug_2d");
 
             pmfx::set_technique_perm(debug_shader, ID_DEBUG_2D);
             pen::renderer_set_constant_buffer(cb_2d_view, 1, pen::CBUFFER_BIND_VS);
@@ -38,21 +38,52 @@ namespace
         u32 raster_state;
         u32 blend_state;
         u32 depth_stencil_state;
-        u32 vertex_buffer;
-        u32 index_buffer;
         u32 font_texture;
         u32 font_sampler_state;
-        u32 vb_size;
-        u32 ib_size;
         u32 constant_buffer;
         u32 imgui_shader;
         u32 imgui_ex_shader;
+    };
+
+    // draw lists are cached per imgui window so idle frames can redraw them without an update, consecutive commands
+    // which share a texture and clip rect are merged into a single draw
+    struct ui_batch
+    {
+        ImDrawCallback callback;
+        void*          callback_data;
+        u32            texture;
+        ImVec4         clip_rect;
+        u32            index_offset;
+        u32            index_count;
+    };
+
+    struct ui_draw_list
+    {
+        const ImDrawList* draw_list;
+        u32               vertex_buffer;
+        u32               index_buffer;
+        u32               vb_size;
+        u32               ib_size;
+        u32               last_used_frame;
+        ui_batch*         batches;
+    };
 
-        void* vb_copy_buffer = nullptr;
-        void* ib_copy_buffer = nullptr;
+    struct ui_cache
+    {
+        ui_draw_list*        draw_lists = nullptr;
+        u32*                 draw_order = nullptr; // indices into draw_lists in the order of the last update
+        u32                  frame = 0;
+        f64                  last_update_ms = 0.0;
+        ImVec2               display_size = ImVec2(0.0f, 0.0f);
+        bool                 input = true; // input this frame, updates are capped while there is none
+        dev_ui::render_stats stats = {};
     };
 
+    static const u32 k_ui_release_frames = 120;   // cached draw lists unused for this many frames are released
+    static const f64 k_ui_idle_update_ms = 100.0; // update interval while there is no input
+
     render_handles s_imgui_rs;
+    ui_cache       s_ui_cache;
     pen::json      s_program_preferences;
     Str            s_program_prefs_filename;
     bool           s_console_open = false;
@@ -103,96 +134,172 @@ namespace
         io.Fonts->TexID = IMG(s_imgui_rs.font_texture);
     }
 
-    void update_dynamic_buffers(ImDrawData* draw_data)
+    u32 create_dynamic_buffer(u32 bind_flags, u32 size)
     {
-        if (s_imgui_rs.vertex_buffer == 0 || (s32)s_imgui_rs.vb_size < draw_data->TotalVtxCount)
-        {
-            if (s_imgui_rs.vertex_buffer != 0)
-            {
-                pen::renderer_release_buffer(s_imgui_rs.vertex_buffer);
-            };
+        pen::buffer_creation_params bcp;
+        bcp.usage_flags = PEN_USAGE_DYNAMIC;
+        bcp.bind_flags = bind_flags;
+        bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
+        bcp.buffer_size = size;
+        bcp.data = (void*)nullptr;
 
-            s_imgui_rs.vb_size = draw_data->TotalVtxCount + 10000;
+        return pen::renderer_create_buffer(bcp);
+    }
 
-            pen::buffer_creation_params bcp;
-            bcp.usage_flags = PEN_USAGE_DYNAMIC;
-            bcp.bind_flags = PEN_BIND_VERTEX_BUFFER;
-            bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
-            bcp.buffer_size = s_imgui_rs.vb_size * sizeof(ImDrawVert);
-            bcp.data = (void*)nullptr;
+    void release_draw_list(ui_draw_list& dl)
+    {
+        pen::renderer_release_buffer(dl.vertex_buffer);
+        pen::renderer_release_buffer(dl.index_buffer);
+        sb_free(dl.batches);
+    }
 
-            if (s_imgui_rs.vb_copy_buffer == nullptr)
-            {
-                s_imgui_rs.vb_copy_buffer = pen::memory_alloc(s_imgui_rs.vb_size * sizeof(ImDrawVert));
-            }
-            else
-            {
-                s_imgui_rs.vb_copy_buffer =
-                    pen::memory_realloc(s_imgui_rs.vb_copy_buffer, s_imgui_rs.vb_size * sizeof(ImDrawVert));
-            }
+    u32 find_draw_list(const ImDrawList* cmd_list)
+    {
+        // one entry per window, a linear search is fine
+        u32 num_lists = sb_count(s_ui_cache.draw_lists);
+        for (u32 i = 0; i < num_lists; ++i)
+            if (s_ui_cache.draw_lists[i].draw_list == cmd_list)
+                return i;
+
+        ui_draw_list dl = {};
+        dl.draw_list = cmd_list;
+        sb_push(s_ui_cache.draw_lists, dl);
+
+        return num_lists;
+    }
+
+    void upload_draw_list(ui_draw_list& dl, const ImDrawList* cmd_list)
+    {
+        u32 num_verts = cmd_list->VtxBuffer.Size;
+        u32 num_indices = cmd_list->IdxBuffer.Size;
 
-            s_imgui_rs.vertex_buffer = pen::renderer_create_buffer(bcp);
+        // grow with some slack so windows which change size every frame do not recreate buffers every frame
+        if (dl.vb_size < num_verts)
+        {
+            if (dl.vertex_buffer)
+                pen::renderer_release_buffer(dl.vertex_buffer);
+
+            dl.vb_size = num_verts + num_verts / 2 + 256;
+            dl.vertex_buffer = create_dynamic_buffer(PEN_BIND_VERTEX_BUFFER, dl.vb_size * sizeof(ImDrawVert));
         }
 
-        if (s_imgui_rs.index_buffer == 0 || (s32)s_imgui_rs.ib_size < draw_data->TotalIdxCount)
+        if (dl.ib_size < num_indices)
         {
-            if (s_imgui_rs.index_buffer != 0)
-            {
-                pen::renderer_release_buffer(s_imgui_rs.index_buffer);
-            };
+            if (dl.index_buffer)
+                pen::renderer_release_buffer(dl.index_buffer);
 
-            s_imgui_rs.ib_size = draw_data->TotalIdxCount + 5000;
+            dl.ib_size = num_indices + num_indices / 2 + 512;
+            dl.index_buffer = create_dynamic_buffer(PEN_BIND_INDEX_BUFFER, dl.ib_size * sizeof(ImDrawIdx));
+        }
+
+        u32 vertex_size = num_verts * sizeof(ImDrawVert);
+        u32 index_size = num_indices * sizeof(ImDrawIdx);
 
-            pen::buffer_creation_params bcp;
-            bcp.usage_flags = PEN_USAGE_DYNAMIC;
-            bcp.bind_flags = PEN_BIND_INDEX_BUFFER;
-            bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
-            bcp.buffer_size = s_imgui_rs.ib_size * sizeof(ImDrawIdx);
-            bcp.data = (void*)nullptr;
+        pen::renderer_update_buffer(dl.vertex_buffer, cmd_list->VtxBuffer.Data, vertex_size);
+        pen::renderer_update_buffer(dl.index_buffer, cmd_list->IdxBuffer.Data, index_size);
 
-            if (s_imgui_rs.ib_copy_buffer == nullptr)
+        s_ui_cache.stats.bytes_uploaded += vertex_size + index_size;
+        s_ui_cache.stats.draw_lists_uploaded++;
+    }
+
+    void build_draw_list_batches(ui_draw_list& dl, const ImDrawList* cmd_list)
+    {
+        if (dl.batches)
+            stb__sbn(dl.batches) = 0;
+
+        u32 index_offset = 0;
+        for (s32 cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+        {
+            const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+
+            ui_batch batch = {};
+            batch.callback = pcmd->UserCallback;
+            batch.callback_data = pcmd->UserCallbackData;
+            batch.texture = (u32)(intptr_t)pcmd->TextureId;
+            batch.clip_rect = pcmd->ClipRect;
+            batch.index_offset = index_offset;
+            batch.index_count = pcmd->ElemCount;
+
+            index_offset += pcmd->ElemCount;
+
+            if (!batch.callback)
             {
-                s_imgui_rs.ib_copy_buffer = pen::memory_alloc(s_imgui_rs.ib_size * sizeof(ImDrawIdx));
+                if (batch.index_count == 0)
+                    continue;
+
+                // merge with the previous draw when only the index range differs
+                u32 num_batches = sb_count(dl.batches);
+                if (num_batches > 0)
+                {
+                    ui_batch& prev = dl.batches[num_batches - 1];
+                    if (!prev.callback && prev.texture == batch.texture &&
+                        memcmp(&prev.clip_rect, &batch.clip_rect, sizeof(ImVec4)) == 0 &&
+                        prev.index_offset + prev.index_count == batch.index_offset)
+                    {
+                        prev.index_count += batch.index_count;
+                        continue;
+                    }
+                }
             }
-            else
+
+            sb_push(dl.batches, batch);
+        }
+    }
+
+    void update_draw_lists(ImDrawData* draw_data)
+    {
+        // release lists whose windows have not been drawn for a while
+        u32 num_lists = sb_count(s_ui_cache.draw_lists);
+        for (u32 i = 0; i < num_lists;)
+        {
+            ui_draw_list& dl = s_ui_cache.draw_lists[i];
+            if (s_ui_cache.frame - dl.last_used_frame < k_ui_release_frames)
             {
-                s_imgui_rs.ib_copy_buffer =
-                    pen::memory_realloc(s_imgui_rs.ib_copy_buffer, s_imgui_rs.ib_size * sizeof(ImDrawIdx));
+                ++i;
+                continue;
             }
 
-            s_imgui_rs.index_buffer = pen::renderer_create_buffer(bcp);
+            release_draw_list(dl);
+            dl = s_ui_cache.draw_lists[--num_lists];
+            stb__sbn(s_ui_cache.draw_lists) = num_lists;
         }
 
-        u32 vb_offset = 0;
-        u32 ib_offset = 0;
+        if (s_ui_cache.draw_order)
+            stb__sbn(s_ui_cache.draw_order) = 0;
 
         for (s32 n = 0; n < draw_data->CmdListsCount; n++)
         {
-            ImDrawList* cmd_list = draw_data->CmdLists[n];
-            u32         vertex_size = cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
-            u32         index_size = cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+            const ImDrawList* cmd_list = draw_data->CmdLists[n];
+            if (cmd_list->IdxBuffer.Size == 0)
+                continue;
 
-            c8* vb_mem = (c8*)s_imgui_rs.vb_copy_buffer;
-            c8* ib_mem = (c8*)s_imgui_rs.ib_copy_buffer;
+            u32           index = find_draw_list(cmd_list);
+            ui_draw_list& dl = s_ui_cache.draw_lists[index];
+            dl.last_used_frame = s_ui_cache.frame;
 
-            memcpy(&vb_mem[vb_offset], cmd_list->VtxBuffer.Data, vertex_size);
-            memcpy(&ib_mem[ib_offset], cmd_list->IdxBuffer.Data, index_size);
+            // hashing the geometry to skip unchanged windows cost more than the upload it saved, updates upload all
+            upload_draw_list(dl, cmd_list);
+            build_draw_list_batches(dl, cmd_list);
 
-            vb_offset += vertex_size;
-            ib_offset += index_size;
+            sb_push(s_ui_cache.draw_order, index);
         }
 
-        pen::renderer_update_buffer(s_imgui_rs.vertex_buffer, s_imgui_rs.vb_copy_buffer, vb_offset);
-        pen::renderer_update_buffer(s_imgui_rs.index_buffer, s_imgui_rs.ib_copy_buffer, ib_offset);
+        // projection only changes with the display size
+        const ImGuiIO& io = ImGui::GetIO();
+        if (io.DisplaySize.x != s_ui_cache.display_size.x || io.DisplaySize.y != s_ui_cache.display_size.y)
+        {
+            f32 L = 0.0f;
+            f32 R = io.DisplaySize.x;
+            f32 B = io.DisplaySize.y;
+            f32 T = 0.0f;
 
-        f32 L = 0.0f;
-        f32 R = ImGui::GetIO().DisplaySize.x;
-        f32 B = ImGui::GetIO().DisplaySize.y;
-        f32 T = 0.0f;
+            mat4 ortho = mat::create_orthographic_projection(L, R, B, T, 0.0f, 1.0f);
 
-        mat4 ortho = mat::create_orthographic_projection(L, R, B, T, 0.0f, 1.0f);
+            pen::renderer_update_buffer(s_imgui_rs.constant_buffer, ortho.m, sizeof(mat4), 0);
 
-        pen::renderer_update_buffer(s_imgui_rs.constant_buffer, ortho.m, sizeof(mat4), 0);
+            s_ui_cache.display_size = io.DisplaySize;
+            s_ui_cache.stats.bytes_uploaded += sizeof(mat4);
+        }
     }
 
     void create_render_states()
@@ -269,12 +376,21 @@ namespace
         // mouse wheel state
         const pen::mouse_state& ms = pen::input_get_mouse_state();
 
-        io.MouseDown[0] = ms.buttons[PEN_MOUSE_L];
-        io.MouseDown[1] = ms.buttons[PEN_MOUSE_R];
-        io.MouseDown[2] = ms.buttons[PEN_MOUSE_M];
+        // any change in input makes the ui update this frame, without it updates are capped
+        bool             any_input = false;
+        static const u32 buttons[] = {PEN_MOUSE_L, PEN_MOUSE_R, PEN_MOUSE_M};
+
+        for (s32 i = 0; i < 3; ++i)
+        {
+            bool down = ms.buttons[buttons[i]];
+            any_input |= down || io.MouseDown[i] != down;
+            io.MouseDown[i] = down;
+        }
 
         static f32 prev_mouse_wheel = (f32)ms.wheel;
 
+        any_input |= (f32)ms.wheel != prev_mouse_wheel || io.MousePos.x != (f32)ms.x || io.MousePos.y != (f32)ms.y;
+
         io.MouseWheel += (f32)ms.wheel - prev_mouse_wheel;
         io.MousePos.x = (f32)ms.x;
         io.MousePos.y = (f32)ms.y;
@@ -283,9 +399,16 @@ namespace
 
         Str input = pen::input_get_unicode_input();
         io.AddInputCharactersUTF8(input.c_str());
+        any_input |= input.length() > 0;
 
         for (s32 i = 0; i < PK_COUNT; ++i)
-            io.KeysDown[i] = pen::input_key(i);
+        {
+            bool down = pen::input_key(i);
+            any_input |= down || io.KeysDown[i] != down;
+            io.KeysDown[i] = down;
+        }
+
+        s_ui_cache.input = any_input;
 
         // Read keyboard modifiers inputs
         io.KeyCtrl = pen::input_key(PK_CONTROL);
@@ -434,6 +557,14 @@ namespace put
 
         void shutdown()
         {
+            u32 num_lists = sb_count(s_ui_cache.draw_lists);
+            for (u32 i = 0; i < num_lists; ++i)
+                release_draw_list(s_ui_cache.draw_lists[i]);
+
+            sb_free(s_ui_cache.draw_lists);
+            sb_free(s_ui_cache.draw_order);
+            s_ui_cache = {};
+
             ImGui::Shutdown();
         }
 
@@ -441,7 +572,20 @@ namespace put
         {
             const ImGuiIO& io = ImGui::GetIO();
 
-            update_dynamic_buffers(draw_data);
+            // without input redraw the last update until the idle interval has passed
+            f64  now = pen::get_time_ms();
+            bool idle = !s_ui_cache.input && now - s_ui_cache.last_update_ms < k_ui_idle_update_ms;
+            bool resized = io.DisplaySize.x != s_ui_cache.display_size.x || io.DisplaySize.y != s_ui_cache.display_size.y;
+
+            s_ui_cache.frame++;
+            s_ui_cache.stats = {};
+            s_ui_cache.stats.throttled = idle && !resized && s_ui_cache.draw_order != nullptr;
+
+            if (!s_ui_cache.stats.throttled)
+            {
+                update_draw_lists(draw_data);
+                s_ui_cache.last_update_ms = now;
+            }
 
             // set to main viewport
             pen::viewport vp = {0.0f, 0.0f, PEN_BACK_BUFFER_RATIO, 1.0f, 0.0f, 1.0};
@@ -456,43 +600,52 @@ namespace put
 
             pmfx::set_technique(s_imgui_rs.imgui_shader, 0);
 
-            int vtx_offset = 0;
-            int idx_offset = 0;
-            for (int n = 0; n < draw_data->CmdListsCount; n++)
+            pen::renderer_set_constant_buffer(s_imgui_rs.constant_buffer, 1, pen::CBUFFER_BIND_VS);
+
+            u32 num_lists = sb_count(s_ui_cache.draw_order);
+            for (u32 n = 0; n < num_lists; n++)
             {
-                const ImDrawList* cmd_list = draw_data->CmdLists[n];
-                for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+                const ui_draw_list& dl = s_ui_cache.draw_lists[s_ui_cache.draw_order[n]];
+
+                pen::renderer_set_vertex_buffer(dl.vertex_buffer, 0, sizeof(ImDrawVert), 0);
+                pen::renderer_set_index_buffer(dl.index_buffer, PEN_FORMAT_R16_UINT, 0);
+
+                u32 num_batches = sb_count(dl.batches);
+                for (u32 b = 0; b < num_batches; ++b)
                 {
-                    const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
-                    if (pcmd->UserCallback)
+                    const ui_batch& batch = dl.batches[b];
+                    if (batch.callback)
                     {
-                        pcmd->UserCallback(cmd_list, pcmd);
+                        ImDrawCmd cmd;
+                        cmd.UserCallback = batch.callback;
+                        cmd.UserCallbackData = batch.callback_data;
+                        batch.callback(dl.draw_list, &cmd);
+                        continue;
                     }
-                    else
-                    {
-                        pen::renderer_set_texture((u32)(intptr_t)pcmd->TextureId, s_imgui_rs.font_sampler_state, 0,
-                                                  pen::TEXTURE_BIND_PS);
 
-                        pen::rect r = {pcmd->ClipRect.x, pcmd->ClipRect.y, pcmd->ClipRect.z, pcmd->ClipRect.w};
+                    pen::renderer_set_texture(batch.texture, s_imgui_rs.font_sampler_state, 0, pen::TEXTURE_BIND_PS);
 
-                        // convert scissor to ratios, for safe window resizing
-                        r.left /= io.DisplaySize.x;
-                        r.top /= io.DisplaySize.y;
-                        r.right /= io.DisplaySize.x;
-                        r.bottom /= io.DisplaySize.y;
+                    pen::rect r = {batch.clip_rect.x, batch.clip_rect.y, batch.clip_rect.z, batch.clip_rect.w};
 
-                        pen::renderer_set_scissor_rect_ratio(r);
+                    // convert scissor to ratios, for safe window resizing
+                    r.left /= io.DisplaySize.x;
+                    r.top /= io.DisplaySize.y;
+                    r.right /= io.DisplaySize.x;
+                    r.bottom /= io.DisplaySize.y;
 
-                        pen::renderer_set_vertex_buffer(s_imgui_rs.vertex_buffer, 0, sizeof(ImDrawVert), 0);
-                        pen::renderer_set_index_buffer(s_imgui_rs.index_buffer, PEN_FORMAT_R16_UINT, 0);
-                        pen::renderer_set_constant_buffer(s_imgui_rs.constant_buffer, 1, pen::CBUFFER_BIND_VS);
+                    pen::renderer_set_scissor_rect_ratio(r);
 
-                        pen::renderer_draw_indexed(pcmd->ElemCount, idx_offset, vtx_offset, PEN_PT_TRIANGLELIST);
-                    }
-                    idx_offset += pcmd->ElemCount;
+                    pen::renderer_draw_indexed(batch.index_count, batch.index_offset, 0, PEN_PT_TRIANGLELIST);
+                    s_ui_cache.stats.draw_calls++;
                 }
-                vtx_offset += cmd_list->VtxBuffer.Size;
             }
+
+            s_ui_cache.stats.draw_lists = num_lists;
+        }
+
+        const render_stats& get_render_stats()
+        {
+            return s_ui_cache.stats;
         }
 
         struct custom_draw_call
@@ -501,13 +654,27 @@ namespace put
             u32       cbuffer;
         };
 
+        // shader and cbuffer are packed into the callback data rather than allocated, cached draw lists replay
+        // callbacks on frames where imgui has not been updated
+        void* _pack_draw_call(ui_shader shader, u32 cbuffer)
+        {
+            return (void*)(((uintptr_t)cbuffer << 4) | (uintptr_t)(shader + 1));
+        }
+
+        custom_draw_call _unpack_draw_call(const void* data)
+        {
+            custom_draw_call cd;
+            cd.shader = (ui_shader)(((uintptr_t)data & 0xf) - 1);
+            cd.cbuffer = (u32)((uintptr_t)data >> 4);
+            return cd;
+        }
+
         void _set_shader_cb(const ImDrawList* parent_list, const ImDrawCmd* cmd)
         {
-            custom_draw_call cd = *(custom_draw_call*)cmd->UserCallbackData;
-            delete (custom_draw_call*)cmd->UserCallbackData;
+            custom_draw_call cd = _unpack_draw_call(cmd->UserCallbackData);
 
-            static hash_id ids[] = {PEN_HASH("tex_2d"), PEN_HASH("tex_cube"), PEN_HASH("tex_volume"),
-                                    PEN_HASH("tex_2d_array"), PEN_HASH("tex_cube_array")};
+            static hash_id ids[] = {PEN_HASHC("tex_2d"), PEN_HASHC("tex_cube"), PEN_HASHC("tex_volume"),
+                                    PEN_HASHC("tex_2d_array"), PEN_HASHC("tex_cube_array")};
 
             if (cd.shader == e_ui_shader::imgui)
             {
@@ -522,15 +689,13 @@ namespace put
 
         void set_shader(ui_shader shader, u32 cbuffer)
         {
-            custom_draw_call* cd = new custom_draw_call();
-            cd->shader = shader;
-            cd->cbuffer = cbuffer;
-
-            ImGui::GetWindowDrawList()->AddCallback(&_set_shader_cb, (void*)cd);
+            ImGui::GetWindowDrawList()->AddCallback(&_set_shader_cb, _pack_draw_call(shader, cbuffer));
         }
 
         void new_frame()
         {
+            PEN_MEMORY_TAG_SCOPE(dev_ui);
+
             process_input();
 
             // toggle enable disable
@@ -578,6 +743,8 @@ namespace put
 
         void render()
         {
+            PEN_MEMORY_TAG_SCOPE(dev_ui);
+
             if (s_enable_rendering)
                 ImGui::Render();
         }
@@ -1488,6 +1655,12 @@ namespace put
                 ImGui::Text("Renderer: %s", ri.renderer);
                 ImGui::Text("Vendor: %s", ri.vendor);
 
+                const render_stats& rs = get_render_stats();
+                ImGui::Separator();
+                ImGui::Text("UI Upload: %u bytes", rs.bytes_uploaded);
+                ImGui::Text("UI Windows: %u / %u uploaded", rs.draw_lists_uploaded, rs.draw_lists);
+                ImGui::Text("UI Draw Calls: %u%s", rs.draw_calls, rs.throttled ? " (idle)" : "");
+
                 ImGui::End();
             }
         }
@@ -65,6 +65,15 @@ namespace put
         }
         typedef e_ui_shader::ui_shader_t ui_shader;
 
+        struct render_stats
+        {
+            u32  bytes_uploaded;      // vertex, index and constant data uploaded by the last render
+            u32  draw_lists;          // windows drawn
+            u32  draw_lists_uploaded; // windows uploaded, all of them on updates and none on idle frames
+            u32  draw_calls;
+            bool throttled;           // no input, the last update was redrawn
+        };
+
         bool        init();
         void        shutdown();
         void        render();
@@ -75,6 +84,9 @@ namespace put
         void        util_init();
         void        enable(bool enabled);
 
+        // ui render stats
+        const render_stats& get_render_stats();
+
         // console
         bool        is_console_open();
         void        show_console(bool val);
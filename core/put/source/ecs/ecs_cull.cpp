@@ -542,6 +542,414 @@ namespace put
             //frustum_cull_sphere_simd256(scene, cam, entities_in, entities_out);
         }
 
+        //
+        // multi frustum, planes are transposed so 4 frusta are tested against an entity at once
+        //
+
+        struct frustum_group
+        {
+            f32 nx[6][4], ny[6][4], nz[6][4]; // plane normals
+            f32 ax[6][4], ay[6][4], az[6][4]; // abs plane normals to project the aabb extent
+            f32 pd[6][4];                     // plane distances
+        };
+
+        pen_inline u32 frustum_group_outside_mask(const frustum_group& g, const vec4f& pos, const vec4f& extent)
+        {
+            // outside if dot(pos, n) - dot(extent, abs(n)) + pd > 0 for any plane, returns a bit per frustum
+#if __SSE__ || __AVX__
+            __m128 px = _mm_set1_ps(pos.x);
+            __m128 py = _mm_set1_ps(pos.y);
+            __m128 pz = _mm_set1_ps(pos.z);
+            __m128 ex = _mm_set1_ps(extent.x);
+            __m128 ey = _mm_set1_ps(extent.y);
+            __m128 ez = _mm_set1_ps(extent.z);
+            __m128 zero = _mm_setzero_ps();
+            __m128 outside = zero;
+
+            for (u32 p = 0; p < 6; ++p)
+            {
+                __m128 d = _mm_mul_ps(px, _mm_loadu_ps(g.nx[p]));
+                d = _mm_add_ps(d, _mm_mul_ps(py, _mm_loadu_ps(g.ny[p])));
+                d = _mm_add_ps(d, _mm_mul_ps(pz, _mm_loadu_ps(g.nz[p])));
+
+                __m128 r = _mm_mul_ps(ex, _mm_loadu_ps(g.ax[p]));
+                r = _mm_add_ps(r, _mm_mul_ps(ey, _mm_loadu_ps(g.ay[p])));
+                r = _mm_add_ps(r, _mm_mul_ps(ez, _mm_loadu_ps(g.az[p])));
+
+                d = _mm_add_ps(_mm_sub_ps(d, r), _mm_loadu_ps(g.pd[p]));
+                outside = _mm_or_ps(outside, _mm_cmpgt_ps(d, zero));
+            }
+
+            return (u32)_mm_movemask_ps(outside);
+#else
+            u32 outside = 0;
+            for (u32 f = 0; f < 4; ++f)
+            {
+                for (u32 p = 0; p < 6; ++p)
+                {
+                    f32 d = pos.x * g.nx[p][f] + pos.y * g.ny[p][f] + pos.z * g.nz[p][f];
+                    f32 r = extent.x * g.ax[p][f] + extent.y * g.ay[p][f] + extent.z * g.az[p][f];
+
+                    if (d - r + g.pd[p][f] > 0.0f)
+                    {
+                        outside |= 1 << f;
+                        break;
+                    }
+                }
+            }
+            return outside;
+#endif
+        }
+
+        void frustum_cull_aabb_multi(const ecs_scene* scene, const frustum* frusta, u32 num_frusta, u32* entities_in,
+                                     u32** entities_out)
+        {
+            if (num_frusta == 0)
+                return;
+
+            // transpose frusta into groups of 4, padding the last group with the last frustum
+            u32            num_groups = (num_frusta + 3) / 4;
+            frustum_group* groups = (frustum_group*)pen::memory_alloc(sizeof(frustum_group) * num_groups);
+
+            for (u32 f = 0; f < num_groups * 4; ++f)
+            {
+                const frustum& frust = frusta[std::min<u32>(f, num_frusta - 1)];
+                frustum_group& g = groups[f / 4];
+                u32            l = f % 4;
+
+                for (u32 p = 0; p < 6; ++p)
+                {
+                    vec3f n = frust.n[p];
+                    g.nx[p][l] = n.x;
+                    g.ny[p][l] = n.y;
+                    g.nz[p][l] = n.z;
+                    g.ax[p][l] = fabs(n.x);
+                    g.ay[p][l] = fabs(n.y);
+                    g.az[p][l] = fabs(n.z);
+                    g.pd[p][l] = maths::plane_distance(frust.p[p], n);
+                }
+            }
+
+            u32 n = sb_count(entities_in);
+            for (u32 i = 0; i < n; ++i)
+            {
+                u32          e = entities_in[i];
+                const vec4f& pos = scene->pos_extent[e].pos;
+                const vec4f& extent = scene->pos_extent[e].extent;
+
+                for (u32 gi = 0; gi < num_groups; ++gi)
+                {
+                    u32 outside = frustum_group_outside_mask(groups[gi], pos, extent);
+                    if (outside == 0xf)
+                        continue;
+
+                    u32 first = gi * 4;
+                    u32 count = std::min<u32>(4, num_frusta - first);
+                    for (u32 l = 0; l < count; ++l)
+                        if (!(outside & (1 << l)))
+                            sb_push(entities_out[first + l], e);
+                }
+            }
+
+            pen::memory_free(groups);
+        }
+
+        //
+        // clustered lights
+        //
+
+        struct cluster_range
+        {
+            u8 x0, x1, y0, y1, z0, z1;
+        };
+
+        bool light_cluster_range(const mat4& view_proj, const vec4f& sphere, const cluster_info_buffer& info,
+                                 cluster_range& range)
+        {
+            const u32 gx = e_scene_limits::cluster_grid_x;
+            const u32 gy = e_scene_limits::cluster_grid_y;
+            const u32 gz = e_scene_limits::cluster_grid_z;
+
+            vec3f c = sphere.xyz;
+            f32   r = sphere.w;
+            f32   zn = info.depth.x;
+            f32   zf = info.depth.y;
+
+            // clip w is the view depth for perspective projections
+            vec4f w_row = view_proj.get_row(3);
+            f32   w_scale = mag(w_row.xyz);
+            f32   wc = dot(w_row.xyz, c) + w_row.w;
+            f32   wmin = wc - r * w_scale;
+            f32   wmax = wc + r * w_scale;
+
+            if (wmax < zn || wmin > zf)
+                return false;
+
+            auto slice = [&](f32 w) -> u8 {
+                f32 s = log(std::max(w, zn)) * info.depth.z + info.depth.w;
+                return (u8)std::min<f32>(std::max<f32>(s, 0.0f), (f32)(gz - 1));
+            };
+
+            range.z0 = slice(wmin);
+            range.z1 = slice(wmax);
+
+            // screen bounds from the corners of the sphere aabb, lights crossing the near plane cover the whole screen
+            range.x0 = 0;
+            range.x1 = gx - 1;
+            range.y0 = 0;
+            range.y1 = gy - 1;
+
+            if (wmin <= zn)
+                return true;
+
+            vec2f smin = vec2f::flt_max();
+            vec2f smax = -vec2f::flt_max();
+            for (u32 i = 0; i < 8; ++i)
+            {
+                vec3f corner = c + vec3f(i & 1 ? r : -r, i & 2 ? r : -r, i & 4 ? r : -r);
+                vec4f p = view_proj.transform_vector(vec4f(corner, 1.0f));
+                if (p.w <= zn)
+                    return true;
+
+                vec2f ndc = p.xy / p.w;
+                smin = min_union(smin, ndc);
+                smax = max_union(smax, ndc);
+            }
+
+            if (smax.x < -1.0f || smin.x > 1.0f || smax.y < -1.0f || smin.y > 1.0f)
+                return false;
+
+            auto tile = [](f32 ndc, u32 g) -> u8 {
+                f32 t = (ndc * 0.5f + 0.5f) * (f32)g;
+                return (u8)std::min<f32>(std::max<f32>(t, 0.0f), (f32)(g - 1));
+            };
+
+            range.x0 = tile(smin.x, gx);
+            range.x1 = tile(smax.x, gx);
+            range.y0 = tile(smin.y, gy);
+            range.y1 = tile(smax.y, gy);
+
+            return true;
+        }
+
+        // the count and fill passes are split by z slice so each thread owns whole clusters and fills them in light
+        // order, helpers are started as jobs on first use and jobs_terminate_all wakes them to exit
+        static const u32 k_cluster_threads = 4;           // including the calling thread
+        static const u32 k_cluster_parallel_lights = 256; // fewer lights run both passes on the calling thread
+
+        struct cluster_pass
+        {
+            const cluster_range* ranges = nullptr;
+            u32*                 counts = nullptr;
+            u32*                 data = nullptr;
+            u32                  num_lights = 0;
+            u32                  num_threads = 1;
+            bool                 fill = false;
+        };
+
+        static cluster_pass    s_cluster_pass;
+        static pen::semaphore* s_cluster_start[k_cluster_threads] = {};
+        static pen::semaphore* s_cluster_done = nullptr;
+        static u32             s_num_cluster_helpers = 0;
+
+        void cluster_pass_slices(const cluster_pass& cp, u32 thread)
+        {
+            const u32 gx = e_scene_limits::cluster_grid_x;
+            const u32 gy = e_scene_limits::cluster_grid_y;
+            const u32 gz = e_scene_limits::cluster_grid_z;
+
+            u32  z_begin = thread * gz / cp.num_threads;
+            u32  z_end = (thread + 1) * gz / cp.num_threads;
+            u32* indices = cp.data + gx * gy * gz * 2;
+
+            for (u32 i = 0; i < cp.num_lights; ++i)
+            {
+                const cluster_range& cr = cp.ranges[i];
+                if (cr.x0 > cr.x1)
+                    continue;
+
+                u32 z0 = std::max<u32>(cr.z0, z_begin);
+                u32 z1 = std::min<u32>(cr.z1 + 1, z_end);
+
+                for (u32 z = z0; z < z1; ++z)
+                {
+                    for (u32 y = cr.y0; y <= cr.y1; ++y)
+                    {
+                        for (u32 x = cr.x0; x <= cr.x1; ++x)
+                        {
+                            u32 c = (z * gy + y) * gx + x;
+                            if (cp.fill)
+                                indices[cp.data[c * 2] + cp.counts[c]++] = i;
+                            else
+                                cp.counts[c]++;
+                        }
+                    }
+                }
+            }
+        }
+
+        void* cluster_thread(void* params)
+        {
+            pen::job_thread_params* job_params = (pen::job_thread_params*)params;
+            pen::job*               p_thread_info = job_params->job_info;
+            u32                     thread = (u32)(size_t)job_params->user_data;
+
+            p_thread_info->p_sem_wake = s_cluster_start[thread];
+            pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+
+            for (;;)
+            {
+                // posted for each pass and by jobs_terminate_all
+                pen::semaphore_wait(s_cluster_start[thread]);
+
+                if (pen::semaphore_try_wait(p_thread_info->p_sem_exit))
+                    break;
+
+                cluster_pass_slices(s_cluster_pass, thread);
+                pen::semaphore_post(s_cluster_done, 1);
+            }
+
+            pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+            pen::semaphore_post(p_thread_info->p_sem_terminated, 1);
+            return PEN_THREAD_OK;
+        }
+
+        void run_cluster_pass(const cluster_pass& cp)
+        {
+            if (cp.num_threads == 1)
+            {
+                cluster_pass_slices(cp, 0);
+                return;
+            }
+
+            s_cluster_pass = cp;
+            for (u32 t = 1; t < cp.num_threads; ++t)
+                pen::semaphore_post(s_cluster_start[t], 1);
+
+            cluster_pass_slices(cp, 0);
+
+            for (u32 t = 1; t < cp.num_threads; ++t)
+                pen::semaphore_wait(s_cluster_done);
+        }
+
+        u32 cluster_pass_threads(u32 num_lights)
+        {
+            if (num_lights < k_cluster_parallel_lights)
+                return 1;
+
+            if (!s_cluster_done)
+            {
+                s_cluster_done = pen::semaphore_create(0, k_cluster_threads);
+
+                // job slots are limited, run with whichever helpers could be started
+                for (u32 t = 1; t < k_cluster_threads; ++t)
+                {
+                    s_cluster_start[t] = pen::semaphore_create(0, 1);
+                    if (!pen::jobs_create_job(cluster_thread, 1024 * 1024, (void*)(size_t)t,
+                                              pen::e_thread_start_flags::detached))
+                    {
+                        pen::semaphore_destroy(s_cluster_start[t]);
+                        s_cluster_start[t] = nullptr;
+                        break;
+                    }
+
+                    s_num_cluster_helpers++;
+                }
+            }
+
+            return 1 + s_num_cluster_helpers;
+        }
+
+        light_cluster_view* cluster_lights(ecs_scene* scene, const camera* cam)
+        {
+            const u32 gx = e_scene_limits::cluster_grid_x;
+            const u32 gy = e_scene_limits::cluster_grid_y;
+            const u32 gz = e_scene_limits::cluster_grid_z;
+            const u32 num_clusters = gx * gy * gz;
+
+            light_clusters& lc = scene->clusters;
+            u32             num_lights = sb_count(lc.lights);
+            mat4            view_proj = cam->proj * cam->view;
+
+            // views rendered from the same camera share clusters, the matrix catches cameras updated mid frame
+            for (u32 v = 0; v < lc.num_views; ++v)
+            {
+                light_cluster_view& cached = lc.views[v];
+                if (cached.cam == cam && memcmp(&cached.view_proj, &view_proj, sizeof(mat4)) == 0)
+                    return &cached;
+            }
+
+            if (lc.num_views == sb_count(lc.views))
+                sb_push(lc.views, light_cluster_view());
+
+            light_cluster_view& lcv = lc.views[lc.num_views++];
+            lcv.cam = cam;
+            lcv.view_proj = view_proj;
+
+            // log depth slices, slice = log(depth) * scale + bias
+            f32 zn = std::max<f32>(cam->near_plane, 0.01f);
+            f32 zf = std::max<f32>(cam->far_plane, zn + 1.0f);
+            f32 log_range = log(zf / zn);
+
+            lcv.info.grid = vec4f((f32)gx, (f32)gy, (f32)gz, (f32)num_lights);
+            lcv.info.depth = vec4f(zn, zf, (f32)gz / log_range, -(f32)gz * log(zn) / log_range);
+
+            if (lc.counts)
+                stb__sbn(lc.counts) = 0;
+
+            sb_add(lc.counts, num_clusters);
+            memset(lc.counts, 0x0, sizeof(u32) * num_clusters);
+
+            cluster_range* ranges = (cluster_range*)pen::memory_alloc(sizeof(cluster_range) * std::max<u32>(num_lights, 1));
+            u32            num_indices = 0;
+
+            for (u32 i = 0; i < num_lights; ++i)
+            {
+                cluster_range& cr = ranges[i];
+                if (!light_cluster_range(view_proj, lc.bounds[i], lcv.info, cr))
+                {
+                    cr.x0 = 1;
+                    cr.x1 = 0;
+                    continue;
+                }
+
+                num_indices += (cr.x1 - cr.x0 + 1) * (cr.y1 - cr.y0 + 1) * (cr.z1 - cr.z0 + 1);
+            }
+
+            // offset and count per cluster, indices follow
+            u32 data_size = num_clusters * 2 + num_indices;
+            if (lcv.data)
+                stb__sbn(lcv.data) = 0;
+
+            sb_add(lcv.data, data_size);
+            lcv.data_size = data_size;
+
+            // count lights per cluster
+            cluster_pass cp;
+            cp.ranges = ranges;
+            cp.counts = lc.counts;
+            cp.data = lcv.data;
+            cp.num_lights = num_lights;
+            cp.num_threads = cluster_pass_threads(num_lights);
+            run_cluster_pass(cp);
+
+            u32 offset = 0;
+            for (u32 c = 0; c < num_clusters; ++c)
+            {
+                lcv.data[c * 2 + 0] = offset;
+                lcv.data[c * 2 + 1] = lc.counts[c];
+                offset += lc.counts[c];
+                lc.counts[c] = 0;
+            }
+
+            // write light indices, counts are reused as the fill position per cluster
+            cp.fill = true;
+            run_cluster_pass(cp);
+
+            pen::memory_free(ranges);
+            return &lcv;
+        }
+
         void debug_culling()
         {
             // debug culling
@@ -8,6 +8,7 @@ namespace put
     namespace ecs
     {
         struct ecs_scene;
+        struct light_cluster_view;
 
         // run time detect of simd extensions and setup function pointers to the fastest implementation
         void simd_init();
@@ -20,5 +21,15 @@ namespace put
         // frustum_cull_xxx functions are replaced by simd where available and fall back to scalar if no simd is available
         void frustum_cull_aabb(const ecs_scene* scene, const camera* cam, u32* entities_in, u32** entities_out);
         void frustum_cull_sphere(const ecs_scene* scene, const camera* cam, u32* entities_in, u32** entities_out);
+
+        // culls entities_in against num_frusta in a single pass, entities inside frusta[i] are pushed to entities_out[i].
+        // frusta are tested 4 at a time with simd where available.
+        void frustum_cull_aabb_multi(const ecs_scene* scene, const frustum* frusta, u32 num_frusta, u32* entities_in,
+                                     u32** entities_out);
+
+        // assigns scene->clusters.lights to a froxel grid for cam, cells are screen space tiles by log distributed
+        // depth slices. results are cached per camera and view projection until scene->clusters.num_views is reset,
+        // the returned pointer is valid until the next call. large light counts split z slices over helper threads.
+        light_cluster_view* cluster_lights(ecs_scene* scene, const camera* cam);
     } // namespace ecs
 } // namespace put
@@ -28,10 +28,10 @@ using namespace ecs;
 
 namespace
 {
-    const hash_id ID_PICKING_BUFFER = PEN_HASH("picking");
+    const hash_id ID_PICKING_BUFFER = PEN_HASHC("picking");
 
-    const hash_id ID_PRIMITIVE[] = {PEN_HASH("quad"),   PEN_HASH("cube"),    PEN_HASH("cylinder"),
-                                    PEN_HASH("sphere"), PEN_HASH("capsule"), PEN_HASH("cone")};
+    const hash_id ID_PRIMITIVE[] = {PEN_HASHC("quad"),   PEN_HASHC("cube"),    PEN_HASHC("cylinder"),
+                                    PEN_HASHC("sphere"), PEN_HASHC("capsule"), PEN_HASHC("cone")};
 
     const c8* k_camera_mode_names[] = {"Modelling", "Fly"};
 
@@ -101,6 +101,8 @@ namespace
         f32                  grid_cell_size;
         f32                  grid_size;
         Str                  current_working_scene = "";
+        bool                 autosave = false;
+        f32                  autosave_interval = 60.0f;
     };
 
     struct node_state
@@ -223,14 +225,14 @@ namespace put
             // add light
             u32 light = get_new_entity(scene);
             scene->names[light] = "front_light";
-            scene->id_name[light] = PEN_HASH("front_light");
+            scene->id_name[light] = PEN_HASHC("front_light");
             scene->lights[light].colour = vec3f::one();
             scene->lights[light].direction = vec3f::one();
             scene->lights[light].type = e_light_type::dir;
             scene->transforms[light].translation = vec3f::zero();
             scene->transforms[light].rotation = quat();
             scene->transforms[light].scale = vec3f::one();
-            scene->entities[light] |= e_cmp::light;
+            add_components(scene, light, e_cmp::light);
             scene->entities[light] |= e_cmp::transform;
             instantiate_model_cbuffer(scene, light);
 
@@ -277,6 +279,8 @@ namespace put
             s_model_view_controller.settings.invert_x = dev_ui::get_program_preference("camera_invert_x").as_bool();
             s_model_view_controller.settings.invert_y = dev_ui::get_program_preference("camera_invert_y").as_bool();
             s_model_view_controller.settings.zoom_speed = dev_ui::get_program_preference("camera_zoom_speed").as_f32(1.0f);
+            s_model_view_controller.autosave = dev_ui::get_program_preference("autosave").as_bool();
+            s_model_view_controller.autosave_interval = dev_ui::get_program_preference("autosave_interval").as_f32(60.0f);
             s_model_view_controller.invalidated = true;
 
             ecs_controller controller;
@@ -317,7 +321,7 @@ namespace put
             if (scene->entities[master] & e_cmp::master_instance)
                 return;
 
-            scene->entities[master] |= e_cmp::master_instance;
+            add_components(scene, master, e_cmp::master_instance);
 
             scene->master_instances[master].num_instances = selection_size;
             scene->master_instances[master].instance_stride = sizeof(cmp_draw_call);
@@ -670,8 +674,15 @@ namespace put
                     u32 pitch = (u32)w * 4;
                     u32 data_size = (u32)h * pitch;
 
-                    pen::resource_read_back_params rrbp = {rt->handle, rt->format,        pitch, data_size, 4,
-                                                           data_size,  &picking_read_back};
+                    pen::resource_read_back_params rrbp;
+                    rrbp.resource_index = rt->handle;
+                    rrbp.format = rt->format;
+                    rrbp.row_pitch = pitch;
+                    rrbp.depth_pitch = data_size;
+                    rrbp.block_size = 4;
+                    rrbp.data_size = data_size;
+                    rrbp.call_back_function = &picking_read_back;
+                    rrbp.max_latency = 3; // result is polled for, no need to stall the render thread
 
                     pen::renderer_read_back_resource(rrbp);
 
@@ -827,6 +838,8 @@ namespace put
                 memcpy(cmp[node_index], ns.components[i], cmp.size);
             }
 
+            update_component_sets(scene, node_index);
+
             node_state& us = s_editor_nodes[node_index].action_state[e_editor_actions::undo];
             node_state& rs = s_editor_nodes[node_index].action_state[e_editor_actions::redo];
 
@@ -991,6 +1004,25 @@ namespace put
                     }
                 }
 
+                if (ImGui::Checkbox("Autosave", &s_model_view_controller.autosave))
+                {
+                    dev_ui::set_program_preference("autosave", s_model_view_controller.autosave);
+                }
+
+                if (s_model_view_controller.autosave)
+                {
+                    if (ImGui::InputFloat("Autosave Interval (s)", &s_model_view_controller.autosave_interval))
+                    {
+                        dev_ui::set_program_preference("autosave_interval", s_model_view_controller.autosave_interval);
+                    }
+
+                    ecs::scene_autosave_stats stats = ecs::get_scene_autosave_stats();
+                    ImGui::Text("Saves: %i (%i full), last wrote %i bytes", stats.num_saves, stats.num_full_saves,
+                                (s32)stats.bytes_written);
+                    ImGui::Text("Capture: %.3f(ms), frame max %.3f(ms), write %.3f(ms)", stats.capture_ms,
+                                stats.capture_max_ms, stats.serialise_ms);
+                }
+
                 if (ImGui::Button("Set Project Dir"))
                 {
                     set_project_dir = true;
@@ -1436,6 +1468,15 @@ namespace put
                 }
             }
 
+            // autosave alongside the working scene, the autosave can be opened like any other .pms
+            if (s_model_view_controller.autosave && s_model_view_controller.current_working_scene.length() > 0)
+            {
+                Str autosave_file = pen::str_replace_string(s_model_view_controller.current_working_scene, ".pms", "");
+                autosave_file.append(".autosave.pms");
+
+                put::ecs::update_scene_autosave(scene, autosave_file.c_str(), s_model_view_controller.autosave_interval);
+            }
+
             if (dev_open)
             {
                 if (ImGui::Begin("Dev", &dev_open))
@@ -1752,7 +1793,7 @@ namespace put
 
                     instantiate_geometry(gr, scene, selected_index);
 
-                    material_resource* mr = get_material_resource(PEN_HASH("default_material"));
+                    material_resource* mr = get_material_resource(PEN_HASHC("default_material"));
 
                     instantiate_material(mr, scene, selected_index);
 
@@ -2250,15 +2291,26 @@ namespace put
                     bool changed = ImGui::Combo("Type", (s32*)&scene->lights[selected_index].type,
                                                 "Directional\0Point\0Spot\0Area\0Area Ex\0", 4);
 
+                    // area lights have their own set
+                    if (changed)
+                        update_component_sets(scene, selected_index);
+
                     if (snl.azimuth == 0.0f && snl.altitude == 0.0f)
                         maths::xyz_to_azimuth_altitude(snl.direction, snl.azimuth, snl.altitude);
 
                     bool edited = changed;
 
                     u32 flags = snl.flags;
-                    ImGui::CheckboxFlags("Shadow Map", &flags, 1);
+                    ImGui::CheckboxFlags("Shadow Map", &flags, e_light_flags::shadow_map);
+                    ImGui::CheckboxFlags("Cache Shadow", &flags, e_light_flags::shadow_cache);
                     snl.flags = flags;
 
+                    if (flags & e_light_flags::shadow_cache)
+                    {
+                        shadow_cache_stats stats = get_shadow_cache_stats(scene);
+                        ImGui::Text("Shadow views cached: %i / %i", stats.num_cached_views, stats.num_views);
+                    }
+
                     switch (scene->lights[selected_index].type)
                     {
                         case e_light_type::dir:
@@ -2398,7 +2450,7 @@ namespace put
                         scene->state_flags[si] &= e_state::no_shadow;
 
                     if (caster_type == 2)
-                        scene->entities[si] |= e_cmp::sdf_shadow;
+                        add_components(scene, si, e_cmp::sdf_shadow);
                 }
 
                 if (caster_type == CAST_SDF)
@@ -2580,7 +2632,7 @@ namespace put
                     if (ImGui::InputText("", buf, 64))
                     {
                         scene->names[selected_index] = buf;
-                        scene->id_name[selected_index] = PEN_HASH(buf);
+                        scene->id_name[selected_index] = pen::hash_intern(buf);
                     }
 
                     ImGui::SameLine();
@@ -3111,9 +3163,9 @@ namespace put
 
             pen::renderer_set_constant_buffer(view.cb_view, 0, pen::CBUFFER_BIND_PS | pen::CBUFFER_BIND_VS);
 
-            static const hash_id id_volume[] = {PEN_HASH("full_screen_quad"), PEN_HASH("sphere"), PEN_HASH("cone")};
+            static const hash_id id_volume[] = {PEN_HASHC("full_screen_quad"), PEN_HASHC("sphere"), PEN_HASHC("cone")};
 
-            static const hash_id id_technique = PEN_HASH("constant_colour");
+            static const hash_id id_technique = PEN_HASHC("constant_colour");
             static const u32     shader = pmfx::load_shader("pmfx_utility");
 
             geometry_resource* volume[PEN_ARRAY_SIZE(id_volume)];
@@ -3467,8 +3519,8 @@ namespace put
             put::dbg::render_3d(view.cb_view);
 
             // no depth test and default raster state
-            static hash_id id_disabled = PEN_HASH("disabled");
-            static hash_id id_default = PEN_HASH("default");
+            static hash_id id_disabled = PEN_HASHC("disabled");
+            static hash_id id_default = PEN_HASHC("default");
 
             u32 depth_disabled = pmfx::get_render_state(id_disabled, pmfx::e_render_state::depth_stencil);
             u32 fill = pmfx::get_render_state(id_default, pmfx::e_render_state::rasterizer);
@@ -125,8 +125,8 @@ namespace put
             p_geometry->min_extents = -vec3f(1.0f, 0.00001f, 1.0f);
             p_geometry->max_extents = vec3f(1.0f, 0.00001f, 1.0f);
             p_geometry->geometry_name = "quad";
-            p_geometry->hash = PEN_HASH("quad");
-            p_geometry->file_hash = PEN_HASH("primitive");
+            p_geometry->hash = PEN_HASHC("quad");
+            p_geometry->file_hash = PEN_HASHC("primitive");
             p_geometry->filename = "primitive";
             p_geometry->p_skin = nullptr;
 
@@ -176,8 +176,8 @@ namespace put
             p_geometry->min_extents = -vec3f(1.0f, 1.0f, 0.0f);
             p_geometry->max_extents = vec3f(1.0f, 1.0f, 0.0f);
             p_geometry->geometry_name = "full_screen_quad";
-            p_geometry->hash = PEN_HASH("full_screen_quad");
-            p_geometry->file_hash = PEN_HASH("primitive");
+            p_geometry->hash = PEN_HASHC("full_screen_quad");
+            p_geometry->file_hash = PEN_HASHC("primitive");
             p_geometry->filename = "primitive";
             p_geometry->p_skin = nullptr;
 
@@ -333,7 +333,7 @@ namespace put
             p_geometry->max_extents = vec3f(1.0f, top, 1.0f);
             p_geometry->geometry_name = name;
             p_geometry->hash = PEN_HASH(name);
-            p_geometry->file_hash = PEN_HASH("primitive");
+            p_geometry->file_hash = PEN_HASHC("primitive");
             p_geometry->filename = "primitive";
             p_geometry->p_skin = nullptr;
 
@@ -472,8 +472,8 @@ namespace put
 
             // hash / ids
             p_geometry->geometry_name = "capsule";
-            p_geometry->hash = PEN_HASH("capsule");
-            p_geometry->file_hash = PEN_HASH("primitive");
+            p_geometry->hash = PEN_HASHC("capsule");
+            p_geometry->file_hash = PEN_HASHC("primitive");
             p_geometry->filename = "primitive";
             p_geometry->p_skin = nullptr;
 
@@ -592,8 +592,8 @@ namespace put
 
             // hash / ids
             p_geometry->geometry_name = "sphere";
-            p_geometry->hash = PEN_HASH("sphere");
-            p_geometry->file_hash = PEN_HASH("primitive");
+            p_geometry->hash = PEN_HASHC("sphere");
+            p_geometry->file_hash = PEN_HASHC("primitive");
             p_geometry->filename = "primitive";
             p_geometry->p_skin = nullptr;
 
@@ -741,8 +741,8 @@ namespace put
 
             // hash / ids
             p_geometry->geometry_name = "cube";
-            p_geometry->hash = PEN_HASH("cube");
-            p_geometry->file_hash = PEN_HASH("primitive");
+            p_geometry->hash = PEN_HASHC("cube");
+            p_geometry->file_hash = PEN_HASHC("primitive");
             p_geometry->filename = "primitive";
             p_geometry->p_skin = nullptr;
 
@@ -934,8 +934,8 @@ namespace put
             p_geometry->min_extents = -vec3f::one();
             p_geometry->max_extents = vec3f::one();
             p_geometry->geometry_name = "cylinder";
-            p_geometry->hash = PEN_HASH("cylinder");
-            p_geometry->file_hash = PEN_HASH("primitive");
+            p_geometry->hash = PEN_HASHC("cylinder");
+            p_geometry->file_hash = PEN_HASHC("primitive");
             p_geometry->filename = "primitive";
             p_geometry->p_skin = nullptr;
 
@@ -991,7 +991,7 @@ namespace put
             
             p_geometry->geometry_name = name;
             p_geometry->hash = PEN_HASH(name.c_str());
-            p_geometry->file_hash = PEN_HASH("primitive");
+            p_geometry->file_hash = PEN_HASHC("primitive");
             p_geometry->filename = "primitive";
             p_geometry->p_skin = nullptr;
 
@@ -1407,7 +1407,7 @@ namespace put
             memcpy(&mr->data[4], &f, sizeof(vec4f));
 
             mr->material_name = "default_material";
-            mr->hash = PEN_HASH("default_material");
+            mr->hash = PEN_HASHC("default_material");
 
             static const u32 default_maps[] = {put::load_texture("data/textures/defaults/albedo.dds"),
                                                put::load_texture("data/textures/defaults/normal.dds"),
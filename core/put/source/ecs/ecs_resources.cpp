@@ -25,9 +25,9 @@ using namespace ecs;
 namespace
 {
     // id hashes
-    const hash_id ID_CONTROL_RIG = PEN_HASH("controlrig");
-    const hash_id ID_JOINT = PEN_HASH("joint");
-    const hash_id ID_TRAJECTORY = PEN_HASH("trajectoryshjnt");
+    const hash_id ID_CONTROL_RIG = PEN_HASHC("controlrig");
+    const hash_id ID_JOINT = PEN_HASHC("joint");
+    const hash_id ID_TRAJECTORY = PEN_HASHC("trajectoryshjnt");
 
     // constants
     static const u32 k_matrix_floats = 16;
@@ -456,7 +456,7 @@ namespace
         // root node
         u32 root = nodes_start;
         scene->names[root] = pen::str_basename(filename);
-        scene->id_name[root] = PEN_HASH(scene->names[root]);
+        scene->id_name[root] = pen::hash_intern(scene->names[root].c_str());
         scene->parents[root] = nodes_start;
         scene->transforms[root].scale = vec3f::one();
         scene->transforms[root].translation = vec3f::zero();
@@ -478,8 +478,8 @@ namespace
             Str node_name = read_parsable_string(&p_u32reader);
             Str geometry_name = read_parsable_string(&p_u32reader);
 
-            scene->id_name[current_node] = PEN_HASH(node_name.c_str());
-            scene->id_geometry[current_node] = PEN_HASH(geometry_name.c_str());
+            scene->id_name[current_node] = pen::hash_intern(node_name.c_str());
+            scene->id_geometry[current_node] = pen::hash_intern(geometry_name.c_str());
 
             scene->names[current_node] = node_name;
             scene->geometry_names[current_node] = geometry_name;
@@ -723,7 +723,7 @@ namespace
                         }
                         else
                         {
-                            static hash_id id_default = PEN_HASH("default_material");
+                            static hash_id id_default = PEN_HASHC("default_material");
 
                             mr = get_material_resource(id_default);
 
@@ -927,7 +927,7 @@ namespace put
             }
 
             scene->physics_data[entity_index].type = e_physics_type::rigid_body;
-            scene->entities[s] |= e_cmp::physics;
+            add_components(scene, s, e_cmp::physics);
         }
 
         using physics::rigid_body_params;
@@ -955,7 +955,7 @@ namespace put
             u32* child_handles = nullptr;
             scene->physics_handles[parent] = physics::add_compound_rb(cbpr, &child_handles);
             scene->physics_data[parent].type = e_physics_type::rigid_body;
-            scene->entities[parent] |= e_cmp::physics;
+            add_components(scene, parent, e_cmp::physics);
 
             // fixup children
             PEN_ASSERT(sb_count(child_handles) == num_children);
@@ -964,7 +964,7 @@ namespace put
                 u32 ci = children[i];
                 scene->physics_handles[ci] = child_handles[i];
                 scene->physics_data[ci].type = e_physics_type::compound_child;
-                scene->entities[ci] |= e_cmp::physics;
+                add_components(scene, ci, e_cmp::physics);
             }
         }
 
@@ -973,7 +973,7 @@ namespace put
             if (!(scene->entities[entity_index] & e_cmp::physics))
                 return;
 
-            scene->entities[entity_index] &= ~e_cmp::physics;
+            remove_components(scene, entity_index, e_cmp::physics);
 
             physics::release_entity(scene->physics_handles[entity_index]);
             scene->physics_handles[entity_index] = PEN_INVALID_HANDLE;
@@ -1006,7 +1006,7 @@ namespace put
             scene->entities[entity_index] |= e_cmp::geometry;
 
             if (gr->p_skin)
-                scene->entities[entity_index] |= e_cmp::skinned;
+                add_components(scene, entity_index, e_cmp::skinned);
 
             instance->vertex_shader_class = ID_VERTEX_CLASS_BASIC;
             if (scene->entities[entity_index] & e_cmp::skinned)
@@ -1144,8 +1144,8 @@ namespace put
             geom.num_vertices = pre_skin.num_verts;
 
             // set pre-skinned and unset skinned
-            scene->entities[entity_index] |= e_cmp::pre_skinned;
-            scene->entities[entity_index] &= ~e_cmp::skinned;
+            add_components(scene, entity_index, e_cmp::pre_skinned);
+            remove_components(scene, entity_index, e_cmp::skinned);
 
             geom.vertex_shader_class = ID_VERTEX_CLASS_BASIC;
         }
@@ -1178,7 +1178,7 @@ namespace put
                 controller.root_joint_ref = ecs::get_ref_from_index(scene, joints_offset);
                 controller.playback_rate = 1.0f;
 
-                scene->entities[entity_index] |= e_cmp::anim_controller;
+                add_components(scene, entity_index, e_cmp::anim_controller);
             }
         }
 
@@ -1193,8 +1193,8 @@ namespace put
 
             hash_id id_type = pmv["volume_type"].as_hash_id();
 
-            static hash_id id_sdf = PEN_HASH("signed_distance_field");
-            static hash_id id_cl = PEN_HASH("clamp_linear");
+            static hash_id id_sdf = PEN_HASHC("signed_distance_field");
+            static hash_id id_cl = PEN_HASHC("clamp_linear");
             if (id_type != id_sdf)
             {
                 dev_console_log_level(dev_ui::console_level::error, "[shadow] %s is not a signed distance field texture",
@@ -1205,7 +1205,7 @@ namespace put
             scene->transforms[entity_index].scale = scale;
             scene->shadows[entity_index].texture_handle = volume_texture;
             scene->shadows[entity_index].sampler_state = pmfx::get_render_state(id_cl, pmfx::e_render_state::sampler);
-            scene->entities[entity_index] |= e_cmp::sdf_shadow;
+            add_components(scene, entity_index, e_cmp::sdf_shadow);
         }
 
         void instantiate_light(ecs_scene* scene, u32 entity_index)
@@ -1214,7 +1214,7 @@ namespace put
                 return;
 
             // cbuffer for draw call, light volume for editor / deferred etc
-            scene->entities[entity_index] |= e_cmp::light;
+            add_components(scene, entity_index, e_cmp::light);
             instantiate_model_cbuffer(scene, entity_index);
 
             scene->bounding_volumes[entity_index].min_extents = -vec3f::one();
@@ -1241,11 +1241,11 @@ namespace put
 
         void instantiate_area_light(ecs_scene* scene, u32 entity_index)
         {
-            geometry_resource* gr = get_geometry_resource(PEN_HASH("quad"));
+            geometry_resource* gr = get_geometry_resource(PEN_HASHC("quad"));
 
             material_resource area_light_material;
-            area_light_material.id_shader = PEN_HASH("pmfx_utility");
-            area_light_material.id_technique = PEN_HASH("area_light_colour");
+            area_light_material.id_shader = PEN_HASHC("pmfx_utility");
+            area_light_material.id_technique = PEN_HASHC("area_light_colour");
             area_light_material.material_name = "area_light_colour";
             area_light_material.shader_name = "pmfx_utility";
 
@@ -1253,18 +1253,18 @@ namespace put
             instantiate_material(&area_light_material, scene, entity_index);
             instantiate_model_cbuffer(scene, entity_index);
 
-            scene->entities[entity_index] |= e_cmp::light;
             scene->lights[entity_index].type = e_light_type::area;
+            add_components(scene, entity_index, e_cmp::light);
             scene->area_light[entity_index].shader = PEN_INVALID_HANDLE;
         }
 
         void instantiate_area_light_ex(ecs_scene* scene, u32 entity_index, area_light_resource& alr)
         {
-            geometry_resource* gr = get_geometry_resource(PEN_HASH("quad"));
+            geometry_resource* gr = get_geometry_resource(PEN_HASHC("quad"));
 
             material_resource area_light_material;
-            area_light_material.id_shader = PEN_HASH("pmfx_utility");
-            area_light_material.id_technique = PEN_HASH("area_light_texture");
+            area_light_material.id_shader = PEN_HASHC("pmfx_utility");
+            area_light_material.id_technique = PEN_HASHC("area_light_texture");
             area_light_material.material_name = "area_light_texture";
             area_light_material.shader_name = "pmfx_utility";
 
@@ -1272,8 +1272,8 @@ namespace put
             instantiate_material(&area_light_material, scene, entity_index);
             instantiate_model_cbuffer(scene, entity_index);
 
-            scene->entities[entity_index] |= e_cmp::light;
             scene->lights[entity_index].type = e_light_type::area_ex;
+            add_components(scene, entity_index, e_cmp::light);
 
             if (!alr.texture_name.empty())
             {
@@ -1307,24 +1307,21 @@ namespace put
             // set defaults
             if (mr->id_shader == 0)
             {
-                static hash_id id_default_shader = PEN_HASH("forward_render");
-                static hash_id id_default_technique = PEN_HASH("forward_lit");
+                static hash_id id_default_shader = PEN_HASHC("forward_render");
+                static hash_id id_default_technique = PEN_HASHC("forward_lit");
 
                 mr->shader_name = "forward_render";
                 mr->id_shader = id_default_shader;
                 mr->id_technique = id_default_technique;
             }
 
-            static hash_id id_default_sampler_state = PEN_HASH("wrap_linear");
+            static hash_id id_default_sampler_state = PEN_HASHC("wrap_linear");
 
             for (u32 i = 0; i < e_texture::COUNT; ++i)
             {
                 if (!mr->id_sampler_state[i])
                     mr->id_sampler_state[i] = id_default_sampler_state;
             }
-            
-            memset(&scene->material_resources[entity_index].shader_name , 0x00, sizeof(Str));
-            memset(&scene->material_resources[entity_index].material_name , 0x00, sizeof(Str));
 
             scene->material_resources[entity_index] = *mr;
 
@@ -1362,7 +1359,13 @@ namespace put
             // permutation form geom
             permutation_flags_from_vertex_class(permutation, geometry->vertex_shader_class);
 
+            // techniques without a clustered_lights permutation mask the flag out
+            permutation &= ~e_shader_permutation::clustered_lights;
+            if (scene->flags & e_scene_flags::clustered_lights)
+                permutation |= e_shader_permutation::clustered_lights;
+
             // technique / permutation
+
             material->technique_index = pmfx::get_technique_index_perm(material->shader, resource->id_technique, permutation);
             PEN_ASSERT(is_valid(material->technique_index));
 
@@ -1401,7 +1404,7 @@ namespace put
                     }
                 }
 
-                scene->entities[entity_index] |= e_cmp::samplers;
+                add_components(scene, entity_index, e_cmp::samplers);
                 scene->state_flags[entity_index] |= e_state::samplers_initialised;
             }
 
@@ -2083,9 +2086,9 @@ namespace put
             hash_id id_type = pmv["volume_type"].as_hash_id();
 
             static volume_instance vi[] = {
-                {PEN_HASH("volume_texture"), PEN_HASH("volume_texture"), PEN_HASH("clamp_point"), e_cmp::volume},
+                {PEN_HASHC("volume_texture"), PEN_HASHC("volume_texture"), PEN_HASHC("clamp_point"), e_cmp::volume},
 
-                {PEN_HASH("signed_distance_field"), PEN_HASH("volume_sdf"), PEN_HASH("clamp_linear"), e_cmp::sdf_shadow}};
+                {PEN_HASHC("signed_distance_field"), PEN_HASHC("volume_sdf"), PEN_HASHC("clamp_linear"), e_cmp::sdf_shadow}};
 
             int i = 0;
             for (auto& v : vi)
@@ -2100,12 +2103,12 @@ namespace put
             material_resource* material = new material_resource;
             material->material_name = "volume_sdf_material";
             material->shader_name = "pmfx_utility";
-            material->id_shader = PEN_HASH("pmfx_utility");
+            material->id_shader = PEN_HASHC("pmfx_utility");
             material->id_technique = vi[i].id_technique;
 
             add_material_resource(material);
 
-            geometry_resource* cube = get_geometry_resource(PEN_HASH("cube"));
+            geometry_resource* cube = get_geometry_resource(PEN_HASHC("cube"));
 
             vec3f pos = vec3f::zero();
 
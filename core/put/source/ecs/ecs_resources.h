@@ -110,6 +110,17 @@ namespace put
         }
         typedef u32 pmm_load_flags;
 
+        namespace e_scene_save_flags
+        {
+            enum scene_save_flags_t
+            {
+                none = 0,
+                compress = 1 << 0,  // lz4 compress chunks, compressed chunks cannot be mapped directly and load slower
+                version_10 = 1 << 1 // version 10 section stream, to compare load times against the chunked format
+            };
+        }
+        typedef u32 scene_save_flags;
+
         namespace e_pmm_renderable
         {
             enum pmm_renderable_t
@@ -266,10 +277,27 @@ namespace put
             f32 x, y, z, w;
         };
 
-        void save_scene(const c8* filename, ecs_scene* scene);
+        struct scene_autosave_stats
+        {
+            u32 num_saves = 0;
+            u32 num_full_saves = 0;
+            u64 bytes_written = 0;    // last save
+            f64 capture_ms = 0.0;     // main thread time spent capturing the last snapshot, spread over many frames
+            f64 capture_max_ms = 0.0; // most main thread time spent capturing in a single frame
+            f64 serialise_ms = 0.0;   // background thread time spent writing the last save
+        };
+
+        void save_scene(const c8* filename, ecs_scene* scene, u32 save_flags = e_scene_save_flags::none);
         void save_sub_scene(ecs_scene* scene, u32 root);
         void load_scene(const c8* filename, ecs_scene* scene, bool merge = false);
 
+        // call once per frame, every interval the scene is captured into a snapshot in blocks of entities within
+        // budget_ms per frame, a background thread then writes the whole scene the first time and only the ranges of
+        // component arrays which have changed since the last snapshot after that. the output is a regular .pms file
+        void                 update_scene_autosave(ecs_scene* scene, const c8* filename, f32 interval_s,
+                                                   f32 budget_ms = 0.5f);
+        scene_autosave_stats get_scene_autosave_stats(); // copy of the stats published by the last save
+
         s32 load_pmm(const c8* model_scene_name, ecs_scene* scene = nullptr, u32 load_flags = e_pmm_load_flags::all);
         s32 load_pma(const c8* model_scene_name);
         s32 load_pmv(const c8* filename, ecs_scene* scene);
@@ -2,9 +2,12 @@
 // Copyright 2014 - 2019 Alex Dixon.
 // License: https://github.com/polymonster/pmtech/blob/master/license.md
 
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <functional>
 
+#include "compression.h"
 #include "console.h"
 #include "data_struct.h"
 #include "debug_render.h"
@@ -151,8 +154,108 @@ namespace put
             initialise_free_list(scene);
         }
 
+        static const u64 k_set_cmp[e_cmp_set::count] = {
+            e_cmp::light,
+            0, // area lights are identified by light type
+            e_cmp::physics,
+            e_cmp::anim_controller,
+            e_cmp::samplers,
+            e_cmp::skinned,
+            e_cmp::pre_skinned,
+            e_cmp::master_instance,
+            e_cmp::sdf_shadow
+        };
+
+        static bool cmp_set_member(const ecs_scene* scene, u32 set, u32 entity)
+        {
+            u64 e = scene->entities[entity];
+            if (set == e_cmp_set::area_light)
+                return (e & e_cmp::light) && scene->lights[entity].type >= e_light_type::area;
+
+            return e & k_set_cmp[set];
+        }
+
+        void clear_component_sets(ecs_scene* scene)
+        {
+            for (u32 s = 0; s < e_cmp_set::count; ++s)
+                if (scene->cmp_sets[s].dense)
+                    stb__sbn(scene->cmp_sets[s].dense) = 0;
+        }
+
+        void update_component_sets(ecs_scene* scene, u32 entity)
+        {
+            // the whole set is rebuilt on the next update
+            if (scene->flags & e_scene_flags::invalidate_cmp_sets)
+                return;
+
+            for (u32 s = 0; s < e_cmp_set::count; ++s)
+            {
+                cmp_set& set = scene->cmp_sets[s];
+                u32      count = sb_count(set.dense);
+                u32      i = (u32)(std::lower_bound(set.dense, set.dense + count, entity) - set.dense);
+                bool     present = i < count && set.dense[i] == entity;
+
+                if (cmp_set_member(scene, s, entity) == present)
+                    continue;
+
+                if (present)
+                {
+                    memmove(&set.dense[i], &set.dense[i + 1], (count - i - 1) * sizeof(u32));
+                    stb__sbn(set.dense)--;
+                }
+                else
+                {
+                    // entities are mostly created in ascending order so this is usually an append
+                    sb_push(set.dense, entity);
+                    memmove(&set.dense[i + 1], &set.dense[i], (count - i) * sizeof(u32));
+                    set.dense[i] = entity;
+                }
+            }
+        }
+
+        void update_component_sets(ecs_scene* scene)
+        {
+            if (!(scene->flags & e_scene_flags::invalidate_cmp_sets))
+                return;
+
+            scene->flags &= ~e_scene_flags::invalidate_cmp_sets;
+
+            static u64 s_any_cmp = 0;
+            if (!s_any_cmp)
+                for (u32 s = 0; s < e_cmp_set::count; ++s)
+                    s_any_cmp |= k_set_cmp[s];
+
+            clear_component_sets(scene);
+
+            // single pass over the entity flags, only after loads and bulk moves which shift entity indices
+            for (u32 n = 0; n < scene->num_entities; ++n)
+            {
+                if (!(scene->entities[n] & s_any_cmp))
+                    continue;
+
+                for (u32 s = 0; s < e_cmp_set::count; ++s)
+                    if (cmp_set_member(scene, s, n))
+                        sb_push(scene->cmp_sets[s].dense, n);
+            }
+        }
+
+        void add_components(ecs_scene* scene, u32 entity, u64 cmp)
+        {
+            scene->entities[entity] |= cmp;
+            update_component_sets(scene, entity);
+        }
+
+        void remove_components(ecs_scene* scene, u32 entity, u64 cmp)
+        {
+            scene->entities[entity] &= ~cmp;
+            update_component_sets(scene, entity);
+        }
+
         void free_scene_buffers(ecs_scene* scene, bool cmp_mem_only = 0)
         {
+            // cleared up front so zeroing each entity does not search the sets
+            clear_component_sets(scene);
+
             // Remove entites for sub systems (physics, rendering, etc)
             if (!cmp_mem_only)
             {
@@ -177,6 +280,8 @@ namespace put
 
         void zero_entity_components(ecs_scene* scene, u32 node_index)
         {
+            scene->structure_version++;
+
             for (u32 i = 0; i < scene->num_components; ++i)
             {
                 generic_cmp_array& cmp = scene->get_component_array(i);
@@ -186,6 +291,8 @@ namespace put
 
             // Annoyingly nodeindex == parent is used to determine if a node is not a child
             scene->parents[node_index] = node_index;
+
+            update_component_sets(scene, node_index);
         }
 
         void delete_entity(ecs_scene* scene, u32 node_index)
@@ -246,12 +353,16 @@ namespace put
         // a component wise memcpy of all components and extension components
         void entity_cpy(ecs_scene* scene, u32 dst, u32 src)
         {
+            scene->structure_version++;
+
             // will copy extensions and base
             for (u32 i = 0; i < scene->num_components; ++i)
             {
                 generic_cmp_array& cmp = scene->get_component_array(i);
                 memcpy(cmp[dst], cmp[src], cmp.size);
             }
+
+            update_component_sets(scene, dst);
         }
 
         void swap_entities(ecs_scene* scene, u32 a, s32 b)
@@ -298,18 +409,11 @@ namespace put
                 memcpy(cmp[dst], cmp[src], cmp.size);
             }
 
-            // assign
-            Str blank;
-            memcpy(&p_sn->names[dst], &blank, sizeof(Str));
-            memcpy(&p_sn->material_names[dst], &blank, sizeof(Str));
-            memcpy(&p_sn->material_names[dst], &blank, sizeof(Str));
+            update_component_sets(p_sn, dst);
 
-            p_sn->names[dst] = p_sn->names[src].c_str();
+            // names are copied with the components
             p_sn->names[dst].append(suffix);
 
-            p_sn->geometry_names[dst] = p_sn->geometry_names[src].c_str();
-            p_sn->material_names[dst] = p_sn->material_names[src].c_str();
-
             // fixup
             u32 parent_offset = p_sn->parents[src] - src;
             if (parent == -1)
@@ -366,6 +470,7 @@ namespace put
             svr_shadow_maps.name = "ecs_render_shadow_maps";
             svr_shadow_maps.id_name = PEN_HASH(svr_shadow_maps.name.c_str());
             svr_shadow_maps.render_function = &ecs::render_shadow_views;
+            svr_shadow_maps.cache_function = &ecs::shadow_view_cached;
 
             put::scene_view_renderer svr_area_light_textures;
             svr_area_light_textures.name = "ecs_render_area_light_textures";
@@ -376,6 +481,7 @@ namespace put
             svr_omni_shadow_maps.name = "ecs_render_omni_shadow_maps";
             svr_omni_shadow_maps.id_name = PEN_HASH(svr_omni_shadow_maps.name.c_str());
             svr_omni_shadow_maps.render_function = &ecs::render_omni_shadow_views;
+            svr_omni_shadow_maps.cache_function = &ecs::omni_shadow_view_cached;
 
             put::scene_view_renderer svr_volume_gi;
             svr_volume_gi.name = "ecs_compute_volume_gi";
@@ -455,6 +561,40 @@ namespace put
         {
             free_scene_buffers(scene);
 
+            shadow_cull& sv = scene->shadow_visibility;
+            u32          num_views = sb_count(sv.views);
+            for (u32 i = 0; i < num_views; ++i)
+                sb_free(sv.views[i].entities);
+
+            sb_free(sv.views);
+            sb_free(sv.frusta);
+            sb_free(sv.filtered_entities);
+            sv = shadow_cull();
+
+            light_clusters& lc = scene->clusters;
+            sb_free(lc.lights);
+            sb_free(lc.bounds);
+            sb_free(lc.counts);
+
+            u32 num_cluster_views = sb_count(lc.views);
+            for (u32 v = 0; v < num_cluster_views; ++v)
+                sb_free(lc.views[v].data);
+
+            sb_free(lc.views);
+
+            u32 cluster_buffers[] = {lc.light_buffer, lc.data_buffer, lc.info_buffer};
+            for (u32 b : cluster_buffers)
+                if (is_valid(b))
+                    pen::renderer_release_buffer(b);
+
+            lc = light_clusters();
+
+            for (u32 s = 0; s < e_cmp_set::count; ++s)
+            {
+                sb_free(scene->cmp_sets[s].dense);
+                scene->cmp_sets[s] = cmp_set();
+            }
+
             // todo release resource refs
             // geom
             // anim
@@ -464,10 +604,13 @@ namespace put
         {
             ecs_scene* scene = view.scene;
 
-            u32 count = 0;
-            u32 area_light = -1;
-            for (u32 i = 0; i < scene->num_entities; ++i)
+            u32  count = 0;
+            u32  area_light = -1;
+            u32  num_area_lights = 0;
+            u32* area_lights = get_cmp_set(scene, e_cmp_set::area_light, num_area_lights);
+            for (u32 a = 0; a < num_area_lights; ++a)
             {
+                u32 i = area_lights[a];
                 if (!(scene->entities[i] & e_cmp::light))
                     continue;
 
@@ -570,6 +713,220 @@ namespace put
             }
         }
 
+        hash_id shadow_targets_hash()
+        {
+            static const hash_id k_targets[] = {PEN_HASHC("shadow_map"), PEN_HASHC("omni_shadow_map"),
+                                                PEN_HASHC("colour_shadow_map")};
+
+            pen::hash_murmur hm;
+            hm.begin();
+            for (auto id : k_targets)
+            {
+                const pmfx::render_target* rt = pmfx::get_render_target(id);
+                if (!rt)
+                    continue;
+
+                hm.add(rt->handle);
+                hm.add(rt->num_arrays);
+                hm.add(rt->width);
+                hm.add(rt->height);
+            }
+            return hm.end();
+        }
+
+        void update_shadow_cache(ecs_scene* scene, u32 num_views)
+        {
+            shadow_cull& sv = scene->shadow_visibility;
+
+            hash_id targets_hash = shadow_targets_hash();
+            bool    targets_changed = targets_hash != sv.targets_hash;
+            sv.targets_hash = targets_hash;
+
+            // a view is re-rendered when its light, frustum or set of visible casters changes, or a caster moved.
+            // movement comes from the transform_changed flag update_scene sets per entity, so static casters only
+            // add their id and buffers to the hash of each view instead of their world matrix
+            sv.stats = shadow_cache_stats();
+            sv.stats.num_views = num_views;
+            for (u32 i = 0; i < num_views; ++i)
+            {
+                shadow_view& v = sv.views[i];
+                u32          n = v.light_index;
+
+                pen::hash_murmur hm;
+                hm.begin();
+                hm.add(&sv.frusta[i], sizeof(frustum));
+                hm.add(&scene->lights[n], sizeof(cmp_light));
+
+                // skinned casters animate without their world matrix changing so they always invalidate
+                bool dynamic = false;
+                u32  num_entities = sb_count(v.entities);
+                for (u32 j = 0; j < num_entities; ++j)
+                {
+                    u32 e = v.entities[j];
+                    if (scene->entities[e] & (e_cmp::skinned | e_cmp::pre_skinned))
+                    {
+                        dynamic = true;
+                        break;
+                    }
+
+                    // keep hashing the rest so next frame compares against the full caster set
+                    if (scene->state_flags[e] & e_state::transform_changed)
+                    {
+                        dynamic = true;
+                        sv.stats.num_moved_casters++;
+                    }
+
+                    hm.add(e);
+                    hm.add(scene->geometries[e].vertex_buffer);
+                    hm.add(scene->position_geometries[e].vertex_buffer);
+
+                    // instances are filtered out of the list, check them through their master
+                    if (scene->entities[e] & e_cmp::master_instance)
+                    {
+                        u32 num_instances = scene->master_instances[e].num_instances;
+                        hm.add(num_instances);
+
+                        for (u32 k = 1; k <= num_instances; ++k)
+                        {
+                            if (scene->state_flags[e + k] & e_state::transform_changed)
+                            {
+                                dynamic = true;
+                                sv.stats.num_moved_casters++;
+                            }
+                        }
+                    }
+                }
+
+                hash_id hash = hm.end();
+
+                // colour shadow maps for gi depend on material data as well, they are always re-rendered
+                u32  flags = scene->lights[n].flags;
+                bool cache = (flags & e_light_flags::shadow_cache) && !(flags & e_light_flags::global_illumination);
+
+                v.cached = cache && !dynamic && !targets_changed && hash == v.cache_hash;
+                v.cache_hash = hash;
+
+                if (v.cached)
+                    sv.stats.num_cached_views++;
+            }
+        }
+
+        void update_shadow_visibility(ecs_scene* scene)
+        {
+            shadow_cull& sv = scene->shadow_visibility;
+
+            // reset lists and keep their memory for the next frame
+            u32 num_allocated = sb_count(sv.views);
+            for (u32 i = 0; i < num_allocated; ++i)
+                if (sv.views[i].entities)
+                    stb__sbn(sv.views[i].entities) = 0;
+
+            if (sv.frusta)
+                stb__sbn(sv.frusta) = 0;
+
+            if (sv.filtered_entities)
+                stb__sbn(sv.filtered_entities) = 0;
+
+            sv.num_shadow_maps = 0;
+            sv.num_omni_shadow_maps = 0;
+            sv.stats = shadow_cache_stats();
+
+            // gather all shadow map frusta in the order of the shadow map array
+            u32  num_views = 0;
+            u32  num_lights = 0;
+            u32* lights = get_cmp_set(scene, e_cmp_set::light, num_lights);
+            for (u32 l = 0; l < num_lights; ++l)
+            {
+                u32 n = lights[l];
+                if (!(scene->entities[n] & e_cmp::light))
+                    continue;
+
+                if (!(scene->lights[n].flags & (e_light_flags::shadow_map | e_light_flags::global_illumination)))
+                    continue;
+
+                camera cam;
+                shadow_camera_from_entity(cam, scene, n);
+
+                if (num_views >= sb_count(sv.views))
+                    sb_push(sv.views, shadow_view());
+
+                sv.views[num_views++].light_index = n;
+                sb_push(sv.frusta, cam.camera_frustum);
+                sv.num_shadow_maps++;
+            }
+
+            // followed by 6 faces per omni shadow map
+            for (u32 l = 0; l < num_lights; ++l)
+            {
+                u32 n = lights[l];
+                if (!(scene->entities[n] & e_cmp::light))
+                    continue;
+
+                if (!(scene->lights[n].flags & e_light_flags::omni_shadow_map))
+                    continue;
+
+                camera cam;
+                cam.pos = scene->transforms[n].translation;
+                put::camera_create_cubemap(&cam, 0.1f, scene->lights[n].radius * 2.0f);
+
+                for (u32 f = 0; f < 6; ++f)
+                {
+                    put::camera_set_cubemap_face(&cam, f);
+                    camera_update_frustum(&cam);
+
+                    if (num_views >= sb_count(sv.views))
+                        sb_push(sv.views, shadow_view());
+
+                    sv.views[num_views++].light_index = n;
+                    sb_push(sv.frusta, cam.camera_frustum);
+                }
+
+                sv.num_omni_shadow_maps++;
+            }
+
+            if (num_views == 0)
+                return;
+
+            // single pass over the scene for all views
+            u32** lists = (u32**)pen::memory_alloc(sizeof(u32*) * num_views);
+            for (u32 i = 0; i < num_views; ++i)
+                lists[i] = sv.views[i].entities;
+
+            filter_entities_scalar(scene, &sv.filtered_entities);
+            frustum_cull_aabb_multi(scene, sv.frusta, num_views, sv.filtered_entities, lists);
+
+            // lists may have grown
+            for (u32 i = 0; i < num_views; ++i)
+                sv.views[i].entities = lists[i];
+
+            pen::memory_free(lists);
+
+            update_shadow_cache(scene, num_views);
+        }
+
+        shadow_cache_stats get_shadow_cache_stats(const ecs_scene* scene)
+        {
+            return scene->shadow_visibility.stats;
+        }
+
+        bool shadow_view_cached(const scene_view& view)
+        {
+            const shadow_cull& sv = view.scene->shadow_visibility;
+            if (view.array_index >= sv.num_shadow_maps)
+                return false;
+
+            return sv.views[view.array_index].cached;
+        }
+
+        bool omni_shadow_view_cached(const scene_view& view)
+        {
+            const shadow_cull& sv = view.scene->shadow_visibility;
+            if (view.array_index >= sv.num_omni_shadow_maps * 6)
+                return false;
+
+            return sv.views[sv.num_shadow_maps + view.array_index].cached;
+        }
+
         void render_shadow_views(const scene_view& view)
         {
             ecs_scene* scene = view.scene;
@@ -587,18 +944,13 @@ namespace put
                 cb_view = pen::renderer_create_buffer(bcp);
             }
 
-            static mat4 shadow_matrices[e_scene_limits::max_shadow_maps];
-            u32         shadow_index = 0;
-            for (u32 n = 0; n < scene->num_entities; ++n)
+            static mat4        shadow_matrices[e_scene_limits::max_shadow_maps];
+            const shadow_cull& sv = scene->shadow_visibility;
+            if (view.array_index < sv.num_shadow_maps)
             {
-                if (!(scene->entities[n] & e_cmp::light))
-                    continue;
-
-                if (!(scene->lights[n].flags & (e_light_flags::shadow_map | e_light_flags::global_illumination)))
-                    continue;
-
-                if (shadow_index++ != view.array_index)
-                    continue;
+                // light and visible entities were found in update_shadow_visibility
+                const shadow_view& sview = sv.views[view.array_index];
+                u32                n = sview.light_index;
 
                 // create a shadow camera
                 camera cam;
@@ -625,7 +977,7 @@ namespace put
                 }
 
                 pen::renderer_update_buffer(cb_view, &shadow_vp, sizeof(mat4));
-                shadow_matrices[shadow_index - 1] = shadow_vp;
+                shadow_matrices[view.array_index] = shadow_vp;
                 vv.cb_view = cb_view;
 
                 // colour shadow maps
@@ -651,7 +1003,7 @@ namespace put
                     pen::renderer_set_constant_buffer(cb_light, 10, pen::CBUFFER_BIND_PS);
                 }
 
-                render_scene_view(vv);
+                render_scene_entities(vv, sview.entities);
             }
 
             // update cbuffer
@@ -682,36 +1034,30 @@ namespace put
                 cb_light = pen::renderer_create_buffer(bcp);
             }
 
-            u32 target_omni_light_index = view.array_index / 6;
-            u32 array_face = view.array_index % 6;
-            u32 omni_light_index = 0;
-            for (u32 n = 0; n < scene->num_entities; ++n)
-            {
-                if (!(scene->entities[n] & e_cmp::light))
-                    continue;
-
-                if (!(scene->lights[n].flags & e_light_flags::omni_shadow_map))
-                    continue;
+            // omni views follow the shadow maps, 6 faces per light
+            const shadow_cull& sv = scene->shadow_visibility;
+            if (view.array_index >= sv.num_omni_shadow_maps * 6)
+                return;
 
-                if (omni_light_index++ != target_omni_light_index)
-                    continue;
+            const shadow_view& sview = sv.views[sv.num_shadow_maps + view.array_index];
+            u32                n = sview.light_index;
+            u32                array_face = view.array_index % 6;
 
-                cam_omni_shadow.pos = scene->transforms[n].translation;
-                put::camera_create_cubemap(&cam_omni_shadow, 0.1f, scene->lights[n].radius * 2.0f);
-                put::camera_set_cubemap_face(&cam_omni_shadow, array_face);
-                put::camera_update_shader_constants(&cam_omni_shadow);
+            cam_omni_shadow.pos = scene->transforms[n].translation;
+            put::camera_create_cubemap(&cam_omni_shadow, 0.1f, scene->lights[n].radius * 2.0f);
+            put::camera_set_cubemap_face(&cam_omni_shadow, array_face);
+            put::camera_update_shader_constants(&cam_omni_shadow);
 
-                light_data ld;
-                single_light_from_entity(ld, scene, n);
-                pen::renderer_update_buffer(cb_light, &ld, sizeof(light_data));
-                pen::renderer_set_constant_buffer(cb_light, 10, pen::CBUFFER_BIND_PS);
+            light_data ld;
+            single_light_from_entity(ld, scene, n);
+            pen::renderer_update_buffer(cb_light, &ld, sizeof(light_data));
+            pen::renderer_set_constant_buffer(cb_light, 10, pen::CBUFFER_BIND_PS);
 
-                scene_view vv = view;
-                vv.camera = &cam_omni_shadow;
-                vv.cb_view = cam_omni_shadow.cbuffer;
+            scene_view vv = view;
+            vv.camera = &cam_omni_shadow;
+            vv.cb_view = cam_omni_shadow.cbuffer;
 
-                render_scene_view(vv);
-            }
+            render_scene_entities(vv, sview.entities);
         }
 
         void render_light_volumes(const scene_view& view)
@@ -723,9 +1069,9 @@ namespace put
 
             pen::renderer_set_constant_buffer(view.cb_view, 0, pen::CBUFFER_BIND_PS | pen::CBUFFER_BIND_VS);
 
-            static hash_id id_volume[] = {PEN_HASH("full_screen_quad"), PEN_HASH("sphere"), PEN_HASH("cone")};
+            static hash_id id_volume[] = {PEN_HASHC("full_screen_quad"), PEN_HASHC("sphere"), PEN_HASHC("cone")};
 
-            static hash_id id_technique[] = {PEN_HASH("directional_light"), PEN_HASH("point_light"), PEN_HASH("spot_light")};
+            static hash_id id_technique[] = {PEN_HASHC("directional_light"), PEN_HASHC("point_light"), PEN_HASHC("spot_light")};
 
             static u32 shader = pmfx::load_shader("deferred_render");
 
@@ -733,14 +1079,17 @@ namespace put
             for (u32 i = 0; i < PEN_ARRAY_SIZE(id_volume); ++i)
                 volume[i] = get_geometry_resource(id_volume[i]);
 
-            static hash_id id_cull_front = PEN_HASH("front_face_cull");
+            static hash_id id_cull_front = PEN_HASHC("front_face_cull");
             u32            cull_front = pmfx::get_render_state(id_cull_front, pmfx::e_render_state::sampler);
 
-            static hash_id id_disable_depth = PEN_HASH("disabled");
+            static hash_id id_disable_depth = PEN_HASHC("disabled");
             u32            depth_disabled = pmfx::get_render_state(id_disable_depth, pmfx::e_render_state::depth_stencil);
 
-            for (u32 n = 0; n < scene->num_entities; ++n)
+            u32  num_lights = 0;
+            u32* lights = get_cmp_set(scene, e_cmp_set::light, num_lights);
+            for (u32 l = 0; l < num_lights; ++l)
             {
+                u32 n = lights[l];
                 if (!(scene->entities[n] & e_cmp::light))
                     continue;
 
@@ -844,9 +1193,9 @@ namespace put
             }
 
             // get render targets
-            const pmfx::render_target* gi_rt = pmfx::get_render_target(PEN_HASH("volume_gi"));
-            const pmfx::render_target* sm_rt = pmfx::get_render_target(PEN_HASH("colour_shadow_map_depth"));
-            const pmfx::render_target* col_sm_rt = pmfx::get_render_target(PEN_HASH("colour_shadow_map"));
+            const pmfx::render_target* gi_rt = pmfx::get_render_target(PEN_HASHC("volume_gi"));
+            const pmfx::render_target* sm_rt = pmfx::get_render_target(PEN_HASHC("colour_shadow_map_depth"));
+            const pmfx::render_target* col_sm_rt = pmfx::get_render_target(PEN_HASHC("colour_shadow_map"));
             u32                        volume_gi_tex = gi_rt->handle;
             u32                        colour_shadow_map = col_sm_rt->handle;
             u32                        colour_shadow_map_depth = sm_rt->handle;
@@ -861,9 +1210,12 @@ namespace put
             info.scene_size.xyz = vec3f(min(max_dim, 128.0f));
 
             // get inv shadow matrices
-            u32 i = 0;
-            for (u32 n = 0; n < scene->num_entities; ++n)
+            u32  i = 0;
+            u32  num_lights = 0;
+            u32* lights = get_cmp_set(scene, e_cmp_set::light, num_lights);
+            for (u32 l = 0; l < num_lights; ++l)
             {
+                u32 n = lights[l];
                 if (!(scene->entities[n] & e_cmp::light))
                     continue;
 
@@ -898,10 +1250,95 @@ namespace put
             pen::renderer_set_texture(0, 0, 2, pen::TEXTURE_BIND_CS);
         }
 
-        void render_scene_view(const scene_view& view)
+        // returns true when the buffer was recreated, the new buffer has no contents
+        bool grow_structured_buffer(u32& buffer, u32& buffer_size, u32 required_size, u32 stride)
         {
-            // PEN_PERF_SCOPE_PRINT(render_scene_view);
+            if (required_size <= buffer_size && is_valid(buffer))
+                return false;
+
+            if (is_valid(buffer))
+                pen::renderer_release_buffer(buffer);
+
+            buffer_size = std::max<u32>(required_size, buffer_size * 2);
+
+            pen::buffer_creation_params bcp;
+            bcp.usage_flags = PEN_USAGE_DYNAMIC;
+            bcp.bind_flags = PEN_BIND_SHADER_RESOURCE;
+            bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
+            bcp.buffer_size = buffer_size;
+            bcp.stride = stride;
+            bcp.data = nullptr;
+
+            buffer = pen::renderer_create_buffer(bcp);
+            return true;
+        }
+
+        void bind_light_clusters(const scene_view& view)
+        {
+            ecs_scene*      scene = view.scene;
+            light_clusters& lc = scene->clusters;
+
+            if (!view.camera)
+                return;
+
+            light_cluster_view* lcv = cluster_lights(scene, view.camera);
+            u32                 view_index = (u32)(lcv - lc.views);
+            u32                 num_lights = sb_count(lc.lights);
+
+            if (grow_structured_buffer(lc.light_buffer, lc.light_buffer_size,
+                                       std::max<u32>(num_lights, 1) * sizeof(light_data), sizeof(light_data)))
+                lc.lights_uploaded = false;
+
+            u32 data_bytes = lcv->data_size * sizeof(u32);
+            if (grow_structured_buffer(lc.data_buffer, lc.data_buffer_size, data_bytes, sizeof(u32)))
+                lc.bound_view = PEN_INVALID_HANDLE;
+
+            if (!is_valid(lc.info_buffer))
+            {
+                pen::buffer_creation_params bcp;
+                bcp.usage_flags = PEN_USAGE_DYNAMIC;
+                bcp.bind_flags = PEN_BIND_CONSTANT_BUFFER;
+                bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
+                bcp.buffer_size = sizeof(cluster_info_buffer);
+                bcp.data = nullptr;
+
+                lc.info_buffer = pen::renderer_create_buffer(bcp);
+            }
+
+            // lights are uploaded once per frame, cluster data only when switching to another camera's clusters
+            if (!lc.lights_uploaded && num_lights > 0)
+            {
+                pen::renderer_update_buffer(lc.light_buffer, lc.lights, num_lights * sizeof(light_data));
+                lc.lights_uploaded = true;
+            }
+
+            if (lc.bound_view != view_index)
+            {
+                pen::renderer_update_buffer(lc.data_buffer, lcv->data, data_bytes);
+                pen::renderer_update_buffer(lc.info_buffer, &lcv->info, sizeof(cluster_info_buffer));
+                lc.bound_view = view_index;
+            }
+
+            pen::renderer_set_constant_buffer(lc.info_buffer, 12, pen::CBUFFER_BIND_PS);
+            pen::renderer_set_structured_buffer(lc.light_buffer, 4, pen::SBUFFER_BIND_PS | pen::SBUFFER_BIND_READ);
+            pen::renderer_set_structured_buffer(lc.data_buffer, 6, pen::SBUFFER_BIND_PS | pen::SBUFFER_BIND_READ);
+        }
+
+        void enable_clustered_lights(ecs_scene* scene, bool enable)
+        {
+            if (enable)
+                scene->flags |= e_scene_flags::clustered_lights;
+            else
+                scene->flags &= ~e_scene_flags::clustered_lights;
 
+            // re-bake to select the clustered_lights permutation of techniques which support it
+            for (u32 n = 0; n < scene->num_entities; ++n)
+                if (scene->entities[n] & e_cmp::material)
+                    bake_material_handles(scene, n);
+        }
+
+        void render_scene_entities(const scene_view& view, u32* culled_entities)
+        {
             ecs_scene* scene = view.scene;
             if (scene->view_flags & e_scene_view_flags::hide)
                 return;
@@ -920,17 +1357,25 @@ namespace put
                 static u32 ltc_mat = put::load_texture("data/textures/ltc/ltc_mat.dds");
                 static u32 ltc_mag = put::load_texture("data/textures/ltc/ltc_amp.dds");
 
-                static hash_id id_clamp_linear = PEN_HASH("clamp_linear");
+                static hash_id id_clamp_linear = PEN_HASHC("clamp_linear");
                 u32            clamp_linear = pmfx::get_render_state(id_clamp_linear, pmfx::e_render_state::sampler);
 
                 pen::renderer_set_texture(ltc_mat, clamp_linear, 13, pen::TEXTURE_BIND_PS);
                 pen::renderer_set_texture(ltc_mag, clamp_linear, 12, pen::TEXTURE_BIND_PS);
+
+                // unshadowed point and spot lights without the forward light limit
+                if (scene->flags & e_scene_flags::clustered_lights)
+                    bind_light_clusters(view);
             }
 
             // sdf shadows
             pen::renderer_set_constant_buffer(scene->sdf_shadow_buffer, 5, pen::CBUFFER_BIND_PS);
-            for (u32 n = 0; n < scene->num_entities; ++n)
+
+            u32  num_sdf = 0;
+            u32* sdf_shadows = get_cmp_set(scene, e_cmp_set::sdf_shadow, num_sdf);
+            for (u32 s = 0; s < num_sdf; ++s)
             {
+                u32 n = sdf_shadows[s];
                 if (!(scene->entities[n] & e_cmp::sdf_shadow))
                     continue;
 
@@ -948,17 +1393,11 @@ namespace put
             pen::renderer_set_constant_buffer(scene->gi_volume_buffer, 11, pen::CBUFFER_BIND_PS);
 
             // blue noise
-            static hash_id id_wrap_point = PEN_HASH("wrap_point");
+            static hash_id id_wrap_point = PEN_HASHC("wrap_point");
             u32            wrap_point = pmfx::get_render_state(id_wrap_point, pmfx::e_render_state::sampler);
             static u32     blue_noise = put::load_texture("data/textures/noise/blue_noise_ldr_rgba_0.dds");
             pen::renderer_set_texture(blue_noise, wrap_point, 5, pen::TEXTURE_BIND_PS);
 
-            // filter and cull
-            u32* filtered_entities = nullptr;
-            u32* culled_entities = nullptr;
-            filter_entities_scalar(scene, &filtered_entities);
-            frustum_cull_aabb_scalar(scene, view.camera, filtered_entities, &culled_entities);
-            
             // track to prevent redundant state changes.
             u32 cur_shader = -1;
             u32 cur_technique = -1;
@@ -1081,6 +1520,23 @@ namespace put
                 // single
                 pen::renderer_draw_indexed(p_geom->num_indices, 0, 0, PEN_PT_TRIANGLELIST);
             }
+        }
+
+        void render_scene_view(const scene_view& view)
+        {
+            // PEN_PERF_SCOPE_PRINT(render_scene_view);
+
+            ecs_scene* scene = view.scene;
+            if (scene->view_flags & e_scene_view_flags::hide)
+                return;
+
+            // filter and cull
+            u32* filtered_entities = nullptr;
+            u32* culled_entities = nullptr;
+            filter_entities_scalar(scene, &filtered_entities);
+            frustum_cull_aabb_scalar(scene, view.camera, filtered_entities, &culled_entities);
+
+            render_scene_entities(view, culled_entities);
 
             if (filtered_entities)
             {
@@ -1095,8 +1551,11 @@ namespace put
 
         void update_animations(ecs_scene* scene, f32 dt)
         {
-            for (u32 n = 0; n < scene->num_entities; ++n)
+            u32  num_controllers = 0;
+            u32* controllers = get_cmp_set(scene, e_cmp_set::anim_controller, num_controllers);
+            for (u32 c = 0; c < num_controllers; ++c)
             {
+                u32 n = controllers[c];
                 if (!(scene->entities[n] & e_cmp::anim_controller))
                     continue;
 
@@ -1346,8 +1805,11 @@ namespace put
         void reset(ecs_scene* scene)
         {
             // reset physics positions
-            for (s32 i = 0; i < scene->num_entities; ++i)
+            u32  num_physics = 0;
+            u32* physics_entities = get_cmp_set(scene, e_cmp_set::physics, num_physics);
+            for (u32 p = 0; p < num_physics; ++p)
             {
+                u32 i = physics_entities[p];
                 if (scene->entities[i] & e_cmp::physics)
                 {
                     if (scene->physics_data[i].type != e_physics_type::rigid_body)
@@ -1372,6 +1834,8 @@ namespace put
 
         void update_scene(ecs_scene* scene, f32 dt)
         {
+            PEN_MEMORY_TAG_SCOPE(ecs);
+
             // static anim time to pass into draw calls etc..
             f32 anim_time = pen::get_time_ms() / 1000.0f;
 
@@ -1383,6 +1847,9 @@ namespace put
                 if (scene->controllers[c].funcs.update_func)
                     scene->controllers[c].funcs.update_func(scene->controllers[c], scene, dt);
 
+            // rebuild the sets if a load or bulk move invalidated them
+            update_component_sets(scene);
+
             if (scene->flags & e_scene_flags::pause_update)
             {
                 physics::set_paused(1);
@@ -1404,6 +1871,9 @@ namespace put
             // scene node transform
             for (size_t n = 0; n < scene->num_entities; ++n)
             {
+                // cached shadow maps only need to know which casters moved
+                scene->state_flags[n] &= ~e_state::transform_changed;
+
                 // force physics entity to sync and ignore controlled transform
                 if (scene->state_flags[n] & e_state::sync_physics_transform)
                 {
@@ -1463,11 +1933,15 @@ namespace put
                 }
 
                 // heirarchical scene transform
-                u32 parent = scene->parents[n];
-                if (parent == n)
-                    scene->world_matrices[n] = scene->local_matrices[n];
-                else
-                    scene->world_matrices[n] = scene->world_matrices[parent] * scene->local_matrices[n];
+                u32  parent = scene->parents[n];
+                mat4 world = scene->local_matrices[n];
+                if (parent != n)
+                    world = scene->world_matrices[parent] * world;
+
+                if (memcmp(&world, &scene->world_matrices[n], sizeof(mat4)) != 0)
+                    scene->state_flags[n] |= e_state::transform_changed;
+
+                scene->world_matrices[n] = world;
             }
 
             // bounding volume transform
@@ -1555,30 +2029,63 @@ namespace put
                 }
             }
 
-            // Forward light buffer
-            static forward_light_buffer light_buffer;
-            s32                         pos = 0;
-            s32                         num_lights = 0;
-
-            memset(&light_buffer, 0x0, sizeof(forward_light_buffer));
+            // gather lights in a single pass into compact per type lists
+            static u32* s_light_lists[e_light_type::area_ex + 1] = {0};
+            for (u32 t = 0; t <= e_light_type::area_ex; ++t)
+                if (s_light_lists[t])
+                    stb__sbn(s_light_lists[t]) = 0;
 
-            // directional lights
-            s32 num_directions_lights = 0;
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            u32  num_light_entities = 0;
+            u32* light_entities = get_cmp_set(scene, e_cmp_set::light, num_light_entities);
+            for (u32 l = 0; l < num_light_entities; ++l)
             {
+                u32 n = light_entities[l];
                 if (!(scene->entities[n] & e_cmp::light))
                     continue;
 
-                cmp_light& l = scene->lights[n];
-                if (l.type != e_light_type::dir)
-                    continue;
+                u32 type = scene->lights[n].type;
+                if (type <= e_light_type::area_ex)
+                    sb_push(s_light_lists[type], n);
+            }
+
+            u32* dir_lights = s_light_lists[e_light_type::dir];
+            u32* point_lights = s_light_lists[e_light_type::point];
+            u32* spot_lights = s_light_lists[e_light_type::spot];
+
+            // unshadowed point and spot lights are assigned to clusters per view, they are not limited in count
+            // when clustering is enabled they are left out of the forward buffer which is then only shadowed lights
+            light_clusters& lc = scene->clusters;
+            if (lc.lights)
+                stb__sbn(lc.lights) = 0;
+
+            if (lc.bounds)
+                stb__sbn(lc.bounds) = 0;
+
+            lc.num_views = 0;
+            lc.bound_view = PEN_INVALID_HANDLE;
+            lc.lights_uploaded = false;
+
+            // Forward light buffer
+            static forward_light_buffer light_buffer;
+            s32                         pos = 0;
+            s32                         num_lights = 0;
+
+            memset(&light_buffer, 0x0, sizeof(forward_light_buffer));
+
+            // directional lights
+            s32 num_directions_lights = 0;
+            u32 num_dir = sb_count(dir_lights);
+            for (u32 i = 0; i < num_dir; ++i)
+            {
+                u32        n = dir_lights[i];
+                cmp_light& l = scene->lights[n];
 
                 // update bv and transform
                 scene->bounding_volumes[n].min_extents = -vec3f(FLT_MAX);
                 scene->bounding_volumes[n].max_extents = vec3f(FLT_MAX);
 
                 if (num_lights >= e_scene_limits::max_forward_lights)
-                    break;
+                    continue;
 
                 // current directional light is a point light very far away
                 // with no attenuation..
@@ -1594,14 +2101,11 @@ namespace put
 
             // point lights
             s32 num_point_lights = 0;
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            u32 num_point = sb_count(point_lights);
+            for (u32 i = 0; i < num_point; ++i)
             {
-                if (!(scene->entities[n] & e_cmp::light))
-                    continue;
-
+                u32        n = point_lights[i];
                 cmp_light& l = scene->lights[n];
-                if (l.type != e_light_type::point)
-                    continue;
 
                 // update bv and transform
                 scene->bounding_volumes[n].min_extents = -vec3f::one();
@@ -1611,14 +2115,29 @@ namespace put
                 scene->transforms[n].scale = vec3f(rad, rad, rad);
                 scene->entities[n] |= e_cmp::transform;
 
-                if (num_lights >= e_scene_limits::max_forward_lights)
-                    break;
-
                 cmp_transform& t = scene->transforms[n];
 
-                bool sm = l.flags & e_light_flags::omni_shadow_map;
-                light_buffer.lights[pos].pos_radius = vec4f(t.translation, l.radius);
-                light_buffer.lights[pos].colour = vec4f(l.colour, sm ? 1.0 : 0.0);
+                bool       sm = l.flags & e_light_flags::omni_shadow_map;
+                light_data ld;
+                ld.pos_radius = vec4f(t.translation, l.radius);
+                ld.dir_cutoff = vec4f::zero();
+                ld.colour = vec4f(l.colour, sm ? 1.0 : 0.0);
+                ld.data = vec4f::zero();
+
+                if (!sm)
+                {
+                    sb_push(lc.lights, ld);
+                    sb_push(lc.bounds, vec4f(t.translation, l.radius));
+
+                    // clustered lights are not packed into the forward buffer, leaving its slots for shadowed lights
+                    if (scene->flags & e_scene_flags::clustered_lights)
+                        continue;
+                }
+
+                if (num_lights >= e_scene_limits::max_forward_lights)
+                    continue;
+
+                light_buffer.lights[pos] = ld;
 
                 ++num_point_lights;
                 ++num_lights;
@@ -1627,19 +2146,12 @@ namespace put
 
             // spot lights
             s32 num_spot_lights = 0;
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            u32 num_spot = sb_count(spot_lights);
+            for (u32 i = 0; i < num_spot; ++i)
             {
-                if (num_lights >= e_scene_limits::max_forward_lights)
-                    break;
-
-                if (!(scene->entities[n] & e_cmp::light))
-                    continue;
-
+                u32        n = spot_lights[i];
                 cmp_light& l = scene->lights[n];
 
-                if (l.type != e_light_type::spot)
-                    continue;
-
                 // update bv and transform
                 scene->bounding_volumes[n].min_extents = -vec3f::one();
                 scene->bounding_volumes[n].max_extents = vec3f(1.0f, 0.0f, 1.0f);
@@ -1655,11 +2167,31 @@ namespace put
 
                 vec3f dir = normalized(-scene->world_matrices[n].get_column(1).xyz);
 
-                bool sm = l.flags & e_light_flags::shadow_map;
-                light_buffer.lights[pos].pos_radius = vec4f(t.translation, l.radius);
-                light_buffer.lights[pos].dir_cutoff = vec4f(dir, l.cos_cutoff);
-                light_buffer.lights[pos].colour = vec4f(l.colour, sm ? 1.0 : 0.0);
-                light_buffer.lights[pos].data = vec4f(l.spot_falloff, 0.0f, 0.0f, 0.0f);
+                bool       sm = l.flags & e_light_flags::shadow_map;
+                light_data ld;
+                ld.pos_radius = vec4f(t.translation, l.radius);
+                ld.dir_cutoff = vec4f(dir, l.cos_cutoff);
+                ld.colour = vec4f(l.colour, sm ? 1.0 : 0.0);
+                ld.data = vec4f(l.spot_falloff, 1.0f, 0.0f, 0.0f);
+
+                if (!sm)
+                {
+                    // sphere bounding the cone
+                    f32 half_range = range * 0.5f;
+                    f32 cone_radius = lo * range;
+                    f32 bound_radius = sqrt(half_range * half_range + cone_radius * cone_radius);
+
+                    sb_push(lc.lights, ld);
+                    sb_push(lc.bounds, vec4f(t.translation + dir * half_range, bound_radius));
+
+                    if (scene->flags & e_scene_flags::clustered_lights)
+                        continue;
+                }
+
+                if (num_lights >= e_scene_limits::max_forward_lights)
+                    continue;
+
+                light_buffer.lights[pos] = ld;
 
                 ++num_spot_lights;
                 ++num_lights;
@@ -1680,18 +2212,17 @@ namespace put
             u32 num_area_lights = 0;
             u32 num_constant_colour_area_lights = 0;
             u32 num_textured_area_lights = 0;
+
             // constant colour area light
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            u32* area_lights = s_light_lists[e_light_type::area];
+            u32  num_area = sb_count(area_lights);
+            for (u32 i = 0; i < num_area; ++i)
             {
-                if (num_lights >= e_scene_limits::max_forward_lights)
+                if (num_area_lights >= e_scene_limits::max_area_lights)
                     break;
 
-                if (!(scene->entities[n] & e_cmp::light))
-                    continue;
-
+                u32        n = area_lights[i];
                 cmp_light& l = scene->lights[n];
-                if (l.type != e_light_type::area)
-                    continue;
 
                 mat4& wm = scene->world_matrices[n];
                 for (u32 c = 0; c < 4; ++c)
@@ -1702,18 +2233,17 @@ namespace put
 
                 ++num_area_lights;
             }
+
             // textured / shader / animated area light
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            u32* area_ex_lights = s_light_lists[e_light_type::area_ex];
+            u32  num_area_ex = sb_count(area_ex_lights);
+            for (u32 i = 0; i < num_area_ex; ++i)
             {
-                if (num_lights >= e_scene_limits::max_forward_lights)
+                if (num_area_lights >= e_scene_limits::max_area_lights)
                     break;
 
-                if (!(scene->entities[n] & e_cmp::light))
-                    continue;
-
+                u32        n = area_ex_lights[i];
                 cmp_light& l = scene->lights[n];
-                if (l.type != e_light_type::area_ex)
-                    continue;
 
                 mat4& wm = scene->world_matrices[n];
                 for (u32 c = 0; c < 4; ++c)
@@ -1732,7 +2262,7 @@ namespace put
 
             pen::renderer_update_buffer(scene->area_light_buffer, &al_buffer, sizeof(al_buffer));
 
-            const pmfx::render_target* alrt = pmfx::get_render_target(PEN_HASH("area_light_textures"));
+            const pmfx::render_target* alrt = pmfx::get_render_target(PEN_HASHC("area_light_textures"));
             if (alrt)
             {
                 if (alrt->num_arrays < num_area_lights)
@@ -1744,13 +2274,16 @@ namespace put
                     rrp.num_arrays = std::max<u32>(num_area_lights, 1);
                     rrp.num_mips = -1;
                     rrp.collection = pen::TEXTURE_COLLECTION_ARRAY;
-                    pmfx::resize_render_target(PEN_HASH("area_light_textures"), rrp);
+                    pmfx::resize_render_target(PEN_HASHC("area_light_textures"), rrp);
                 }
             }
 
             // Distance field shadows
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            u32  num_sdf = 0;
+            u32* sdf_shadows = get_cmp_set(scene, e_cmp_set::sdf_shadow, num_sdf);
+            for (u32 s = 0; s < num_sdf; ++s)
             {
+                u32 n = sdf_shadows[s];
                 if (!(scene->entities[n] & e_cmp::sdf_shadow))
                     continue;
 
@@ -1768,12 +2301,9 @@ namespace put
             u32 num_shadow_maps = 0;
             u32 num_omni_shadow_maps = 0;
             u32 num_gi_maps = 0;
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            for (u32 i = 0; i < num_light_entities; ++i)
             {
-                if (!(scene->entities[n] & e_cmp::light))
-                    continue;
-
-                cmp_light& l = scene->lights[n];
+                cmp_light& l = scene->lights[light_entities[i]];
 
                 if (l.flags & e_light_flags::global_illumination)
                     num_gi_maps++;
@@ -1786,7 +2316,7 @@ namespace put
             }
 
             // resize shadow maps..
-            const pmfx::render_target* sm = pmfx::get_render_target(PEN_HASH("shadow_map"));
+            const pmfx::render_target* sm = pmfx::get_render_target(PEN_HASHC("shadow_map"));
             if (sm)
             {
                 if (sm->num_arrays < num_shadow_maps)
@@ -1798,12 +2328,12 @@ namespace put
                     rrp.num_arrays = num_shadow_maps;
                     rrp.num_mips = 1;
                     rrp.collection = pen::TEXTURE_COLLECTION_ARRAY;
-                    pmfx::resize_render_target(PEN_HASH("shadow_map"), rrp);
+                    pmfx::resize_render_target(PEN_HASHC("shadow_map"), rrp);
                 }
             }
 
             // resize omni directional
-            const pmfx::render_target* osm = pmfx::get_render_target(PEN_HASH("omni_shadow_map"));
+            const pmfx::render_target* osm = pmfx::get_render_target(PEN_HASHC("omni_shadow_map"));
             if (osm)
             {
                 if (osm->num_arrays < num_omni_shadow_maps * 6)
@@ -1815,12 +2345,12 @@ namespace put
                     rrp.num_arrays = num_omni_shadow_maps * 6;
                     rrp.num_mips = 1;
                     rrp.collection = pen::TEXTURE_COLLECTION_CUBE_ARRAY;
-                    pmfx::resize_render_target(PEN_HASH("omni_shadow_map"), rrp);
+                    pmfx::resize_render_target(PEN_HASHC("omni_shadow_map"), rrp);
                 }
             }
 
             // resize gi maps
-            const pmfx::render_target* gism = pmfx::get_render_target(PEN_HASH("colour_shadow_map"));
+            const pmfx::render_target* gism = pmfx::get_render_target(PEN_HASHC("colour_shadow_map"));
             if (gism)
             {
                 if (gism->num_arrays < num_gi_maps)
@@ -1832,17 +2362,23 @@ namespace put
                     rrp.num_arrays = num_gi_maps;
                     rrp.num_mips = 1;
                     rrp.collection = pen::TEXTURE_COLLECTION_ARRAY;
-                    pmfx::resize_render_target(PEN_HASH("colour_shadow_map"), rrp);
-                    pmfx::resize_render_target(PEN_HASH("colour_shadow_map_depth"), rrp);
+                    pmfx::resize_render_target(PEN_HASHC("colour_shadow_map"), rrp);
+                    pmfx::resize_render_target(PEN_HASHC("colour_shadow_map_depth"), rrp);
                 }
             }
 
+            // cull every shadow map view in one pass
+            update_shadow_visibility(scene);
+
             // update pre skinned vertex buffers
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            u32  num_pre_skinned = 0;
+            u32* pre_skinned = get_cmp_set(scene, e_cmp_set::pre_skinned, num_pre_skinned);
+            for (u32 p = 0; p < num_pre_skinned; ++p)
             {
+                u32 n = pre_skinned[p];
                 if (!(scene->entities[n] & e_cmp::pre_skinned))
                     continue;
-                
+
                 u32 cbuffer = -1;
                 cmp_geometry& geom = scene->geometries[n];
                 cmp_geometry& pos_geom = scene->position_geometries[n];
@@ -1886,8 +2422,8 @@ namespace put
                 static u32 shader = pmfx::load_shader("forward_render");
             
                 static hash_id id_pre_skin[] = {
-                    PEN_HASH("pre_skin"),
-                    PEN_HASH("pre_skin_position")
+                    PEN_HASHC("pre_skin"),
+                    PEN_HASHC("pre_skin_position")
                 };
                 
                 u32 pre_skin_target[2] = {
@@ -1914,48 +2450,48 @@ namespace put
             }
             
             // update skinning buffers
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            u32  num_skinned = 0;
+            u32* skinned = get_cmp_set(scene, e_cmp_set::skinned, num_skinned);
+            for (u32 sk = 0; sk < num_skinned; ++sk)
             {
-                if (scene->entities[n] & e_cmp::pre_skinned)
+                u32 n = skinned[sk];
+                if (!(scene->entities[n] & e_cmp::skinned) || scene->entities[n] & e_cmp::pre_skinned)
                     continue;
                     
-                if (scene->entities[n] & e_cmp::skinned)
+                // sub geom share bones with parent
+                if(scene->entities[n] & e_cmp::sub_geometry)
                 {
-                    // sub geom share bones with parent
-                    if(scene->entities[n] & e_cmp::sub_geometry)
-                    {
-                        u32 p = scene->parents[n];
-                        scene->bone_cbuffer[n] = scene->bone_cbuffer[p];
-                        continue;
-                    }
-                    
-                    static mat4 bb[85];
-                    cmp_geometry* p_geom = &scene->geometries[n];
-                    if (!scene->bone_cbuffer[n])
-                    {
-                        pen::buffer_creation_params bcp;
-                        bcp.usage_flags = PEN_USAGE_DYNAMIC;
-                        bcp.bind_flags = PEN_BIND_CONSTANT_BUFFER;
-                        bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
-                        bcp.buffer_size = sizeof(mat4) * 85;
-                        bcp.data = nullptr;
-
-                        scene->bone_cbuffer[n] = pen::renderer_create_buffer(bcp);
-                    }
-                    
-                    u32 rjr = scene->anim_controller_v2[n].root_joint_ref;
-                    s32 joints_offset = ecs::get_index_from_ref(scene, rjr);
-                    joints_offset += p_geom->p_skin->bone_offset;
-                    
-                    for (s32 i = 0; i < p_geom->p_skin->num_joints; ++i)
-                    {
-                        mat4& joint_matrix = scene->world_matrices[joints_offset + i];
-                        mat4& bind_matrix = p_geom->p_skin->joint_bind_matrices[i];
-                        bb[i] = joint_matrix * bind_matrix;
-                    }
-
-                    pen::renderer_update_buffer(scene->bone_cbuffer[n], bb, sizeof(bb));
+                    u32 p = scene->parents[n];
+                    scene->bone_cbuffer[n] = scene->bone_cbuffer[p];
+                    continue;
+                }
+                
+                static mat4 bb[85];
+                cmp_geometry* p_geom = &scene->geometries[n];
+                if (!scene->bone_cbuffer[n])
+                {
+                    pen::buffer_creation_params bcp;
+                    bcp.usage_flags = PEN_USAGE_DYNAMIC;
+                    bcp.bind_flags = PEN_BIND_CONSTANT_BUFFER;
+                    bcp.cpu_access_flags = PEN_CPU_ACCESS_WRITE;
+                    bcp.buffer_size = sizeof(mat4) * 85;
+                    bcp.data = nullptr;
+
+                    scene->bone_cbuffer[n] = pen::renderer_create_buffer(bcp);
+                }
+                
+                u32 rjr = scene->anim_controller_v2[n].root_joint_ref;
+                s32 joints_offset = ecs::get_index_from_ref(scene, rjr);
+                joints_offset += p_geom->p_skin->bone_offset;
+                
+                for (s32 i = 0; i < p_geom->p_skin->num_joints; ++i)
+                {
+                    mat4& joint_matrix = scene->world_matrices[joints_offset + i];
+                    mat4& bind_matrix = p_geom->p_skin->joint_bind_matrices[i];
+                    bb[i] = joint_matrix * bind_matrix;
                 }
+
+                pen::renderer_update_buffer(scene->bone_cbuffer[n], bb, sizeof(bb));
             }
 
             // update draw call data
@@ -1997,11 +2533,14 @@ namespace put
             }
 
             // update instance buffers
-            for (size_t n = 0; n < scene->num_entities; ++n)
+            u32  num_masters = 0;
+            u32* masters = get_cmp_set(scene, e_cmp_set::master_instance, num_masters);
+            for (u32 m = 0; m < num_masters; ++m)
             {
+                u32 n = masters[m];
                 if (!(scene->entities[n] & e_cmp::master_instance))
                     continue;
-                    
+
                 if (scene->entities[n] & e_cmp::custom_instance_buffer)
                     continue;
 
@@ -2009,9 +2548,6 @@ namespace put
 
                 u32 instance_data_size = master.num_instances * master.instance_stride;
                 pen::renderer_update_buffer(master.instance_buffer, &scene->draw_call_data[n + 1], instance_data_size);
-
-                // stride over sub instances
-                n += scene->master_instances[n].num_instances;
             }
 
             // update physics running 1 frame behind to allow the sets to take effect
@@ -2028,6 +2564,46 @@ namespace put
             // PEN_LOG("scene update: %f(ms)", elapsed);
         }
 
+        namespace e_scene_chunk
+        {
+            enum scene_chunk_t
+            {
+                component,
+                extensions,
+                strings,
+                lookups,
+                cameras
+            };
+        }
+
+        namespace e_scene_chunk_flags
+        {
+            enum scene_chunk_flags_t
+            {
+                lz4 = 1 << 0
+            };
+        }
+
+        namespace e_scene_lookups
+        {
+            enum scene_lookups_t
+            {
+                names,
+                geometry,
+                animations,
+                materials,
+                shadows,
+                samplers,
+                area_lights, // version 12
+                COUNT
+            };
+        }
+
+        // from version 11 a scene is a header followed by a chunk directory, each chunk starts on a page boundary so
+        // pod component arrays can be memory mapped and bulk copied into the scene without any per entity parsing
+        static const u32 k_scene_chunk_alignment = 4096;
+        static const u32 k_scene_camera_size = sizeof(hash_id) + sizeof(vec3f) * 2 + sizeof(vec2f) + sizeof(f32) * 5;
+
         struct scene_header
         {
             s32 header_size = sizeof(*this);
@@ -2037,328 +2613,1566 @@ namespace put
             s32 num_lookup_strings = 0;
             s32 num_extensions = 0;
             s32 num_base_components = 0;
-            s32 reserved_1[25] = {0};
+            s32 num_chunks = 0;      // version 11
+            s32 chunk_alignment = 0; // version 11
+            s32 reserved_1[23] = {0};
             u32 view_flags = 0;
             s32 selected_index = 0;
             s32 reserved_2[30] = {0};
         };
 
-        struct lookup_string
+        struct scene_chunk
+        {
+            u32 type;
+            u32 index;        // component index for component chunks
+            u32 element_size; // component stride for component chunks
+            u32 flags;
+            u64 offset; // from the start of the file
+            u64 size;   // size stored in the file, compressed or not
+            u64 uncompressed_size;
+        };
+
+        struct scene_chunk_data
+        {
+            scene_chunk chunk;
+            const void* data;
+        };
+
+        // interned string table, the strings chunk contains num entries, chars size, entries sorted by id, chars
+        struct scene_string
         {
-            Str     name;
             hash_id id;
+            u32     offset;
+            u32     len;
         };
-        static lookup_string* s_lookup_strings = nullptr;
 
-        void write_lookup_string(const char* string, std::ofstream& ofs, const c8* strip_project_dir = nullptr)
+        struct scene_string_table
         {
-            hash_id id = 0;
+            const scene_string* entries = nullptr;
+            const c8*           chars = nullptr;
+            u32                 num_entries = 0;
+        };
 
-            Str stripped = string;
-            if (strip_project_dir)
+        struct scene_string_builder
+        {
+            scene_string* entries = nullptr;
+            c8*           chars = nullptr;
+        };
+
+        struct scene_writer
+        {
+            u8* data = nullptr;
+
+            void write(const void* src, size_t size)
             {
-                stripped = pen::str_replace_string(stripped, strip_project_dir, "");
-                string = stripped.c_str();
+                if (size == 0)
+                    return;
+
+                u8* dst = sb_add(data, (int)size);
+                memcpy(dst, src, size);
             }
 
-            if (!string)
+            // reset the size and keep the allocation for reuse
+            void clear()
             {
-                ofs.write((const c8*)&id, sizeof(hash_id));
-                return;
+                if (data)
+                    stb__sbn(data) = 0;
             }
 
-            id = PEN_HASH(string);
-            ofs.write((const c8*)&id, sizeof(hash_id));
-
-            u32 num_strings = sb_count(s_lookup_strings);
-            for (u32 i = 0; i < num_strings; ++i)
+            template <typename T>
+            void write(const T& v)
             {
-                if (id == s_lookup_strings[i].id)
-                {
-                    return;
-                }
+                write(&v, sizeof(T));
             }
+        };
 
-            lookup_string ls = {string, id};
-            sb_push(s_lookup_strings, ls);
-        }
-
-        Str read_lookup_string(std::ifstream& ifs)
+        struct scene_reader
         {
-            hash_id id;
-            ifs.read((c8*)&id, sizeof(hash_id));
+            const u8* data;
+            size_t    size;
+            size_t    pos;
 
-            u32 num_strings = sb_count(s_lookup_strings);
-            for (u32 i = 0; i < num_strings; ++i)
+            template <typename T>
+            void read(T& v)
             {
-                if (s_lookup_strings[i].id == id)
-                {
-                    return s_lookup_strings[i].name;
-                }
-            }
+                if (pos + sizeof(T) <= size)
+                    memcpy(&v, data + pos, sizeof(T));
+                else
+                    memset(&v, 0x0, sizeof(T));
 
-            return "";
-        }
+                pos += sizeof(T);
+            }
 
-        hash_id rehash_lookup_string(hash_id id)
-        {
-            u32 num_strings = sb_count(s_lookup_strings);
-            for (u32 i = 0; i < num_strings; ++i)
+            const u8* skip(size_t bytes)
             {
-                if (s_lookup_strings[i].id == id)
-                {
-                    return PEN_HASH(s_lookup_strings[i].name);
-                }
+                const u8* p = data + pos;
+                pos += bytes;
+                return pos <= size ? p : nullptr;
             }
+        };
 
-            return 0;
-        }
+        struct ext_components
+        {
+            hash_id id;
+            u32     start_cmp;
+            u32     num_cmp;
+        };
 
-        void save_sub_scene(ecs_scene* scene, u32 root)
+        // material_resource as saved before names were stored in place, only the raw bytes are read
+        struct material_resource_str
         {
-            std::vector<s32> nodes;
-            build_heirarchy_node_list(scene, root, nodes);
+            hash_id hash;
+            Str     material_name;
+            Str     shader_name;
+            f32     data[64];
+            hash_id id_shader;
+            hash_id id_technique;
+            hash_id id_sampler_state[e_texture::COUNT];
+            s32     texture_handles[e_texture::COUNT];
+        };
 
-            u32 num = nodes.size();
+        // file layout agnostic view of a loaded scene, populated from version 10 streams or version 11 chunks
+        struct scene_sections
+        {
+            u32*            component_sizes = nullptr;
+            const u8**      component_data = nullptr;
+            u64*            component_bytes = nullptr; // size of the data available, checked against num_nodes
+            ext_components* exts = nullptr;
+            scene_reader    cameras = {};
+            scene_reader    lookups = {};
+            void**          allocations = nullptr;
+        };
 
-            ecs_scene sub_scene;
+        static scene_string_builder s_save_strings;
+        static scene_string_builder s_legacy_strings;
+        static scene_string_table   s_lookup_strings;
 
-            // create sub scene with same components
-            u32 num_ext = sb_count(scene->extensions);
-            for (u32 e = 0; e < num_ext; ++e)
-                scene->extensions[e].funcs.ext_func(&sub_scene);
+        bool scene_string_less(const scene_string& a, const scene_string& b)
+        {
+            return a.id < b.id;
+        }
 
-            resize_scene_buffers(&sub_scene, num);
+        void write_lookup_string(const char* string, scene_writer& w, scene_string_builder& strings,
+                                 const c8* strip_project_dir = nullptr)
+        {
+            hash_id id = 0;
 
-            for (u32 i = 0; i < num; ++i)
+            Str stripped = string;
+            if (strip_project_dir)
             {
-                u32 ii = nodes[i];
-                if (ii == PEN_INVALID_HANDLE)
-                    continue;
-
-                u32 ni = sub_scene.num_entities;
-
-                for (u32 c = 0; c < scene->num_components; ++c)
-                {
-                    generic_cmp_array& src = scene->get_component_array(c);
-                    generic_cmp_array& dst = sub_scene.get_component_array(c);
-
-                    memcpy(dst[ni], src[ii], src.size);
-                }
+                stripped = pen::str_replace_string(stripped, strip_project_dir, "");
+                string = stripped.c_str();
+            }
 
-                sub_scene.parents[ni] -= root;
-                sub_scene.num_entities++;
+            if (!string)
+            {
+                w.write(id);
+                return;
             }
 
-            Str fn = "";
-            fn.appendf("../../assets/scene/%s.pms", sub_scene.names[0].c_str());
+            id = PEN_HASH(string);
+            w.write(id);
 
-            save_scene(fn.c_str(), &sub_scene);
+            // duplicates are removed when the table is finalised, avoiding a search per string
+            u32          len = pen::string_length(string);
+            scene_string ss = {id, (u32)sb_count(strings.chars), len};
+            sb_push(strings.entries, ss);
 
-            free_scene_buffers(&sub_scene, true);
-            unregister_ecs_extensions(&sub_scene);
+            c8* dst = sb_add(strings.chars, len + 1);
+            memcpy(dst, string, len);
+            dst[len] = '\0';
         }
 
-        void save_scene(const c8* filename, ecs_scene* scene)
+        // lookups are written in sections, each section covers all entities so entity ranges can be written
+        // independently and concatenated, which allows autosave to only regenerate ranges which have changed
+        void write_entity_lookups(ecs_scene* scene, u32 section, u32 start, u32 end, scene_writer& w,
+                                  scene_string_builder& strings, const c8* project_dir)
         {
-            const c8* wd = pen::os_get_user_info().working_directory;
-            Str       project_dir = dev_ui::get_program_preference_filename("project_dir", wd);
-
-            std::ofstream ofs(filename, std::ofstream::binary);
-
-            sb_free(s_lookup_strings);
-            s_lookup_strings = nullptr;
-
-            // write basic components
-            for (u32 i = 0; i < scene->num_components; ++i)
+            switch (section)
             {
-                generic_cmp_array& cmp = scene->get_component_array(i);
-                ofs.write((const c8*)cmp.data, cmp.size * scene->num_entities);
-            }
+                case e_scene_lookups::names:
+                {
+                    for (u32 n = start; n < end; ++n)
+                    {
+                        write_lookup_string(scene->names[n].c_str(), w, strings);
+                        write_lookup_string(scene->geometry_names[n].c_str(), w, strings);
+                        write_lookup_string(scene->material_names[n].c_str(), w, strings);
+                    }
+                }
+                break;
+                case e_scene_lookups::geometry:
+                {
+                    for (u32 n = start; n < end; ++n)
+                    {
+                        if (!(scene->entities[n] & e_cmp::geometry))
+                            continue;
 
-            // specialisations ------------------------------------------------------------------------------
+                        geometry_resource* gr = get_geometry_resource(scene->id_geometry[n]);
 
-            // names
-            for (s32 n = 0; n < scene->num_entities; ++n)
-            {
-                write_lookup_string(scene->names[n].c_str(), ofs);
-                write_lookup_string(scene->geometry_names[n].c_str(), ofs);
-                write_lookup_string(scene->material_names[n].c_str(), ofs);
-            }
+                        w.write(gr->submesh_index);
 
-            // geometry
-            for (s32 n = 0; n < scene->num_entities; ++n)
+                        write_lookup_string(gr->filename.c_str(), w, strings, project_dir);
+                        write_lookup_string(gr->geometry_name.c_str(), w, strings, project_dir);
+                    }
+                }
+                break;
+                case e_scene_lookups::animations:
+                {
+                    for (u32 n = start; n < end; ++n)
+                    {
+                        s32 size = 0;
+
+                        if (scene->anim_controller_v2[n].anim_instances)
+                            size = sb_count(scene->anim_controller_v2[n].anim_instances);
+
+                        w.write(size);
+
+                        for (s32 i = 0; i < size; ++i)
+                        {
+                            // todo with anim controller v2
+                            // auto* anim = get_animation_resource(scene->anim_controller_v2[n].anim_instances[i].);
+                            write_lookup_string("placeholder", w, strings, project_dir);
+                        }
+                    }
+                }
+                break;
+                case e_scene_lookups::materials:
+                {
+                    for (u32 n = start; n < end; ++n)
+                    {
+                        if (!(scene->entities[n] & e_cmp::material))
+                            continue;
+
+                        cmp_material&      mat = scene->materials[n];
+                        material_resource& mat_res = scene->material_resources[n];
+
+                        const char* shader_name = pmfx::get_shader_name(mat.shader);
+                        const char* technique_name = pmfx::get_technique_name(mat.shader, mat_res.id_technique);
+
+                        write_lookup_string(mat_res.material_name.c_str(), w, strings);
+                        write_lookup_string(shader_name, w, strings);
+                        write_lookup_string(technique_name, w, strings);
+                    }
+                }
+                break;
+                case e_scene_lookups::shadows:
+                {
+                    for (u32 n = start; n < end; ++n)
+                    {
+                        if (!(scene->entities[n] & e_cmp::sdf_shadow))
+                            continue;
+
+                        cmp_shadow& shadow = scene->shadows[n];
+
+                        write_lookup_string(put::get_texture_filename(shadow.texture_handle).c_str(), w, strings,
+                                            project_dir);
+                    }
+                }
+                break;
+                case e_scene_lookups::samplers:
+                {
+                    for (u32 n = start; n < end; ++n)
+                    {
+                        if (!(scene->entities[n] & e_cmp::samplers))
+                            continue;
+
+                        cmp_samplers& samplers = scene->samplers[n];
+
+                        for (u32 i = 0; i < e_pmfx_constants::max_technique_sampler_bindings; ++i)
+                        {
+                            write_lookup_string(put::get_texture_filename(samplers.sb[i].handle).c_str(), w, strings,
+                                                project_dir);
+                            write_lookup_string(pmfx::get_render_state_name(samplers.sb[i].sampler_state).c_str(), w,
+                                                strings, project_dir);
+                        }
+                    }
+                }
+                break;
+                case e_scene_lookups::area_lights:
+                {
+                    for (u32 n = start; n < end; ++n)
+                    {
+                        if (!(scene->entities[n] & e_cmp::light) || scene->lights[n].type != e_light_type::area_ex)
+                            continue;
+
+                        area_light_resource& alr = scene->area_light_resources[n];
+
+                        write_lookup_string(alr.shader_name.c_str(), w, strings);
+                        write_lookup_string(alr.technique_name.c_str(), w, strings);
+                        write_lookup_string(alr.texture_name.c_str(), w, strings, project_dir);
+                        write_lookup_string(alr.sampler_state_name.c_str(), w, strings);
+                    }
+                }
+                break;
+                default:
+                    break;
+            }
+        }
+
+        void write_string_table(scene_string_builder& strings, scene_writer& w)
+        {
+            u32 num_strings = sb_count(strings.entries);
+            std::sort(strings.entries, strings.entries + num_strings, scene_string_less);
+
+            // unique and compact
+            scene_string_builder interned;
+            for (u32 i = 0; i < num_strings; ++i)
             {
-                if (!(scene->entities[n] & e_cmp::geometry))
+                const scene_string& ss = strings.entries[i];
+                if (i > 0 && ss.id == strings.entries[i - 1].id)
+                    continue;
+
+                scene_string is = {ss.id, (u32)sb_count(interned.chars), ss.len};
+                sb_push(interned.entries, is);
+
+                c8* dst = sb_add(interned.chars, ss.len + 1);
+                memcpy(dst, &strings.chars[ss.offset], ss.len + 1);
+            }
+
+            u32 num_interned = sb_count(interned.entries);
+            u32 chars_size = sb_count(interned.chars);
+            w.write(num_interned);
+            w.write(chars_size);
+            w.write(interned.entries, num_interned * sizeof(scene_string));
+            w.write(interned.chars, chars_size);
+
+            sb_free(interned.entries);
+            sb_free(interned.chars);
+        }
+
+        const c8* find_lookup_string(hash_id id)
+        {
+            // entries are sorted by id
+            u32 lo = 0;
+            u32 hi = s_lookup_strings.num_entries;
+            while (lo < hi)
+            {
+                u32 mid = lo + (hi - lo) / 2;
+                if (s_lookup_strings.entries[mid].id < id)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            if (lo < s_lookup_strings.num_entries && s_lookup_strings.entries[lo].id == id)
+                return &s_lookup_strings.chars[s_lookup_strings.entries[lo].offset];
+
+            return nullptr;
+        }
+
+        const c8* read_lookup_string(scene_reader& r)
+        {
+            hash_id id;
+            r.read(id);
+
+            const c8* str = find_lookup_string(id);
+            return str ? str : "";
+        }
+
+        hash_id rehash_lookup_string(hash_id id)
+        {
+            const c8* str = find_lookup_string(id);
+            if (str)
+                return PEN_HASH(str);
+
+            return 0;
+        }
+
+        void layout_scene_chunks(scene_header& sh, scene_chunk_data* chunks)
+        {
+            u32 num_chunks = sb_count(chunks);
+
+            // layout chunks on page boundaries after the header and directory
+            u64 offset = sizeof(scene_header) + sizeof(scene_chunk) * num_chunks;
+            for (u32 i = 0; i < num_chunks; ++i)
+            {
+                offset = PEN_ALIGN(offset, k_scene_chunk_alignment);
+                chunks[i].chunk.offset = offset;
+                offset += chunks[i].chunk.size;
+            }
+
+            sh.num_chunks = num_chunks;
+            sh.chunk_alignment = k_scene_chunk_alignment;
+        }
+
+        void write_scene_chunk_directory(std::ostream& os, const scene_header& sh, const scene_chunk_data* chunks)
+        {
+            os.write((const c8*)&sh, sizeof(scene_header));
+
+            u32 num_chunks = sb_count(chunks);
+            for (u32 i = 0; i < num_chunks; ++i)
+                os.write((const c8*)&chunks[i].chunk, sizeof(scene_chunk));
+        }
+
+        // writes chunks [first, last) padding from the current stream position up to each chunk offset
+        void write_scene_chunk_data(std::ostream& os, const scene_chunk_data* chunks, u32 first, u32 last)
+        {
+            static const c8 padding[k_scene_chunk_alignment] = {0};
+            for (u32 i = first; i < last; ++i)
+            {
+                u64 pos = (u64)os.tellp();
+                os.write(padding, (std::streamsize)(chunks[i].chunk.offset - pos));
+                os.write((const c8*)chunks[i].data, (std::streamsize)chunks[i].chunk.size);
+            }
+        }
+
+        void write_scene_chunks(const c8* filename, scene_header& sh, scene_chunk_data* chunks, u32 save_flags)
+        {
+            u32   num_chunks = sb_count(chunks);
+            void* compressed = nullptr;
+
+            // compress chunks where it is worthwhile, keeping the compressed data contiguous
+            if (save_flags & e_scene_save_flags::compress)
+            {
+                u32 total_bound = 0;
+                for (u32 i = 0; i < num_chunks; ++i)
+                    total_bound += pen::compress_lz4_bound((u32)chunks[i].chunk.size);
+
+                compressed = pen::memory_alloc(total_bound);
+                u8* dst = (u8*)compressed;
+
+                for (u32 i = 0; i < num_chunks; ++i)
+                {
+                    scene_chunk& chunk = chunks[i].chunk;
+                    u32          bound = pen::compress_lz4_bound((u32)chunk.size);
+                    u32          size = pen::compress_lz4(chunks[i].data, (u32)chunk.size, dst, bound);
+
+                    if (size == 0 || size >= chunk.size)
+                        continue;
+
+                    chunk.flags |= e_scene_chunk_flags::lz4;
+                    chunk.size = size;
+                    chunks[i].data = dst;
+                    dst += size;
+                }
+            }
+
+            layout_scene_chunks(sh, chunks);
+
+            std::ofstream ofs(filename, std::ofstream::binary);
+            write_scene_chunk_directory(ofs, sh, chunks);
+            write_scene_chunk_data(ofs, chunks, 0, num_chunks);
+            ofs.close();
+
+            pen::memory_free(compressed);
+        }
+
+        void save_sub_scene(ecs_scene* scene, u32 root)
+        {
+            std::vector<s32> nodes;
+            build_heirarchy_node_list(scene, root, nodes);
+
+            u32 num = nodes.size();
+
+            ecs_scene sub_scene;
+
+            // create sub scene with same components
+            u32 num_ext = sb_count(scene->extensions);
+            for (u32 e = 0; e < num_ext; ++e)
+                scene->extensions[e].funcs.ext_func(&sub_scene);
+
+            resize_scene_buffers(&sub_scene, num);
+
+            for (u32 i = 0; i < num; ++i)
+            {
+                u32 ii = nodes[i];
+                if (ii == PEN_INVALID_HANDLE)
                     continue;
 
-                geometry_resource* gr = get_geometry_resource(scene->id_geometry[n]);
+                u32 ni = sub_scene.num_entities;
+
+                for (u32 c = 0; c < scene->num_components; ++c)
+                {
+                    generic_cmp_array& src = scene->get_component_array(c);
+                    generic_cmp_array& dst = sub_scene.get_component_array(c);
+
+                    memcpy(dst[ni], src[ii], src.size);
+                }
+
+                sub_scene.parents[ni] -= root;
+                sub_scene.num_entities++;
+            }
+
+            Str fn = "";
+            fn.appendf("../../assets/scene/%s.pms", sub_scene.names[0].c_str());
+
+            save_scene(fn.c_str(), &sub_scene);
+
+            free_scene_buffers(&sub_scene, true);
+            unregister_ecs_extensions(&sub_scene);
+        }
+
+        // camera names are appended to lookups after the entity sections, extensions and camera info have their own chunks
+        void write_scene_globals(ecs_scene* scene, scene_writer& lookups, scene_writer& exts, scene_writer& cam_info,
+                                 scene_string_builder& strings)
+        {
+            // cameras
+            camera** cams = pmfx::get_cameras();
+            u32      num_cams = sb_count(cams);
+            for (u32 i = 0; i < num_cams; ++i)
+            {
+                write_lookup_string(cams[i]->name.c_str(), lookups, strings);
+            }
+
+            // extensions
+            u32 num_extensions = sb_count(scene->extensions);
+            for (u32 i = 0; i < num_extensions; ++i)
+            {
+                u32 co = get_extension_component_offset(scene, i);
+                write_lookup_string(scene->extensions[i].name.c_str(), exts, strings);
+                exts.write(co);
+                exts.write(scene->extensions[i].num_components);
+            }
+
+            // camera info
+            cam_info.write(num_cams);
+            for (u32 i = 0; i < num_cams; ++i)
+            {
+                hash_id id_cam = PEN_HASH(cams[i]->name);
+                cam_info.write(id_cam);
+                cam_info.write(cams[i]->pos);
+                cam_info.write(cams[i]->focus);
+                cam_info.write(cams[i]->rot);
+                cam_info.write(cams[i]->fov);
+                cam_info.write(cams[i]->aspect);
+                cam_info.write(cams[i]->near_plane);
+                cam_info.write(cams[i]->far_plane);
+                cam_info.write(cams[i]->zoom);
+            }
+        }
+
+        void call_extension_save_funcs(ecs_scene* scene)
+        {
+            u32 num_extensions = sb_count(scene->extensions);
+            for (u32 i = 0; i < num_extensions; ++i)
+                if (scene->extensions[i].funcs.save_func)
+                    scene->extensions[i].funcs.save_func(scene->extensions[i], scene);
+        }
+
+        void push_scene_chunk(scene_chunk_data*& chunks, u32 type, u32 index, u32 element_size, u64 size, const void* data)
+        {
+            scene_chunk_data cd = {};
+            cd.chunk.type = type;
+            cd.chunk.index = index;
+            cd.chunk.element_size = element_size;
+            cd.chunk.size = size;
+            cd.chunk.uncompressed_size = size;
+            cd.data = data;
+            sb_push(chunks, cd);
+        }
+
+        // specialisation chunks always follow the component chunks
+        void push_scene_section_chunks(scene_chunk_data*& chunks, scene_writer& exts, scene_writer& strings,
+                                       scene_writer& lookups, scene_writer& cam_info)
+        {
+            push_scene_chunk(chunks, e_scene_chunk::extensions, 0, 0, sb_count(exts.data), exts.data);
+            push_scene_chunk(chunks, e_scene_chunk::strings, 0, 0, sb_count(strings.data), strings.data);
+            push_scene_chunk(chunks, e_scene_chunk::lookups, 0, 0, sb_count(lookups.data), lookups.data);
+            push_scene_chunk(chunks, e_scene_chunk::cameras, 0, 0, sb_count(cam_info.data), cam_info.data);
+        }
+
+        // version 10 section stream: header, component sizes, extensions, strings, cameras, components, lookups
+        void write_scene_v10(const c8* filename, scene_header& sh, ecs_scene* scene, scene_writer& exts,
+                             scene_writer& strings, scene_writer& lookups, scene_writer& cam_info)
+        {
+            sh.version = 10;
+
+            std::ofstream ofs(filename, std::ofstream::binary);
+            ofs.write((const c8*)&sh, sizeof(scene_header));
+
+            for (u32 c = 0; c < sh.num_components; ++c)
+                ofs.write((const c8*)&scene->get_component_array(c).size, sizeof(u32));
+
+            ofs.write((const c8*)exts.data, sb_count(exts.data));
+
+            // strings are length, chars, id rather than the sorted table
+            scene_reader        r = {strings.data, (size_t)sb_count(strings.data), 0};
+            u32                 num_strings, chars_size;
+            r.read(num_strings);
+            r.read(chars_size);
+            const scene_string* entries = (const scene_string*)r.skip(num_strings * sizeof(scene_string));
+            const c8*           chars = (const c8*)r.skip(chars_size);
+            for (u32 i = 0; i < num_strings; ++i)
+            {
+                ofs.write((const c8*)&entries[i].len, sizeof(u32));
+                ofs.write(&chars[entries[i].offset], entries[i].len);
+                ofs.write((const c8*)&entries[i].id, sizeof(hash_id));
+            }
+
+            ofs.write((const c8*)cam_info.data, sb_count(cam_info.data));
+
+            for (u32 c = 0; c < sh.num_components; ++c)
+            {
+                generic_cmp_array& cmp = scene->get_component_array(c);
+                ofs.write((const c8*)cmp.data, (size_t)cmp.size * scene->num_entities);
+            }
+
+            ofs.write((const c8*)lookups.data, sb_count(lookups.data));
+            ofs.close();
+        }
+
+        void save_scene(const c8* filename, ecs_scene* scene, u32 save_flags)
+        {
+            const c8* wd = pen::os_get_user_info().working_directory;
+            Str       project_dir = dev_ui::get_program_preference_filename("project_dir", wd);
+
+            sb_free(s_save_strings.entries);
+            sb_free(s_save_strings.chars);
+            s_save_strings = {};
+
+            // call extensions specific save
+            call_extension_save_funcs(scene);
+
+            // specialisations ------------------------------------------------------------------------------
+            bool v10 = save_flags & e_scene_save_flags::version_10;
+            u32  num_lookups = v10 ? (u32)e_scene_lookups::area_lights : (u32)e_scene_lookups::COUNT;
+
+            scene_writer lookups;
+            for (u32 i = 0; i < num_lookups; ++i)
+                write_entity_lookups(scene, i, 0, scene->num_entities, lookups, s_save_strings, project_dir.c_str());
+
+            scene_writer exts;
+            scene_writer cam_info;
+            write_scene_globals(scene, lookups, exts, cam_info, s_save_strings);
+
+            // interned strings, written last once all lookups have been gathered
+            scene_writer strings;
+            write_string_table(s_save_strings, strings);
+
+            // header
+            scene_header sh;
+            sh.num_nodes = scene->num_entities;
+            sh.view_flags = scene->view_flags;
+            sh.selected_index = scene->selected_index;
+            sh.num_components = scene->num_components;
+            sh.num_base_components = scene->num_base_components;
+            sh.num_lookup_strings = *(u32*)strings.data;
+            sh.num_extensions = sb_count(scene->extensions);
+
+            if (v10)
+            {
+                write_scene_v10(filename, sh, scene, exts, strings, lookups, cam_info);
+
+                sb_free(exts.data);
+                sb_free(strings.data);
+                sb_free(lookups.data);
+                sb_free(cam_info.data);
+                return;
+            }
+
+            // chunk directory, a chunk per component array followed by the specialisations
+            scene_chunk_data* chunks = nullptr;
+            for (u32 c = 0; c < sh.num_components; ++c)
+            {
+                generic_cmp_array& cmp = scene->get_component_array(c);
+                push_scene_chunk(chunks, e_scene_chunk::component, c, cmp.size, (u64)cmp.size * scene->num_entities,
+                                 cmp.data);
+            }
+
+            push_scene_section_chunks(chunks, exts, strings, lookups, cam_info);
+
+            write_scene_chunks(filename, sh, chunks, save_flags);
+
+            // cleanup
+            sb_free(exts.data);
+            sb_free(strings.data);
+            sb_free(lookups.data);
+            sb_free(cam_info.data);
+            sb_free(chunks);
+        }
+
+        // autosave ----------------------------------------------------------------------------------------------------
+        // the scene is captured into a snapshot a block of entities at a time over as many frames as it takes, blocks
+        // are compared against the previous snapshot so after the first full save only the changed ranges of component
+        // arrays are written back into the file in place. blocks are consistent but may be captured on different
+        // frames, any structural edit (create, delete, swap or reparent) restarts the capture so blocks agree on the
+        // hierarchy.
+        // full saves are written to <file>.tmp and renamed over the file, delta saves are journaled in <file>.journal
+        // before the file is patched and a complete journal left by a crash is replayed by the next load_scene
+
+        static const u32 k_autosave_block_size = 256;
+
+        namespace e_autosave_state
+        {
+            enum autosave_state_t
+            {
+                idle,
+                capturing,
+                serialising
+            };
+        }
+
+        struct autosave_block
+        {
+            scene_writer         lookups[e_scene_lookups::COUNT];
+            scene_string_builder strings;
+            u32                  hash;
+        };
+
+        struct autosave_snapshot
+        {
+            ecs_scene*           scene = nullptr;
+            Str                  filename;
+            Str                  project_dir;
+            u32                  num_entities = 0;
+            u32                  num_components = 0;
+            u32                  num_blocks = 0;
+            u32*                 component_sizes = nullptr;
+            u8**                 components = nullptr;
+            u8*                  dirty = nullptr; // num_components * num_blocks
+            autosave_block*      blocks = nullptr;
+            scene_header         header;
+            scene_writer         lookups; // cameras
+            scene_writer         exts;
+            scene_writer         cam_info;
+            scene_string_builder strings;
+            u32                  globals_hash = 0;
+            u32                  next_block = 0;
+            u32                  structure_version = 0;
+            bool                 full_save = true;
+            bool                 lookups_dirty = false;
+            f64                  capture_ms = 0.0;
+            f64                  capture_max_ms = 0.0;
+            f64                  last_save_time = 0.0;
+            scene_autosave_stats stats; // owned by the autosave thread
+            a_u32                state;
+        };
+
+        static autosave_snapshot    s_autosave;
+        static scene_autosave_stats s_autosave_stats; // copy of snap.stats published under s_autosave_stats_mutex
+        static pen::mutex*          s_autosave_stats_mutex = nullptr;
+        static pen::semaphore*      s_autosave_queued = nullptr;
+        static bool                 s_autosave_thread = false;
+
+        void clear_string_builder(scene_string_builder& sb)
+        {
+            if (sb.entries)
+                stb__sbn(sb.entries) = 0;
+
+            if (sb.chars)
+                stb__sbn(sb.chars) = 0;
+        }
+
+        void append_string_builder(scene_string_builder& dst, const scene_string_builder& src)
+        {
+            u32 base = sb_count(dst.chars);
+            u32 num_entries = sb_count(src.entries);
+            for (u32 i = 0; i < num_entries; ++i)
+            {
+                scene_string ss = src.entries[i];
+                ss.offset += base;
+                sb_push(dst.entries, ss);
+            }
+
+            u32 num_chars = sb_count(src.chars);
+            if (num_chars)
+                memcpy(sb_add(dst.chars, num_chars), src.chars, num_chars);
+        }
+
+        void add_writer_hash(pen::hash_murmur& hm, const scene_writer& w)
+        {
+            u32 size = sb_count(w.data);
+            if (size)
+                hm.add(w.data, size);
+        }
+
+        static const u32 k_autosave_journal_magic = PEN_FOURCC('P', 'J', 'N', 'L');
+
+        struct autosave_journal_header
+        {
+            u32 magic; // written last, an unfinished journal has none
+            u32 num_patches;
+            u32 hash; // of the patch records that follow
+            u32 reserved;
+        };
+
+        struct autosave_patch
+        {
+            u64       offset;
+            u64       size;
+            const u8* data;
+        };
+
+        Str autosave_filename(const c8* filename, const c8* ext)
+        {
+            Str fn = filename;
+            fn.append(ext);
+            return fn;
+        }
+
+        void apply_autosave_patches(const c8* filename, const autosave_patch* patches, u32 num_patches)
+        {
+            std::fstream fs(filename, std::fstream::in | std::fstream::out | std::fstream::binary);
+            for (u32 i = 0; i < num_patches; ++i)
+            {
+                fs.seekp((std::streamoff)patches[i].offset);
+                fs.write((const c8*)patches[i].data, (std::streamsize)patches[i].size);
+            }
+            fs.close();
+        }
+
+        bool write_autosave_journal(const c8* filename, const autosave_patch* patches, u32 num_patches)
+        {
+            Str           jfn = autosave_filename(filename, ".journal");
+            std::ofstream ofs(jfn.c_str(), std::ofstream::binary);
+            if (!ofs.is_open())
+                return false;
+
+            autosave_journal_header jh = {};
+            ofs.write((const c8*)&jh, sizeof(jh));
+
+            pen::hash_murmur hm;
+            hm.begin();
+            for (u32 i = 0; i < num_patches; ++i)
+            {
+                const autosave_patch& p = patches[i];
+                ofs.write((const c8*)&p.offset, sizeof(u64));
+                ofs.write((const c8*)&p.size, sizeof(u64));
+                ofs.write((const c8*)p.data, (std::streamsize)p.size);
+
+                hm.add(&p.offset, sizeof(u64));
+                hm.add(&p.size, sizeof(u64));
+                hm.add(p.data, (s32)p.size);
+            }
+
+            // records are flushed before the header marks the journal complete
+            ofs.flush();
+
+            jh.magic = k_autosave_journal_magic;
+            jh.num_patches = num_patches;
+            jh.hash = hm.end();
+
+            ofs.seekp(0);
+            ofs.write((const c8*)&jh, sizeof(jh));
+            ofs.close();
+
+            return !ofs.fail();
+        }
+
+        // applies a complete journal left by an interrupted delta save, an incomplete one is discarded because the
+        // file is only patched after the journal is complete
+        void replay_autosave_journal(const c8* filename)
+        {
+            Str    jfn = autosave_filename(filename, ".journal");
+            void*  data = nullptr;
+            size_t size = 0;
+            if (pen::filesystem_map_file(jfn.c_str(), &data, size) != PEN_ERR_OK)
+                return;
+
+            scene_reader            r = {(const u8*)data, size, 0};
+            autosave_journal_header jh;
+            r.read(jh);
+
+            autosave_patch* patches = nullptr;
+            bool            valid = jh.magic == k_autosave_journal_magic;
+
+            pen::hash_murmur hm;
+            hm.begin();
+            for (u32 i = 0; valid && i < jh.num_patches; ++i)
+            {
+                autosave_patch p;
+                r.read(p.offset);
+                r.read(p.size);
+
+                valid = r.pos <= r.size && p.size <= r.size - r.pos;
+                if (!valid)
+                    break;
+
+                p.data = r.skip((size_t)p.size);
+                sb_push(patches, p);
+
+                hm.add(&p.offset, sizeof(u64));
+                hm.add(&p.size, sizeof(u64));
+                hm.add(p.data, (s32)p.size);
+            }
+
+            if (valid && hm.end() == jh.hash)
+            {
+                apply_autosave_patches(filename, patches, jh.num_patches);
+                dev_ui::log_level(dev_ui::console_level::message, "[scene] replayed autosave journal: %s", jfn.c_str());
+            }
+            else
+            {
+                dev_ui::log_level(dev_ui::console_level::warning, "[scene] discarding incomplete autosave journal: %s",
+                                  jfn.c_str());
+            }
+
+            sb_free(patches);
+            pen::filesystem_unmap_file(data, size);
+            std::remove(jfn.c_str());
+        }
+
+        void free_autosave_snapshot(autosave_snapshot& snap)
+        {
+            for (u32 c = 0; c < snap.num_components; ++c)
+                pen::memory_free(snap.components[c]);
+
+            for (u32 b = 0; b < snap.num_blocks; ++b)
+            {
+                autosave_block& blk = snap.blocks[b];
+                for (u32 i = 0; i < e_scene_lookups::COUNT; ++i)
+                    sb_free(blk.lookups[i].data);
+
+                sb_free(blk.strings.entries);
+                sb_free(blk.strings.chars);
+            }
+
+            pen::memory_free(snap.components);
+            pen::memory_free(snap.component_sizes);
+            pen::memory_free(snap.dirty);
+            pen::memory_free(snap.blocks);
+
+            snap.components = nullptr;
+            snap.component_sizes = nullptr;
+            snap.dirty = nullptr;
+            snap.blocks = nullptr;
+            snap.num_components = 0;
+            snap.num_blocks = 0;
+        }
+
+        void begin_autosave_capture(ecs_scene* scene, const c8* filename)
+        {
+            autosave_snapshot& snap = s_autosave;
+
+            bool layout_changed = snap.scene != scene || snap.num_entities != scene->num_entities ||
+                                  snap.num_components != scene->num_components ||
+                                  strcmp(snap.filename.c_str(), filename) != 0;
+
+            for (u32 c = 0; !layout_changed && c < snap.num_components; ++c)
+                layout_changed = snap.component_sizes[c] != scene->get_component_array(c).size;
+
+            if (layout_changed)
+            {
+                free_autosave_snapshot(snap);
+
+                snap.scene = scene;
+                snap.filename = filename;
+                snap.num_entities = scene->num_entities;
+                snap.num_components = scene->num_components;
+                snap.num_blocks = (snap.num_entities + k_autosave_block_size - 1) / k_autosave_block_size;
+
+                snap.component_sizes = (u32*)pen::memory_alloc(sizeof(u32) * snap.num_components);
+                snap.components = (u8**)pen::memory_alloc(sizeof(u8*) * snap.num_components);
+                for (u32 c = 0; c < snap.num_components; ++c)
+                {
+                    snap.component_sizes[c] = scene->get_component_array(c).size;
+                    snap.components[c] = (u8*)pen::memory_alloc((size_t)snap.component_sizes[c] * snap.num_entities);
+                }
+
+                snap.dirty = (u8*)pen::memory_calloc(snap.num_components * snap.num_blocks, 1);
+                snap.blocks = (autosave_block*)pen::memory_calloc(snap.num_blocks, sizeof(autosave_block));
+
+                snap.full_save = true;
+            }
+
+            const c8* wd = pen::os_get_user_info().working_directory;
+            snap.project_dir = dev_ui::get_program_preference_filename("project_dir", wd);
+
+            call_extension_save_funcs(scene);
+
+            snap.structure_version = scene->structure_version;
+            snap.next_block = 0;
+            snap.capture_ms = 0.0;
+            snap.capture_max_ms = 0.0;
+        }
+
+        void capture_autosave_block(ecs_scene* scene, u32 b)
+        {
+            autosave_snapshot& snap = s_autosave;
+
+            u32 start = b * k_autosave_block_size;
+            u32 end = min(start + k_autosave_block_size, snap.num_entities);
+
+            for (u32 c = 0; c < snap.num_components; ++c)
+            {
+                u32 size = snap.component_sizes[c];
+                u8* src = (u8*)scene->get_component_array(c).data + (size_t)start * size;
+                u8* dst = snap.components[c] + (size_t)start * size;
+
+                size_t bytes = (size_t)(end - start) * size;
+                if (snap.full_save || memcmp(dst, src, bytes) != 0)
+                {
+                    memcpy(dst, src, bytes);
+                    snap.dirty[c * snap.num_blocks + b] = 1;
+                }
+            }
+
+            // lookups reference strings and resources which can change without touching component memory
+            autosave_block& blk = snap.blocks[b];
+            clear_string_builder(blk.strings);
+
+            pen::hash_murmur hm;
+            hm.begin();
+            for (u32 i = 0; i < e_scene_lookups::COUNT; ++i)
+            {
+                blk.lookups[i].clear();
+                write_entity_lookups(scene, i, start, end, blk.lookups[i], blk.strings, snap.project_dir.c_str());
+                add_writer_hash(hm, blk.lookups[i]);
+            }
+
+            u32 hash = hm.end();
+            if (hash != blk.hash)
+            {
+                blk.hash = hash;
+                snap.lookups_dirty = true;
+            }
+        }
+
+        // returns true if anything needs writing
+        bool end_autosave_capture(ecs_scene* scene)
+        {
+            autosave_snapshot& snap = s_autosave;
+
+            snap.lookups.clear();
+            snap.exts.clear();
+            snap.cam_info.clear();
+            clear_string_builder(snap.strings);
+
+            write_scene_globals(scene, snap.lookups, snap.exts, snap.cam_info, snap.strings);
+
+            scene_header& sh = snap.header;
+            sh = scene_header();
+            sh.num_nodes = snap.num_entities;
+            sh.view_flags = scene->view_flags;
+            sh.selected_index = scene->selected_index;
+            sh.num_components = snap.num_components;
+            sh.num_base_components = scene->num_base_components;
+            sh.num_extensions = sb_count(scene->extensions);
 
-                ofs.write((const c8*)&gr->submesh_index, sizeof(u32));
+            pen::hash_murmur hm;
+            hm.begin();
+            hm.add(&sh, sizeof(scene_header));
+            add_writer_hash(hm, snap.lookups);
+            add_writer_hash(hm, snap.exts);
+            add_writer_hash(hm, snap.cam_info);
 
-                write_lookup_string(gr->filename.c_str(), ofs, project_dir.c_str());
-                write_lookup_string(gr->geometry_name.c_str(), ofs, project_dir.c_str());
+            u32 hash = hm.end();
+            if (hash != snap.globals_hash)
+            {
+                snap.globals_hash = hash;
+                snap.lookups_dirty = true;
             }
 
-            // animations
-            for (s32 n = 0; n < scene->num_entities; ++n)
+            if (snap.full_save || snap.lookups_dirty)
+                return true;
+
+            u32 num_dirty = snap.num_components * snap.num_blocks;
+            for (u32 i = 0; i < num_dirty; ++i)
+                if (snap.dirty[i])
+                    return true;
+
+            return false;
+        }
+
+        // runs on the autosave thread, the main thread does not touch the snapshot while serialising
+        void write_autosave(autosave_snapshot& snap)
+        {
+            f64 start = pen::get_time_ms();
+
+            // gather block lookups and strings in section order
+            scene_string_builder merged = {};
+            for (u32 b = 0; b < snap.num_blocks; ++b)
+                append_string_builder(merged, snap.blocks[b].strings);
+
+            append_string_builder(merged, snap.strings);
+
+            scene_writer lookups;
+            for (u32 i = 0; i < e_scene_lookups::COUNT; ++i)
+                for (u32 b = 0; b < snap.num_blocks; ++b)
+                    lookups.write(snap.blocks[b].lookups[i].data, sb_count(snap.blocks[b].lookups[i].data));
+
+            lookups.write(snap.lookups.data, sb_count(snap.lookups.data));
+
+            scene_writer strings;
+            write_string_table(merged, strings);
+
+            scene_header sh = snap.header;
+            sh.num_lookup_strings = *(u32*)strings.data;
+
+            scene_chunk_data* chunks = nullptr;
+            for (u32 c = 0; c < snap.num_components; ++c)
             {
-                s32 size = 0;
+                u32 size = snap.component_sizes[c];
+                push_scene_chunk(chunks, e_scene_chunk::component, c, size, (u64)size * snap.num_entities,
+                                 snap.components[c]);
+            }
 
-                if (scene->anim_controller_v2[n].anim_instances)
-                    size = sb_count(scene->anim_controller_v2[n].anim_instances);
+            push_scene_section_chunks(chunks, snap.exts, strings, lookups, snap.cam_info);
 
-                ofs.write((const c8*)&size, sizeof(s32));
+            // component chunks keep their offsets between saves because the layout has not changed
+            layout_scene_chunks(sh, chunks);
 
-                for (s32 i = 0; i < size; ++i)
-                {
-                    // todo with anim controller v2
-                    // auto* anim = get_animation_resource(scene->anim_controller_v2[n].anim_instances[i].);
-                    write_lookup_string("placeholder", ofs, project_dir.c_str());
-                }
+            const c8* filename = snap.filename.c_str();
+            if (!snap.full_save)
+            {
+                std::ifstream ifs(filename, std::ifstream::binary);
+                snap.full_save = !ifs.is_open();
             }
 
-            // material
-            for (s32 n = 0; n < scene->num_entities; ++n)
+            u64 bytes_written = 0;
+            u32 num_chunks = sb_count(chunks);
+            if (snap.full_save)
             {
-                if (!(scene->entities[n] & e_cmp::material))
-                    continue;
+                // written aside and renamed over the file so a crash leaves the previous save intact
+                Str tmp = autosave_filename(filename, ".tmp");
+                write_scene_chunks(tmp.c_str(), sh, chunks, e_scene_save_flags::none);
 
-                cmp_material&      mat = scene->materials[n];
-                material_resource& mat_res = scene->material_resources[n];
+                // windows will not rename over an existing file
+                if (std::rename(tmp.c_str(), filename) != 0)
+                {
+                    std::remove(filename);
+                    std::rename(tmp.c_str(), filename);
+                }
 
-                const char* shader_name = pmfx::get_shader_name(mat.shader);
-                const char* technique_name = pmfx::get_technique_name(mat.shader, mat_res.id_technique);
+                // a journal left from before is for the replaced file
+                Str jfn = autosave_filename(filename, ".journal");
+                std::remove(jfn.c_str());
 
-                write_lookup_string(mat_res.material_name.c_str(), ofs);
-                write_lookup_string(shader_name, ofs);
-                write_lookup_string(technique_name, ofs);
-            }
+                for (u32 i = 0; i < num_chunks; ++i)
+                    bytes_written += chunks[i].chunk.size;
 
-            // shadow
-            for (s32 n = 0; n < scene->num_entities; ++n)
+                snap.stats.num_full_saves++;
+                snap.full_save = false;
+            }
+            else
             {
-                if (!(scene->entities[n] & e_cmp::sdf_shadow))
-                    continue;
+                autosave_patch* patches = nullptr;
 
-                cmp_shadow& shadow = scene->shadows[n];
+                // contiguous runs of dirty blocks
+                for (u32 c = 0; c < snap.num_components; ++c)
+                {
+                    const u8* dirty = &snap.dirty[c * snap.num_blocks];
+                    u32       size = snap.component_sizes[c];
+
+                    for (u32 b = 0; b < snap.num_blocks;)
+                    {
+                        if (!dirty[b])
+                        {
+                            ++b;
+                            continue;
+                        }
+
+                        u32 first = b;
+                        while (b < snap.num_blocks && dirty[b])
+                            ++b;
+
+                        u64 start_entity = (u64)first * k_autosave_block_size;
+                        u64 end_entity = min<u64>((u64)b * k_autosave_block_size, snap.num_entities);
+
+                        autosave_patch p;
+                        p.offset = chunks[c].chunk.offset + start_entity * size;
+                        p.size = (end_entity - start_entity) * size;
+                        p.data = snap.components[c] + start_entity * size;
+                        sb_push(patches, p);
+                    }
+                }
+
+                // variable sized chunks are rewritten at the end of the file, including the padding between them
+                u64 tail = sizeof(scene_header) + sizeof(scene_chunk) * num_chunks;
+                if (snap.num_components > 0)
+                    tail = chunks[snap.num_components - 1].chunk.offset + chunks[snap.num_components - 1].chunk.size;
+
+                u64 tail_end = tail;
+                if (num_chunks > 0)
+                    tail_end = max(tail, chunks[num_chunks - 1].chunk.offset + chunks[num_chunks - 1].chunk.size);
 
-                write_lookup_string(put::get_texture_filename(shadow.texture_handle).c_str(), ofs, project_dir.c_str());
+                u8* tail_data = (u8*)pen::memory_calloc((size_t)(tail_end - tail) + 1, 1);
+                for (u32 i = snap.num_components; i < num_chunks; ++i)
+                    memcpy(tail_data + (chunks[i].chunk.offset - tail), chunks[i].data, (size_t)chunks[i].chunk.size);
+
+                autosave_patch tp = {tail, tail_end - tail, tail_data};
+                sb_push(patches, tp);
+
+                // and the directory last
+                u32 directory_size = sizeof(scene_header) + sizeof(scene_chunk) * num_chunks;
+                u8* directory = (u8*)pen::memory_alloc(directory_size);
+                memcpy(directory, &sh, sizeof(scene_header));
+
+                scene_chunk* directory_chunks = (scene_chunk*)(directory + sizeof(scene_header));
+                for (u32 i = 0; i < num_chunks; ++i)
+                    memcpy(&directory_chunks[i], &chunks[i].chunk, sizeof(scene_chunk));
+
+                autosave_patch dp = {0, directory_size, directory};
+                sb_push(patches, dp);
+
+                u32 num_patches = sb_count(patches);
+                if (write_autosave_journal(filename, patches, num_patches))
+                {
+                    apply_autosave_patches(filename, patches, num_patches);
+
+                    Str jfn = autosave_filename(filename, ".journal");
+                    std::remove(jfn.c_str());
+
+                    for (u32 i = 0; i < num_patches; ++i)
+                        bytes_written += patches[i].size;
+                }
+                else
+                {
+                    // the file is left untouched and rewritten in full next time
+                    dev_ui::log_level(dev_ui::console_level::error, "[error] scene - cannot write autosave journal: %s",
+                                      filename);
+                    snap.full_save = true;
+                }
+
+                pen::memory_free(tail_data);
+                pen::memory_free(directory);
+                sb_free(patches);
             }
 
-            // sampler bindings
-            for (s32 n = 0; n < scene->num_entities; ++n)
+            memset(snap.dirty, 0x0, snap.num_components * snap.num_blocks);
+            snap.lookups_dirty = false;
+
+            snap.stats.num_saves++;
+            snap.stats.bytes_written = bytes_written;
+            snap.stats.capture_ms = snap.capture_ms;
+            snap.stats.capture_max_ms = snap.capture_max_ms;
+            snap.stats.serialise_ms = pen::get_time_ms() - start;
+
+            pen::mutex_lock(s_autosave_stats_mutex);
+            s_autosave_stats = snap.stats;
+            pen::mutex_unlock(s_autosave_stats_mutex);
+
+            sb_free(merged.entries);
+            sb_free(merged.chars);
+            sb_free(lookups.data);
+            sb_free(strings.data);
+            sb_free(chunks);
+        }
+
+        void* autosave_thread(void* params)
+        {
+            pen::job_thread_params* job_params = (pen::job_thread_params*)params;
+
+            pen::job* p_thread_info = job_params->job_info;
+            p_thread_info->p_sem_wake = s_autosave_queued;
+            pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+
+            for (;;)
             {
-                if (!(scene->entities[n] & e_cmp::samplers))
-                    continue;
+                // posted when a snapshot is queued and by jobs_terminate_all
+                pen::semaphore_wait(s_autosave_queued);
 
-                cmp_samplers& samplers = scene->samplers[n];
+                if (pen::semaphore_try_wait(p_thread_info->p_sem_exit))
+                    break;
 
-                for (u32 i = 0; i < e_pmfx_constants::max_technique_sampler_bindings; ++i)
+                if (s_autosave.state == e_autosave_state::serialising)
                 {
-                    write_lookup_string(put::get_texture_filename(samplers.sb[i].handle).c_str(), ofs, project_dir.c_str());
-                    write_lookup_string(pmfx::get_render_state_name(samplers.sb[i].sampler_state).c_str(), ofs,
-                                        project_dir.c_str());
+                    write_autosave(s_autosave);
+                    s_autosave.last_save_time = pen::get_time_ms();
+                    s_autosave.state = e_autosave_state::idle;
                 }
             }
 
-            // cameras
-            camera** cams = pmfx::get_cameras();
-            u32      num_cams = sb_count(cams);
-            for (u32 i = 0; i < num_cams; ++i)
+            pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+            pen::semaphore_post(p_thread_info->p_sem_terminated, 1);
+            return PEN_THREAD_OK;
+        }
+
+        void update_scene_autosave(ecs_scene* scene, const c8* filename, f32 interval_s, f32 budget_ms)
+        {
+            autosave_snapshot& snap = s_autosave;
+
+            u32 state = snap.state;
+            if (state == e_autosave_state::serialising)
+                return;
+
+            if (!s_autosave_thread)
             {
-                write_lookup_string(cams[i]->name.c_str(), ofs);
+                s_autosave_stats_mutex = pen::mutex_create();
+                s_autosave_queued = pen::semaphore_create(0, 1);
+                pen::jobs_create_job(autosave_thread, 1024 * 1024, nullptr, pen::e_thread_start_flags::detached);
+                s_autosave_thread = true;
             }
 
-            // call extensions specific save
-            u32 num_extensions = sb_count(scene->extensions);
-            for (u32 i = 0; i < num_extensions; ++i)
-                if (scene->extensions[i].funcs.save_func)
-                    scene->extensions[i].funcs.save_func(scene->extensions[i], scene);
+            f64 start = pen::get_time_ms();
 
-            ofs.close();
+            if (state == e_autosave_state::idle)
+            {
+                if (start - snap.last_save_time < (f64)interval_s * 1000.0)
+                    return;
 
-            std::ifstream infile(filename, std::ifstream::binary);
+                begin_autosave_capture(scene, filename);
+                snap.state = e_autosave_state::capturing;
+            }
+            else if (scene != snap.scene || scene->num_entities != snap.num_entities ||
+                     scene->num_components != snap.num_components || scene->structure_version != snap.structure_version)
+            {
+                // entities were added, removed, moved or reparented mid capture, start again
+                begin_autosave_capture(scene, filename);
+            }
 
-            // get size of file
-            infile.seekg(0, infile.end);
-            u32 scene_data_size = (u32)infile.tellg();
-            infile.seekg(0);
+            while (snap.next_block < snap.num_blocks)
+            {
+                capture_autosave_block(scene, snap.next_block++);
 
-            // allocate memory for file content
-            c8* scene_data = new c8[scene_data_size];
+                if (pen::get_time_ms() - start > budget_ms)
+                    break;
+            }
 
-            // read content of infile
-            infile.read(scene_data, scene_data_size);
+            bool complete = snap.next_block >= snap.num_blocks;
+            bool needs_write = complete && end_autosave_capture(scene);
 
-            ofs = std::ofstream(filename, std::ofstream::binary);
+            f64 elapsed = pen::get_time_ms() - start;
+            snap.capture_ms += elapsed;
+            snap.capture_max_ms = max(snap.capture_max_ms, elapsed);
 
-            // header
-            scene_header sh;
-            sh.num_nodes = scene->num_entities;
-            sh.view_flags = scene->view_flags;
-            sh.selected_index = scene->selected_index;
-            sh.num_components = scene->num_components;
-            sh.num_base_components = scene->num_base_components;
-            sh.num_lookup_strings = sb_count(s_lookup_strings);
-            sh.num_extensions = sb_count(scene->extensions);
-            ofs.write((const c8*)&sh, sizeof(scene_header));
+            if (!complete)
+                return;
 
-            // component sizes
-            for (u32 c = 0; c < sh.num_components; ++c)
+            if (needs_write)
             {
-                ofs.write((const c8*)&scene->get_component_array(c).size, sizeof(u32));
+                snap.state = e_autosave_state::serialising;
+                pen::semaphore_post(s_autosave_queued, 1);
+            }
+            else
+            {
+                snap.last_save_time = pen::get_time_ms();
+                snap.state = e_autosave_state::idle;
+            }
+        }
+
+        scene_autosave_stats get_scene_autosave_stats()
+        {
+            scene_autosave_stats stats;
+            if (!s_autosave_stats_mutex)
+                return stats;
+
+            pen::mutex_lock(s_autosave_stats_mutex);
+            stats = s_autosave_stats;
+            pen::mutex_unlock(s_autosave_stats_mutex);
+            return stats;
+        }
+
+        const u8* get_chunk_data(const u8* file_data, size_t file_size, const scene_chunk& chunk, scene_sections& ss)
+        {
+            if (chunk.offset + chunk.size > file_size)
+                return nullptr;
+
+            const u8* data = file_data + chunk.offset;
+
+            if (!(chunk.flags & e_scene_chunk_flags::lz4))
+                return data;
+
+            void* decompressed = pen::memory_alloc((size_t)chunk.uncompressed_size);
+            sb_push(ss.allocations, decompressed);
+
+            u32 size = pen::decompress_lz4(data, (u32)chunk.size, decompressed, (u32)chunk.uncompressed_size);
+            if (size != chunk.uncompressed_size)
+                return nullptr;
+
+            return (const u8*)decompressed;
+        }
+
+        void read_string_table(const u8* data, size_t size)
+        {
+            scene_reader r = {data, size, 0};
+
+            u32 num_entries, chars_size;
+            r.read(num_entries);
+            r.read(chars_size);
+
+            const u8* entries = r.skip(num_entries * sizeof(scene_string));
+            const u8* chars = r.skip(chars_size);
+
+            if (!entries || !chars)
+                return;
+
+            s_lookup_strings.entries = (const scene_string*)entries;
+            s_lookup_strings.chars = (const c8*)chars;
+            s_lookup_strings.num_entries = num_entries;
+        }
+
+        bool read_scene_chunks(const u8* file_data, size_t file_size, const scene_header& sh, scene_sections& ss)
+        {
+            scene_reader      r = {file_data, file_size, sizeof(scene_header)};
+            const scene_chunk* chunks = (const scene_chunk*)r.skip(sizeof(scene_chunk) * sh.num_chunks);
+            if (!chunks)
+                return false;
+
+            // components without a chunk are left null and skipped on load
+            memset(sb_add(ss.component_sizes, sh.num_components), 0x0, sh.num_components * sizeof(u32));
+            memset(sb_add(ss.component_data, sh.num_components), 0x0, sh.num_components * sizeof(const u8*));
+            memset(sb_add(ss.component_bytes, sh.num_components), 0x0, sh.num_components * sizeof(u64));
+
+            for (u32 i = 0; i < sh.num_chunks; ++i)
+            {
+                const scene_chunk& chunk = chunks[i];
+
+                const u8* data = get_chunk_data(file_data, file_size, chunk, ss);
+                if (!data)
+                    return false;
+
+                // uncompressed chunks are bounds checked against the file with their stored size
+                size_t size = (size_t)(chunk.flags & e_scene_chunk_flags::lz4 ? chunk.uncompressed_size : chunk.size);
+
+                switch (chunk.type)
+                {
+                    case e_scene_chunk::component:
+                        if (chunk.index < sh.num_components)
+                        {
+                            ss.component_sizes[chunk.index] = chunk.element_size;
+                            ss.component_data[chunk.index] = data;
+                            ss.component_bytes[chunk.index] = size;
+                        }
+                        break;
+                    case e_scene_chunk::extensions:
+                    {
+                        scene_reader er = {data, size, 0};
+                        for (u32 e = 0; e < sh.num_extensions; ++e)
+                        {
+                            ext_components ext;
+                            er.read(ext.id);
+                            er.read(ext.start_cmp);
+                            er.read(ext.num_cmp);
+                            sb_push(ss.exts, ext);
+                        }
+                    }
+                    break;
+                    case e_scene_chunk::strings:
+                        read_string_table(data, size);
+                        break;
+                    case e_scene_chunk::lookups:
+                        ss.lookups = {data, size, 0};
+                        break;
+                    case e_scene_chunk::cameras:
+                        ss.cameras = {data, size, 0};
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            return sb_count(ss.exts) == sh.num_extensions;
+        }
+
+        bool read_scene_v10(const u8* file_data, size_t file_size, const scene_header& sh, scene_sections& ss)
+        {
+            // version 10 and earlier are a stream of sections, with string lookups written as parsable strings
+            scene_reader r = {file_data, file_size, sizeof(scene_header)};
+
+            for (u32 i = 0; i < sh.num_components; ++i)
+            {
+                u32 size;
+                r.read(size);
+                sb_push(ss.component_sizes, size);
             }
 
-            // extensions
             for (u32 i = 0; i < sh.num_extensions; ++i)
             {
-                u32 co = get_extension_component_offset(scene, i);
-                write_lookup_string(scene->extensions[i].name.c_str(), ofs);
-                ofs.write((const c8*)&co, sizeof(u32));
-                ofs.write((const c8*)&scene->extensions[i].num_components, sizeof(u32));
+                ext_components ext;
+                r.read(ext.id);
+                r.read(ext.start_cmp);
+                r.read(ext.num_cmp);
+                sb_push(ss.exts, ext);
             }
 
-            // string lookups
-            for (u32 l = 0; l < sh.num_lookup_strings; ++l)
+            sb_free(s_legacy_strings.entries);
+            sb_free(s_legacy_strings.chars);
+            s_legacy_strings = {};
+
+            for (u32 n = 0; n < sh.num_lookup_strings; ++n)
             {
-                write_parsable_string(s_lookup_strings[l].name.c_str(), ofs);
-                ofs.write((const c8*)&s_lookup_strings[l].id, sizeof(hash_id));
+                u32 len;
+                r.read(len);
+
+                const u8* str = r.skip(len);
+                if (!str)
+                    return false;
+
+                scene_string entry = {0, (u32)sb_count(s_legacy_strings.chars), len};
+                r.read(entry.id);
+                sb_push(s_legacy_strings.entries, entry);
+
+                c8* dst = sb_add(s_legacy_strings.chars, len + 1);
+                memcpy(dst, str, len);
+                dst[len] = '\0';
             }
 
-            // write camera info
-            ofs.write((const c8*)&num_cams, sizeof(u32));
-            for (u32 i = 0; i < num_cams; ++i)
+            u32 num_strings = sb_count(s_legacy_strings.entries);
+            std::sort(s_legacy_strings.entries, s_legacy_strings.entries + num_strings, scene_string_less);
+
+            s_lookup_strings.entries = s_legacy_strings.entries;
+            s_lookup_strings.chars = s_legacy_strings.chars;
+            s_lookup_strings.num_entries = num_strings;
+
+            // cameras
+            u32 num_cams;
+            ss.cameras = r;
+            r.read(num_cams);
+            r.skip(num_cams * k_scene_camera_size);
+
+            // component arrays are contiguous
+            for (u32 i = 0; i < sh.num_components; ++i)
             {
-                hash_id id_cam = PEN_HASH(cams[i]->name);
-                ofs.write((const c8*)&id_cam, sizeof(hash_id));
-                ofs.write((const c8*)&cams[i]->pos, sizeof(vec3f));
-                ofs.write((const c8*)&cams[i]->focus, sizeof(vec3f));
-                ofs.write((const c8*)&cams[i]->rot, sizeof(vec2f));
-                ofs.write((const c8*)&cams[i]->fov, sizeof(f32));
-                ofs.write((const c8*)&cams[i]->aspect, sizeof(f32));
-                ofs.write((const c8*)&cams[i]->near_plane, sizeof(f32));
-                ofs.write((const c8*)&cams[i]->far_plane, sizeof(f32));
-                ofs.write((const c8*)&cams[i]->zoom, sizeof(f32));
-            }
-
-            // write scene data
-            ofs.write(scene_data, scene_data_size);
-            ofs.close();
+                const u8* data = r.skip(ss.component_sizes[i] * sh.num_nodes);
+                if (!data)
+                    return false;
+
+                sb_push(ss.component_data, data);
+                sb_push(ss.component_bytes, (u64)ss.component_sizes[i] * sh.num_nodes);
+            }
+
+            // and the remainder is specialisations
+            ss.lookups = {r.data + r.pos, r.size - r.pos, 0};
+            return true;
         }
 
         void load_scene(const c8* filename, ecs_scene* scene, bool merge)
         {
-            scene->flags |= e_scene_flags::invalidate_scene_tree;
+            scene->flags |= e_scene_flags::invalidate_scene_tree | e_scene_flags::invalidate_cmp_sets;
             bool      error = false;
             const c8* wd = pen::os_get_user_info().working_directory;
             Str       project_dir = dev_ui::get_program_preference_filename("project_dir", wd);
 
-            std::ifstream ifs(pen::os_path_for_resource(filename).c_str(), std::ofstream::binary);
+            f64 load_start = pen::get_time_ms();
+
+            // finish a delta autosave interrupted part way through
+            replay_autosave_journal(filename);
+
+            void*  mapped = nullptr;
+            size_t file_size = 0;
+            if (pen::filesystem_map_file(filename, &mapped, file_size) != PEN_ERR_OK || file_size < sizeof(scene_header))
+            {
+                dev_ui::log_level(dev_ui::console_level::error, "[error] scene - cannot open file: %s", filename);
+                pen::filesystem_unmap_file(mapped, file_size);
+                return;
+            }
+
+            const u8* file_data = (const u8*)mapped;
 
             // header
             scene_header sh;
-            ifs.read((c8*)&sh, sizeof(scene_header));
+            memcpy(&sh, file_data, sizeof(scene_header));
+
+            // version 9 adds extensions
+            if (sh.version < 9)
+                sh.num_base_components = sh.num_components;
+
+            // version 11 adds chunks
+            scene_sections ss;
+            s_lookup_strings = {};
+
+            bool valid = false;
+            if (sh.version >= 11)
+                valid = read_scene_chunks(file_data, file_size, sh, ss);
+            else
+                valid = read_scene_v10(file_data, file_size, sh, ss);
+
+            if (!valid)
+            {
+                dev_ui::log_level(dev_ui::console_level::error, "[error] scene - corrupt or truncated file: %s", filename);
+
+                for (u32 i = 0; i < sb_count(ss.allocations); ++i)
+                    pen::memory_free(ss.allocations[i]);
+
+                sb_free(ss.allocations);
+                sb_free(ss.component_sizes);
+                sb_free(ss.component_data);
+                sb_free(ss.component_bytes);
+                sb_free(ss.exts);
+                pen::filesystem_unmap_file(mapped, file_size);
+                return;
+            }
 
             if (!merge)
             {
@@ -2366,10 +4180,6 @@ namespace put
                 scene->filename = filename;
             }
 
-            // version 9 adds extensions
-            if (sh.version < 9)
-                sh.num_base_components = sh.num_components;
-
             // unpack header
             s32 num_nodes = sh.num_nodes;
 
@@ -2394,46 +4204,7 @@ namespace put
 
             scene->num_entities = new_num_nodes;
 
-            // read component sizes
-            u32* component_sizes = nullptr;
-            for (u32 i = 0; i < sh.num_components; ++i)
-            {
-                u32 size;
-                ifs.read((c8*)&size, sizeof(u32));
-                sb_push(component_sizes, size);
-            }
-
-            // extensions
-            struct ext_components
-            {
-                hash_id id;
-                u32     start_cmp;
-                u32     num_cmp;
-            };
-            ext_components* exts = nullptr;
-
-            for (u32 i = 0; i < sh.num_extensions; ++i)
-            {
-                ext_components ext;
-                ifs.read((c8*)&ext.id, sizeof(hash_id));
-                ifs.read((c8*)&ext.start_cmp, sizeof(u32));
-                ifs.read((c8*)&ext.num_cmp, sizeof(u32));
-
-                sb_push(exts, ext);
-            }
-
-            // read string lookups
-            sb_free(s_lookup_strings);
-            s_lookup_strings = nullptr;
-
-            for (u32 n = 0; n < sh.num_lookup_strings; ++n)
-            {
-                lookup_string ls;
-                ls.name = read_parsable_string(ifs);
-                ifs.read((c8*)&ls.id, sizeof(hash_id));
-
-                sb_push(s_lookup_strings, ls);
-            }
+            ext_components* exts = ss.exts;
 
             // rehash extension ids
             for (u32 i = 0; i < sh.num_extensions; ++i)
@@ -2443,22 +4214,22 @@ namespace put
 
             // read cameras
             u32 num_cams;
-            ifs.read((c8*)&num_cams, sizeof(u32));
+            ss.cameras.read(num_cams);
 
             for (u32 i = 0; i < num_cams; ++i)
             {
                 camera  cam;
                 hash_id id_cam;
 
-                ifs.read((c8*)&id_cam, sizeof(hash_id));
-                ifs.read((c8*)&cam.pos, sizeof(vec3f));
-                ifs.read((c8*)&cam.focus, sizeof(vec3f));
-                ifs.read((c8*)&cam.rot, sizeof(vec2f));
-                ifs.read((c8*)&cam.fov, sizeof(f32));
-                ifs.read((c8*)&cam.aspect, sizeof(f32));
-                ifs.read((c8*)&cam.near_plane, sizeof(f32));
-                ifs.read((c8*)&cam.far_plane, sizeof(f32));
-                ifs.read((c8*)&cam.zoom, sizeof(f32));
+                ss.cameras.read(id_cam);
+                ss.cameras.read(cam.pos);
+                ss.cameras.read(cam.focus);
+                ss.cameras.read(cam.rot);
+                ss.cameras.read(cam.fov);
+                ss.cameras.read(cam.aspect);
+                ss.cameras.read(cam.near_plane);
+                ss.cameras.read(cam.far_plane);
+                ss.cameras.read(cam.zoom);
 
                 // find camera and set
                 camera* _cam = pmfx::get_camera(id_cam);
@@ -2475,7 +4246,7 @@ namespace put
                 }
             }
 
-            // read all components
+            // copy all components
             for (u32 i = 0; i < sh.num_components; ++i)
             {
                 u32 ri = i; // remap i.. if we have extensions
@@ -2497,32 +4268,42 @@ namespace put
                     }
                 }
 
-                bool read = false;
+                if (ri == -1 || !ss.component_data[i])
+                    continue;
 
-                if (ri != -1)
+                if (ss.component_bytes[i] < (u64)ss.component_sizes[i] * num_nodes)
                 {
-                    generic_cmp_array& cmp = scene->get_component_array(ri);
+                    dev_ui::log_level(dev_ui::console_level::error, "[error] scene - component %u truncated: %s", i,
+                                      filename);
+                    continue;
+                }
+
+                generic_cmp_array& cmp = scene->get_component_array(ri);
 
-                    if (cmp.size == component_sizes[i])
+                if (cmp.size == ss.component_sizes[i])
+                {
+                    // copy whole array
+                    c8* data_offset = (c8*)cmp.data + zero_offset * cmp.size;
+                    memcpy(data_offset, ss.component_data[i], cmp.size * num_nodes);
+                }
+                else if (&cmp == (generic_cmp_array*)&scene->material_resources &&
+                         ss.component_sizes[i] == sizeof(material_resource_str))
+                {
+                    // names are re-read from the lookups below, keep the rest
+                    const material_resource_str* src = (const material_resource_str*)ss.component_data[i];
+                    for (s32 n = 0; n < num_nodes; ++n)
                     {
-                        // read whole array
-                        c8* data_offset = (c8*)cmp.data + zero_offset * cmp.size;
-                        ifs.read(data_offset, cmp.size * num_nodes);
-                        read = true;
+                        material_resource& dst = scene->material_resources[zero_offset + n];
+                        dst.hash = src[n].hash;
+                        memcpy(dst.data, src[n].data, sizeof(dst.data));
+                        dst.id_shader = src[n].id_shader;
+                        dst.id_technique = src[n].id_technique;
+                        memcpy(dst.id_sampler_state, src[n].id_sampler_state, sizeof(dst.id_sampler_state));
+                        memcpy(dst.texture_handles, src[n].texture_handles, sizeof(dst.texture_handles));
                     }
                 }
 
-                if (!read)
-                {
-                    // read the old size
-                    u32 array_size = component_sizes[i] * num_nodes;
-                    c8* old = (c8*)pen::memory_alloc(array_size);
-                    ifs.read(old, array_size);
-
-                    // here any fuxup can be applied old into cmp.data
-
-                    pen::memory_free(old);
-                }
+                // here any fuxup can be applied from ss.component_data[i] with the old size into cmp.data
             }
 
             // fixup parents for scene import / merge
@@ -2530,15 +4311,15 @@ namespace put
                 scene->parents[n] += zero_offset;
 
             // read specialisations
+            scene_reader& lookups = ss.lookups;
             for (s32 n = zero_offset; n < zero_offset + num_nodes; ++n)
             {
-                memset(&scene->names[n], 0x0, sizeof(Str));
-                memset(&scene->geometry_names[n], 0x0, sizeof(Str));
-                memset(&scene->material_names[n], 0x0, sizeof(Str));
+                scene->names[n] = read_lookup_string(lookups);
+                scene->geometry_names[n] = read_lookup_string(lookups);
+                scene->material_names[n] = read_lookup_string(lookups);
 
-                scene->names[n] = read_lookup_string(ifs);
-                scene->geometry_names[n] = read_lookup_string(ifs);
-                scene->material_names[n] = read_lookup_string(ifs);
+                // so id_name can be mapped back with pen::hash_name
+                pen::hash_intern(scene->names[n].c_str());
             }
 
             // geometry
@@ -2547,14 +4328,14 @@ namespace put
                 if (scene->entities[n] & e_cmp::geometry)
                 {
                     u32 submesh;
-                    ifs.read((c8*)&submesh, sizeof(u32));
+                    lookups.read(submesh);
 
                     Str filename = project_dir;
-                    Str name = read_lookup_string(ifs).c_str();
-                    Str geometry_name = read_lookup_string(ifs);
+                    Str name = read_lookup_string(lookups);
+                    Str geometry_name = read_lookup_string(lookups);
 
                     hash_id        name_hash = PEN_HASH(name.c_str());
-                    static hash_id primitive_id = PEN_HASH("primitive");
+                    static hash_id primitive_id = PEN_HASHC("primitive");
 
                     filename.append(name.c_str());
 
@@ -2614,12 +4395,12 @@ namespace put
             for (s32 n = zero_offset; n < zero_offset + num_nodes; ++n)
             {
                 s32 size;
-                ifs.read((c8*)&size, sizeof(s32));
+                lookups.read(size);
 
                 for (s32 i = 0; i < size; ++i)
                 {
                     Str anim_name = project_dir;
-                    anim_name.append(read_lookup_string(ifs).c_str());
+                    anim_name.append(read_lookup_string(lookups));
 
                     anim_handle h = load_pma(anim_name.c_str());
 
@@ -2644,13 +4425,11 @@ namespace put
                 material_resource& mat_res = scene->material_resources[n];
 
                 // Invalidate stuff we need to recreate
-                memset(&mat_res.material_name, 0x0, sizeof(Str));
-                memset(&mat_res.shader_name, 0x0, sizeof(Str));
                 mat.material_cbuffer = PEN_INVALID_HANDLE;
 
-                Str material_name = read_lookup_string(ifs);
-                Str shader = read_lookup_string(ifs);
-                Str technique = read_lookup_string(ifs);
+                Str material_name = read_lookup_string(lookups);
+                Str shader = read_lookup_string(lookups);
+                Str technique = read_lookup_string(lookups);
 
                 mat_res.material_name = material_name;
                 mat_res.id_shader = PEN_HASH(shader.c_str());
@@ -2664,7 +4443,7 @@ namespace put
                 if (!(scene->entities[n] & e_cmp::sdf_shadow))
                     continue;
 
-                Str sdf_shadow_volume_file = read_lookup_string(ifs);
+                Str sdf_shadow_volume_file = read_lookup_string(lookups);
                 sdf_shadow_volume_file = pen::str_replace_string(sdf_shadow_volume_file, ".dds", ".pmv");
 
                 dev_console_log("[scene load] %s", sdf_shadow_volume_file.c_str());
@@ -2681,18 +4460,18 @@ namespace put
 
                 for (u32 i = 0; i < e_pmfx_constants::max_technique_sampler_bindings; ++i)
                 {
-                    Str texture_name = read_lookup_string(ifs);
+                    const c8* texture_name = read_lookup_string(lookups);
 
-                    if (!texture_name.empty())
+                    if (texture_name[0] != '\0')
                     {
-                        samplers.sb[i].handle = put::load_texture(texture_name.c_str());
+                        samplers.sb[i].handle = put::load_texture(texture_name);
                         samplers.sb[i].sampler_state =
-                            pmfx::get_render_state(PEN_HASH("wrap_linear"), pmfx::e_render_state::sampler);
+                            pmfx::get_render_state(PEN_HASHC("wrap_linear"), pmfx::e_render_state::sampler);
                     }
 
-                    Str sampler_state_name = read_lookup_string(ifs);
+                    const c8* sampler_state_name = read_lookup_string(lookups);
 
-                    if (!sampler_state_name.empty())
+                    if (sampler_state_name[0] != '\0')
                     {
                         samplers.sb[i].sampler_state =
                             pmfx::get_render_state(PEN_HASH(sampler_state_name), pmfx::e_render_state::sampler);
@@ -2700,9 +4479,27 @@ namespace put
                 }
             }
 
+            // area light names, long names are interned pointers so the saved component bytes are not used
+            for (s32 n = zero_offset; n < zero_offset + num_nodes; ++n)
+            {
+                area_light_resource& alr = scene->area_light_resources[n];
+                alr = area_light_resource();
+
+                if (sh.version < 12)
+                    continue;
+
+                if (!(scene->entities[n] & e_cmp::light) || scene->lights[n].type != e_light_type::area_ex)
+                    continue;
+
+                alr.shader_name = read_lookup_string(lookups);
+                alr.technique_name = read_lookup_string(lookups);
+                alr.texture_name = read_lookup_string(lookups);
+                alr.sampler_state_name = read_lookup_string(lookups);
+            }
+
             // read cams strings
             for (u32 i = 0; i < num_cams; ++i)
-                read_lookup_string(ifs);
+                read_lookup_string(lookups);
 
             // read extensions
             for (u32 i = 0; i < sh.num_extensions; ++i)
@@ -2733,13 +4530,23 @@ namespace put
                     scene->view_flags |= (e_scene_view_flags::matrix | e_scene_view_flags::bones);
             }
 
-            ifs.close();
-
             initialise_free_list(scene);
 
-            // cleanup
-            sb_free(component_sizes);
-            sb_free(exts);
+            // cleanup, string lookups point into the mapped file or legacy strings
+            s_lookup_strings = {};
+
+            for (u32 i = 0; i < sb_count(ss.allocations); ++i)
+                pen::memory_free(ss.allocations[i]);
+
+            sb_free(ss.allocations);
+            sb_free(ss.component_sizes);
+            sb_free(ss.component_data);
+            sb_free(ss.component_bytes);
+            sb_free(ss.exts);
+
+            pen::filesystem_unmap_file(mapped, file_size);
+
+            dev_console_log("[scene load] %s: %i entities in %f(ms)", filename, num_nodes, pen::get_time_ms() - load_start);
         }
     } // namespace ecs
 } // namespace put
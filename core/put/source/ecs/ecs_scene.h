@@ -10,6 +10,7 @@
 #include "pmfx.h"
 
 #include "data_struct.h"
+#include "name_str.h"
 #include "pen.h"
 
 #include "maths/maths.h"
@@ -61,7 +62,9 @@ namespace put
             {
                 none = 0,
                 invalidate_scene_tree = 1 << 1,
-                pause_update = 1 << 2
+                pause_update = 1 << 2,
+                clustered_lights = 1 << 3, // set with enable_clustered_lights
+                invalidate_cmp_sets = 1 << 4 // loads and bulk moves, component sets are rebuilt on the next update
             };
         }
         typedef u32 scene_flags;
@@ -78,6 +81,7 @@ namespace put
                 samplers_initialised = (1 << 5),
                 apply_anim_transform = (1 << 6),
                 sync_physics_transform = (1 << 7),
+                transform_changed = (1 << 8), // world matrix changed in the last update_scene
                 alpha_blended = (1 << 0)
             };
         }
@@ -137,7 +141,10 @@ namespace put
                 max_area_lights = 10,
                 max_shadow_maps = 100,
                 max_sdf_shadows = 1,
-                max_omni_shadow_maps = 100
+                max_omni_shadow_maps = 100,
+                cluster_grid_x = 16,
+                cluster_grid_y = 8,
+                cluster_grid_z = 24
             };
         }
 
@@ -170,13 +177,34 @@ namespace put
             };
         }
 
+        // iteration indices for rare components, component storage stays dense soa and these only list the entities
+        // which use each component so systems can skip the rest. membership is kept by add_components,
+        // remove_components and the entity copy / delete paths
+        namespace e_cmp_set
+        {
+            enum cmp_set_t
+            {
+                light,
+                area_light, // lights of type area or area_ex
+                physics,
+                anim_controller,
+                samplers,
+                skinned,
+                pre_skinned,
+                master_instance,
+                sdf_shadow,
+                count
+            };
+        }
+
         namespace e_light_flags
         {
             enum light_flags_t : u8
             {
                 shadow_map = 1 << 0,
                 omni_shadow_map = 1 << 1,
-                global_illumination = 1 << 2
+                global_illumination = 1 << 2,
+                shadow_cache = 1 << 3 // keep shadow maps from previous frames until something inside the light changes
             };
         };
         typedef u8 light_flags;
@@ -202,14 +230,14 @@ namespace put
         // material resources could be re-used created and shared
         struct material_resource
         {
-            hash_id hash;
-            Str     material_name;
-            Str     shader_name;
-            f32     data[64];
-            hash_id id_shader = 0;
-            hash_id id_technique = 0;
-            hash_id id_sampler_state[e_texture::COUNT] = {0};
-            s32     texture_handles[e_texture::COUNT] = {0};
+            hash_id       hash;
+            pen::name_str material_name;
+            pen::name_str shader_name;
+            f32           data[64];
+            hash_id       id_shader = 0;
+            hash_id       id_technique = 0;
+            hash_id       id_sampler_state[e_texture::COUNT] = {0};
+            s32           texture_handles[e_texture::COUNT] = {0};
         };
 
         // contains baked handles for o(1) time setting of technique / shader
@@ -338,10 +366,10 @@ namespace put
         // data to save / load and reconstruct area light textures
         struct area_light_resource
         {
-            Str shader_name;
-            Str technique_name;
-            Str texture_name;
-            Str sampler_state_name;
+            pen::name_str shader_name;
+            pen::name_str technique_name;
+            pen::name_str texture_name;
+            pen::name_str sampler_state_name;
         };
 
         typedef maths::transform cmp_transform;
@@ -357,7 +385,7 @@ namespace put
             vec4f pos_radius; // radius = point radius and spot length
             vec4f dir_cutoff; // spot dir and cos cutoff
             vec4f colour;     // w = boolean cast shadow
-            vec4f data;       // x = spot falloff, yzw reserved
+            vec4f data;       // x = spot falloff, y = 1 for spot lights, zw reserved
         };
 
         struct forward_light_buffer
@@ -366,6 +394,41 @@ namespace put
             light_data lights[e_scene_limits::max_forward_lights];
         };
 
+        // matches cluster_info in globals.pmfx
+        struct cluster_info_buffer
+        {
+            vec4f grid;  // x, y, z = cluster grid dimensions, w = num lights
+            vec4f depth; // x = near, y = far, z = log depth scale, w = log depth bias
+        };
+
+        // light clusters for one camera, reused by every view rendered from it until the lights are next gathered
+        struct light_cluster_view
+        {
+            const camera*       cam = nullptr;
+            mat4                view_proj;
+            u32*                data = nullptr; // offset and count per cluster followed by light indices
+            u32                 data_size = 0;
+            cluster_info_buffer info;
+        };
+
+        // unshadowed point and spot lights assigned to a froxel grid per camera, clusters are built once per camera per
+        // frame and uploaded as structured buffers for the clustered_lights shader permutation
+        struct light_clusters
+        {
+            light_data*         lights = nullptr; // gathered in update_scene
+            vec4f*              bounds = nullptr; // world space bounding sphere per light
+            u32*                counts = nullptr; // per cluster scratch
+            light_cluster_view* views = nullptr;  // allocations are kept when views are reset
+            u32                 num_views = 0;    // reset when lights are gathered
+            u32                 bound_view = PEN_INVALID_HANDLE; // view whose data and info are in the gpu buffers
+            bool                lights_uploaded = false;
+            u32                 light_buffer = PEN_INVALID_HANDLE;
+            u32                 data_buffer = PEN_INVALID_HANDLE;
+            u32                 info_buffer = PEN_INVALID_HANDLE;
+            u32                 light_buffer_size = 0;
+            u32                 data_buffer_size = 0;
+        };
+
         struct distance_field_shadow
         {
             mat4 world_matrix;
@@ -457,9 +520,44 @@ namespace put
             ecs_controller_functions funcs;
         };
         
+        // entities visible to a shadow map view, cleared but not freed between frames
+        struct shadow_view
+        {
+            u32     light_index;
+            u32*    entities;
+            hash_id cache_hash; // light, frustum and visible casters from the last frame
+            bool    cached;     // contents from the last frame are still valid and rendering is skipped
+        };
+
+        // shadow caching for the current frame
+        struct shadow_cache_stats
+        {
+            u32 num_views = 0;
+            u32 num_cached_views = 0;  // views kept from the last frame, rendering them is skipped
+            u32 num_moved_casters = 0; // visible casters whose transform changed, counted once per view they are in
+        };
+
+        // built once per frame in update_scene by culling all shadow views in a single pass over the scene
+        struct shadow_cull
+        {
+            shadow_view*       views = nullptr; // shadow maps followed by 6 cubemap faces for each omni shadow map
+            frustum*           frusta = nullptr;
+            u32*               filtered_entities = nullptr;
+            u32                num_shadow_maps = 0;
+            u32                num_omni_shadow_maps = 0;
+            shadow_cache_stats stats;
+            hash_id            targets_hash = 0; // cached views are invalidated if the shadow targets are recreated
+        };
+
+        // sorted list of the entity indices using a component, costs 4 bytes per member
+        struct cmp_set
+        {
+            u32* dense = nullptr; // stretchy buffer in entity order
+        };
+
         struct ecs_scene
         {
-            static const u32 k_version = 10;
+            static const u32 k_version = 12; // version 12 area light names in lookups
 
             ecs_scene()
             {
@@ -473,9 +571,9 @@ namespace put
             cmp_array<hash_id>                  id_name;
             cmp_array<hash_id>                  id_geometry;
             cmp_array<hash_id>                  id_material;
-            cmp_array<Str>                      names;
-            cmp_array<Str>                      geometry_names;
-            cmp_array<Str>                      material_names;
+            cmp_array<pen::name_str>            names;
+            cmp_array<pen::name_str>            geometry_names;
+            cmp_array<pen::name_str>            material_names;
             cmp_array<u32>                      parents;
             cmp_array<cmp_transform>            transforms;
             cmp_array<mat4>                     local_matrices;
@@ -535,7 +633,11 @@ namespace put
             scene_view_flags view_flags = 0;
             extents          renderable_extents;
             extents          shadow_extent_constraints = {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+            shadow_cull      shadow_visibility;
+            light_clusters   clusters;
+            cmp_set          cmp_sets[e_cmp_set::count];
             u32*             selection_list = nullptr;
+            u32              structure_version = 0; // bumped when entities are created, deleted, moved or reparented
             u32              version = k_version;
             Str              filename = "";
 
@@ -557,12 +659,22 @@ namespace put
 
         void update(f32 dt);
         void update_scene(ecs_scene* scene, f32 dt);
+        void update_shadow_visibility(ecs_scene* scene);
+        void update_component_sets(ecs_scene* scene);             // full rebuild only if invalidate_cmp_sets is set
+        void update_component_sets(ecs_scene* scene, u32 entity); // re-evaluate one entity after editing its flags
+        void add_components(ecs_scene* scene, u32 entity, u64 cmp);
+        void remove_components(ecs_scene* scene, u32 entity, u64 cmp);
+        void enable_clustered_lights(ecs_scene* scene, bool enable);
         void reset(ecs_scene* scene);
         
         void render_scene_view(const scene_view& view);
+        void render_scene_entities(const scene_view& view, u32* culled_entities); // draws a pre culled entity list
         void render_light_volumes(const scene_view& view);
         void render_shadow_views(const scene_view& view);
         void render_omni_shadow_views(const scene_view& view);
+        bool shadow_view_cached(const scene_view& view);
+        bool omni_shadow_view_cached(const scene_view& view);
+        shadow_cache_stats get_shadow_cache_stats(const ecs_scene* scene);
         void render_area_light_textures(const scene_view& view);
         void compute_volume_gi(const scene_view& view);
 
@@ -638,6 +750,13 @@ namespace put
             return offset;
         }
 
+        // entities in the set in ascending order, flags written directly need update_component_sets(scene, entity)
+        pen_inline u32* get_cmp_set(const ecs_scene* scene, u32 set, u32& count)
+        {
+            count = sb_count(scene->cmp_sets[set].dense);
+            return scene->cmp_sets[set].dense;
+        }
+
         inline generic_cmp_array& ecs_scene::get_component_array(u32 index)
         {
             if (index >= num_base_components)
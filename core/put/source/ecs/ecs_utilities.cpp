@@ -131,7 +131,8 @@ namespace put
 
             //fully update free list
             initialise_free_list(scene);
-            scene->flags |= e_scene_flags::invalidate_scene_tree;
+            scene->flags |= e_scene_flags::invalidate_scene_tree | e_scene_flags::invalidate_cmp_sets;
+            scene->structure_version++;
         }
 
         void get_new_entities_append(ecs_scene* scene, s32 num, s32& start, s32& end)
@@ -221,6 +222,7 @@ namespace put
                 }
 
                 scene->num_entities = std::max<u32>(end, scene->num_entities);
+                scene->structure_version++;
             }
         }
 
@@ -246,6 +248,7 @@ namespace put
             u32 i = ii;
 
             scene->flags |= e_scene_flags::invalidate_scene_tree;
+            scene->structure_version++;
 
             scene->num_entities = std::max<u32>(i + 1, scene->num_entities);
 
@@ -391,6 +394,7 @@ namespace put
                 return;
 
             scene->parents[child] = parent;
+            scene->structure_version++;
 
             mat4 parent_mat = scene->world_matrices[parent];
 
@@ -496,7 +500,7 @@ namespace put
             if (scene->entities[master] & e_cmp::master_instance)
                 return;
 
-            scene->entities[master] |= e_cmp::master_instance;
+            add_components(scene, master, e_cmp::master_instance);
 
             scene->master_instances[master].num_instances = num_nodes;
             scene->master_instances[master].instance_stride = sizeof(cmp_draw_call);
@@ -680,7 +684,7 @@ namespace put
             scene->bounding_volumes[nn].max_extents = scene->bounding_volumes[nn].transformed_max_extents;
 
             // todo.. use material.
-            material_resource* mr = get_material_resource(PEN_HASH("default_material"));
+            material_resource* mr = get_material_resource(PEN_HASHC("default_material"));
             instantiate_material(mr, scene, nn);
 
             instantiate_model_cbuffer(scene, nn);
@@ -741,7 +745,7 @@ namespace put
                         continue;
 
                     Str ss = pen::str_substr(anim->channels[c].target_name, target_len - bone_len, target_len);
-                    if (ss == scene->names[jnode])
+                    if (ss == scene->names[jnode].c_str())
                     {
                         // bind sampler to joint
                         sampler.joint = j;
@@ -763,7 +767,7 @@ namespace put
             sb_push(controller.anim_instance_ids, anim->id_name);
 
             // todo validate
-            scene->entities[node_index] |= e_cmp::anim_controller;
+            add_components(scene, node_index, e_cmp::anim_controller);
             return anim_index;
         }
     } // namespace ecs
@@ -4,6 +4,7 @@
 
 #include "loader.h"
 #include "dev_ui.h"
+#include "texture_mips.h"
 
 #include "console.h"
 #include "data_struct.h"
@@ -19,6 +20,7 @@
 #include "str_utilities.h"
 #include "timer.h"
 
+#include <algorithm>
 #include <fstream>
 #include <vector>
 
@@ -150,14 +152,36 @@ namespace
         bool                 invalidated = false;
         std::vector<hash_id> changes;
         u32                  rebuild_ts = 0;
+        bool                 pending = false; // changes are waiting for the debounce before building
+        f64                  change_ms = 0.0;
 
         void (*build_callback)();
         void (*hotload_callback)(std::vector<hash_id>& dirty);
     };
 
+    // maps a dependency input path to the file watch which builds it
+    struct watched_input
+    {
+        hash_id     id_path;
+        hash_id     id_data_file;
+        file_watch* fw;
+    };
+
+    bool operator<(const watched_input& a, const watched_input& b)
+    {
+        return a.id_path < b.id_path;
+    }
+
     // static vars
     std::vector<file_watch*>       k_file_watches;
     std::vector<texture_reference> k_texture_references;
+    std::vector<watched_input>     k_watched_inputs;
+    std::vector<hash_id>           k_watched_directories;
+
+    const f64 k_watch_debounce_ms = 100.0;
+    u32       s_dir_watcher = PEN_INVALID_HANDLE;
+    bool      s_watched_inputs_invalid = true;
+    bool      s_watch_events_dropped = false;
 
     u32 calc_level_size(u32 width, u32 height, bool compressed, u32 block_size)
     {
@@ -429,18 +453,46 @@ namespace
     };
 
     pen::ring_buffer<hot_loader_cmd> s_hot_loader_cmd_buffer;
+    pen::ring_buffer<c8*>            s_watch_event_buffer; // paths read by the hot loader thread, nullptr for dropped
+    pen::semaphore*                  s_hot_loader_cmd_queued = nullptr;
+
+    void queue_watch_event(const c8* path, void* user_data)
+    {
+        c8* copy = nullptr;
+        if (path)
+        {
+            u32 len = strlen(path);
+            copy = (c8*)pen::memory_alloc(len + 1);
+            memcpy(copy, path, len + 1);
+        }
+
+        s_watch_event_buffer.put(copy);
+    }
 
     void* hot_loader_thread(void* params)
     {
         pen::job_thread_params* job_params = (pen::job_thread_params*)params;
 
         pen::job* p_thread_info = job_params->job_info;
+        p_thread_info->p_sem_wake = s_hot_loader_cmd_queued;
         pen::semaphore_post(p_thread_info->p_sem_continue, 1);
 
-        s_hot_loader_cmd_buffer.create(32);
+        s_hot_loader_cmd_buffer.create(32, pen::e_ring_buffer_full::grow);
 
         for (;;)
         {
+            if (s_dir_watcher != PEN_INVALID_HANDLE)
+            {
+                // block on the inotify fd, commands and exit are picked up within the debounce
+                if (pen::filesystem_watch_wait(s_dir_watcher, (u32)k_watch_debounce_ms) == PEN_ERR_OK)
+                    pen::filesystem_watch_poll(s_dir_watcher, queue_watch_event, nullptr);
+            }
+            else
+            {
+                // posted when a command is queued and by jobs_terminate_all
+                pen::semaphore_wait(s_hot_loader_cmd_queued);
+            }
+
             hot_loader_cmd* cmd = s_hot_loader_cmd_buffer.get();
             while (cmd)
             {
@@ -463,9 +515,6 @@ namespace
 
             if (pen::semaphore_try_wait(p_thread_info->p_sem_exit))
                 break;
-
-            // plenty of sleep
-            pen::thread_sleep_ms(16);
         }
 
         pen::semaphore_post(p_thread_info->p_sem_continue, 1);
@@ -494,6 +543,118 @@ namespace
             }
         }
     }
+
+    void file_watch_changed(file_watch* fw, const Str& input, hash_id id_data_file, u32 input_ts)
+    {
+        dev_console_log("[file watcher] input file %s has changed", input.c_str());
+
+        if (std::find(fw->changes.begin(), fw->changes.end(), id_data_file) == fw->changes.end())
+            fw->changes.push_back(id_data_file);
+
+        fw->rebuild_ts = std::max(fw->rebuild_ts, input_ts);
+    }
+
+    void poll_file_watch_mtimes(file_watch* fw)
+    {
+        pen::json files = fw->dependencies["files"];
+        s32       num_files = files.size();
+        for (s32 i = 0; i < num_files; ++i)
+        {
+            pen::json outputs = files[i];
+            s32       num_inputs = outputs.size();
+            u32       current_ts = 0;
+
+            Str fn = pen::os_path_for_resource(fw->filename.c_str());
+            if (pen::filesystem_getmtime(fn.c_str(), current_ts) == PEN_ERR_OK)
+            {
+                for (s32 j = 0; j < num_inputs; ++j)
+                {
+                    Str ifn = outputs[j]["name"].as_str();
+                    u32 input_ts = 0;
+                    if (pen::filesystem_getmtime(ifn.c_str(), input_ts) == PEN_ERR_OK)
+                    {
+                        if (!fw->invalidated && input_ts > current_ts)
+                        {
+                            Str data_file = outputs[j]["data_file"].as_str();
+                            file_watch_changed(fw, ifn, PEN_HASH(data_file.c_str()), input_ts);
+
+                            fw->build_callback();
+                            fw->invalidated = true;
+                            fw->pending = false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void build_watched_inputs()
+    {
+        k_watched_inputs.clear();
+
+        for (auto* fw : k_file_watches)
+        {
+            pen::json files = fw->dependencies["files"];
+            s32       num_files = files.size();
+            for (s32 i = 0; i < num_files; ++i)
+            {
+                pen::json outputs = files[i];
+                s32       num_inputs = outputs.size();
+                for (s32 j = 0; j < num_inputs; ++j)
+                {
+                    Str ifn = outputs[j]["name"].as_str();
+                    Str data_file = outputs[j]["data_file"].as_str();
+
+                    // watch the directory containing the input, events are reported as dir/name
+                    s32     loc = pen::str_find_reverse(ifn, "/");
+                    Str     dir = loc > 0 ? pen::str_substr(ifn, 0, loc) : "";
+                    hash_id id_dir = PEN_HASH(dir.c_str());
+
+                    if (std::find(k_watched_directories.begin(), k_watched_directories.end(), id_dir) ==
+                        k_watched_directories.end())
+                    {
+                        if (pen::filesystem_watch_add_directory(s_dir_watcher, dir.c_str()) != PEN_ERR_OK)
+                            dev_console_log_level(dev_ui::console_level::warning,
+                                                  "[file watcher] unable to watch directory %s", dir.c_str());
+
+                        k_watched_directories.push_back(id_dir);
+                    }
+
+                    k_watched_inputs.push_back({PEN_HASH(ifn.c_str()), PEN_HASH(data_file.c_str()), fw});
+                }
+            }
+        }
+
+        std::sort(k_watched_inputs.begin(), k_watched_inputs.end());
+        s_watched_inputs_invalid = false;
+    }
+
+    void dir_watch_event(const c8* path, void* user_data)
+    {
+        if (!path)
+        {
+            s_watch_events_dropped = true;
+            return;
+        }
+
+        watched_input key;
+        key.id_path = PEN_HASH(path);
+
+        auto it = std::lower_bound(k_watched_inputs.begin(), k_watched_inputs.end(), key);
+        for (; it != k_watched_inputs.end() && it->id_path == key.id_path; ++it)
+        {
+            file_watch* fw = it->fw;
+            if (fw->invalidated)
+                continue;
+
+            u32 input_ts = 0;
+            pen::filesystem_getmtime(path, input_ts);
+            file_watch_changed(fw, path, it->id_data_file, input_ts);
+
+            fw->pending = true;
+            fw->change_ms = pen::get_time_ms();
+        }
+    }
 } // namespace
 
 namespace put
@@ -502,6 +663,12 @@ namespace put
     {
         PEN_HOTLOADING_ENABLED;
 
+        // event driven where supported, otherwise poll_hot_loader falls back to checking mtimes each frame
+        if (pen::filesystem_watch_create(s_dir_watcher) != PEN_ERR_OK)
+            s_dir_watcher = PEN_INVALID_HANDLE;
+
+        s_watch_event_buffer.create(64, pen::e_ring_buffer_full::grow);
+        s_hot_loader_cmd_queued = pen::semaphore_create(0, 1);
         pen::jobs_create_job(hot_loader_thread, 1024 * 1024, nullptr, pen::e_thread_start_flags::detached);
 
         pen::json pmbuild_config = pen::json::load_from_file("data/pmbuild_config.json");
@@ -527,6 +694,7 @@ namespace put
             memcpy(cmd.cmdline, cmdline.c_str(), len);
             cmd.cmdline[len] = '\0';
             s_hot_loader_cmd_buffer.put(cmd);
+            pen::semaphore_post(s_hot_loader_cmd_queued, 1);
 
             // wait 10 seconds
             s_timeout = 1000.0f * 10.0f;
@@ -539,8 +707,16 @@ namespace put
         return s_pmbuild_cmd;
     }
 
-    void save_texture(const c8* filename, const texture_info& info)
+    void save_texture(const c8* filename, const texture_info& src_info, bool generate_mips)
     {
+        // optionally build a full mip chain for textures saved with only the top level
+        texture_info info = src_info;
+        if (generate_mips && info.num_mips <= 1 && !put::generate_mips(info))
+        {
+            dev_console_log_level(dev_ui::console_level::warning, "[warning] save_texture: can't generate mips for %s",
+                                  filename);
+        }
+
         // dds header
         dds_header hdr = {0};
         hdr.magic = 0x20534444;
@@ -586,6 +762,9 @@ namespace put
         ofs.write((const c8*)info.data, info.data_size);
 
         ofs.close();
+
+        if (info.data != src_info.data)
+            pen::memory_free(info.data);
     }
 
     u32 load_texture(const c8* filename)
@@ -672,6 +851,7 @@ namespace put
         fw->build_callback = build_callback;
 
         k_file_watches.push_back(fw);
+        s_watched_inputs_invalid = true;
     }
 
     void poll_hot_loader()
@@ -681,6 +861,24 @@ namespace put
         // print build cmd to console first time init
         get_build_cmd();
 
+        bool watching = s_dir_watcher != PEN_INVALID_HANDLE;
+        if (watching)
+        {
+            if (s_watched_inputs_invalid)
+                build_watched_inputs();
+
+            // events are read on the hot loader thread as they arrive
+            c8** path = s_watch_event_buffer.get();
+            while (path)
+            {
+                dir_watch_event(*path, nullptr);
+                pen::memory_free(*path);
+                path = s_watch_event_buffer.get();
+            }
+        }
+
+        f64 now_ms = pen::get_time_ms();
+
         for (auto* fw : k_file_watches)
         {
             if (fw->invalidated)
@@ -692,53 +890,30 @@ namespace put
                     if (dep_ts >= fw->rebuild_ts)
                     {
                         fw->dependencies = pen::json::load_from_file(fw->filename.c_str());
+                        s_watched_inputs_invalid = true;
 
                         // rebuild has succeeded
                         dev_console_log("[file watcher] rebuild for %s complete", fw->filename.c_str());
                         fw->hotload_callback(fw->changes);
                         fw->changes.clear();
+                        fw->rebuild_ts = 0;
                         fw->invalidated = false;
                     }
                 }
             }
-            else
+            else if (!watching || s_watch_events_dropped)
             {
-                pen::json files = fw->dependencies["files"];
-                s32       num_files = files.size();
-                for (s32 i = 0; i < num_files; ++i)
-                {
-                    pen::json outputs = files[i];
-                    s32       num_inputs = outputs.size();
-                    u32       current_ts = 0;
-
-                    Str fn = pen::os_path_for_resource(fw->filename.c_str());
-                    if (pen::filesystem_getmtime(fn.c_str(), current_ts) == PEN_ERR_OK)
-                    {
-                        for (s32 j = 0; j < num_inputs; ++j)
-                        {
-                            Str ifn = outputs[j]["name"].as_str();
-                            u32 input_ts = 0;
-                            if (pen::filesystem_getmtime(ifn.c_str(), input_ts) == PEN_ERR_OK)
-                            {
-                                if (!fw->invalidated)
-                                {
-                                    if (input_ts > current_ts)
-                                    {
-                                        dev_console_log("[file watcher] input file %s has changed", ifn.c_str());
-
-                                        Str data_file = outputs[j]["data_file"].as_str();
-                                        fw->changes.push_back(PEN_HASH(data_file.c_str()));
-                                        fw->rebuild_ts = input_ts;
-
-                                        fw->build_callback();
-                                        fw->invalidated = true;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+                poll_file_watch_mtimes(fw);
+            }
+            else if (fw->pending && now_ms - fw->change_ms >= k_watch_debounce_ms)
+            {
+                // coalesce bursts of writes (editor saves, source control) into a single build
+                fw->pending = false;
+                fw->build_callback();
+                fw->invalidated = true;
             }
         }
+
+        s_watch_events_dropped = false;
     }
 } // namespace put
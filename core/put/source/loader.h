@@ -15,7 +15,7 @@ namespace put
 
     // Textures
     u32  load_texture(const c8* filename);
-    void save_texture(const c8* filename, const texture_info& tcp);
+    void save_texture(const c8* filename, const texture_info& tcp, bool generate_mips = false);
     void get_texture_info(u32 handle, texture_info& info);
     Str  get_texture_filename(u32 handle);
     void texture_browser_ui();
@@ -220,6 +220,8 @@ namespace physics
 
     void* physics_thread_main(void* params)
     {
+        PEN_MEMORY_TAG_SCOPE(physics);
+
         pen::job_thread_params* job_params = (pen::job_thread_params*)params;
         pen::job*               p_thread_info = job_params->job_info;
         pen::semaphore_post(p_thread_info->p_sem_continue, 1);
@@ -231,7 +233,7 @@ namespace physics
 
         physics_initialise();
 
-        s_cmd_buffer.create(1024);
+        s_cmd_buffer.create(1024, pen::e_ring_buffer_full::grow); // drained once per frame
 
         pen_main_loop(physics_thread_update);
         return PEN_THREAD_OK;
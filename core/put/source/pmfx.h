@@ -11,9 +11,9 @@
 
 #include "str/Str.h"
 
-static const hash_id ID_VERTEX_CLASS_INSTANCED = PEN_HASH("_instanced");
-static const hash_id ID_VERTEX_CLASS_SKINNED = PEN_HASH("_skinned");
-static const hash_id ID_VERTEX_CLASS_BASIC = PEN_HASH("");
+static const hash_id ID_VERTEX_CLASS_INSTANCED = PEN_HASHC("_instanced");
+static const hash_id ID_VERTEX_CLASS_SKINNED = PEN_HASHC("_skinned");
+static const hash_id ID_VERTEX_CLASS_BASIC = PEN_HASHC("");
 
 namespace put
 {
@@ -53,7 +53,8 @@ namespace put
         enum shader_permutation_t
         {
             skinned = 1 << 31,
-            instanced = 1 << 30
+            instanced = 1 << 30,
+            clustered_lights = 1 << 29
         };
     }
     typedef u32 shader_permutation;
@@ -77,12 +78,14 @@ namespace put
     };
 
     typedef void (*svr_render_function)(const scene_view&);
+    typedef bool (*svr_cache_function)(const scene_view&);
     struct scene_view_renderer
     {
         Str     name;
         hash_id id_name = 0;
 
         svr_render_function render_function = nullptr;
+        svr_cache_function  cache_function = nullptr; // optional, return true if view.array_index is still valid
     };
 
     struct technique_constant_data
@@ -238,6 +241,7 @@ namespace put
             hash_id   id_sub_type;
             Str       name;
             bool      loaded = false;
+            bool      loading = false; // files are being read in the background
             pen::json info;
 
             u32 vertex_shader;
@@ -330,6 +334,14 @@ namespace put
         void set_technique(u32 shader, u32 technique_index);
         bool set_technique_perm(u32 shader, hash_id id_technique, u32 permutation = 0);
 
+        // techniques load on first use, once a default technique is set techniques load in the background instead and
+        // draws use the default until they are ready. the default should have a compatible vertex layout.
+        // manifests are json {"techniques": [{"shader": "forward_render", "technique": "forward_lit", "permutation": 0}]}
+        void set_default_technique(u32 shader, hash_id id_technique, u32 permutation = 0);
+        void warm_up_techniques(const c8* manifest_filename);      // load all techniques in a manifest in the background
+        void save_technique_manifest(const c8* manifest_filename); // write all loaded techniques to a manifest
+        bool technique_ready(u32 shader, u32 technique_index);
+
         void initialise_constant_defaults(u32 shader, u32 technique_index, f32* data);
         void initialise_sampler_defaults(u32 handle, u32 technique_index, sampler_set& samplers);
 
@@ -34,11 +34,11 @@ using namespace ecs;
 namespace
 {
     // clang-format off
-    const hash_id k_id_main_colour = PEN_HASH("main_colour");
-    const hash_id k_id_main_depth  = PEN_HASH("main_depth");
-    const hash_id k_id_wrap_linear = PEN_HASH("wrap_linear"); // todo rename
-    const hash_id k_id_default = PEN_HASH("default");
-    const hash_id k_id_disabled = PEN_HASH("disabled");
+    const hash_id k_id_main_colour = PEN_HASHC("main_colour");
+    const hash_id k_id_main_depth  = PEN_HASHC("main_depth");
+    const hash_id k_id_wrap_linear = PEN_HASHC("wrap_linear"); // todo rename
+    const hash_id k_id_default = PEN_HASHC("default");
+    const hash_id k_id_disabled = PEN_HASHC("disabled");
     
     namespace e_pp_flags
     {
@@ -167,16 +167,16 @@ namespace
     };
     
     const format_info rt_format[] = {
-        {"rgba8",   PEN_HASH("rgba8"),      PEN_TEX_FORMAT_RGBA8_UNORM,         32,     PEN_BIND_RENDER_TARGET},
-        {"bgra8",   PEN_HASH("bgra8"),      PEN_TEX_FORMAT_BGRA8_UNORM,         32,     PEN_BIND_RENDER_TARGET},
-        {"rgba32f", PEN_HASH("rgba32f"),    PEN_TEX_FORMAT_R32G32B32A32_FLOAT,  32 * 4, PEN_BIND_RENDER_TARGET},
-        {"rgba16f", PEN_HASH("rgba16f"),    PEN_TEX_FORMAT_R16G16B16A16_FLOAT,  16 * 4, PEN_BIND_RENDER_TARGET},
-        {"r32f",    PEN_HASH("r32f"),       PEN_TEX_FORMAT_R32_FLOAT,           32,     PEN_BIND_RENDER_TARGET},
-        {"r16f",    PEN_HASH("r16f"),       PEN_TEX_FORMAT_R16_FLOAT,           16,     PEN_BIND_RENDER_TARGET},
-        {"r32u",    PEN_HASH("r32u"),       PEN_TEX_FORMAT_R32_UINT,            32,     PEN_BIND_RENDER_TARGET},
-        {"d24s8",   PEN_HASH("d24s8"),      PEN_TEX_FORMAT_D24_UNORM_S8_UINT,   32,     PEN_BIND_DEPTH_STENCIL},
-        {"d32f",    PEN_HASH("d32f"),       PEN_TEX_FORMAT_D32_FLOAT,           32,     PEN_BIND_DEPTH_STENCIL},
-        {"d32fs8",  PEN_HASH("d32fs8"),     PEN_TEX_FORMAT_D32_FLOAT_S8_UINT,   40,     PEN_BIND_DEPTH_STENCIL}
+        {"rgba8",   PEN_HASHC("rgba8"),      PEN_TEX_FORMAT_RGBA8_UNORM,         32,     PEN_BIND_RENDER_TARGET},
+        {"bgra8",   PEN_HASHC("bgra8"),      PEN_TEX_FORMAT_BGRA8_UNORM,         32,     PEN_BIND_RENDER_TARGET},
+        {"rgba32f", PEN_HASHC("rgba32f"),    PEN_TEX_FORMAT_R32G32B32A32_FLOAT,  32 * 4, PEN_BIND_RENDER_TARGET},
+        {"rgba16f", PEN_HASHC("rgba16f"),    PEN_TEX_FORMAT_R16G16B16A16_FLOAT,  16 * 4, PEN_BIND_RENDER_TARGET},
+        {"r32f",    PEN_HASHC("r32f"),       PEN_TEX_FORMAT_R32_FLOAT,           32,     PEN_BIND_RENDER_TARGET},
+        {"r16f",    PEN_HASHC("r16f"),       PEN_TEX_FORMAT_R16_FLOAT,           16,     PEN_BIND_RENDER_TARGET},
+        {"r32u",    PEN_HASHC("r32u"),       PEN_TEX_FORMAT_R32_UINT,            32,     PEN_BIND_RENDER_TARGET},
+        {"d24s8",   PEN_HASHC("d24s8"),      PEN_TEX_FORMAT_D24_UNORM_S8_UINT,   32,     PEN_BIND_DEPTH_STENCIL},
+        {"d32f",    PEN_HASHC("d32f"),       PEN_TEX_FORMAT_D32_FLOAT,           32,     PEN_BIND_DEPTH_STENCIL},
+        {"d32fs8",  PEN_HASHC("d32fs8"),     PEN_TEX_FORMAT_D32_FLOAT_S8_UINT,   40,     PEN_BIND_DEPTH_STENCIL}
     };
 
     const Str rt_ratio[] = {
@@ -251,6 +251,7 @@ namespace
         put::camera*    camera;
 
         std::vector<void (*)(const put::scene_view&)> render_functions;
+        std::vector<bool (*)(const put::scene_view&)> cache_functions;
 
         // targets
         u32 render_targets[pen::MAX_MRT] = {PEN_INVALID_HANDLE, PEN_INVALID_HANDLE, PEN_INVALID_HANDLE, PEN_INVALID_HANDLE,
@@ -1233,7 +1234,7 @@ namespace put
                         if (r["cpu_write"].as_bool(false))
                             tcp.cpu_access_flags |= PEN_CPU_ACCESS_WRITE;
 
-                        static hash_id id_write = PEN_HASH("write");
+                        static hash_id id_write = PEN_HASHC("write");
                         if (r["pp"].as_hash_id() == id_write)
                         {
                             new_info.pp = e_vrt_mode::write;
@@ -1866,6 +1867,7 @@ namespace put
                         {
                             found = true;
                             new_view.render_functions.push_back(sv.render_function);
+                            new_view.cache_functions.push_back(sv.cache_function);
                         }
                     }
 
@@ -1904,8 +1906,8 @@ namespace put
                         vec2f   dir;
                     };
 
-                    static dir_preset presets[] = {{PEN_HASH("horizontal"), vec2f(1.0, 0.0)},
-                                                   {PEN_HASH("vertical"), vec2f(0.0, 1.0)}};
+                    static dir_preset presets[] = {{PEN_HASHC("horizontal"), vec2f(1.0, 0.0)},
+                                                   {PEN_HASHC("vertical"), vec2f(0.0, 1.0)}};
 
                     vec2f vdir = vec2f::zero();
 
@@ -2366,7 +2368,7 @@ namespace put
                             pen::json tp = tech_params[c];
 
                             hash_id              id_c = PEN_HASH(tp.key());
-                            static const hash_id id_textures = PEN_HASH("textures");
+                            static const hash_id id_textures = PEN_HASHC("textures");
 
                             if (id_c == id_textures)
                             {
@@ -2688,7 +2690,7 @@ namespace put
 
         void fullscreen_quad(const scene_view& sv)
         {
-            static ecs::geometry_resource* quad = ecs::get_geometry_resource(PEN_HASH("full_screen_quad"));
+            static ecs::geometry_resource* quad = ecs::get_geometry_resource(PEN_HASHC("full_screen_quad"));
             static ecs::pmm_renderable&    r = quad->renderable[e_pmm_renderable::full_vertex_buffer];
 
             if (!is_valid(sv.pmfx_shader))
@@ -2762,7 +2764,7 @@ namespace put
 
             // render
             static u32                     pp_shader = pmfx::load_shader("post_process");
-            static ecs::geometry_resource* quad = ecs::get_geometry_resource(PEN_HASH("full_screen_quad"));
+            static ecs::geometry_resource* quad = ecs::get_geometry_resource(PEN_HASHC("full_screen_quad"));
             static ecs::pmm_renderable&    r = quad->renderable[e_pmm_renderable::full_vertex_buffer];
 
             pen::renderer_set_targets(&v.stashed_output_rt, 1, PEN_NULL_DEPTH_BUFFER);
@@ -2777,7 +2779,7 @@ namespace put
             pen::renderer_set_index_buffer(r.index_buffer, r.index_type, 0);
             pen::renderer_set_vertex_buffer(r.vertex_buffer, 0, r.vertex_size, 0);
 
-            static hash_id id_technique = PEN_HASH("blit");
+            static hash_id id_technique = PEN_HASHC("blit");
             if (!pmfx::set_technique_perm(pp_shader, id_technique))
                 PEN_ASSERT(0);
 
@@ -2853,6 +2855,18 @@ namespace put
                 pen::renderer_set_texture(0, 0, i, pen::TEXTURE_BIND_PS | pen::TEXTURE_BIND_VS);
         }
 
+        bool view_cached(const view_params& v, const scene_view& sv)
+        {
+            if (v.cache_functions.empty())
+                return false;
+
+            for (auto* cf : v.cache_functions)
+                if (!cf || !cf(sv))
+                    return false;
+
+            return true;
+        }
+
         void render_view(view_params& v)
         {
             // compute doesnt need render pipeline setup
@@ -2955,6 +2969,10 @@ namespace put
                 sv.array_index = a;
                 sv.num_arrays = v.num_arrays;
 
+                // keep the contents of slices which every scene view renderer has cached from a previous frame
+                if (view_cached(v, sv))
+                    continue;
+
                 // generate 3d view proj matrix
                 if (v.camera)
                 {
@@ -3078,6 +3096,8 @@ namespace put
 
         void render()
         {
+            PEN_MEMORY_TAG_SCOPE(pmfx);
+
             reload();
 
             for (auto& v : s_views)
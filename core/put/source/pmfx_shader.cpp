@@ -2,6 +2,7 @@
 // Copyright 2014 - 2019 Alex Dixon.
 // License: https://github.com/polymonster/pmtech/blob/master/license.md
 
+#include <fstream>
 #include <vector>
 
 #include "dev_ui.h"
@@ -20,6 +21,7 @@
 #include "pen_json.h"
 #include "pen_string.h"
 #include "renderer.h"
+#include "threads.h"
 
 using namespace put;
 using namespace pmfx;
@@ -32,31 +34,164 @@ namespace
 
     shader_program null_shader = {};
 
-    hash_id id_widgets[] = {PEN_HASH("slider"), PEN_HASH("input"), PEN_HASH("colour")};
+    hash_id id_widgets[] = {PEN_HASHC("slider"), PEN_HASHC("input"), PEN_HASHC("colour")};
     static_assert(PEN_ARRAY_SIZE(id_widgets) == e_constant_widget::COUNT, "mismatched array size");
 
+    // open addressed table mapping (id_technique, masked permutation) to a technique index, permutations of a
+    // technique share an option mask which is stored in a separate entry flagged with is_mask, slots are marked
+    // occupied explicitly so any permutation or mask value (including 0xffffffff) is a valid key
+    struct technique_lookup
+    {
+        hash_id id_technique;
+        u32     permutation;
+        u32     value; // technique index or option mask
+        bool    is_mask;
+        bool    occupied;
+    };
+
     struct pmfx_shader
     {
-        hash_id         id_filename = 0;
-        Str             filename = nullptr;
-        bool            invalidated = false;
-        pen::json       info;
-        u32             info_timestamp = 0;
-        shader_program* techniques = nullptr;
-        u32             rebuild_ts = 0;
+        hash_id           id_filename = 0;
+        Str               filename = nullptr;
+        bool              invalidated = false;
+        pen::json         info;
+        u32               info_timestamp = 0;
+        shader_program*   techniques = nullptr;
+        u32               rebuild_ts = 0;
+        technique_lookup* lookup = nullptr;
+        u32               lookup_capacity = 0; // power of 2
+    };
+
+    namespace e_shader_file
+    {
+        enum shader_file_t
+        {
+            vs,
+            ps,
+            cs,
+            COUNT
+        };
+    }
+
+    struct technique_source
+    {
+        Str       filenames[e_shader_file::COUNT];
+        void*     byte_code[e_shader_file::COUNT] = {nullptr};
+        u32       byte_code_size[e_shader_file::COUNT] = {0};
+        pen_error err = PEN_ERR_OK;
+    };
+
+    // technique files are read on the loader thread, gpu resources are created on the main thread
+    struct technique_load_request
+    {
+        u32              shader;
+        u32              technique_index;
+        hash_id          id_filename;
+        technique_source src;
+    };
+
+    struct default_technique
+    {
+        u32 shader = PEN_INVALID_HANDLE;
+        u32 technique_index = PEN_INVALID_HANDLE;
     };
 
+    const u32 k_technique_load_ring_size = 64;
+
     pmfx_shader*  s_pmfx_list = nullptr;
     const char**  s_shader_names = nullptr;
     const char*** s_technique_names = nullptr;
     hash_id**     s_technique_id_names = nullptr;
     u32           s_num_shader_names = 0;
+
+    default_technique                         s_default_technique;
+    technique_load_request**                  s_technique_load_queue = nullptr;
+    pen::ring_buffer<technique_load_request*> s_technique_read_requests;
+    pen::ring_buffer<technique_load_request*> s_technique_read_results;
+    u32                                       s_technique_loads_in_flight = 0;
+    bool                                      s_technique_loader_thread = false;
+    pen::semaphore*                           s_technique_loads_queued = nullptr;
 } // namespace
 
 namespace put
 {
     namespace pmfx
     {
+        u32 technique_lookup_slot(hash_id id_technique, u32 permutation, bool is_mask, u32 capacity)
+        {
+            u32 h = id_technique ^ (permutation * 0x9e3779b9) ^ (is_mask ? 0x85ebca6b : 0);
+            h ^= h >> 16;
+            return h & (capacity - 1);
+        }
+
+        technique_lookup* find_technique_lookup(const pmfx_shader& pmfx, hash_id id_technique, u32 permutation,
+                                                bool is_mask)
+        {
+            if (!pmfx.lookup)
+                return nullptr;
+
+            u32 cap = pmfx.lookup_capacity;
+            u32 slot = technique_lookup_slot(id_technique, permutation, is_mask, cap);
+            for (u32 i = 0; i < cap; ++i)
+            {
+                technique_lookup& tl = pmfx.lookup[(slot + i) & (cap - 1)];
+
+                if (!tl.occupied)
+                    return nullptr;
+
+                if (tl.id_technique == id_technique && tl.permutation == permutation && tl.is_mask == is_mask)
+                    return &tl;
+            }
+
+            return nullptr;
+        }
+
+        void insert_technique_lookup(pmfx_shader& pmfx, hash_id id_technique, u32 permutation, bool is_mask,
+                                     u32 value)
+        {
+            // first insert wins, matching the order of a linear search
+            if (find_technique_lookup(pmfx, id_technique, permutation, is_mask))
+                return;
+
+            u32 cap = pmfx.lookup_capacity;
+            u32 slot = technique_lookup_slot(id_technique, permutation, is_mask, cap);
+            for (u32 i = 0; i < cap; ++i)
+            {
+                technique_lookup& tl = pmfx.lookup[(slot + i) & (cap - 1)];
+                if (tl.occupied)
+                    continue;
+
+                tl.id_technique = id_technique;
+                tl.permutation = permutation;
+                tl.value = value;
+                tl.is_mask = is_mask;
+                tl.occupied = true;
+                return;
+            }
+        }
+
+        void build_technique_lookup(pmfx_shader& pmfx)
+        {
+            pen::memory_free(pmfx.lookup);
+
+            // entries for each technique and for each option mask, keep load factor under 0.5
+            u32 num_techniques = sb_count(pmfx.techniques);
+            u32 cap = 16;
+            while (cap < num_techniques * 4)
+                cap <<= 1;
+
+            pmfx.lookup_capacity = cap;
+            pmfx.lookup = (technique_lookup*)pen::memory_alloc(sizeof(technique_lookup) * cap);
+            memset(pmfx.lookup, 0x0, sizeof(technique_lookup) * cap);
+
+            for (u32 i = 0; i < num_techniques; ++i)
+            {
+                const shader_program& t = pmfx.techniques[i];
+                insert_technique_lookup(pmfx, t.id_name, 0, true, t.permutation_option_mask);
+                insert_technique_lookup(pmfx, t.id_name, t.permutation_id, false, i);
+            }
+        }
+
         void generate_name_lists()
         {
             pen::memory_free(s_shader_names);
@@ -277,7 +412,7 @@ namespace put
             }
         }
 
-        shader_program preload_shader_technique(const c8* fx_filename, pen::json& j_technique, pen::json& j_info)
+        shader_program preload_shader_technique(pen::json& j_technique)
         {
             shader_program program = {};
 
@@ -285,7 +420,7 @@ namespace put
 
             program.name = name;
             program.id_name = PEN_HASH(name.c_str());
-            program.id_sub_type = PEN_HASH("");
+            program.id_sub_type = PEN_HASHC("");
             program.permutation_id = j_technique["permutation_id"].as_u32();
             program.permutation_option_mask = j_technique["permutation_option_mask"].as_u32();
             program.info = j_technique;
@@ -293,65 +428,79 @@ namespace put
             return program;
         }
 
-        shader_program load_shader_technique(const c8* fx_filename, pen::json& j_technique, pen::json& j_info)
+        void get_technique_source_filenames(const c8* fx_filename, pen::json& j_technique, technique_source& src)
         {
-            shader_program program = {};
-
-            Str name = j_technique["name"].as_str();
-
-            program.name = name;
-            program.id_name = PEN_HASH(name.c_str());
-            program.id_sub_type = PEN_HASH("");
-            program.permutation_id = j_technique["permutation_id"].as_u32();
-            program.permutation_option_mask = j_technique["permutation_option_mask"].as_u32();
-            program.info = j_technique;
-
             const c8* sfp = pen::renderer_get_shader_platform();
 
             // compute shader
             Str cs_name = j_technique["cs"].as_str();
             if (!cs_name.empty())
             {
-                c8* cs_file_buf = (c8*)pen::memory_alloc(256);
-                Str cs_filename_str = j_technique["cs_file"].as_str();
-                pen::string_format(cs_file_buf, 256, "data/pmfx/%s/%s/%s", sfp, fx_filename, cs_filename_str.c_str());
+                src.filenames[e_shader_file::cs].setf("data/pmfx/%s/%s/%s", sfp, fx_filename,
+                                                       j_technique["cs_file"].as_cstr(""));
+                return;
+            }
 
-                pen::shader_load_params cs_slp;
-                cs_slp.type = PEN_SHADER_TYPE_CS;
+            // vertex shader, stream out techniques only have a vertex shader
+            src.filenames[e_shader_file::vs].setf("data/pmfx/%s/%s/%s", sfp, fx_filename, j_technique["vs_file"].as_cstr(""));
 
-                pen_error err = pen::filesystem_read_file_to_buffer(cs_file_buf, &cs_slp.byte_code, cs_slp.byte_code_size);
+            if (!j_technique["stream_out"].as_bool())
+                src.filenames[e_shader_file::ps].setf("data/pmfx/%s/%s/%s", sfp, fx_filename,
+                                                       j_technique["ps_file"].as_cstr(""));
+        }
 
-                pen::memory_free(cs_file_buf);
+        // thread safe, only touches the filesystem
+        pen_error read_technique_source(technique_source& src)
+        {
+            for (u32 i = 0; i < e_shader_file::COUNT; ++i)
+            {
+                if (src.filenames[i].empty())
+                    continue;
 
+                pen_error err = pen::filesystem_read_file_to_buffer(src.filenames[i].c_str(), &src.byte_code[i],
+                                                                    src.byte_code_size[i]);
                 if (err != PEN_ERR_OK)
-                {
-                    pen::memory_free(cs_slp.byte_code);
-                    return program;
-                }
+                    return err;
+            }
 
-                program.compute_shader = pen::renderer_load_shader(cs_slp);
+            return PEN_ERR_OK;
+        }
 
-                return program;
+        void free_technique_source(technique_source& src)
+        {
+            for (u32 i = 0; i < e_shader_file::COUNT; ++i)
+            {
+                pen::memory_free(src.byte_code[i]);
+                src.byte_code[i] = nullptr;
+                src.byte_code_size[i] = 0;
             }
+        }
 
-            // vertex shader
-            c8* vs_file_buf = (c8*)pen::memory_alloc(256);
-            Str vs_filename_str = j_technique["vs_file"].as_str();
-            pen::string_format(vs_file_buf, 256, "data/pmfx/%s/%s/%s", sfp, fx_filename, vs_filename_str.c_str());
-
-            pen::shader_load_params vs_slp;
-            vs_slp.type = PEN_SHADER_TYPE_VS;
+        void create_technique_shaders(shader_program& program, pen::json& j_technique, pen::json& j_info,
+                                      technique_source& src)
+        {
+            if (src.err != PEN_ERR_OK)
+                return;
 
-            pen_error err = pen::filesystem_read_file_to_buffer(vs_file_buf, &vs_slp.byte_code, vs_slp.byte_code_size);
+            // compute shader
+            if (src.byte_code[e_shader_file::cs])
+            {
+                pen::shader_load_params cs_slp;
+                cs_slp.type = PEN_SHADER_TYPE_CS;
+                cs_slp.byte_code = src.byte_code[e_shader_file::cs];
+                cs_slp.byte_code_size = src.byte_code_size[e_shader_file::cs];
 
-            pen::memory_free(vs_file_buf);
+                program.compute_shader = pen::renderer_load_shader(cs_slp);
 
-            if (err != PEN_ERR_OK)
-            {
-                pen::memory_free(vs_slp.byte_code);
-                return program;
+                return;
             }
 
+            // vertex shader
+            pen::shader_load_params vs_slp;
+            vs_slp.type = PEN_SHADER_TYPE_VS;
+            vs_slp.byte_code = src.byte_code[e_shader_file::vs];
+            vs_slp.byte_code_size = src.byte_code_size[e_shader_file::vs];
+
             // vertex stream out shader
             bool stream_out = j_technique["stream_out"].as_bool();
             if (stream_out)
@@ -417,7 +566,7 @@ namespace put
 
                 program.input_layout = pen::renderer_create_input_layout(ilp);
 
-                return program;
+                return;
             }
 
             // traditional vs / ps combo
@@ -426,23 +575,10 @@ namespace put
             pen::memory_free(vs_slp.so_decl_entries);
 
             // pixel shader
-            c8* ps_file_buf = (c8*)pen::memory_alloc(256);
-            Str ps_filename_str = j_technique["ps_file"].as_str();
-
-            pen::string_format(ps_file_buf, 256, "data/pmfx/%s/%s/%s", sfp, fx_filename, ps_filename_str.c_str());
-
             pen::shader_load_params ps_slp;
             ps_slp.type = PEN_SHADER_TYPE_PS;
-
-            err = pen::filesystem_read_file_to_buffer(ps_file_buf, &ps_slp.byte_code, ps_slp.byte_code_size);
-
-            pen::memory_free(ps_file_buf);
-
-            if (err != PEN_ERR_OK)
-            {
-                pen::memory_free(ps_slp.byte_code);
-                return program;
-            }
+            ps_slp.byte_code = src.byte_code[e_shader_file::ps];
+            ps_slp.byte_code_size = src.byte_code_size[e_shader_file::ps];
 
             program.pixel_shader = pen::renderer_load_shader(ps_slp);
 
@@ -470,6 +606,13 @@ namespace put
             program.program_index = pen::renderer_link_shader_program(link_params);
 
             pen::memory_free(link_params.constants);
+        }
+
+        // metadata only depends on the technique json so it is available before the shaders have loaded
+        void create_technique_metadata(shader_program& program, pen::json& j_technique)
+        {
+            if (!j_technique["cs"].as_str().empty() || j_technique["stream_out"].as_bool())
+                return;
 
             // generate technique textures meta data
             program.textures = nullptr;
@@ -513,7 +656,7 @@ namespace put
                 tc.name = jc.name();
                 tc.id_name = PEN_HASH(tc.name);
 
-                hash_id widget = jc["widget"].as_hash_id(PEN_HASH("input"));
+                hash_id widget = jc["widget"].as_hash_id(PEN_HASHC("input"));
                 for (u32 j = 0; j < e_constant_widget::COUNT; ++j)
                 {
                     if (widget == id_widgets[j])
@@ -563,8 +706,8 @@ namespace put
 
                 hash_id id_widget = j_technique["permutations"][i]["type"].as_hash_id();
 
-                static hash_id id_checkbox = PEN_HASH("checkbox");
-                static hash_id id_input = PEN_HASH("input");
+                static hash_id id_checkbox = PEN_HASHC("checkbox");
+                static hash_id id_input = PEN_HASHC("input");
 
                 if (id_widget == id_checkbox)
                 {
@@ -577,20 +720,237 @@ namespace put
 
                 sb_push(program.permutations, tp);
             }
+        }
 
-            return program;
+        void load_shader_technique(shader_program& program, const c8* fx_filename, pen::json& j_info)
+        {
+            technique_source src;
+            get_technique_source_filenames(fx_filename, program.info, src);
+            src.err = read_technique_source(src);
+
+            create_technique_shaders(program, program.info, j_info, src);
+
+            free_technique_source(src);
+        }
+
+        void queue_technique_load(u32 shader, u32 technique_index)
+        {
+            shader_program& t = s_pmfx_list[shader].techniques[technique_index];
+            if (t.loaded || t.loading)
+                return;
+
+            t.loading = true;
+            create_technique_metadata(t, t.info);
+
+            technique_load_request* req = new technique_load_request();
+            req->shader = shader;
+            req->technique_index = technique_index;
+            req->id_filename = s_pmfx_list[shader].id_filename;
+            get_technique_source_filenames(s_pmfx_list[shader].filename.c_str(), t.info, req->src);
+
+            sb_push(s_technique_load_queue, req);
         }
 
         void lazy_load_shader_technique(shader_program& t, u32 shader)
         {
             auto& s = s_pmfx_list[shader];
-            if (!t.loaded)
+            if (t.loaded)
+                return;
+
+            // with a default technique to fall back to, load in the background instead of stalling
+            if (s_default_technique.shader != PEN_INVALID_HANDLE)
+            {
+                queue_technique_load(shader, (u32)(&t - s.techniques));
+                return;
+            }
+
+            // needed now, a background load in flight is discarded when it completes
+            if (!t.loading)
+                create_technique_metadata(t, t.info);
+
+            load_shader_technique(t, s.filename.c_str(), s.info);
+            t.loaded = true;
+            t.loading = false;
+        }
+
+        void* technique_loader_thread(void* params)
+        {
+            pen::job_thread_params* job_params = (pen::job_thread_params*)params;
+
+            pen::job* p_thread_info = job_params->job_info;
+            p_thread_info->p_sem_wake = s_technique_loads_queued;
+            pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+
+            for (;;)
+            {
+                // posted when techniques are submitted and by jobs_terminate_all
+                pen::semaphore_wait(s_technique_loads_queued);
+
+                if (pen::semaphore_try_wait(p_thread_info->p_sem_exit))
+                    break;
+
+                technique_load_request** preq = s_technique_read_requests.get();
+                while (preq)
+                {
+                    technique_load_request* req = *preq;
+                    req->src.err = read_technique_source(req->src);
+                    s_technique_read_results.put(req);
+
+                    preq = s_technique_read_requests.get();
+                }
+            }
+
+            pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+            pen::semaphore_post(p_thread_info->p_sem_terminated, 1);
+            return PEN_THREAD_OK;
+        }
+
+        // feeds queued techniques to the loader thread and creates gpu resources for the ones which have been read
+        void update_technique_loads()
+        {
+            u32 num_queued = sb_count(s_technique_load_queue);
+            if (num_queued == 0 && s_technique_loads_in_flight == 0)
+                return;
+
+            if (!s_technique_loader_thread)
+            {
+                s_technique_read_requests.create(k_technique_load_ring_size);
+                s_technique_read_results.create(k_technique_load_ring_size);
+                s_technique_loads_queued = pen::semaphore_create(0, 1);
+                pen::jobs_create_job(technique_loader_thread, 1024 * 1024, nullptr, pen::e_thread_start_flags::detached);
+                s_technique_loader_thread = true;
+            }
+
+            // ring buffers are fixed size, keep the remainder queued until there is space
+            u32 submitted = 0;
+            while (submitted < num_queued && s_technique_loads_in_flight < k_technique_load_ring_size - 1)
+            {
+                s_technique_read_requests.put(s_technique_load_queue[submitted++]);
+                ++s_technique_loads_in_flight;
+            }
+
+            if (submitted > 0)
             {
-                t = load_shader_technique(s.filename.c_str(), t.info, s.info);
-                t.loaded = true;
+                u32 remaining = num_queued - submitted;
+                size_t bytes = remaining * sizeof(technique_load_request*);
+                memmove(s_technique_load_queue, s_technique_load_queue + submitted, bytes);
+                stb__sbn(s_technique_load_queue) = remaining;
+
+                // the loader drains every pending request per wake, so one post covers the batch
+                pen::semaphore_post(s_technique_loads_queued, 1);
+            }
+
+            technique_load_request** preq = s_technique_read_results.get();
+            while (preq)
+            {
+                technique_load_request* req = *preq;
+                --s_technique_loads_in_flight;
+
+                // the shader may have been released or hot reloaded while the files were being read
+                u32 shader = req->shader;
+                if (shader < sb_count(s_pmfx_list) && s_pmfx_list[shader].id_filename == req->id_filename &&
+                    req->technique_index < sb_count(s_pmfx_list[shader].techniques))
+                {
+                    auto& s = s_pmfx_list[shader];
+                    auto& t = s.techniques[req->technique_index];
+
+                    if (t.loading)
+                    {
+                        create_technique_shaders(t, t.info, s.info, req->src);
+                        t.loaded = true;
+                        t.loading = false;
+                    }
+                }
+
+                free_technique_source(req->src);
+                delete req;
+
+                preq = s_technique_read_results.get();
             }
         }
 
+        bool technique_ready(u32 shader, u32 technique_index)
+        {
+            if (shader >= sb_count(s_pmfx_list))
+                return false;
+
+            if (technique_index >= sb_count(s_pmfx_list[shader].techniques))
+                return false;
+
+            return s_pmfx_list[shader].techniques[technique_index].loaded;
+        }
+
+        void set_default_technique(u32 shader, hash_id id_technique, u32 permutation)
+        {
+            s_default_technique.shader = PEN_INVALID_HANDLE;
+
+            // the default is always loaded synchronously
+            u32 ti = get_technique_index_perm(shader, id_technique, permutation);
+            if (!is_valid(ti))
+                return;
+
+            s_default_technique.shader = shader;
+            s_default_technique.technique_index = ti;
+        }
+
+        void warm_up_techniques(const c8* manifest_filename)
+        {
+            pen::json manifest = pen::json::load_from_file(manifest_filename);
+
+            pen::json j_techniques = manifest["techniques"];
+            u32       num_techniques = j_techniques.size();
+            for (u32 i = 0; i < num_techniques; ++i)
+            {
+                pen::json jt = j_techniques[i];
+
+                u32 shader = load_shader(jt["shader"].as_cstr());
+                if (!is_valid(shader))
+                    continue;
+
+                hash_id id_technique = PEN_HASH(jt["technique"].as_cstr(""));
+                u32     permutation = jt["permutation"].as_u32();
+
+                u32 nt = sb_count(s_pmfx_list[shader].techniques);
+                for (u32 t = 0; t < nt; ++t)
+                {
+                    auto& tech = s_pmfx_list[shader].techniques[t];
+                    if (tech.id_name == id_technique && tech.permutation_id == (permutation & tech.permutation_option_mask))
+                    {
+                        queue_technique_load(shader, t);
+                        break;
+                    }
+                }
+            }
+        }
+
+        void save_technique_manifest(const c8* manifest_filename)
+        {
+            Str manifest = "{\n    \"techniques\": [";
+
+            bool first = true;
+            u32  num_pmfx = sb_count(s_pmfx_list);
+            for (u32 i = 0; i < num_pmfx; ++i)
+            {
+                u32 nt = sb_count(s_pmfx_list[i].techniques);
+                for (u32 t = 0; t < nt; ++t)
+                {
+                    auto& tech = s_pmfx_list[i].techniques[t];
+                    if (!tech.loaded)
+                        continue;
+
+                    manifest.appendf("%s\n        {\"shader\": \"%s\", \"technique\": \"%s\", \"permutation\": %u}",
+                                     first ? "" : ",", s_pmfx_list[i].filename.c_str(), tech.name.c_str(),
+                                     tech.permutation_id);
+                    first = false;
+                }
+            }
+
+            manifest.append("\n    ]\n}\n");
+
+            std::ofstream ofs(manifest_filename);
+            ofs << manifest.c_str();
+        }
+
         void initialise_constant_defaults(u32 shader, u32 technique_index, f32* data)
         {
             if (shader >= sb_count(s_pmfx_list))
@@ -615,7 +975,7 @@ namespace put
             {
                 pmfx::technique_sampler* ts = pmfx::get_technique_samplers(shader, technique_index);
 
-                static hash_id id_wrap_linear = PEN_HASH("wrap_linear");
+                static hash_id id_wrap_linear = PEN_HASHC("wrap_linear");
 
                 u32 num_tt = sb_count(ts);
                 for (u32 i = 0; i < num_tt; ++i)
@@ -711,9 +1071,15 @@ namespace put
             if (technique_index >= sb_count(s_pmfx_list[shader].techniques))
                 return;
 
-            auto& t = s_pmfx_list[shader].techniques[technique_index];
+            auto* tp = &s_pmfx_list[shader].techniques[technique_index];
+
+            lazy_load_shader_technique(*tp, shader);
 
-            lazy_load_shader_technique(t, shader);
+            // draw with the default until the technique has loaded in the background
+            if (!tp->loaded)
+                tp = &s_pmfx_list[s_default_technique.shader].techniques[s_default_technique.technique_index];
+
+            auto& t = *tp;
 
             if (t.stream_out_shader)
             {
@@ -749,25 +1115,19 @@ namespace put
 
         u32 get_technique_index_perm(u32 shader, hash_id id_technique, u32 permutation)
         {
-            u32 num_techniques = sb_count(s_pmfx_list[shader].techniques);
-            for (u32 i = 0; i < num_techniques; ++i)
-            {
-                auto& t = s_pmfx_list[shader].techniques[i];
+            pmfx_shader& pmfx = s_pmfx_list[shader];
 
-                if (t.id_name != id_technique)
-                    continue;
-
-                u32 masked_permutation = permutation & t.permutation_option_mask;
-
-                if (t.permutation_id != masked_permutation)
-                    continue;
+            technique_lookup* mask = find_technique_lookup(pmfx, id_technique, 0, true);
+            if (!mask)
+                return PEN_INVALID_HANDLE;
 
-                lazy_load_shader_technique(t, shader);
+            technique_lookup* tl = find_technique_lookup(pmfx, id_technique, permutation & mask->value, false);
+            if (!tl)
+                return PEN_INVALID_HANDLE;
 
-                return i;
-            }
+            lazy_load_shader_technique(pmfx.techniques[tl->value], shader);
 
-            return PEN_INVALID_HANDLE;
+            return tl->value;
         }
 
         Str get_pmfx_info_filename(const c8* pmfx_filename)
@@ -784,6 +1144,10 @@ namespace put
         {
             s_pmfx_list[shader].filename = nullptr;
 
+            pen::memory_free(s_pmfx_list[shader].lookup);
+            s_pmfx_list[shader].lookup = nullptr;
+            s_pmfx_list[shader].lookup_capacity = 0;
+
             u32 num_techniques = sb_count(s_pmfx_list[shader].techniques);
 
             for (u32 i = 0; i < num_techniques; ++i)
@@ -831,11 +1195,13 @@ namespace put
             for (s32 i = 0; i < _techniques.size(); ++i)
             {
                 pen::json      t = _techniques[i];
-                shader_program new_technique = preload_shader_technique(filename, t, new_pmfx.info);
+                shader_program new_technique = preload_shader_technique(t);
 
                 sb_push(new_pmfx.techniques, new_technique);
             }
 
+            build_technique_lookup(new_pmfx);
+
             return new_pmfx;
         }
 
@@ -898,13 +1264,13 @@ namespace put
 
         void poll_for_changes()
         {
+            update_technique_loads();
+
             PEN_HOTLOADING_ENABLED;
 
             Str shader_compiler_str = put::get_build_cmd();
             shader_compiler_str.append("-pmfx");
 
-            u32 current_counter = 0;
-
             u32  num_pmfx = sb_count(s_pmfx_list);
             u32* reload_list = nullptr;
 
@@ -959,8 +1325,6 @@ namespace put
                         }
                     }
                 }
-
-                current_counter++;
             }
 
             u32 num_reload = sb_count(reload_list);
@@ -971,7 +1335,7 @@ namespace put
                 {
                     auto&       pmfx_set = s_pmfx_list[reload_list[i]];
                     pmfx_shader pmfx_new = load_internal(pmfx_set.filename.c_str());
-                    release_shader(current_counter);
+                    release_shader(reload_list[i]);
                     pmfx_set = pmfx_new;
                 }
 
@@ -0,0 +1,601 @@
+// texture_mips.cpp
+// Copyright 2014 - 2019 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+#include "texture_mips.h"
+
+#include "data_struct.h"
+#include "memory.h"
+#include "threads.h"
+#include "timer.h"
+
+#include <math.h>
+
+#if __SSE2__ || __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    using namespace put;
+
+    static const u32 k_mip_workers = 8;
+    static const u32 k_texels_per_work = 1 << 14; // destination texels per work item
+    static const u32 k_max_taps = 6;
+
+    bool s_simd = true; // false runs the scalar loops, see set_mip_simd
+
+    namespace e_component
+    {
+        enum component_t
+        {
+            unorm8,
+            float16,
+            float32
+        };
+    }
+
+    struct mip_format
+    {
+        u32 channels;
+        u32 component;
+        u32 texel_size;
+    };
+
+    // taps for a single axis relative to 2 * destination coord
+    struct filter_taps
+    {
+        s32 offset[k_max_taps];
+        f32 weight[k_max_taps];
+        u32 count;
+    };
+
+    // taps resolved and clamped to the source level for a single destination coord
+    struct axis_taps
+    {
+        u32 coord[k_max_taps];
+        f32 weight[k_max_taps];
+        u32 count;
+    };
+
+    struct mip_work
+    {
+        const u8* src;
+        u8*       dst;
+        u32       row_begin; // rows are flattened y + z * height of the destination level
+        u32       row_end;
+    };
+
+    struct mip_level_context
+    {
+        mip_format      fmt;
+        u32             filter;
+        filter_taps     taps;
+        u32             src_dim[3];
+        u32             dst_dim[3];
+        mip_work*       work = nullptr;
+        a_u32           next_work;
+        pen::semaphore* sem_done = nullptr;
+    };
+
+    bool get_mip_format(u32 format, mip_format& mf)
+    {
+        switch (format)
+        {
+            case PEN_TEX_FORMAT_BGRA8_UNORM:
+            case PEN_TEX_FORMAT_RGBA8_UNORM:
+                mf = {4, e_component::unorm8, 4};
+                return true;
+            case PEN_TEX_FORMAT_R8_UNORM:
+                mf = {1, e_component::unorm8, 1};
+                return true;
+            case PEN_TEX_FORMAT_R16_FLOAT:
+                mf = {1, e_component::float16, 2};
+                return true;
+            case PEN_TEX_FORMAT_R16G16B16A16_FLOAT:
+                mf = {4, e_component::float16, 8};
+                return true;
+            case PEN_TEX_FORMAT_R32_FLOAT:
+                mf = {1, e_component::float32, 4};
+                return true;
+            case PEN_TEX_FORMAT_R32G32_FLOAT:
+                mf = {2, e_component::float32, 8};
+                return true;
+            case PEN_TEX_FORMAT_R32G32B32A32_FLOAT:
+                mf = {4, e_component::float32, 16};
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    f32 bessel_i0(f32 x)
+    {
+        // power series, converges in a handful of terms for the alpha used below
+        f32 sum = 1.0f;
+        f32 term = 1.0f;
+        for (u32 k = 1; k < 16; ++k)
+        {
+            term *= (x * 0.5f) / (f32)k;
+            sum += term * term;
+        }
+        return sum;
+    }
+
+    filter_taps get_filter_taps(u32 filter)
+    {
+        filter_taps ft;
+
+        if (filter != e_mip_filter::kaiser)
+        {
+            ft.count = 2;
+            ft.offset[0] = 0;
+            ft.offset[1] = 1;
+            ft.weight[0] = 0.5f;
+            ft.weight[1] = 0.5f;
+            return ft;
+        }
+
+        // sinc at half the source rate, windowed to a radius of 3 source texels
+        static const f32 radius = 3.0f;
+        static const f32 alpha = 4.0f;
+
+        f32 total = 0.0f;
+        ft.count = k_max_taps;
+        for (u32 i = 0; i < k_max_taps; ++i)
+        {
+            ft.offset[i] = (s32)i - 2;
+
+            f32 d = (f32)ft.offset[i] - 0.5f;
+            f32 x = (f32)M_PI * d * 0.5f;
+            f32 sinc = sinf(x) / x;
+            f32 r = d / radius;
+            f32 window = bessel_i0(alpha * sqrtf(1.0f - r * r)) / bessel_i0(alpha);
+
+            ft.weight[i] = sinc * window;
+            total += ft.weight[i];
+        }
+
+        for (u32 i = 0; i < k_max_taps; ++i)
+            ft.weight[i] /= total;
+
+        return ft;
+    }
+
+    void resolve_taps(const filter_taps& ft, u32 dst, u32 src_dim, axis_taps& at)
+    {
+        // axes which have already reached 1 texel are carried through unfiltered
+        if (src_dim == 1)
+        {
+            at.count = 1;
+            at.coord[0] = 0;
+            at.weight[0] = 1.0f;
+            return;
+        }
+
+        at.count = ft.count;
+        for (u32 i = 0; i < ft.count; ++i)
+        {
+            s32 c = (s32)dst * 2 + ft.offset[i];
+            at.coord[i] = (u32)min<s32>(max<s32>(c, 0), (s32)src_dim - 1);
+            at.weight[i] = ft.weight[i];
+        }
+    }
+
+    //
+    // row kernels
+    //
+
+    void row_madd(f32* acc, const f32* src, f32 w, u32 n)
+    {
+        u32 i = 0;
+#if __AVX2__
+        __m256 w8 = _mm256_set1_ps(w);
+        for (; s_simd && i + 8 <= n; i += 8)
+            _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), w8)));
+#endif
+#if __SSE2__
+        __m128 w4 = _mm_set1_ps(w);
+        for (; s_simd && i + 4 <= n; i += 4)
+            _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(src + i), w4)));
+#endif
+        for (; i < n; ++i)
+            acc[i] += src[i] * w;
+    }
+
+    void row_max(f32* acc, const f32* src, u32 n)
+    {
+        u32 i = 0;
+#if __AVX2__
+        for (; s_simd && i + 8 <= n; i += 8)
+            _mm256_storeu_ps(acc + i, _mm256_max_ps(_mm256_loadu_ps(acc + i), _mm256_loadu_ps(src + i)));
+#endif
+#if __SSE2__
+        for (; s_simd && i + 4 <= n; i += 4)
+            _mm_storeu_ps(acc + i, _mm_max_ps(_mm_loadu_ps(acc + i), _mm_loadu_ps(src + i)));
+#endif
+        for (; i < n; ++i)
+            acc[i] = acc[i] > src[i] ? acc[i] : src[i];
+    }
+
+    // reduces adjacent texel pairs in x, used by box and max
+    void reduce_pairs(const f32* acc, f32* out, u32 dst_w, u32 channels, bool max_filter)
+    {
+        u32 n = dst_w * channels;
+        u32 i = 0;
+#if __SSE2__
+        __m128 half = _mm_set1_ps(0.5f);
+        if (s_simd && channels == 4)
+        {
+            for (; i < n; i += 4)
+            {
+                __m128 a = _mm_loadu_ps(acc + i * 2);
+                __m128 b = _mm_loadu_ps(acc + i * 2 + 4);
+                _mm_storeu_ps(out + i, max_filter ? _mm_max_ps(a, b) : _mm_mul_ps(_mm_add_ps(a, b), half));
+            }
+        }
+        else if (s_simd && channels == 1)
+        {
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 a = _mm_loadu_ps(acc + i * 2);
+                __m128 b = _mm_loadu_ps(acc + i * 2 + 4);
+                __m128 even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(out + i, max_filter ? _mm_max_ps(even, odd) : _mm_mul_ps(_mm_add_ps(even, odd), half));
+            }
+        }
+#endif
+        for (; i < n; ++i)
+        {
+            u32 x = i / channels;
+            u32 c = i % channels;
+            f32 a = acc[x * 2 * channels + c];
+            f32 b = acc[(x * 2 + 1) * channels + c];
+            out[i] = max_filter ? (a > b ? a : b) : (a + b) * 0.5f;
+        }
+    }
+
+    void downsample_x(const mip_level_context& ctx, const f32* acc, f32* out)
+    {
+        u32 channels = ctx.fmt.channels;
+        u32 src_w = ctx.src_dim[0];
+        u32 dst_w = ctx.dst_dim[0];
+
+        if (src_w == 1)
+        {
+            memcpy(out, acc, channels * sizeof(f32));
+            return;
+        }
+
+        if (ctx.filter != e_mip_filter::kaiser)
+        {
+            reduce_pairs(acc, out, dst_w, channels, ctx.filter == e_mip_filter::max);
+            return;
+        }
+
+        for (u32 x = 0; x < dst_w; ++x)
+        {
+            axis_taps tx;
+            resolve_taps(ctx.taps, x, src_w, tx);
+
+            f32* o = out + x * channels;
+#if __SSE2__
+            if (s_simd && channels == 4)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for (u32 i = 0; i < tx.count; ++i)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(acc + tx.coord[i] * 4), _mm_set1_ps(tx.weight[i])));
+
+                _mm_storeu_ps(o, sum);
+                continue;
+            }
+#endif
+            for (u32 c = 0; c < channels; ++c)
+                o[c] = 0.0f;
+
+            for (u32 i = 0; i < tx.count; ++i)
+                for (u32 c = 0; c < channels; ++c)
+                    o[c] += acc[tx.coord[i] * channels + c] * tx.weight[i];
+        }
+    }
+
+    //
+    // format conversion, unorm8 is kept in 0-255 so the max filter stays exact
+    //
+
+    const f32* load_row(const mip_format& mf, const u8* src, u32 width, f32* row)
+    {
+        u32 n = width * mf.channels;
+
+        switch (mf.component)
+        {
+            case e_component::float32:
+                return (const f32*)src;
+
+            case e_component::float16:
+            {
+                const f16* h = (const f16*)src;
+                for (u32 i = 0; i < n; ++i)
+                    row[i] = half_to_float(h[i]);
+                return row;
+            }
+
+            default:
+            {
+                u32 i = 0;
+#if __SSE2__
+                __m128i zero = _mm_setzero_si128();
+                for (; s_simd && i + 16 <= n; i += 16)
+                {
+                    __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+                    __m128i lo = _mm_unpacklo_epi8(b, zero);
+                    __m128i hi = _mm_unpackhi_epi8(b, zero);
+                    _mm_storeu_ps(row + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+                    _mm_storeu_ps(row + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+                    _mm_storeu_ps(row + i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+                    _mm_storeu_ps(row + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+                }
+#endif
+                for (; i < n; ++i)
+                    row[i] = (f32)src[i];
+                return row;
+            }
+        }
+    }
+
+    void store_row(const mip_format& mf, const f32* row, u32 width, u8* dst)
+    {
+        u32 n = width * mf.channels;
+
+        switch (mf.component)
+        {
+            case e_component::float32:
+                memcpy(dst, row, n * sizeof(f32));
+                break;
+
+            case e_component::float16:
+            {
+                f16* h = (f16*)dst;
+                for (u32 i = 0; i < n; ++i)
+                    h[i] = float_to_half(row[i]);
+            }
+            break;
+
+            default:
+            {
+                // round to nearest and saturate, kaiser can overshoot either side
+                u32 i = 0;
+#if __SSE2__
+                __m128 half = _mm_set1_ps(0.5f);
+                for (; s_simd && i + 16 <= n; i += 16)
+                {
+                    __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(row + i), half));
+                    __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(row + i + 4), half));
+                    __m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(row + i + 8), half));
+                    __m128i d = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(row + i + 12), half));
+                    _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+                }
+#endif
+                for (; i < n; ++i)
+                {
+                    f32 v = row[i];
+                    v = v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v);
+                    dst[i] = (u8)(v + 0.5f);
+                }
+            }
+            break;
+        }
+    }
+
+    //
+    // work
+    //
+
+    void downsample_rows(const mip_level_context& ctx, const mip_work& work, f32* row, f32* acc, f32* out)
+    {
+        const mip_format& mf = ctx.fmt;
+
+        u32  src_pitch = ctx.src_dim[0] * mf.texel_size;
+        u32  src_slice_pitch = src_pitch * ctx.src_dim[1];
+        u32  dst_pitch = ctx.dst_dim[0] * mf.texel_size;
+        u32  n = ctx.src_dim[0] * mf.channels;
+        bool max_filter = ctx.filter == e_mip_filter::max;
+
+        for (u32 r = work.row_begin; r < work.row_end; ++r)
+        {
+            axis_taps ty, tz;
+            resolve_taps(ctx.taps, r % ctx.dst_dim[1], ctx.src_dim[1], ty);
+            resolve_taps(ctx.taps, r / ctx.dst_dim[1], ctx.src_dim[2], tz);
+
+            // filter rows in y and z first so the wide loops run over contiguous memory
+            if (!max_filter)
+                memset(acc, 0x0, n * sizeof(f32));
+
+            for (u32 j = 0; j < tz.count; ++j)
+            {
+                for (u32 i = 0; i < ty.count; ++i)
+                {
+                    const u8*  src = work.src + tz.coord[j] * src_slice_pitch + ty.coord[i] * src_pitch;
+                    const f32* src_row = load_row(mf, src, ctx.src_dim[0], row);
+
+                    if (!max_filter)
+                        row_madd(acc, src_row, tz.weight[j] * ty.weight[i], n);
+                    else if (i == 0 && j == 0)
+                        memcpy(acc, src_row, n * sizeof(f32));
+                    else
+                        row_max(acc, src_row, n);
+                }
+            }
+
+            downsample_x(ctx, acc, out);
+            store_row(mf, out, ctx.dst_dim[0], work.dst + r * dst_pitch);
+        }
+    }
+
+    void process_mip_work(mip_level_context& ctx)
+    {
+        u32  src_n = ctx.src_dim[0] * ctx.fmt.channels;
+        u32  dst_n = ctx.dst_dim[0] * ctx.fmt.channels;
+        f32* scratch = (f32*)pen::memory_alloc((src_n * 2 + dst_n) * sizeof(f32));
+
+        u32 num_work = sb_count(ctx.work);
+        for (;;)
+        {
+            u32 w = ctx.next_work++;
+            if (w >= num_work)
+                break;
+
+            downsample_rows(ctx, ctx.work[w], scratch, scratch + src_n, scratch + src_n * 2);
+        }
+
+        pen::memory_free(scratch);
+    }
+
+    void* mip_worker(void* params)
+    {
+        mip_level_context* ctx = (mip_level_context*)params;
+        process_mip_work(*ctx);
+
+        pen::semaphore_post(ctx->sem_done, 1);
+        return PEN_THREAD_OK;
+    }
+
+    u32 level_size(const u32* dim, const mip_format& mf)
+    {
+        return dim[0] * dim[1] * dim[2] * mf.texel_size;
+    }
+} // namespace
+
+namespace put
+{
+    bool mip_format_supported(u32 format)
+    {
+        mip_format mf;
+        return get_mip_format(format, mf);
+    }
+
+    void set_mip_simd(bool enabled)
+    {
+        s_simd = enabled;
+    }
+
+    bool generate_mips(pen::texture_creation_params& tcp, mip_filter filter, mip_stats* stats)
+    {
+        mip_format mf;
+        if (!get_mip_format(tcp.format, mf) || tcp.pixels_per_block != 1)
+            return false;
+
+        bool volume = tcp.collection_type == pen::TEXTURE_COLLECTION_VOLUME;
+        u32  num_surfaces = volume ? 1 : max<u32>(tcp.num_arrays, 1);
+        u32  top_dim[3] = {tcp.width, tcp.height, volume ? tcp.num_arrays : 1};
+
+        // size of the full chain per surface, and of any chain already in tcp.data so we can find each surface top
+        u32 num_mips = 1;
+        u32 chain_size = 0;
+        u32 src_chain_size = 0;
+        u32 dim[3] = {top_dim[0], top_dim[1], top_dim[2]};
+        for (;;)
+        {
+            u32 ls = level_size(dim, mf);
+            chain_size += ls;
+
+            if (num_mips <= (u32)max<s32>(tcp.num_mips, 1))
+                src_chain_size += ls;
+
+            if (dim[0] == 1 && dim[1] == 1 && dim[2] == 1)
+                break;
+
+            for (u32 i = 0; i < 3; ++i)
+                dim[i] = max<u32>(dim[i] / 2, 1);
+
+            ++num_mips;
+        }
+
+        u8*       data = (u8*)pen::memory_alloc(chain_size * num_surfaces);
+        const u8* src_data = (const u8*)tcp.data;
+        for (u32 s = 0; s < num_surfaces; ++s)
+            memcpy(data + s * chain_size, src_data + s * src_chain_size, level_size(top_dim, mf));
+
+        mip_level_context ctx;
+        ctx.fmt = mf;
+        ctx.filter = filter;
+        ctx.taps = get_filter_taps(filter);
+
+        u32 level_offset = 0;
+        for (u32 i = 0; i < 3; ++i)
+            dim[i] = top_dim[i];
+
+        if (stats)
+            stats->num_levels = 0;
+
+        for (u32 m = 1; m < num_mips; ++m)
+        {
+            f64 level_start = stats ? pen::get_time_ms() : 0.0;
+
+            for (u32 i = 0; i < 3; ++i)
+            {
+                ctx.src_dim[i] = dim[i];
+                ctx.dst_dim[i] = max<u32>(dim[i] / 2, 1);
+            }
+
+            u32 src_size = level_size(ctx.src_dim, mf);
+            u32 num_rows = ctx.dst_dim[1] * ctx.dst_dim[2];
+            u32 rows_per_work = max<u32>(k_texels_per_work / ctx.dst_dim[0], 1);
+
+            if (ctx.work)
+                stb__sbn(ctx.work) = 0;
+
+            for (u32 s = 0; s < num_surfaces; ++s)
+            {
+                u8* src = data + s * chain_size + level_offset;
+                for (u32 r = 0; r < num_rows; r += rows_per_work)
+                {
+                    mip_work w;
+                    w.src = src;
+                    w.dst = src + src_size;
+                    w.row_begin = r;
+                    w.row_end = min<u32>(r + rows_per_work, num_rows);
+                    sb_push(ctx.work, w);
+                }
+            }
+
+            // the calling thread works alongside the helpers, small levels are not worth a thread
+            ctx.next_work = 0;
+            u32 num_helpers = min<u32>(sb_count(ctx.work), k_mip_workers) - 1;
+
+            if (num_helpers > 0 && !ctx.sem_done)
+                ctx.sem_done = pen::semaphore_create(0, k_mip_workers);
+
+            pen::thread* helpers[k_mip_workers];
+            for (u32 h = 0; h < num_helpers; ++h)
+                helpers[h] = pen::thread_create(mip_worker, 1024 * 1024, &ctx, pen::e_thread_start_flags::detached);
+
+            process_mip_work(ctx);
+
+            for (u32 h = 0; h < num_helpers; ++h)
+                pen::semaphore_wait(ctx.sem_done);
+
+            for (u32 h = 0; h < num_helpers; ++h)
+                pen::memory_free(helpers[h]);
+
+            if (stats && stats->num_levels < mip_stats::k_max_levels)
+                stats->level_ms[stats->num_levels++] = pen::get_time_ms() - level_start;
+
+            level_offset += src_size;
+            for (u32 i = 0; i < 3; ++i)
+                dim[i] = ctx.dst_dim[i];
+        }
+
+        sb_free(ctx.work);
+
+        if (ctx.sem_done)
+            pen::semaphore_destroy(ctx.sem_done);
+
+        tcp.data = data;
+        tcp.data_size = chain_size * num_surfaces;
+        tcp.num_mips = num_mips;
+
+        return true;
+    }
+} // namespace put
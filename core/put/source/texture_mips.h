@@ -0,0 +1,47 @@
+// texture_mips.h
+// Copyright 2014 - 2019 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Cpu mip chain generation for uncompressed 2d, cube, array and volume textures.
+// Output follows the layout the renderers upload: cube faces and array slices each own a full mip chain,
+// volume mips are stored one after the other with depth halving at each level.
+// The SSE2 and AVX2 row loops are selected at compile time from __SSE2__ and __AVX2__, there is no runtime cpu
+// dispatch. pmtech builds every project with -mavx2 (/arch:AVX2 on windows), so AVX2 builds need an AVX2 host.
+
+#pragma once
+
+#include "renderer.h"
+
+namespace put
+{
+    namespace e_mip_filter
+    {
+        enum mip_filter_t
+        {
+            box,   // average of the 2x2 or 2x2x2 footprint
+            max,   // component wise max of the footprint, keeps sparse voxel occupancy visible in low mips
+            kaiser // 6 tap kaiser windowed sinc, sharper than box at the cost of 3x the taps per axis
+        };
+    }
+    typedef e_mip_filter::mip_filter_t mip_filter;
+
+    struct mip_stats
+    {
+        static const u32 k_max_levels = 16;
+
+        f64 level_ms[k_max_levels]; // generation time of each level below the top
+        u32 num_levels;
+    };
+
+    // rgba8, bgra8, r8, r16f, rgba16f, r32f, rg32f and rgba32f are supported
+    bool mip_format_supported(u32 format);
+
+    // enabled by default, false runs the scalar loops for every thread so bench -mips can compare the output
+    void set_mip_simd(bool enabled);
+
+    // replaces tcp.data with a new allocation containing the full mip chain down to 1x1x1, and updates num_mips and
+    // data_size. the top level is taken from the existing data which is not freed. levels are processed in order and
+    // each level is split across worker threads by surface and row. returns false if the format is not supported.
+    bool generate_mips(pen::texture_creation_params& tcp, mip_filter filter = e_mip_filter::box,
+                       mip_stats* stats = nullptr);
+} // namespace put
@@ -13,6 +13,7 @@
 #include "ecs/ecs_utilities.h"
 #include "pmfx.h"
 #include "str_utilities.h"
+#include "texture_mips.h"
 #include "timer.h"
 
 #include "console.h"
@@ -32,13 +33,6 @@
 
 #include <fstream>
 
-u8 temp[16];
-#define SIMD_PRINT_u8(V)                                                                                                     \
-    memcpy(temp, &V, 16);                                                                                                    \
-    for (u32 i = 0; i < 16; ++i)                                                                                             \
-        printf("%i ", (u32)temp[i]);                                                                                         \
-    printf("\n");
-
 // Progress / Cancellation
 extern mls_progress g_mls_progress;
 std::atomic<bool>   g_cancel_volume_job;
@@ -102,6 +96,8 @@ namespace put
             s32  volume_type = VOLUME_RASTERISED_TEXELS;
             s32  capture_data = 0;
             bool generate_mips = true;
+            bool cpu_rasterise = false; // conservative triangle / voxel rasterisation on worker threads, no gpu readback
+            bool compare_cpu_raster = false; // gpu path also rasterises on the cpu and logs voxel occupancy differences
         };
 
         struct generated_volume
@@ -133,6 +129,40 @@ namespace put
         };
         static vgt_rasteriser_job s_rasteriser_job;
 
+        // world space triangle with its bgra8 albedo for the cpu rasteriser
+        struct cpu_raster_tri
+        {
+            vec3f v[3];
+            u32   colour;
+        };
+
+        struct cpu_raster_context
+        {
+            cpu_raster_tri* tris = nullptr;
+            u32**           slab_tris = nullptr; // triangle indices binned by z slab
+            u32             num_slabs = 0;
+            u8*             volume_data = nullptr;
+            u32             volume_dim = 0;
+            vec3f           grid_min;
+            vec3f           voxel_size;
+            a_u32           next_slab;
+            pen::semaphore* sem_done = nullptr;
+        };
+        static cpu_raster_context s_cpu_raster;
+
+        // occupied voxels of the last gpu rasterisation against the cpu rasteriser on the same grid
+        struct raster_comparison
+        {
+            u32  gpu_voxels = 0;
+            u32  cpu_voxels = 0;
+            u32  both_voxels = 0;
+            bool valid = false;
+        };
+        static raster_comparison s_raster_comparison;
+
+        static const u32 k_raster_slab_depth = 4;
+        static const u32 k_raster_workers = 8;
+
         struct dd
         {
             vec3f pos;
@@ -164,6 +194,8 @@ namespace put
         // Forwards
         generated_volume create_volume_from_data(u32 volume_dim, u32 block_size, u32 data_size, u32 tex_format,
                                                  u8* volume_data, bool generate_mips);
+        void             complete_rasterised_volume(vgt_rasteriser_job* rasteriser_job, u8* volume_data);
+        bool             cpu_rasterise_volume(vgt_rasteriser_job* rasteriser_job, u8* volume_data);
 
         u8* get_texel(u32 axis, u32 x, u32 y, u32 z)
         {
@@ -333,6 +365,32 @@ namespace put
                 }
             }
 
+            // triangles were gathered on the main thread when the slices completed, the cpu pass restarts progress
+            if (rasteriser_job->options.compare_cpu_raster && !g_cancel_volume_job)
+            {
+                u8* cpu_data = (u8*)pen::memory_alloc(rasteriser_job->data_size);
+                pen::memory_zero(cpu_data, rasteriser_job->data_size);
+
+                if (cpu_rasterise_volume(rasteriser_job, cpu_data))
+                {
+                    raster_comparison rc;
+                    for (u32 i = 3; i < rasteriser_job->data_size; i += rasteriser_job->block_size)
+                    {
+                        bool gpu = volume_data[i] > 0;
+                        bool cpu = cpu_data[i] > 0;
+
+                        rc.gpu_voxels += gpu;
+                        rc.cpu_voxels += cpu;
+                        rc.both_voxels += gpu && cpu;
+                    }
+
+                    rc.valid = true;
+                    s_raster_comparison = rc;
+                }
+
+                pen::memory_free(cpu_data);
+            }
+
             if (g_cancel_volume_job)
             {
                 pen::memory_free(volume_data);
@@ -343,6 +401,19 @@ namespace put
                 return PEN_THREAD_OK;
             }
 
+            complete_rasterised_volume(rasteriser_job, volume_data);
+
+            pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+            pen::semaphore_post(p_thread_info->p_sem_terminated, 1);
+            return PEN_THREAD_OK;
+        }
+
+        void complete_rasterised_volume(vgt_rasteriser_job* rasteriser_job, u8* volume_data)
+        {
+            u32 volume_dim = rasteriser_job->dimension;
+            u32 row_pitch = volume_dim * rasteriser_job->block_size;
+            u32 slice_pitch = volume_dim * row_pitch;
+
             // with the 3d texture now initialised, dilate colour edges so we can use bilinear
             u32 bs = rasteriser_job->block_size;
             u32 rp = row_pitch;
@@ -398,449 +469,338 @@ namespace put
 
             rasteriser_job->generated_volume_index = sb_count(s_generated_volumes) - 1;
             rasteriser_job->combine_in_progress = 2;
-
-            pen::semaphore_post(p_thread_info->p_sem_continue, 1);
-            pen::semaphore_post(p_thread_info->p_sem_terminated, 1);
-            return PEN_THREAD_OK;
         }
 
-        void generate_mips_r32f_simd(pen::texture_creation_params& tcp)
+        // separating axes of a triangle against boxes of half size h, a box centred at c overlaps the triangle if
+        // dot(axis, c) lies within [lo, hi] on every axis. 3 box normals, the triangle normal and 9 edge cross products
+        struct tri_box_axes
         {
-#if PEN_SIMD
-            // calc num mips
-            u32              num_mips = 1;
-            u32              data_size = 0;
-            static const u32 block_size = 4;
+            f32 ax[13];
+            f32 ay[13];
+            f32 az[13];
+            f32 lo[13];
+            f32 hi[13];
+        };
 
-            vec3ui m = vec3ui(tcp.width, tcp.height, tcp.num_arrays);
+        void triangle_box_axes(const cpu_raster_tri& tri, const vec3f& h, tri_box_axes& sa)
+        {
+            vec3f e[3] = {tri.v[1] - tri.v[0], tri.v[2] - tri.v[1], tri.v[0] - tri.v[2]};
 
-            while (m.x > 1 && m.y > 1 && m.z > 1)
-            {
-                data_size += m.x * m.y * m.z * block_size;
+            vec3f axes[13];
+            axes[0] = vec3f::unit_x();
+            axes[1] = vec3f::unit_y();
+            axes[2] = vec3f::unit_z();
+            axes[3] = cross(e[0], e[1]);
 
-                num_mips++;
+            u32 a = 4;
+            for (u32 b = 0; b < 3; ++b)
+                for (u32 i = 0; i < 3; ++i)
+                    axes[a++] = cross(axes[b], e[i]);
 
-                m /= vec3ui(2, 2, 2);
-                m = max_union(m, vec3ui::one());
+            for (u32 i = 0; i < 13; ++i)
+            {
+                const vec3f& ax = axes[i];
+
+                f32 p0 = dot(ax, tri.v[0]);
+                f32 p1 = dot(ax, tri.v[1]);
+                f32 p2 = dot(ax, tri.v[2]);
+                f32 r = h.x * fabs(ax.x) + h.y * fabs(ax.y) + h.z * fabs(ax.z);
+
+                sa.ax[i] = ax.x;
+                sa.ay[i] = ax.y;
+                sa.az[i] = ax.z;
+                sa.lo[i] = min(p0, min(p1, p2)) - r;
+                sa.hi[i] = max(p0, max(p1, p2)) + r;
             }
+        }
 
-            data_size += block_size; // final mip
-
-            // offsets
-            vec3ui offsets[] = {vec3ui(0, 0, 0), vec3ui(0, 1, 0), vec3ui(0, 0, 1), vec3ui(0, 1, 1)};
-
-            u8* data = (u8*)pen::memory_alloc_align(data_size, 16);
-            memcpy(data, tcp.data, tcp.data_size);
-
-            m = vec3ui(tcp.width, tcp.height, tcp.num_arrays);
-
-            u8* prev_level = (u8*)data;
-            u8* cur_level = prev_level + tcp.data_size;
-
-            __m128 vrecip = _mm_set1_ps(1.0f / 8.0f);
-            __m128 r00, r01, r10, r11;
-            __m128 d00, d01, d10, d11;
-
-            u32 p_offset[4];
+        // tests 4 boxes along x starting at centre (cx, cy, cz), returns a bit per overlapping box
+        pen_inline u32 tri_box_overlap4(const tri_box_axes& sa, f32 cx, f32 step, f32 cy, f32 cz)
+        {
+#if PEN_SIMD
+            __m128 vcx = _mm_add_ps(_mm_set1_ps(cx), _mm_mul_ps(_mm_set1_ps(step), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f)));
+            __m128 mask = _mm_cmpeq_ps(vcx, vcx);
 
-            for (u32 i = 0; i < num_mips - 1; ++i)
+            for (u32 i = 0; i < 13; ++i)
             {
-                u32 p_rp = m.x * block_size; // prev row pitch
-                u32 p_sp = p_rp * m.y;       // prev slice pitch
-
-                m /= vec3ui(2, 2, 2);
-                m = max_union(m, vec3ui::one());
-
-                u32 c_rp = m.x * block_size; // cur row pitch
-                u32 c_sp = c_rp * m.y;       // cur slice pitch
+                __m128 d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(sa.ax[i]), vcx), _mm_set1_ps(sa.ay[i] * cy + sa.az[i] * cz));
+                __m128 in = _mm_and_ps(_mm_cmpge_ps(d, _mm_set1_ps(sa.lo[i])), _mm_cmple_ps(d, _mm_set1_ps(sa.hi[i])));
+                mask = _mm_and_ps(mask, in);
+            }
 
-                u32 block_copy_size = std::min<u32>(m.x * 4, 16);
-                u32 block_offset = block_copy_size < 16 ? 0 : 16;
+            return (u32)_mm_movemask_ps(mask);
+#else
+            u32 mask = 0;
+            for (u32 l = 0; l < 4; ++l)
+            {
+                f32 x = cx + step * (f32)l;
 
-                for (u32 z = 0; z < m.z; ++z)
+                u32 i = 0;
+                for (; i < 13; ++i)
                 {
-                    for (u32 y = 0; y < m.y; ++y)
-                    {
-                        for (u32 x = 0; x < m.x; x += 4)
-                        {
-                            vec3ui vobase = vec3ui(x * 2, y * 2, z * 2);
-                            vec3ui vo = vobase;
-                            p_offset[0] = p_sp * vo.z + p_rp * vo.y + block_size * vo.x;
-
-                            vo = vobase + offsets[1];
-                            p_offset[1] = p_sp * vo.z + p_rp * vo.y + block_size * vo.x;
-
-                            vo = vobase + offsets[2];
-                            p_offset[2] = p_sp * vo.z + p_rp * vo.y + block_size * vo.x;
-
-                            vo = vobase + offsets[3];
-                            p_offset[3] = p_sp * vo.z + p_rp * vo.y + block_size * vo.x;
-
-                            memcpy(&r00, &prev_level[p_offset[0]], block_copy_size);
-                            memcpy(&r01, &prev_level[p_offset[0] + block_offset], block_copy_size);
-                            memcpy(&r10, &prev_level[p_offset[1]], block_copy_size);
-                            memcpy(&r11, &prev_level[p_offset[1] + block_offset], block_copy_size);
-
-                            memcpy(&d00, &prev_level[p_offset[2]], block_copy_size);
-                            memcpy(&d01, &prev_level[p_offset[2] + block_offset], block_copy_size);
-                            memcpy(&d10, &prev_level[p_offset[3]], block_copy_size);
-                            memcpy(&d11, &prev_level[p_offset[3] + block_offset], block_copy_size);
-
-                            __m128 x0 = _mm_shuffle_ps(r00, r01, _MM_SHUFFLE(2, 0, 2, 0));
-                            __m128 x1 = _mm_shuffle_ps(r00, r01, _MM_SHUFFLE(3, 1, 3, 1));
-                            __m128 x2 = _mm_shuffle_ps(r10, r11, _MM_SHUFFLE(2, 0, 2, 0));
-                            __m128 x3 = _mm_shuffle_ps(r10, r11, _MM_SHUFFLE(3, 1, 3, 1));
-                            __m128 x4 = _mm_shuffle_ps(d00, d01, _MM_SHUFFLE(2, 0, 2, 0));
-                            __m128 x5 = _mm_shuffle_ps(d00, d01, _MM_SHUFFLE(3, 1, 3, 1));
-                            __m128 x6 = _mm_shuffle_ps(d10, d11, _MM_SHUFFLE(2, 0, 2, 0));
-                            __m128 x7 = _mm_shuffle_ps(d10, d11, _MM_SHUFFLE(3, 1, 3, 1));
-
-                            __m128 output = _mm_add_ps(x0, x1);
-                            output = _mm_add_ps(output, x2);
-                            output = _mm_add_ps(output, x3);
-                            output = _mm_add_ps(output, x4);
-                            output = _mm_add_ps(output, x5);
-                            output = _mm_add_ps(output, x6);
-                            output = _mm_add_ps(output, x7);
-                            output = _mm_mul_ps(output, vrecip);
-
-                            u32 c_offset = c_sp * z + c_rp * y + block_size * x;
-                            memcpy(&cur_level[c_offset], &output, block_copy_size);
-                        }
-                    }
+                    f32 d = sa.ax[i] * x + sa.ay[i] * cy + sa.az[i] * cz;
+                    if (d < sa.lo[i] || d > sa.hi[i])
+                        break;
                 }
 
-                prev_level = cur_level;
-                cur_level += c_sp * m.z;
+                if (i == 13)
+                    mask |= 1 << l;
             }
 
-            tcp.num_mips = num_mips;
-            tcp.data_size = data_size;
-
-            tcp.data = data;
+            return mask;
 #endif
         }
 
-        void generate_mips_rgba8_simd(pen::texture_creation_params& tcp)
+        void triangle_voxel_range(const cpu_raster_context& ctx, const cpu_raster_tri& tri, vec3i& vmin, vec3i& vmax)
         {
-#if PEN_SIMD
-            // calc num mips
-            u32              num_mips = 1;
-            u32              data_size = 0;
-            static const u32 block_size = 4;
+            vec3f tmin = min_union(tri.v[0], min_union(tri.v[1], tri.v[2]));
+            vec3f tmax = max_union(tri.v[0], max_union(tri.v[1], tri.v[2]));
 
-            vec3ui m = vec3ui(tcp.width, tcp.height, tcp.num_arrays);
+            vec3f fmin = (tmin - ctx.grid_min) / ctx.voxel_size;
+            vec3f fmax = (tmax - ctx.grid_min) / ctx.voxel_size;
 
-            while (m.x > 1 && m.y > 1 && m.z > 1)
+            f32 limit = (f32)(ctx.volume_dim - 1);
+            for (u32 i = 0; i < 3; ++i)
             {
-                data_size += m.x * m.y * m.z * block_size;
-
-                num_mips++;
-
-                m /= vec3ui(2, 2, 2);
-                m = max_union(m, vec3ui::one());
+                vmin[i] = (s32)min(max(floorf(fmin[i]), 0.0f), limit);
+                vmax[i] = (s32)min(max(floorf(fmax[i]), 0.0f), limit);
             }
+        }
 
-            data_size += block_size; // final mip
-
-            // offsets
-            vec3ui offsets[] = {vec3ui(0, 0, 0), vec3ui(0, 1, 0), vec3ui(0, 0, 1), vec3ui(0, 1, 1)};
-
-            u8* data = (u8*)pen::memory_alloc(data_size);
-            memcpy(data, tcp.data, tcp.data_size);
-
-            m = vec3ui(tcp.width, tcp.height, tcp.num_arrays);
-
-            u8* prev_level = (u8*)data;
-            u8* cur_level = prev_level + tcp.data_size;
-
-            u32 p_offset[4];
-
-            __m128i r00, r01, r10, r11;
-            __m128i d00, d01, d10, d11;
-
-            uint8_t aumask[16] = {4, 5, 6, 7, 12, 13, 14, 15, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80};
-            uint8_t bumask[16] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 4, 5, 6, 7, 12, 13, 14, 15};
-            uint8_t cumask[16] = {0, 1, 2, 3, 8, 9, 10, 11, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80};
-            uint8_t dumask[16] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0, 1, 2, 3, 8, 9, 10, 11};
-
-            uint8_t u00[16] = {1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4};
-            uint8_t u01[16] = {5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7, 8, 8, 8, 8};
-
-            uint8_t u10[16];
-            uint8_t u11[16];
-
-            uint8_t ud00[16];
-            uint8_t ud01[16];
-
-            uint8_t ud10[16];
-            uint8_t ud11[16];
-
-            for (u32 i = 0; i < 16; ++i)
-            {
-                u10[i] = u00[i] + 10;
-                u11[i] = u01[i] + 10;
+        void rasterise_triangle(cpu_raster_context& ctx, const cpu_raster_tri& tri, s32 z0, s32 z1)
+        {
+            const vec3f& vs = ctx.voxel_size;
+            const vec3f& gmin = ctx.grid_min;
 
-                ud00[i] = u00[i] + 20;
-                ud01[i] = u01[i] + 20;
+            tri_box_axes sa;
+            triangle_box_axes(tri, vs * 0.5f, sa);
 
-                ud10[i] = u00[i] + 30;
-                ud11[i] = u01[i] + 30;
-            }
+            vec3i vmin, vmax;
+            triangle_voxel_range(ctx, tri, vmin, vmax);
 
-            __m128i am, bm, cm, dm;
+            u32 row_pitch = ctx.volume_dim * 4;
+            u32 slice_pitch = ctx.volume_dim * row_pitch;
 
-            memcpy(&am, &aumask, 16);
-            memcpy(&bm, &bumask, 16);
-            memcpy(&cm, &cumask, 16);
-            memcpy(&dm, &dumask, 16);
-
-            for (u32 i = 0; i < num_mips - 1; ++i)
+            s32 zs = max(vmin.z, z0);
+            s32 ze = min(vmax.z, z1 - 1);
+            for (s32 z = zs; z <= ze; ++z)
             {
-                u32 p_rp = m.x * block_size; // prev row pitch
-                u32 p_sp = p_rp * m.y;       // prev slice pitch
-
-                m /= vec3ui(2, 2, 2);
-                m = max_union(m, vec3ui::one());
-
-                u32 c_rp = m.x * block_size; // cur row pitch
-                u32 c_sp = c_rp * m.y;       // cur slice pitch
+                f32 cz = gmin.z + ((f32)z + 0.5f) * vs.z;
 
-                u32 block_copy_size = std::min<u32>(m.x * 4, 16);
-                u32 block_offset = block_copy_size < 16 ? 0 : 16;
-
-                for (u32 z = 0; z < m.z; ++z)
+                for (s32 y = vmin.y; y <= vmax.y; ++y)
                 {
-                    for (u32 y = 0; y < m.y; ++y)
+                    f32 cy = gmin.y + ((f32)y + 0.5f) * vs.y;
+
+                    for (s32 x = vmin.x; x <= vmax.x; x += 4)
                     {
-                        for (u32 x = 0; x < m.x; x += 4)
+                        f32 cx = gmin.x + ((f32)x + 0.5f) * vs.x;
+                        u32 mask = tri_box_overlap4(sa, cx, vs.x, cy, cz);
+
+                        for (s32 l = 0; l < 4; ++l)
                         {
-                            vec3ui vobase = vec3ui(x * 2, y * 2, z * 2);
-                            vec3ui vo = vobase;
-                            p_offset[0] = p_sp * vo.z + p_rp * vo.y + block_size * vo.x;
-
-                            vo = vobase + offsets[1];
-                            p_offset[1] = p_sp * vo.z + p_rp * vo.y + block_size * vo.x;
-
-                            vo = vobase + offsets[2];
-                            p_offset[2] = p_sp * vo.z + p_rp * vo.y + block_size * vo.x;
-
-                            vo = vobase + offsets[3];
-                            p_offset[3] = p_sp * vo.z + p_rp * vo.y + block_size * vo.x;
-
-                            memcpy(&r00, &prev_level[p_offset[0]], block_copy_size);
-                            memcpy(&r01, &prev_level[p_offset[0] + block_offset], block_copy_size);
-                            memcpy(&r10, &prev_level[p_offset[1]], block_copy_size);
-                            memcpy(&r11, &prev_level[p_offset[1] + block_offset], block_copy_size);
-
-                            memcpy(&d00, &prev_level[p_offset[2]], block_copy_size);
-                            memcpy(&d01, &prev_level[p_offset[2] + block_offset], block_copy_size);
-                            memcpy(&d10, &prev_level[p_offset[3]], block_copy_size);
-                            memcpy(&d11, &prev_level[p_offset[3] + block_offset], block_copy_size);
-
-                            // max of 4x4 rgba block
-                            __m128i x0 = _mm_max_epu8(r00, r10);
-                            x0 = _mm_max_epu8(x0, d00);
-                            x0 = _mm_max_epu8(x0, d10);
-
-                            __m128i x1 = _mm_max_epu8(r01, r11);
-                            x1 = _mm_max_epu8(x1, d01);
-                            x1 = _mm_max_epu8(x1, d11);
-
-                            // shuffle and interleave
-                            __m128i v0 = _mm_shuffle_epi8(x0, am);
-                            __m128i v1 = _mm_shuffle_epi8(x0, cm);
-                            __m128i y0 = _mm_shuffle_epi8(x1, bm);
-                            __m128i y1 = _mm_shuffle_epi8(x1, dm);
-
-                            __m128i vv = _mm_max_epu8(v0, v1);
-                            __m128i yy = _mm_max_epu8(y0, y1);
-                            __m128i output = _mm_max_epu8(vv, yy);
-
-                            u32 c_offset = c_sp * z + c_rp * y + block_size * x;
-                            memcpy(&cur_level[c_offset], &output, block_copy_size);
+                            if (!(mask & 1 << l) || x + l > vmax.x)
+                                continue;
+
+                            u32 offset = z * slice_pitch + y * row_pitch + (x + l) * 4;
+                            memcpy(&ctx.volume_data[offset], &tri.colour, 4);
                         }
                     }
                 }
-
-                prev_level = cur_level;
-                cur_level += c_sp * m.z;
             }
-
-            tcp.num_mips = num_mips;
-            tcp.data_size = data_size;
-
-            tcp.data = data;
-#endif
         }
 
-        void generate_mips_r32f(pen::texture_creation_params& tcp)
+        void gather_cpu_raster_triangles(ecs_scene* scene)
         {
-            // calc num mips
-            u32              num_mips = 1;
-            u32              data_size = 0;
-            static const u32 block_size = 4;
+            cpu_raster_context& ctx = s_cpu_raster;
 
-            vec3ui m = vec3ui(tcp.width, tcp.height, tcp.num_arrays);
+            if (ctx.tris)
+                stb__sbn(ctx.tris) = 0;
 
-            while (m.x > 1 && m.y > 1 && m.z > 1)
-            {
-                data_size += m.x * m.y * m.z * block_size;
-
-                num_mips++;
-
-                m /= vec3ui(2, 2, 2);
-                m = max_union(m, vec3ui::one());
-            }
+            static hash_id id_albedo = PEN_HASHC("m_albedo");
 
-            data_size += block_size;
-
-            // offsets
-            vec3ui offsets[] = {vec3ui(0, 0, 0),
+            for (u32 n = 0; n < scene->num_entities; ++n)
+            {
+                if (!(scene->entities[n] & e_cmp::geometry))
+                    continue;
 
-                                vec3ui(1, 0, 0), vec3ui(0, 1, 0), vec3ui(1, 1, 0),
+                // unselected entities are hidden when capturing the selection
+                if (scene->state_flags[n] & e_state::hidden)
+                    continue;
 
-                                vec3ui(0, 0, 1), vec3ui(1, 0, 1), vec3ui(0, 1, 1), vec3ui(1, 1, 1)};
+                geometry_resource* gr = get_geometry_resource(scene->id_geometry[n]);
+                if (!gr)
+                    continue;
 
-            u8* data = (u8*)pen::memory_alloc(data_size);
-            memcpy(data, tcp.data, tcp.data_size);
+                pmm_renderable& r = gr->renderable[e_pmm_renderable::position_only];
+                if (!r.cpu_index_buffer || !r.cpu_vertex_buffer)
+                {
+                    dev_console_log_level(dev_ui::console_level::error,
+                                          "[error] mesh %s does not have cpu vertex / triangle data",
+                                          scene->names[n].c_str());
+                    continue;
+                }
 
-            m = vec3ui(tcp.width, tcp.height, tcp.num_arrays);
+                // textures only live on the gpu, so albedo comes from the material constant where there is one
+                vec4f albedo = vec4f::one();
+                if (scene->entities[n] & e_cmp::material)
+                {
+                    cmp_material&             mat = scene->materials[n];
+                    pmfx::technique_constant* tc = pmfx::get_technique_constant(id_albedo, mat.shader, mat.technique_index);
+                    if (tc)
+                        albedo = *(vec4f*)&scene->material_data[n].data[tc->cb_offset];
+                }
 
-            u8* prev_level = (u8*)data;
-            u8* cur_level = prev_level + tcp.data_size;
+                // bgra8 with full alpha for occupied voxels
+                u8 bgra[4] = {0, 0, 0, 255};
+                for (u32 c = 0; c < 3; ++c)
+                    bgra[2 - c] = (u8)(min(max(albedo[c], 0.0f), 1.0f) * 255.0f);
 
-            for (u32 i = 0; i < num_mips - 1; ++i)
-            {
-                u32 p_rp = m.x * block_size; // prev row pitch
-                u32 p_sp = p_rp * m.y;       // prev slice pitch
+                cpu_raster_tri tri;
+                memcpy(&tri.colour, bgra, 4);
 
-                m /= vec3ui(2, 2, 2);
-                m = max_union(m, vec3ui::one());
+                const mat4& wm = scene->world_matrices[n];
+                vec4f*      vertex_positions = (vec4f*)r.cpu_vertex_buffer;
+                u32         num_tris = r.num_indices / 3;
 
-                u32 c_rp = m.x * block_size; // cur row pitch
-                u32 c_sp = c_rp * m.y;       // cur slice pitch
-
-                for (u32 z = 0; z < m.z; ++z)
+                for (u32 t = 0; t < num_tris; ++t)
                 {
-                    for (u32 y = 0; y < m.y; ++y)
+                    for (u32 i = 0; i < 3; ++i)
                     {
-                        for (u32 x = 0; x < m.x; ++x)
-                        {
-                            u32 c_offset = c_sp * z + c_rp * y + block_size * x;
+                        u32 index = 0;
+                        if (r.index_type == PEN_FORMAT_R32_UINT)
+                            index = ((u32*)r.cpu_index_buffer)[t * 3 + i];
+                        else
+                            index = ((u16*)r.cpu_index_buffer)[t * 3 + i];
 
-                            f32 texel = 0.0f;
+                        tri.v[i] = wm.transform_vector((vec3f)vertex_positions[index].xyz);
+                    }
 
-                            for (u32 o = 0; o < PEN_ARRAY_SIZE(offsets); ++o)
-                            {
-                                vec3ui vo = vec3ui(x * 2, y * 2, z * 2) + offsets[o];
+                    sb_push(ctx.tris, tri);
+                }
+            }
+        }
 
-                                u32 p_offset = p_sp * vo.z + p_rp * vo.y + block_size * vo.x;
+        void* raster_voxel_cpu_worker(void* params)
+        {
+            cpu_raster_context* ctx = (cpu_raster_context*)params;
+            u32                 dim = ctx->volume_dim;
 
-                                f32* ft = (f32*)&prev_level[p_offset];
-                                texel += *ft;
-                            }
+            // slabs are claimed one at a time so workers never write the same voxel
+            for (;;)
+            {
+                u32 slab = ctx->next_slab++;
+                if (slab >= ctx->num_slabs || g_cancel_volume_job)
+                    break;
 
-                            texel /= PEN_ARRAY_SIZE(offsets);
-                            memcpy(&cur_level[c_offset], &texel, sizeof(f32));
-                        }
-                    }
-                }
+                u32 z0 = slab * k_raster_slab_depth;
+                u32 z1 = min(z0 + k_raster_slab_depth, dim);
 
-                prev_level = cur_level;
-                cur_level += c_sp * m.z;
-            }
+                u32* slab_tris = ctx->slab_tris[slab];
+                u32  num_tris = sb_count(slab_tris);
+                for (u32 t = 0; t < num_tris; ++t)
+                    rasterise_triangle(*ctx, ctx->tris[slab_tris[t]], z0, z1);
 
-            tcp.num_mips = num_mips;
-            tcp.data_size = data_size;
+                s_rasteriser_job.combine_position += dim * dim * (z1 - z0);
+            }
 
-            tcp.data = data;
+            pen::semaphore_post(ctx->sem_done, 1);
+            return PEN_THREAD_OK;
         }
 
-        void generate_mips_rgba8(pen::texture_creation_params& tcp)
+        // rasterises the gathered triangles into zeroed volume_data on the job grid, false if the job was cancelled
+        bool cpu_rasterise_volume(vgt_rasteriser_job* rasteriser_job, u8* volume_data)
         {
-            // calc num mips
-            u32              num_mips = 1;
-            u32              data_size = 0;
-            static const u32 block_size = 4;
+            cpu_raster_context& ctx = s_cpu_raster;
+            u32                 volume_dim = rasteriser_job->dimension;
 
-            vec3ui m = vec3ui(tcp.width, tcp.height, tcp.num_arrays);
+            rasteriser_job->combine_position = 0;
 
-            while (m.x > 1 && m.y > 1 && m.z > 1)
+            // same grid as the gpu slices, visible extents padded by a texel
+            vec3f vmin = rasteriser_job->visible_extents.min;
+            vec3f vmax = rasteriser_job->visible_extents.max;
+            f32   texel_boarder = component_wise_max(vmax - vmin) / volume_dim;
+            vmin -= texel_boarder;
+            vmax += texel_boarder;
+
+            ctx.volume_data = volume_data;
+            ctx.volume_dim = volume_dim;
+            ctx.grid_min = vmin;
+            ctx.voxel_size = (vmax - vmin) / (f32)volume_dim;
+            ctx.next_slab = 0;
+
+            // bin triangles into z slabs
+            ctx.num_slabs = (volume_dim + k_raster_slab_depth - 1) / k_raster_slab_depth;
+            ctx.slab_tris = (u32**)pen::memory_alloc(ctx.num_slabs * sizeof(u32*));
+            pen::memory_zero(ctx.slab_tris, ctx.num_slabs * sizeof(u32*));
+
+            u32 num_tris = sb_count(ctx.tris);
+            for (u32 t = 0; t < num_tris; ++t)
             {
-                data_size += m.x * m.y * m.z * block_size;
-
-                num_mips++;
+                vec3i tmin, tmax;
+                triangle_voxel_range(ctx, ctx.tris[t], tmin, tmax);
 
-                m /= vec3ui(2, 2, 2);
-                m = max_union(m, vec3ui::one());
+                for (s32 s = tmin.z / k_raster_slab_depth; s <= tmax.z / (s32)k_raster_slab_depth; ++s)
+                    sb_push(ctx.slab_tris[s], t);
             }
 
-            data_size += block_size;
+            ctx.sem_done = pen::semaphore_create(0, k_raster_workers);
 
-            // offsets
-            vec3ui offsets[] = {vec3ui(0, 0, 0),
+            pen::thread* workers[k_raster_workers];
+            for (u32 w = 0; w < k_raster_workers; ++w)
+                workers[w] = pen::thread_create(raster_voxel_cpu_worker, 1024 * 1024, &ctx,
+                                                pen::e_thread_start_flags::detached);
 
-                                vec3ui(1, 0, 0), vec3ui(0, 1, 0), vec3ui(1, 1, 0),
+            for (u32 w = 0; w < k_raster_workers; ++w)
+                pen::semaphore_wait(ctx.sem_done);
 
-                                vec3ui(0, 0, 1), vec3ui(1, 0, 1), vec3ui(0, 1, 1), vec3ui(1, 1, 1)};
+            for (u32 w = 0; w < k_raster_workers; ++w)
+                pen::memory_free(workers[w]);
 
-            u8* data = (u8*)pen::memory_alloc(data_size);
-            memcpy(data, tcp.data, tcp.data_size);
+            pen::semaphore_destroy(ctx.sem_done);
+            ctx.sem_done = nullptr;
 
-            m = vec3ui(tcp.width, tcp.height, tcp.num_arrays);
+            for (u32 s = 0; s < ctx.num_slabs; ++s)
+                sb_free(ctx.slab_tris[s]);
 
-            u8* prev_level = (u8*)data;
-            u8* cur_level = prev_level + tcp.data_size;
-
-            for (u32 i = 0; i < num_mips - 1; ++i)
-            {
-                u32 p_rp = m.x * block_size; // prev row pitch
-                u32 p_sp = p_rp * m.y;       // prev slice pitch
+            pen::memory_free(ctx.slab_tris);
+            ctx.slab_tris = nullptr;
 
-                m /= vec3ui(2, 2, 2);
-                m = max_union(m, vec3ui::one());
-
-                u32 c_rp = m.x * block_size; // cur row pitch
-                u32 c_sp = c_rp * m.y;       // cur slice pitch
+            return !g_cancel_volume_job;
+        }
 
-                for (u32 z = 0; z < m.z; ++z)
-                {
-                    for (u32 y = 0; y < m.y; ++y)
-                    {
-                        for (u32 x = 0; x < m.x; ++x)
-                        {
-                            u32 c_offset = c_sp * z + c_rp * y + block_size * x;
+        void* raster_voxel_cpu(void* params)
+        {
+            pen::job_thread_params* job_params = (pen::job_thread_params*)params;
+            vgt_rasteriser_job*     rasteriser_job = (vgt_rasteriser_job*)job_params->user_data;
+            pen::job*               p_thread_info = job_params->job_info;
+            pen::semaphore_post(p_thread_info->p_sem_continue, 1);
 
-                            u8 rgba[4] = {0};
+            u32 volume_dim = rasteriser_job->dimension;
 
-                            for (u32 o = 0; o < PEN_ARRAY_SIZE(offsets); ++o)
-                            {
-                                vec3ui vo = vec3ui(x * 2, y * 2, z * 2) + offsets[o];
+            rasteriser_job->block_size = 4;
+            rasteriser_job->data_size = volume_dim * volume_dim * volume_dim * rasteriser_job->block_size;
 
-                                u32 p_offset = p_sp * vo.z + p_rp * vo.y + block_size * vo.x;
+            u8* volume_data = (u8*)pen::memory_alloc(rasteriser_job->data_size);
+            pen::memory_zero(volume_data, rasteriser_job->data_size);
 
-                                for (u32 r = 0; r < 4; ++r)
-                                    rgba[r] = max<u8>(prev_level[p_offset + r], rgba[r]);
-                            }
+            cpu_rasterise_volume(rasteriser_job, volume_data);
 
-                            for (u32 r = 0; r < 4; ++r)
-                            {
-                                // rgba[r] /= PEN_ARRAY_SIZE(offsets);
-                                cur_level[c_offset + r] = rgba[r];
-                            }
-                        }
-                    }
-                }
+            if (g_cancel_volume_job)
+            {
+                pen::memory_free(volume_data);
+                rasteriser_job->combine_in_progress = 0;
+                g_cancel_handled = true;
 
-                prev_level = cur_level;
-                cur_level += c_sp * m.z;
+                pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+                pen::semaphore_post(p_thread_info->p_sem_terminated, 1);
+                return PEN_THREAD_OK;
             }
 
-            tcp.num_mips = num_mips;
-            tcp.data_size = data_size;
+            complete_rasterised_volume(rasteriser_job, volume_data);
 
-            tcp.data = data;
+            pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+            pen::semaphore_post(p_thread_info->p_sem_terminated, 1);
+            return PEN_THREAD_OK;
         }
 
         generated_volume create_volume_from_data(u32 volume_dim, u32 block_size, u32 data_size, u32 tex_format,
@@ -882,6 +842,9 @@ namespace put
                 tcp.format = PEN_TEX_FORMAT_R16_FLOAT;
                 tcp.data_size = new_data_size;
 
+                if (generate_mips && put::generate_mips(tcp, e_mip_filter::box))
+                    pen::memory_free(new_data);
+
                 gv.texture = PEN_INVALID_HANDLE;
                 gv.tcp = tcp;
 
@@ -890,32 +853,10 @@ namespace put
 
             if (generate_mips)
             {
-                // Mips will create their own copy of mem
-                switch (tex_format)
-                {
-                    case PEN_TEX_FORMAT_BGRA8_UNORM:
-                    {
-#if PEN_SIMD
-                        generate_mips_rgba8_simd(tcp);
-
-#else
-                        generate_mips_rgba8(tcp);
-#endif
-                    }
-                    break;
-                    case PEN_TEX_FORMAT_R32_FLOAT:
-                    {
-#if PEN_SIMD
-                        generate_mips_r32f_simd(tcp);
-#else
-                        generate_mips_r32f(tcp);
-#endif
-                    }
-                    break;
-                    default:
-                        PEN_ASSERT(0); // un-implemented mip map gen fucntion
-                        break;
-                }
+                // mips will create their own copy of mem, albedo volumes use max so thin geometry survives to low mips
+                mip_filter filter = tex_format == PEN_TEX_FORMAT_BGRA8_UNORM ? e_mip_filter::max : e_mip_filter::box;
+                if (!put::generate_mips(tcp, filter))
+                    PEN_ASSERT(0); // un-implemented mip map gen format
             }
             else
             {
@@ -936,6 +877,11 @@ namespace put
         {
             if (s_rasteriser_job.combine_in_progress == 0)
             {
+                // gather while the selection capture still hides the other entities
+                s_raster_comparison.valid = false;
+                if (s_rasteriser_job.options.compare_cpu_raster && !s_rasteriser_job.options.cpu_rasterise)
+                    gather_cpu_raster_triangles(scene);
+
                 s_rasteriser_job.combine_in_progress = 1;
                 pen::jobs_create_job(raster_voxel_combine, 1024 * 1024 * 1024, &s_rasteriser_job,
                                      pen::e_thread_start_flags::detached);
@@ -949,6 +895,14 @@ namespace put
 
             generated_volume& gv = s_generated_volumes[s_rasteriser_job.generated_volume_index];
 
+            if (s_raster_comparison.valid)
+            {
+                const raster_comparison& rc = s_raster_comparison;
+                dev_console_log("[volume raster] gpu %u voxels, cpu %u voxels, %u in both, %u gpu only, %u cpu only",
+                                rc.gpu_voxels, rc.cpu_voxels, rc.both_voxels, rc.gpu_voxels - rc.both_voxels,
+                                rc.cpu_voxels - rc.both_voxels);
+            }
+
             if (gv.texture == PEN_INVALID_HANDLE)
                 gv.texture = pen::renderer_create_texture(gv.tcp);
 
@@ -956,11 +910,11 @@ namespace put
             material_resource* volume_material = new material_resource;
             volume_material->material_name = "volume_material";
             volume_material->shader_name = "pmfx_utility";
-            volume_material->id_shader = PEN_HASH("pmfx_utility");
-            volume_material->id_technique = PEN_HASH("volume_texture");
+            volume_material->id_shader = PEN_HASHC("pmfx_utility");
+            volume_material->id_technique = PEN_HASHC("volume_texture");
             add_material_resource(volume_material);
 
-            geometry_resource* cube = get_geometry_resource(PEN_HASH("cube"));
+            geometry_resource* cube = get_geometry_resource(PEN_HASHC("cube"));
 
             vec3f scale = (s_rasteriser_job.visible_extents.max - s_rasteriser_job.visible_extents.min) / 2.0f;
             vec3f pos = s_rasteriser_job.visible_extents.min + scale;
@@ -976,7 +930,7 @@ namespace put
             scene->samplers[new_prim].sb[0].handle = gv.texture;
             scene->samplers[new_prim].sb[0].sampler_unit = e_texture::volume;
             scene->samplers[new_prim].sb[0].sampler_state =
-                pmfx::get_render_state(PEN_HASH("clamp_linear"), pmfx::e_render_state::sampler);
+                pmfx::get_render_state(PEN_HASHC("clamp_linear"), pmfx::e_render_state::sampler);
 
             instantiate_geometry(cube, scene, new_prim);
             instantiate_material(volume_material, scene, new_prim);
@@ -989,13 +943,17 @@ namespace put
 
             gv.scene_node_index = new_prim;
 
-            // clean up
+            // clean up, cpu rasterisation does not use slices
             for (u32 a = 0; a < 6; ++a)
             {
+                if (!s_rasteriser_job.volume_slices[a])
+                    continue;
+
                 for (u32 s = 0; s < s_rasteriser_job.dimension; ++s)
                     pen::memory_free(s_rasteriser_job.volume_slices[a][s]);
 
                 pen::memory_free(s_rasteriser_job.volume_slices[a]);
+                s_rasteriser_job.volume_slices[a] = nullptr;
             }
 
             // completed
@@ -1016,6 +974,25 @@ namespace put
             if (!s_rasteriser_job.rasterise_in_progress)
                 return;
 
+            if (s_rasteriser_job.options.cpu_rasterise)
+            {
+                if (s_rasteriser_job.combine_in_progress == 0)
+                {
+                    // gather on the main thread, the job only touches its own copy of the triangles
+                    gather_cpu_raster_triangles(scene);
+
+                    s_rasteriser_job.combine_in_progress = 1;
+                    pen::jobs_create_job(raster_voxel_cpu, 1024 * 1024, &s_rasteriser_job,
+                                         pen::e_thread_start_flags::detached);
+                }
+                else if (s_rasteriser_job.combine_in_progress == 2)
+                {
+                    volume_raster_completed(scene);
+                }
+
+                return;
+            }
+
             if (s_rasteriser_job.current_requested_slice == s_rasteriser_job.current_slice)
                 return;
 
@@ -1085,7 +1062,7 @@ namespace put
             s_rasteriser_job.current_slice_aabb.min.z *= -1;
             s_rasteriser_job.current_slice_aabb.max.z *= -1;
 
-            static hash_id             id_volume_raster = PEN_HASH("volume_raster");
+            static hash_id             id_volume_raster = PEN_HASHC("volume_raster");
             const pmfx::render_target* rt = pmfx::get_render_target(id_volume_raster);
 
             pen::resource_read_back_params rrbp;
@@ -1096,6 +1073,7 @@ namespace put
             rrbp.resource_index = rt->handle;
             rrbp.format = PEN_TEX_FORMAT_BGRA8_UNORM;
             rrbp.call_back_function = image_read_back;
+            rrbp.max_latency = 3; // next slice is requested once this one arrives
 
             pen::renderer_read_back_resource(rrbp);
             current_requested_slice = current_slice;
@@ -1124,7 +1102,10 @@ namespace put
 
             extents ve = {vec3f(FLT_MAX), vec3f(-FLT_MAX)};
 
-            u32 index_offset = 0;
+            // gather the meshes to capture first so vertex and index data can be sized up front
+            u32* capture_entities = nullptr;
+            u32  num_vertices = 0;
+            u32  num_triangles = 0;
 
             for (u32 n = 0; n < sdf_job->scene->soa_size; ++n)
             {
@@ -1147,9 +1128,7 @@ namespace put
                     geometry_resource* gr = get_geometry_resource(sdf_job->scene->id_geometry[n]);
                     pmm_renderable&    r = gr->renderable[e_pmm_renderable::position_only];
 
-                    vec4f* vertex_positions = (vec4f*)r.cpu_vertex_buffer;
-
-                    if (!r.cpu_index_buffer || !vertex_positions)
+                    if (!r.cpu_index_buffer || !r.cpu_vertex_buffer)
                     {
                         dev_console_log_level(dev_ui::console_level::error,
                                               "[error] mesh %s does not have cpu vertex / triangle data",
@@ -1158,37 +1137,57 @@ namespace put
                         continue;
                     }
 
-                    index_offset = vertices.size();
-                    for (u32 i = 0; i < r.num_vertices; ++i)
+                    sb_push(capture_entities, n);
+                    num_vertices += r.num_vertices;
+                    num_triangles += r.num_indices / 3;
+                }
+            }
+
+            vertices.resize(num_vertices);
+            triangles.resize(num_triangles);
+
+            u32 index_offset = 0;
+            u32 tri_offset = 0;
+            u32 num_capture = sb_count(capture_entities);
+            for (u32 c = 0; c < num_capture; ++c)
+            {
+                u32                n = capture_entities[c];
+                geometry_resource* gr = get_geometry_resource(sdf_job->scene->id_geometry[n]);
+                pmm_renderable&    r = gr->renderable[e_pmm_renderable::position_only];
+                const mat4&        wm = sdf_job->scene->world_matrices[n];
+
+                vec4f* vertex_positions = (vec4f*)r.cpu_vertex_buffer;
+                vec3f* vertex_out = &vertices[index_offset];
+                for (u32 i = 0; i < r.num_vertices; ++i)
+                    vertex_out[i] = wm.transform_vector((vec3f)vertex_positions[i].xyz);
+
+                u32     mesh_triangles = r.num_indices / 3;
+                vec3ui* tri_out = &triangles[tri_offset];
+                if (r.index_type == PEN_FORMAT_R32_UINT)
+                {
+                    u32* indices = (u32*)r.cpu_index_buffer;
+                    for (u32 t = 0; t < mesh_triangles; ++t)
                     {
-                        vec3f tv = sdf_job->scene->world_matrices[n].transform_vector((vec3f)vertex_positions[i].xyz);
-                        vertices.push_back(tv);
+                        u32* ti = &indices[t * 3];
+                        tri_out[t] = vec3ui(index_offset + ti[0], index_offset + ti[1], index_offset + ti[2]);
                     }
-
-                    for (u32 i = 0; i < r.num_indices; i += 3)
+                }
+                else
+                {
+                    u16* indices = (u16*)r.cpu_index_buffer;
+                    for (u32 t = 0; t < mesh_triangles; ++t)
                     {
-                        if (r.index_type == PEN_FORMAT_R32_UINT)
-                        {
-                            u32* indices = (u32*)r.cpu_index_buffer;
-                            u32  i0, i1, i2;
-                            i0 = index_offset + indices[i + 0];
-                            i1 = index_offset + indices[i + 1];
-                            i2 = index_offset + indices[i + 2];
-                            triangles.push_back(vec3ui(i0, i1, i2));
-                        }
-                        else
-                        {
-                            u16* indices = (u16*)r.cpu_index_buffer;
-                            u32  i0, i1, i2;
-                            i0 = index_offset + (u32)indices[i + 0];
-                            i1 = index_offset + (u32)indices[i + 1];
-                            i2 = index_offset + (u32)indices[i + 2];
-                            triangles.push_back(vec3ui(i0, i1, i2));
-                        }
+                        u16* ti = &indices[t * 3];
+                        tri_out[t] = vec3ui(index_offset + ti[0], index_offset + ti[1], index_offset + ti[2]);
                     }
                 }
+
+                index_offset += r.num_vertices;
+                tri_offset += mesh_triangles;
             }
 
+            sb_free(capture_entities);
+
             s_sdf_job.scene_extents = ve;
 
             vec3f sd = s_sdf_job.scene_extents.max - s_sdf_job.scene_extents.min;
@@ -1293,6 +1292,22 @@ namespace put
             static const c8* capture_data_names[] = {"Albedo", "Normals", "Baked Lighting", "Occupancy", "Custom"};
 
             ImGui::Combo("Capture", &s_options.capture_data, capture_data_names, PEN_ARRAY_SIZE(capture_data_names));
+            ImGui::Checkbox("CPU Rasterise", &s_options.cpu_rasterise);
+
+            if (!s_options.cpu_rasterise)
+            {
+                ImGui::SameLine();
+                ImGui::Checkbox("Compare With CPU", &s_options.compare_cpu_raster);
+            }
+
+            if (s_raster_comparison.valid)
+            {
+                // the cpu test is conservative so it is expected to cover every gpu voxel plus a thin shell
+                const raster_comparison& rc = s_raster_comparison;
+                f32 covered = rc.gpu_voxels ? 100.0f * rc.both_voxels / rc.gpu_voxels : 100.0f;
+                ImGui::Text("GPU %u / CPU %u voxels, %.2f%% of GPU voxels also set on the CPU", rc.gpu_voxels,
+                            rc.cpu_voxels, covered);
+            }
 
             static u32* hidden_entities = nullptr;
 
@@ -1339,10 +1354,15 @@ namespace put
                     s_rasteriser_job.dimension = dim;
                     s_rasteriser_job.current_axis = 0;
                     s_rasteriser_job.current_slice = 0;
+                    s_rasteriser_job.combine_in_progress = 0;
+                    s_rasteriser_job.combine_position = 0;
 
                     // allocate cpu mem for rasterised slices
                     for (u32 a = 0; a < 6; ++a)
                     {
+                        if (s_rasteriser_job.options.cpu_rasterise)
+                            break;
+
                         // alloc slices array
                         s_rasteriser_job.volume_slices[a] =
                             (void**)pen::memory_alloc(s_rasteriser_job.dimension * sizeof(void**));
@@ -1400,7 +1420,7 @@ namespace put
 
                     if (ImGui::CollapsingHeader("Render Target Output"))
                     {
-                        static hash_id             id_volume_raster_rt = PEN_HASH("volume_raster");
+                        static hash_id             id_volume_raster_rt = PEN_HASHC("volume_raster");
                         const pmfx::render_target* volume_rt = pmfx::get_render_target(id_volume_raster_rt);
                         ImGui::Image(IMG(volume_rt->handle), ImVec2(256, 256));
                     }
@@ -1467,16 +1487,16 @@ namespace put
                     if (gv.texture == PEN_INVALID_HANDLE)
                         gv.texture = pen::renderer_create_texture(gv.tcp);
 
-                    geometry_resource* cube = get_geometry_resource(PEN_HASH("cube"));
+                    geometry_resource* cube = get_geometry_resource(PEN_HASHC("cube"));
 
-                    u32 ss = pmfx::get_render_state(PEN_HASH("clamp_linear"), pmfx::e_render_state::sampler);
+                    u32 ss = pmfx::get_render_state(PEN_HASHC("clamp_linear"), pmfx::e_render_state::sampler);
 
                     // create material for volume sdf sphere trace
                     material_resource* sdf_material = new material_resource;
                     sdf_material->material_name = "volume_sdf_material";
                     sdf_material->shader_name = "pmfx_utility";
-                    sdf_material->id_shader = PEN_HASH("pmfx_utility");
-                    sdf_material->id_technique = PEN_HASH("volume_sdf");
+                    sdf_material->id_shader = PEN_HASHC("pmfx_utility");
+                    sdf_material->id_technique = PEN_HASHC("volume_sdf");
                     add_material_resource(sdf_material);
 
                     f32 single_scale = component_wise_max((s_sdf_job.scene_extents.max - s_sdf_job.scene_extents.min) / 2.0f);
@@ -1489,7 +1509,7 @@ namespace put
                     s_main_scene->transforms[new_prim].rotation = quat();
                     s_main_scene->transforms[new_prim].scale = scale;
                     s_main_scene->transforms[new_prim].translation = pos;
-                    s_main_scene->entities[new_prim] |= e_cmp::transform | e_cmp::sdf_shadow;
+                    add_components(s_main_scene, new_prim, e_cmp::transform | e_cmp::sdf_shadow);
                     s_main_scene->parents[new_prim] = new_prim;
                     s_main_scene->samplers[new_prim].sb[0].sampler_unit = e_texture::volume;
                     s_main_scene->samplers[new_prim].sb[0].handle = gv.texture;
@@ -1687,7 +1707,7 @@ namespace put
         void post_update()
         {
             static u32     dim = 128;
-            static hash_id id_volume_raster_rt = PEN_HASH("volume_raster");
+            static hash_id id_volume_raster_rt = PEN_HASHC("volume_raster");
 
             u32 cur_dim = 1 << s_options.volume_dimension;
 
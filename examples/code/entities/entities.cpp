@@ -41,7 +41,7 @@ void example_setup(ecs_scene* scene, camera& cam)
     scene->transforms[light].translation = vec3f::zero();
     scene->transforms[light].rotation = quat();
     scene->transforms[light].scale = vec3f::one();
-    scene->entities[light] |= e_cmp::light;
+    add_components(scene, light, e_cmp::light);
     scene->entities[light] |= e_cmp::transform;
 
     light = get_new_entity(scene);
@@ -54,7 +54,7 @@ void example_setup(ecs_scene* scene, camera& cam)
     scene->transforms[light].translation = vec3f::zero();
     scene->transforms[light].rotation = quat();
     scene->transforms[light].scale = vec3f::one();
-    scene->entities[light] |= e_cmp::light;
+    add_components(scene, light, e_cmp::light);
     scene->entities[light] |= e_cmp::transform;
 
     light = get_new_entity(scene);
@@ -67,7 +67,7 @@ void example_setup(ecs_scene* scene, camera& cam)
     scene->transforms[light].translation = vec3f::zero();
     scene->transforms[light].rotation = quat();
     scene->transforms[light].scale = vec3f::one();
-    scene->entities[light] |= e_cmp::light;
+    add_components(scene, light, e_cmp::light);
     scene->entities[light] |= e_cmp::transform;
 
     light = get_new_entity(scene);
@@ -80,7 +80,7 @@ void example_setup(ecs_scene* scene, camera& cam)
     scene->transforms[light].translation = vec3f::zero();
     scene->transforms[light].rotation = quat();
     scene->transforms[light].scale = vec3f::one();
-    scene->entities[light] |= e_cmp::light;
+    add_components(scene, light, e_cmp::light);
     scene->entities[light] |= e_cmp::transform;
 
     //floor for shadow casting
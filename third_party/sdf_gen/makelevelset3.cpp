@@ -4,6 +4,12 @@
 
 #include "makelevelset3.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 mls_progress             g_mls_progress;
 extern std::atomic<bool> g_cancel_volume_job;
 extern std::atomic<bool> g_cancel_handled;
@@ -11,9 +17,67 @@ extern std::atomic<bool> g_cancel_handled;
 #define cancel_return                                                                                                        \
     if (g_cancel_volume_job)                                                                                                 \
     return
-#define tri_progress g_mls_progress.triangles += tri_tick
 #define sweep_progress g_mls_progress.sweeps += sweep_tick
 
+namespace
+{
+    // the narrow band is built in slabs of k so no two threads write the same cell
+    const int k_slab_depth = 4;
+
+    // cells per side of the bricks the fast sweep is scheduled in
+    const int k_sweep_brick = 8;
+
+    u32 num_workers()
+    {
+        u32 n = std::thread::hardware_concurrency();
+        return n > 0 ? n : 4;
+    }
+
+    template <typename F>
+    void run_workers(u32 count, F func)
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(count);
+
+        for (u32 w = 0; w < count; ++w)
+            threads.emplace_back(func, w);
+
+        for (auto& t : threads)
+            t.join();
+    }
+
+    // workers wait here until all of them arrive
+    struct barrier
+    {
+        std::mutex              mutex;
+        std::condition_variable cv;
+        u32                     count;
+        u32                     waiting = 0;
+        u32                     generation = 0;
+
+        barrier(u32 c)
+            : count(c)
+        {
+        }
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            u32 gen = generation;
+            if (++waiting == count)
+            {
+                waiting = 0;
+                ++generation;
+                cv.notify_all();
+                return;
+            }
+
+            cv.wait(lock, [&] { return gen != generation; });
+        }
+    };
+} // namespace
+
 // find distance x0 is from segment x1-x2
 static float point_segment_distance(const Vec3f& x0, const Vec3f& x1, const Vec3f& x2)
 {
@@ -76,8 +140,10 @@ static void check_neighbour(const std::vector<Vec3ui>& tri, const std::vector<Ve
     }
 }
 
-static void sweep(const std::vector<Vec3ui>& tri, const std::vector<Vec3f>& x, Array3f& phi, Array3i& closest_tri,
-                  const Vec3f& origin, float dx, int di, int dj, int dk)
+// sweeps one direction, called on every worker with the same barrier. returns false if the job was cancelled
+static bool sweep(const std::vector<Vec3ui>& tri, const std::vector<Vec3f>& x, Array3f& phi, Array3i& closest_tri,
+                  const Vec3f& origin, float dx, int di, int dj, int dk, u32 w, u32 workers, barrier& brick_barrier,
+                  std::atomic<bool>& abort)
 {
     int i0, i1;
     if (di > 0)
@@ -113,19 +179,77 @@ static void sweep(const std::vector<Vec3ui>& tri, const std::vector<Vec3f>& x, A
         k1 = -1;
     }
 
-    for (int k = k0; k != k1; k += dk)
-        for (int j = j0; j != j1; j += dj)
-            for (int i = i0; i != i1; i += di)
+    // steps along each axis
+    int ci = std::abs(i1 - i0);
+    int cj = std::abs(j1 - j0);
+    int ck = std::abs(k1 - k0);
+    if (ci <= 0 || cj <= 0 || ck <= 0)
+        return true;
+
+    // a cell only reads neighbours behind it on each axis, so bricks on the diagonal plane a + b + c = s are
+    // independent and cells within a brick are visited in sweep order, matching the serial result exactly.
+    // bricks keep the number of barriers per sweep to the brick count along each axis rather than the cell count
+    int bi = (ci + k_sweep_brick - 1) / k_sweep_brick;
+    int bj = (cj + k_sweep_brick - 1) / k_sweep_brick;
+    int bk = (ck + k_sweep_brick - 1) / k_sweep_brick;
+    int num_planes = bi + bj + bk - 2;
+
+    for (int s = 0; s < num_planes; ++s)
+    {
+        int c_min = std::max(0, s - (bi - 1) - (bj - 1));
+        int c_max = std::min(bk - 1, s);
+        u32 brick = 0;
+
+        for (int c = c_min; c <= c_max; ++c)
+        {
+            int b_min = std::max(0, s - c - (bi - 1));
+            int b_max = std::min(bj - 1, s - c);
+
+            for (int b = b_min; b <= b_max; ++b, ++brick)
             {
-                Vec3f gx(i * dx + origin[0], j * dx + origin[1], k * dx + origin[2]);
-                check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i - di, j, k);
-                check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i, j - dj, k);
-                check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i - di, j - dj, k);
-                check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i, j, k - dk);
-                check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i - di, j, k - dk);
-                check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i, j - dj, k - dk);
-                check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i - di, j - dj, k - dk);
+                if (brick % workers != w)
+                    continue;
+
+                int a = s - b - c;
+                int ce = std::min((c + 1) * k_sweep_brick, ck);
+                int be = std::min((b + 1) * k_sweep_brick, cj);
+                int ae = std::min((a + 1) * k_sweep_brick, ci);
+
+                for (int sc = c * k_sweep_brick; sc < ce; ++sc)
+                {
+                    for (int sb = b * k_sweep_brick; sb < be; ++sb)
+                    {
+                        for (int sa = a * k_sweep_brick; sa < ae; ++sa)
+                        {
+                            int i = i0 + sa * di;
+                            int j = j0 + sb * dj;
+                            int k = k0 + sc * dk;
+
+                            Vec3f gx(i * dx + origin[0], j * dx + origin[1], k * dx + origin[2]);
+                            check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i - di, j, k);
+                            check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i, j - dj, k);
+                            check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i - di, j - dj, k);
+                            check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i, j, k - dk);
+                            check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i - di, j, k - dk);
+                            check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i, j - dj, k - dk);
+                            check_neighbour(tri, x, phi, closest_tri, gx, i, j, k, i - di, j - dj, k - dk);
+                        }
+                    }
+                }
             }
+        }
+
+        // only worker 0 samples cancel so every worker leaves after the same plane
+        if (w == 0 && g_cancel_volume_job)
+            abort = true;
+
+        brick_barrier.wait();
+
+        if (abort)
+            return false;
+    }
+
+    return true;
 }
 
 // calculate twice signed area of triangle (0,0)-(x1,y1)-(x2,y2)
@@ -188,113 +312,167 @@ void make_level_set3(const std::vector<Vec3ui>& tri, const std::vector<Vec3f>& x
     Array3i closest_tri(ni, nj, nk, -1);
     Array3i intersection_count(ni, nj, nk, 0); // intersection_count(i,j,k) is # of tri intersections in (i-1,i]x{j}x{k}
     // we begin by initializing distances near the mesh, and figuring out intersection counts
-    Vec3f ijkmin, ijkmax;
-    f32   tri_tick = 1.0f / tri.size();
+    // triangles are binned into slabs of k in triangle order, so ties between triangles resolve as they would serially
+    int                           num_slabs = (nk + k_slab_depth - 1) / k_slab_depth;
+    std::vector<std::vector<u32>> slab_tris(num_slabs);
+    u32                           total_work = 0;
     for (unsigned int t = 0; t < tri.size(); ++t)
     {
-        tri_progress;
-        cancel_return;
-
         unsigned int p, q, r;
         assign(tri[t], p, q, r);
-        // coordinates in grid to high precision
-        double fip = ((double)x[p][0] - origin[0]) / dx, fjp = ((double)x[p][1] - origin[1]) / dx,
-               fkp = ((double)x[p][2] - origin[2]) / dx;
-        double fiq = ((double)x[q][0] - origin[0]) / dx, fjq = ((double)x[q][1] - origin[1]) / dx,
-               fkq = ((double)x[q][2] - origin[2]) / dx;
-        double fir = ((double)x[r][0] - origin[0]) / dx, fjr = ((double)x[r][1] - origin[1]) / dx,
+        double fkp = ((double)x[p][2] - origin[2]) / dx, fkq = ((double)x[q][2] - origin[2]) / dx,
                fkr = ((double)x[r][2] - origin[2]) / dx;
-        // do distances nearby
-        int i0 = clamp(int(min(fip, fiq, fir)) - exact_band, 0, ni - 1),
-            i1 = clamp(int(max(fip, fiq, fir)) + exact_band + 1, 0, ni - 1);
-        int j0 = clamp(int(min(fjp, fjq, fjr)) - exact_band, 0, nj - 1),
-            j1 = clamp(int(max(fjp, fjq, fjr)) + exact_band + 1, 0, nj - 1);
+        // the exact band contains the intersection range
         int k0 = clamp(int(min(fkp, fkq, fkr)) - exact_band, 0, nk - 1),
             k1 = clamp(int(max(fkp, fkq, fkr)) + exact_band + 1, 0, nk - 1);
-        for (int k = k0; k <= k1; ++k)
-            for (int j = j0; j <= j1; ++j)
-                for (int i = i0; i <= i1; ++i)
-                {
-                    Vec3f gx(i * dx + origin[0], j * dx + origin[1], k * dx + origin[2]);
-                    float d = point_triangle_distance(gx, x[p], x[q], x[r]);
-                    if (d < phi(i, j, k))
-                    {
-                        phi(i, j, k) = d;
-                        closest_tri(i, j, k) = t;
-                    }
-                }
-        // and do intersection counts
-        j0 = clamp((int)std::ceil(min(fjp, fjq, fjr)), 0, nj - 1);
-        j1 = clamp((int)std::floor(max(fjp, fjq, fjr)), 0, nj - 1);
-        k0 = clamp((int)std::ceil(min(fkp, fkq, fkr)), 0, nk - 1);
-        k1 = clamp((int)std::floor(max(fkp, fkq, fkr)), 0, nk - 1);
-        for (int k = k0; k <= k1; ++k)
+        for (int sl = k0 / k_slab_depth; sl <= k1 / k_slab_depth; ++sl)
         {
-            if (g_cancel_volume_job)
-                return;
+            slab_tris[sl].push_back(t);
+            ++total_work;
+        }
+    }
+
+    std::atomic<u32> next_slab(0);
+    std::atomic<u32> work_done(0);
+    std::atomic<u32> workers_finished(0);
+    u32              workers = num_workers();
+
+    auto band_worker = [&](u32) {
+        for (;;)
+        {
+            int sl = (int)next_slab.fetch_add(1);
+            if (sl >= num_slabs || g_cancel_volume_job)
+                break;
+
+            int ks = sl * k_slab_depth;
+            int ke = std::min(ks + k_slab_depth, nk) - 1;
 
-            for (int j = j0; j <= j1; ++j)
+            for (u32 t : slab_tris[sl])
             {
-                double a, b, c;
-                if (point_in_triangle_2d(j, k, fjp, fkp, fjq, fkq, fjr, fkr, a, b, c))
+                if (g_cancel_volume_job)
+                    break;
+
+                unsigned int p, q, r;
+                assign(tri[t], p, q, r);
+                // coordinates in grid to high precision
+                double fip = ((double)x[p][0] - origin[0]) / dx, fjp = ((double)x[p][1] - origin[1]) / dx,
+                       fkp = ((double)x[p][2] - origin[2]) / dx;
+                double fiq = ((double)x[q][0] - origin[0]) / dx, fjq = ((double)x[q][1] - origin[1]) / dx,
+                       fkq = ((double)x[q][2] - origin[2]) / dx;
+                double fir = ((double)x[r][0] - origin[0]) / dx, fjr = ((double)x[r][1] - origin[1]) / dx,
+                       fkr = ((double)x[r][2] - origin[2]) / dx;
+                // do distances nearby, limited to this slab
+                int i0 = clamp(int(min(fip, fiq, fir)) - exact_band, 0, ni - 1),
+                    i1 = clamp(int(max(fip, fiq, fir)) + exact_band + 1, 0, ni - 1);
+                int j0 = clamp(int(min(fjp, fjq, fjr)) - exact_band, 0, nj - 1),
+                    j1 = clamp(int(max(fjp, fjq, fjr)) + exact_band + 1, 0, nj - 1);
+                int k0 = std::max(clamp(int(min(fkp, fkq, fkr)) - exact_band, 0, nk - 1), ks),
+                    k1 = std::min(clamp(int(max(fkp, fkq, fkr)) + exact_band + 1, 0, nk - 1), ke);
+                for (int k = k0; k <= k1; ++k)
+                    for (int j = j0; j <= j1; ++j)
+                        for (int i = i0; i <= i1; ++i)
+                        {
+                            Vec3f gx(i * dx + origin[0], j * dx + origin[1], k * dx + origin[2]);
+                            float d = point_triangle_distance(gx, x[p], x[q], x[r]);
+                            if (d < phi(i, j, k))
+                            {
+                                phi(i, j, k) = d;
+                                closest_tri(i, j, k) = t;
+                            }
+                        }
+                // and do intersection counts
+                j0 = clamp((int)std::ceil(min(fjp, fjq, fjr)), 0, nj - 1);
+                j1 = clamp((int)std::floor(max(fjp, fjq, fjr)), 0, nj - 1);
+                k0 = std::max(clamp((int)std::ceil(min(fkp, fkq, fkr)), 0, nk - 1), ks);
+                k1 = std::min(clamp((int)std::floor(max(fkp, fkq, fkr)), 0, nk - 1), ke);
+                for (int k = k0; k <= k1; ++k)
                 {
-                    double fi = a * fip + b * fiq + c * fir; // intersection i coordinate
-                    int    i_interval = int(std::ceil(fi));  // intersection is in (i_interval-1,i_interval]
-                    if (i_interval < 0)
-                        ++intersection_count(0, j,
-                                             k); // we enlarge the first interval to include everything to the -x direction
-                    else if (i_interval < ni)
-                        ++intersection_count(i_interval, j, k);
-                    // we ignore intersections that are beyond the +x side of the grid
+                    for (int j = j0; j <= j1; ++j)
+                    {
+                        double a, b, c;
+                        if (point_in_triangle_2d(j, k, fjp, fkp, fjq, fkq, fjr, fkr, a, b, c))
+                        {
+                            double fi = a * fip + b * fiq + c * fir; // intersection i coordinate
+                            int    i_interval = int(std::ceil(fi));  // intersection is in (i_interval-1,i_interval]
+                            if (i_interval < 0)
+                                ++intersection_count(
+                                    0, j, k); // we enlarge the first interval to include everything to the -x direction
+                            else if (i_interval < ni)
+                                ++intersection_count(i_interval, j, k);
+                            // we ignore intersections that are beyond the +x side of the grid
+                        }
+                    }
                 }
+
+                work_done.fetch_add(1, std::memory_order_relaxed);
             }
         }
-    }
-    // and now we fill in the rest of the distances with fast sweeping
-    f32 sweep_tick = 1.0f / 16.0;
-    for (unsigned int pass = 0; pass < 2; ++pass)
+
+        workers_finished.fetch_add(1);
+    };
+
+    std::vector<std::thread> band_threads;
+    band_threads.reserve(workers);
+    for (u32 w = 0; w < workers; ++w)
+        band_threads.emplace_back(band_worker, w);
+
+    // progress is only written from this thread
+    while (workers_finished.load() < workers)
     {
-        sweep(tri, x, phi, closest_tri, origin, dx, +1, +1, +1);
-        sweep_progress;
-        cancel_return;
-        sweep(tri, x, phi, closest_tri, origin, dx, -1, -1, -1);
-        sweep_progress;
-        cancel_return;
-        sweep(tri, x, phi, closest_tri, origin, dx, +1, +1, -1);
-        sweep_progress;
-        cancel_return;
-        sweep(tri, x, phi, closest_tri, origin, dx, -1, -1, +1);
-        sweep_progress;
-        cancel_return;
-        sweep(tri, x, phi, closest_tri, origin, dx, +1, -1, +1);
-        sweep_progress;
-        cancel_return;
-        sweep(tri, x, phi, closest_tri, origin, dx, -1, +1, -1);
-        sweep_progress;
-        cancel_return;
-        sweep(tri, x, phi, closest_tri, origin, dx, +1, -1, -1);
-        sweep_progress;
-        cancel_return;
-        sweep(tri, x, phi, closest_tri, origin, dx, -1, +1, +1);
-        sweep_progress;
-        cancel_return;
+        g_mls_progress.triangles = (f32)work_done.load(std::memory_order_relaxed) / (f32)std::max(total_work, 1u);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
     }
-    // then figure out signs (inside/outside) from intersection counts
-    for (int k = 0; k < nk; ++k)
-    {
-        cancel_return;
 
-        for (int j = 0; j < nj; ++j)
+    for (auto& t : band_threads)
+        t.join();
+
+    g_mls_progress.triangles = 1.0f;
+    cancel_return;
+
+    // and now we fill in the rest of the distances with fast sweeping, the workers stay alive for all 16 sweeps
+    static const int k_sweep_dirs[8][3] = {{+1, +1, +1}, {-1, -1, -1}, {+1, +1, -1}, {-1, -1, +1},
+                                           {+1, -1, +1}, {-1, +1, -1}, {+1, -1, -1}, {-1, +1, +1}};
+
+    f32               sweep_tick = 1.0f / 16.0;
+    barrier           brick_barrier(workers);
+    std::atomic<bool> abort(false);
+
+    run_workers(workers, [&](u32 w) {
+        for (unsigned int pass = 0; pass < 2; ++pass)
+        {
+            for (u32 d = 0; d < 8; ++d)
+            {
+                const int* dir = k_sweep_dirs[d];
+                if (!sweep(tri, x, phi, closest_tri, origin, dx, dir[0], dir[1], dir[2], w, workers, brick_barrier,
+                           abort))
+                    return;
+
+                if (w == 0)
+                    sweep_progress;
+            }
+        }
+    });
+    cancel_return;
+
+    // then figure out signs (inside/outside) from intersection counts, rows are independent
+    run_workers(workers, [&](u32 w) {
+        for (int k = (int)w; k < nk; k += (int)workers)
         {
-            int total_count = 0;
-            for (int i = 0; i < ni; ++i)
+            if (g_cancel_volume_job)
+                return;
+
+            for (int j = 0; j < nj; ++j)
             {
-                total_count += intersection_count(i, j, k);
-                if (total_count % 2 == 1)
-                {                                 // if parity of intersections so far is odd,
-                    phi(i, j, k) = -phi(i, j, k); // we are inside the mesh
+                int total_count = 0;
+                for (int i = 0; i < ni; ++i)
+                {
+                    total_count += intersection_count(i, j, k);
+                    if (total_count % 2 == 1)
+                    {                                 // if parity of intersections so far is odd,
+                        phi(i, j, k) = -phi(i, j, k); // we are inside the mesh
+                    }
                 }
             }
         }
-    }
+    });
 }
@@ -0,0 +1,928 @@
+// bench.cpp
+// Copyright 2014 - 2019 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Micro benchmarks for pen and put subsystems, each runs a fixed seeded workload so results are comparable between
+// builds. Build pen with "--memory_size_classes" or "--memory_tracking" to compare allocator configurations.
+
+#include "console.h"
+#include "data_struct.h"
+#include "file_system.h"
+#include "memory.h"
+#include "os.h"
+#include "pen.h"
+#include "renderer.h"
+#include "str/Str.h"
+#include "threads.h"
+#include "timer.h"
+
+#include "camera.h"
+#include "ecs/ecs_cull.h"
+#include "ecs/ecs_resources.h"
+#include "ecs/ecs_scene.h"
+#include "ecs/ecs_utilities.h"
+#include "sdf_gen/makelevelset3.h"
+#include "texture_mips.h"
+
+using namespace pen;
+using namespace put;
+
+namespace
+{
+    Str* s_args = nullptr;
+
+    void show_help()
+    {
+        PEN_LOG("bench help");
+        PEN_LOG("    -help <show this dialog>");
+        PEN_LOG("    -memory <malloc vs pen::memory allocation trace>");
+        PEN_LOG("    -ring_buffer <single producer single consumer throughput for each ring_buffer_full mode>");
+        PEN_LOG("    -semaphore <two thread ping pong round trip time through a pair of semaphores>");
+        PEN_LOG("    -scene_load <generated scene load times for version 10 and chunked scene files>");
+        PEN_LOG("    -entities (optional) <number of entities for scene benchmarks, default 100000>");
+        PEN_LOG("    -cluster_lights <froxel light assignment time for increasing light counts>");
+        PEN_LOG("    -sdf <signed distance field generation time at 64, 128 and 256 cubed>");
+        PEN_LOG("    -mips <simd against scalar mip generation, output difference and time per level for each format>");
+        PEN_LOG("    -threads (optional) <number of threads for multi threaded benchmarks, default 4>");
+    }
+
+    bool has_arg(const c8* arg)
+    {
+        u32 num_args = sb_count(s_args);
+        for (u32 i = 0; i < num_args; ++i)
+            if (s_args[i] == arg)
+                return true;
+
+        return false;
+    }
+
+    u32 arg_u32(const c8* arg, u32 default_value)
+    {
+        u32 num_args = sb_count(s_args);
+        for (u32 i = 0; i < num_args; ++i)
+            if (s_args[i] == arg && i + 1 < num_args)
+                return (u32)atoi(s_args[i + 1].c_str());
+
+        return default_value;
+    }
+
+    // deterministic so every build and allocator sees the same trace
+    struct bench_rand
+    {
+        u32 state;
+
+        u32 next()
+        {
+            state = state * 1664525u + 1013904223u;
+            return state >> 8;
+        }
+    };
+
+    // memory
+
+    namespace e_alloc_api
+    {
+        enum alloc_api_t
+        {
+            crt,
+            pen,
+            count
+        };
+    }
+    typedef e_alloc_api::alloc_api_t alloc_api;
+
+    const c8* k_alloc_api_names[] = {"malloc", "pen::memory"};
+
+    void* bench_alloc(alloc_api api, size_t size)
+    {
+        if (api == e_alloc_api::crt)
+            return malloc(size);
+        return pen::memory_alloc(size);
+    }
+
+    void* bench_realloc(alloc_api api, void* mem, size_t size)
+    {
+        if (api == e_alloc_api::crt)
+            return realloc(mem, size);
+        return pen::memory_realloc(mem, size);
+    }
+
+    void bench_free(alloc_api api, void* mem)
+    {
+        if (api == e_alloc_api::crt)
+            free(mem);
+        else
+            pen::memory_free(mem);
+    }
+
+    struct live_alloc
+    {
+        u8*    mem;
+        size_t size;
+        u8     fill;
+    };
+
+    struct memory_worker
+    {
+        alloc_api      api;
+        u32            seed;
+        u32            iterations;
+        u32            errors;
+        memory_worker* next;          // receives 1 in 10 of our frees
+        mutex*         remote_mutex;  // guards remote, pushed by the previous worker
+        live_alloc*    remote;
+        semaphore*     done;
+    };
+
+    const u32 k_live_slots = 1024;
+
+    bool check_alloc(const live_alloc& la)
+    {
+        // first and last bytes are enough to catch overlapping blocks without making the check the benchmark
+        return la.mem[0] == la.fill && la.mem[la.size - 1] == la.fill;
+    }
+
+    size_t memory_trace_size(bench_rand& rng)
+    {
+        // mostly small, some mid sized and occasional large allocations
+        u32 r = rng.next() % 100;
+        if (r < 80)
+            return 8 + rng.next() % 248;
+        if (r < 98)
+            return 256 + rng.next() % (16 * 1024);
+        return 64 * 1024 + rng.next() % (256 * 1024);
+    }
+
+    void drain_remote(memory_worker* w)
+    {
+        mutex_lock(w->remote_mutex);
+        u32 num_remote = sb_count(w->remote);
+        for (u32 i = 0; i < num_remote; ++i)
+        {
+            if (!check_alloc(w->remote[i]))
+                ++w->errors;
+            bench_free(w->api, w->remote[i].mem);
+        }
+        if (w->remote)
+            stb__sbn(w->remote) = 0;
+        mutex_unlock(w->remote_mutex);
+    }
+
+    void* memory_worker_thread(void* params)
+    {
+        memory_worker* w = (memory_worker*)params;
+        bench_rand     rng = {w->seed};
+
+        live_alloc slots[k_live_slots] = {};
+
+        for (u32 i = 0; i < w->iterations; ++i)
+        {
+            live_alloc& la = slots[rng.next() % k_live_slots];
+
+            if (la.mem)
+            {
+                if (!check_alloc(la))
+                    ++w->errors;
+
+                u32 op = rng.next() % 10;
+                if (op == 0)
+                {
+                    // hand to another thread
+                    mutex_lock(w->next->remote_mutex);
+                    sb_push(w->next->remote, la);
+                    mutex_unlock(w->next->remote_mutex);
+                    la.mem = nullptr;
+                    continue;
+                }
+                else if (op == 1 && la.size < 128 * 1024)
+                {
+                    // grow, like a stretchy buffer doubling
+                    la.size *= 2;
+                    la.mem = (u8*)bench_realloc(w->api, la.mem, la.size);
+                    memset(la.mem, la.fill, la.size);
+                    continue;
+                }
+
+                bench_free(w->api, la.mem);
+                la.mem = nullptr;
+            }
+            else
+            {
+                la.size = memory_trace_size(rng);
+                la.fill = (u8)(rng.next() & 0xff);
+                la.mem = (u8*)bench_alloc(w->api, la.size);
+                memset(la.mem, la.fill, la.size);
+            }
+
+            if ((i & 255) == 0)
+                drain_remote(w);
+        }
+
+        for (u32 i = 0; i < k_live_slots; ++i)
+            if (slots[i].mem)
+                bench_free(w->api, slots[i].mem);
+
+        semaphore_post(w->done, 1);
+        return PEN_THREAD_OK;
+    }
+
+    f64 run_memory_trace(alloc_api api, u32 num_threads, u32 iterations, u32& errors)
+    {
+        memory_worker* workers = (memory_worker*)pen::memory_alloc(sizeof(memory_worker) * num_threads);
+        semaphore*     done = semaphore_create(0, num_threads);
+
+        for (u32 t = 0; t < num_threads; ++t)
+        {
+            memory_worker& w = workers[t];
+            w.api = api;
+            w.seed = 0x9e3779b9u * (t + 1);
+            w.iterations = iterations;
+            w.errors = 0;
+            w.next = &workers[(t + 1) % num_threads];
+            w.remote_mutex = mutex_create();
+            w.remote = nullptr;
+            w.done = done;
+        }
+
+        f64 start = get_time_ms();
+
+        for (u32 t = 0; t < num_threads; ++t)
+            thread_create(memory_worker_thread, 1024 * 1024, &workers[t], e_thread_start_flags::detached);
+
+        for (u32 t = 0; t < num_threads; ++t)
+            semaphore_wait(done);
+
+        // frees handed over after the receiving thread finished
+        for (u32 t = 0; t < num_threads; ++t)
+            drain_remote(&workers[t]);
+
+        f64 elapsed = get_time_ms() - start;
+
+        errors = 0;
+        for (u32 t = 0; t < num_threads; ++t)
+        {
+            errors += workers[t].errors;
+            sb_free(workers[t].remote);
+            mutex_destroy(workers[t].remote_mutex);
+        }
+
+        semaphore_destroy(done);
+        pen::memory_free(workers);
+        return elapsed;
+    }
+
+    void bench_memory(u32 max_threads)
+    {
+#if PEN_MEMORY_SIZE_CLASSES
+        const c8* backend = "size classes";
+#else
+        const c8* backend = "malloc";
+#endif
+        PEN_LOG("memory: pen::memory backend is %s, tracking %s", backend, PEN_MEMORY_TRACKING ? "on" : "off");
+
+        static const u32 k_iterations = 1000000;
+        for (u32 threads = 1; threads <= max_threads; threads *= 2)
+        {
+            for (u32 a = 0; a < e_alloc_api::count; ++a)
+            {
+                u32 errors = 0;
+                f64 ms = run_memory_trace((alloc_api)a, threads, k_iterations, errors);
+                PEN_LOG("memory: %-12s %u threads x %u ops %8.2f ms %s", k_alloc_api_names[a], threads, k_iterations,
+                        ms, errors ? "CORRUPT" : "");
+            }
+        }
+    }
+
+    // ring buffer
+
+    const c8* k_ring_buffer_full_names[] = {"block", "spin", "grow"};
+
+    struct ring_producer
+    {
+        void*      rb;
+        u32        count;
+        u32        batch;
+        semaphore* done;
+    };
+
+    // u64 payloads carry their index so the consumer can check order, str payloads exercise construct and destruct
+    template <typename T>
+    T ring_item(u64 i);
+
+    template <>
+    u64 ring_item<u64>(u64 i)
+    {
+        return i;
+    }
+
+    template <>
+    Str ring_item<Str>(u64 i)
+    {
+        static Str s_items[4] = {"a", "unicode", "text input longer than the small string buffer", ""};
+        return s_items[i & 3];
+    }
+
+    template <typename T>
+    bool ring_check(const T& item, u64 i);
+
+    template <>
+    bool ring_check<u64>(const u64& item, u64 i)
+    {
+        return item == i;
+    }
+
+    template <>
+    bool ring_check<Str>(const Str& item, u64 i)
+    {
+        return item.length() == ring_item<Str>(i).length();
+    }
+
+    template <typename T>
+    void* ring_producer_thread(void* params)
+    {
+        ring_producer*  p = (ring_producer*)params;
+        ring_buffer<T>* rb = (ring_buffer<T>*)p->rb;
+
+        T items[64];
+        for (u32 i = 0; i < p->count; i += p->batch)
+        {
+            if (p->batch == 1)
+            {
+                rb->put(ring_item<T>(i));
+                continue;
+            }
+
+            for (u32 j = 0; j < p->batch; ++j)
+                items[j] = ring_item<T>(i + j);
+
+            rb->put_n(items, p->batch);
+        }
+
+        semaphore_post(p->done, 1);
+        return PEN_THREAD_OK;
+    }
+
+    template <typename T>
+    f64 run_ring_buffer(ring_buffer_full full, u32 count, u32 batch, u32& errors)
+    {
+        ring_buffer<T>* rb = new ring_buffer<T>();
+        rb->create(1024, full);
+
+        ring_producer p;
+        p.rb = rb;
+        p.count = count;
+        p.batch = batch;
+        p.done = semaphore_create(0, 1);
+
+        f64 start = get_time_ms();
+        thread_create(ring_producer_thread<T>, 1024 * 1024, &p, e_thread_start_flags::detached);
+
+        T   items[64];
+        u32 read = 0;
+        errors = 0;
+        while (read < count)
+        {
+            if (batch == 1)
+            {
+                T* item = rb->get();
+                if (item)
+                {
+                    if (!ring_check(*item, read))
+                        ++errors;
+                    ++read;
+                }
+                continue;
+            }
+
+            u32 n = rb->get_n(items, batch);
+            for (u32 i = 0; i < n; ++i)
+                if (!ring_check(items[i], read + i))
+                    ++errors;
+
+            read += n;
+        }
+
+        semaphore_wait(p.done);
+        f64 elapsed = get_time_ms() - start;
+
+        semaphore_destroy(p.done);
+        delete rb;
+        return elapsed;
+    }
+
+    template <typename T>
+    void bench_ring_buffer_type(const c8* type_name)
+    {
+        static const u32 k_items = 4 * 1024 * 1024;
+        static const u32 k_batches[] = {1, 64};
+
+        for (u32 f = 0; f < PEN_ARRAY_SIZE(k_ring_buffer_full_names); ++f)
+        {
+            for (u32 b = 0; b < PEN_ARRAY_SIZE(k_batches); ++b)
+            {
+                u32 errors = 0;
+                f64 ms = run_ring_buffer<T>((ring_buffer_full)f, k_items, k_batches[b], errors);
+
+                PEN_LOG("ring_buffer: %-4s %-5s batch %2u %8.2f ms %7.2f M items/s %s", type_name,
+                        k_ring_buffer_full_names[f], k_batches[b], ms, (k_items / 1000.0) / ms,
+                        errors ? "OUT OF ORDER" : "");
+            }
+        }
+    }
+
+    void bench_ring_buffer()
+    {
+        bench_ring_buffer_type<u64>("u64");
+        bench_ring_buffer_type<Str>("str");
+    }
+
+    // semaphore
+
+    struct ping_pong
+    {
+        semaphore* ping;
+        semaphore* pong;
+        semaphore* done;
+        u32        count;
+    };
+
+    void* pong_thread(void* params)
+    {
+        ping_pong* pp = (ping_pong*)params;
+        for (u32 i = 0; i < pp->count; ++i)
+        {
+            semaphore_wait(pp->ping);
+            semaphore_post(pp->pong, 1);
+        }
+
+        semaphore_post(pp->done, 1);
+        return PEN_THREAD_OK;
+    }
+
+    // each round trip is a post and a wake on both threads, so this is the latency of handing work to a sleeping or
+    // spinning thread and getting the reply back
+    void bench_semaphore()
+    {
+        static const u32 k_round_trips[] = {1000, 10000, 100000};
+
+        for (u32 r = 0; r < PEN_ARRAY_SIZE(k_round_trips); ++r)
+        {
+            ping_pong pp;
+            pp.ping = semaphore_create(0, 1);
+            pp.pong = semaphore_create(0, 1);
+            pp.done = semaphore_create(0, 1);
+            pp.count = k_round_trips[r];
+
+            thread_create(pong_thread, 1024 * 1024, &pp, e_thread_start_flags::detached);
+
+            f64 start = get_time_ms();
+            for (u32 i = 0; i < pp.count; ++i)
+            {
+                semaphore_post(pp.ping, 1);
+                semaphore_wait(pp.pong);
+            }
+            f64 ms = get_time_ms() - start;
+
+            semaphore_wait(pp.done);
+
+            PEN_LOG("semaphore: %6u round trips %9.2f ms %8.3f us per round trip", pp.count, ms,
+                    (ms * 1000.0) / pp.count);
+
+            semaphore_destroy(pp.ping);
+            semaphore_destroy(pp.pong);
+            semaphore_destroy(pp.done);
+        }
+    }
+
+    // scene load
+
+    // put benchmarks create scenes, which need the renderer thread to create buffers
+    bool needs_renderer()
+    {
+        return has_arg("-scene_load");
+    }
+
+    // a hierarchy of transforms with names, bounding volumes and a sprinkling of lights, no geometry or materials so
+    // the scene needs no data files. every entity has a unique name so the string table is as large as it gets
+    void generate_scene(ecs::ecs_scene* scene, u32 num_entities)
+    {
+        bench_rand r = {num_entities};
+
+        for (u32 i = 0; i < num_entities; ++i)
+        {
+            u32 n = ecs::get_new_entity(scene);
+
+            scene->names[n].setf("entity_%u", i);
+            scene->id_name[n] = PEN_HASH(scene->names[n].c_str());
+            scene->parents[n] = (i % 16) ? n - (i % 16) : n;
+            scene->entities[n] |= ecs::e_cmp::allocated | ecs::e_cmp::transform;
+
+            ecs::cmp_transform& t = scene->transforms[n];
+            t.translation = vec3f((r.next() % 2000) * 0.1f, (r.next() % 200) * 0.1f, (r.next() % 2000) * 0.1f);
+            t.rotation = quat();
+            t.scale = vec3f::one();
+
+            scene->bounding_volumes[n].min_extents = -vec3f::one();
+            scene->bounding_volumes[n].max_extents = vec3f::one();
+
+            if (r.next() % 100 == 0)
+            {
+                ecs::add_components(scene, n, ecs::e_cmp::light);
+                scene->lights[n].type = ecs::e_light_type::point;
+                scene->lights[n].colour = vec3f::white();
+                scene->lights[n].radius = 5.0f;
+            }
+        }
+    }
+
+    const c8* k_scene_format_names[] = {"version 10", "chunked", "chunked lz4"};
+    const u32 k_scene_save_flags[] = {ecs::e_scene_save_flags::version_10, ecs::e_scene_save_flags::none,
+                                      ecs::e_scene_save_flags::compress};
+
+    void bench_scene_load(u32 num_entities)
+    {
+        static const u32 k_loads = 5;
+
+        ecs::ecs_scene* scene = ecs::create_scene("bench");
+
+        for (u32 f = 0; f < PEN_ARRAY_SIZE(k_scene_format_names); ++f)
+        {
+            ecs::clear_scene(scene);
+            generate_scene(scene, num_entities);
+
+            Str filename;
+            filename.setf("bench_scene_%u.pms", f);
+
+            f64 start = get_time_ms();
+            ecs::save_scene(filename.c_str(), scene, k_scene_save_flags[f]);
+            f64 save_ms = get_time_ms() - start;
+
+            void*  mapped = nullptr;
+            size_t file_size = 0;
+            filesystem_map_file(filename.c_str(), &mapped, file_size);
+            filesystem_unmap_file(mapped, file_size);
+
+            // the first load reads the file just written, so every load is from the page cache
+            f64 min_ms = DBL_MAX;
+            f64 total_ms = 0.0;
+            for (u32 i = 0; i < k_loads; ++i)
+            {
+                ecs::clear_scene(scene);
+
+                start = get_time_ms();
+                ecs::load_scene(filename.c_str(), scene);
+                f64 ms = get_time_ms() - start;
+
+                min_ms = std::min(min_ms, ms);
+                total_ms += ms;
+
+                // flush the buffer creates and releases issued by the load
+                renderer_present();
+                renderer_consume_cmd_buffer();
+            }
+
+            Str last_name;
+            last_name.setf("entity_%u", num_entities - 1);
+            bool ok = scene->num_entities == num_entities && scene->names[num_entities - 1] == last_name.c_str();
+
+            PEN_LOG("scene_load: %-11s %u entities %6.1f MB save %8.2f ms load min %8.2f ms avg %8.2f ms %s",
+                    k_scene_format_names[f], num_entities, file_size / (1024.0 * 1024.0), save_ms, min_ms,
+                    total_ms / k_loads, ok ? "" : "MISMATCH");
+
+            remove(filename.c_str());
+        }
+
+        ecs::destroy_scene(scene);
+    }
+
+    // cluster lights
+
+    // lights scattered over a 200 x 200 area in front of the camera, as a town full of street and window lights
+    void bench_cluster_lights()
+    {
+        static const u32 k_iterations = 100;
+        static const u32 k_light_counts[] = {256, 1024, 4096, 16384};
+
+        camera cam;
+        camera_create_perspective(&cam, 60.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+        cam.focus = vec3f(0.0f, 0.0f, -100.0f);
+        cam.rot = vec2f(-0.3f, 0.0f);
+        cam.zoom = 110.0f;
+        camera_update_look_at(&cam);
+
+        ecs::ecs_scene*     scene = new ecs::ecs_scene();
+        ecs::light_clusters& lc = scene->clusters;
+
+        for (u32 c = 0; c < PEN_ARRAY_SIZE(k_light_counts); ++c)
+        {
+            u32        num_lights = k_light_counts[c];
+            bench_rand r = {num_lights};
+
+            if (lc.lights)
+                stb__sbn(lc.lights) = 0;
+
+            if (lc.bounds)
+                stb__sbn(lc.bounds) = 0;
+
+            for (u32 i = 0; i < num_lights; ++i)
+            {
+                vec3f pos = vec3f((r.next() % 2000) * 0.1f - 100.0f, (r.next() % 100) * 0.1f,
+                                  -(f32)(r.next() % 2000) * 0.1f);
+                f32   radius = 2.0f + (r.next() % 80) * 0.1f;
+
+                ecs::light_data ld;
+                ld.pos_radius = vec4f(pos, radius);
+                ld.dir_cutoff = vec4f::zero();
+                ld.colour = vec4f::one();
+                ld.data = vec4f::zero();
+
+                sb_push(lc.lights, ld);
+                sb_push(lc.bounds, vec4f(pos, radius));
+            }
+
+            // resetting the views each iteration as update_scene does forces a rebuild
+            u32 data_size = 0;
+            f64 start = get_time_ms();
+            for (u32 i = 0; i < k_iterations; ++i)
+            {
+                lc.num_views = 0;
+                data_size = ecs::cluster_lights(scene, &cam)->data_size;
+            }
+
+            f64 ms = (get_time_ms() - start) / k_iterations;
+
+            // further views from the same camera in the same frame
+            start = get_time_ms();
+            for (u32 i = 0; i < k_iterations; ++i)
+                ecs::cluster_lights(scene, &cam);
+
+            f64 cached_ms = (get_time_ms() - start) / k_iterations;
+
+            u32 num_clusters = ecs::e_scene_limits::cluster_grid_x * ecs::e_scene_limits::cluster_grid_y *
+                               ecs::e_scene_limits::cluster_grid_z;
+
+            u32 num_indices = data_size - num_clusters * 2;
+            PEN_LOG("cluster_lights: %5u lights %8.3f ms (cached %6.4f ms) %6u light indices", num_lights, ms,
+                    cached_ms, num_indices);
+        }
+
+        sb_free(lc.lights);
+        sb_free(lc.bounds);
+        sb_free(lc.counts);
+
+        for (u32 v = 0; v < sb_count(lc.views); ++v)
+            sb_free(lc.views[v].data);
+
+        sb_free(lc.views);
+        lc = ecs::light_clusters();
+        delete scene;
+    }
+
+    // sdf
+
+    // a bumpy sphere so the narrow band and the sweeps see a curved closed surface
+    void bench_sdf()
+    {
+        static const u32 k_dims[] = {64, 128, 256};
+        static const u32 k_segments = 40;
+
+        std::vector<vec3f>  vertices;
+        std::vector<vec3ui> triangles;
+
+        for (u32 a = 0; a <= k_segments; ++a)
+        {
+            for (u32 b = 0; b < k_segments; ++b)
+            {
+                f32 theta = (f32)M_PI * a / k_segments;
+                f32 phi = (f32)M_TWO_PI * b / k_segments;
+                f32 r = 0.8f + 0.1f * sinf(5.0f * phi) * sinf(3.0f * theta);
+                vertices.push_back(vec3f(r * sinf(theta) * cosf(phi), r * cosf(theta), r * sinf(theta) * sinf(phi)));
+            }
+        }
+
+        for (u32 a = 0; a < k_segments; ++a)
+        {
+            for (u32 b = 0; b < k_segments; ++b)
+            {
+                u32 i0 = a * k_segments + b;
+                u32 i1 = a * k_segments + (b + 1) % k_segments;
+                u32 i2 = (a + 1) * k_segments + b;
+                u32 i3 = (a + 1) * k_segments + (b + 1) % k_segments;
+                triangles.push_back(vec3ui(i0, i2, i1));
+                triangles.push_back(vec3ui(i1, i2, i3));
+            }
+        }
+
+        for (u32 d = 0; d < PEN_ARRAY_SIZE(k_dims); ++d)
+        {
+            u32 dim = k_dims[d];
+
+            Array3f phi;
+            f64     start = get_time_ms();
+            make_level_set3(triangles, vertices, vec3f(-1.1f), 2.2f / dim, dim, dim, dim, phi);
+            f64 ms = get_time_ms() - start;
+
+            // inside count changes if the sign or distances do
+            u32 inside = 0;
+            for (f32 v : phi.a)
+                if (v < 0.0f)
+                    ++inside;
+
+            PEN_LOG("sdf: %3u^3 %5u triangles %10.2f ms %9u cells inside", dim, (u32)triangles.size(), ms, inside);
+        }
+    }
+
+    // mips
+
+    struct mip_bench_format
+    {
+        const c8* name;
+        u32       format;
+        u32       block_size;
+        u32       component; // 0 unorm8, 1 f16, 2 f32
+    };
+
+    const mip_bench_format k_mip_formats[] = {
+        {"rgba8", PEN_TEX_FORMAT_RGBA8_UNORM, 4, 0},          {"bgra8", PEN_TEX_FORMAT_BGRA8_UNORM, 4, 0},
+        {"r8", PEN_TEX_FORMAT_R8_UNORM, 1, 0},                {"r16f", PEN_TEX_FORMAT_R16_FLOAT, 2, 1},
+        {"rgba16f", PEN_TEX_FORMAT_R16G16B16A16_FLOAT, 8, 1}, {"r32f", PEN_TEX_FORMAT_R32_FLOAT, 4, 2},
+        {"rg32f", PEN_TEX_FORMAT_R32G32_FLOAT, 8, 2},         {"rgba32f", PEN_TEX_FORMAT_R32G32B32A32_FLOAT, 16, 2}};
+
+    // largest difference of any component between two mip chains, in 0-255 for unorm8
+    f32 mip_chain_diff(const mip_bench_format& mbf, const u8* a, const u8* b, u32 size)
+    {
+        f32 diff = 0.0f;
+        switch (mbf.component)
+        {
+            case 0:
+                for (u32 i = 0; i < size; ++i)
+                    diff = max(diff, fabsf((f32)a[i] - (f32)b[i]));
+                break;
+            case 1:
+                for (u32 i = 0; i < size / 2; ++i)
+                    diff = max(diff, fabsf(half_to_float(((f16*)a)[i]) - half_to_float(((f16*)b)[i])));
+                break;
+            default:
+                for (u32 i = 0; i < size / 4; ++i)
+                    diff = max(diff, fabsf(((f32*)a)[i] - ((f32*)b)[i]));
+                break;
+        }
+        return diff;
+    }
+
+    void bench_mips()
+    {
+        static const u32 k_dim = 1024;
+        static const c8* k_filter_names[] = {"box", "max", "kaiser"};
+
+        for (u32 f = 0; f < PEN_ARRAY_SIZE(k_mip_formats); ++f)
+        {
+            const mip_bench_format& mbf = k_mip_formats[f];
+
+            // seeded noise, floats in 0-1
+            u32        size = k_dim * k_dim * mbf.block_size;
+            u8*        top = (u8*)memory_alloc(size);
+            bench_rand r = {f + 1};
+            switch (mbf.component)
+            {
+                case 0:
+                    for (u32 i = 0; i < size; ++i)
+                        top[i] = (u8)(r.next() & 0xff);
+                    break;
+                case 1:
+                    for (u32 i = 0; i < size / 2; ++i)
+                        ((f16*)top)[i] = float_to_half((r.next() % 1024) / 1023.0f);
+                    break;
+                default:
+                    for (u32 i = 0; i < size / 4; ++i)
+                        ((f32*)top)[i] = (r.next() % 1024) / 1023.0f;
+                    break;
+            }
+
+            for (u32 filter = 0; filter < PEN_ARRAY_SIZE(k_filter_names); ++filter)
+            {
+                texture_creation_params tcp[2];
+                mip_stats               stats[2];
+                f64                     total_ms[2];
+
+                for (u32 simd = 0; simd < 2; ++simd)
+                {
+                    texture_creation_params& t = tcp[simd];
+                    t.collection_type = TEXTURE_COLLECTION_NONE;
+                    t.width = k_dim;
+                    t.height = k_dim;
+                    t.format = mbf.format;
+                    t.num_mips = 1;
+                    t.num_arrays = 1;
+                    t.block_size = mbf.block_size;
+                    t.pixels_per_block = 1;
+                    t.data = top;
+                    t.data_size = size;
+
+                    set_mip_simd(simd == 1);
+                    f64 start = get_time_ms();
+                    generate_mips(t, (mip_filter)filter, &stats[simd]);
+                    total_ms[simd] = get_time_ms() - start;
+                }
+
+                set_mip_simd(true);
+
+                f32 diff = mip_chain_diff(mbf, (const u8*)tcp[0].data, (const u8*)tcp[1].data, tcp[0].data_size);
+                PEN_LOG("mips: %-7s %-6s scalar %7.2f ms simd %7.2f ms max diff %g", mbf.name, k_filter_names[filter],
+                        total_ms[0], total_ms[1], diff);
+
+                Str levels;
+                for (u32 l = 0; l < stats[1].num_levels; ++l)
+                    levels.appendf(" %.3f", stats[1].level_ms[l]);
+
+                PEN_LOG("    simd ms per level:%s", levels.c_str());
+
+                memory_free(tcp[0].data);
+                memory_free(tcp[1].data);
+            }
+
+            memory_free(top);
+        }
+    }
+} // namespace
+
+namespace pen
+{
+    pen_creation_params pen_entry(int argc, char** argv)
+    {
+        // unpack args
+        for (u32 i = 0; i < argc; ++i)
+            sb_push(s_args, argv[i]);
+
+        pen::pen_creation_params p;
+        p.window_width = 1280;
+        p.window_height = 720;
+        p.window_title = "bench";
+        p.window_sample_count = 1;
+        p.user_thread_function = user_entry;
+        p.flags = needs_renderer() ? pen::e_pen_create_flags::renderer : pen::e_pen_create_flags::console_app;
+        return p;
+    }
+} // namespace pen
+
+void* pen::user_entry(void* params)
+{
+    // unpack the params passed to the thread and signal to the engine it ok to proceed
+    pen::job_thread_params* job_params = (pen::job_thread_params*)params;
+    pen::job*               p_thread_info = job_params->job_info;
+    pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+
+    u32  max_threads = arg_u32("-threads", 4);
+    bool ran = false;
+
+    if (has_arg("-memory"))
+    {
+        bench_memory(max_threads);
+        ran = true;
+    }
+
+    if (has_arg("-ring_buffer"))
+    {
+        bench_ring_buffer();
+        ran = true;
+    }
+
+    if (has_arg("-semaphore"))
+    {
+        bench_semaphore();
+        ran = true;
+    }
+
+    if (has_arg("-scene_load"))
+    {
+        bench_scene_load(arg_u32("-entities", 100000));
+        ran = true;
+    }
+
+    if (has_arg("-cluster_lights"))
+    {
+        bench_cluster_lights();
+        ran = true;
+    }
+
+    if (has_arg("-sdf"))
+    {
+        bench_sdf();
+        ran = true;
+    }
+
+    if (has_arg("-mips"))
+    {
+        bench_mips();
+        ran = true;
+    }
+
+    if (!ran || has_arg("-help"))
+        show_help();
+
+    // signal to the engine the thread has finished
+    pen::os_terminate(0);
+    pen::semaphore_post(p_thread_info->p_sem_terminated, 1);
+
+    return PEN_THREAD_OK;
+}
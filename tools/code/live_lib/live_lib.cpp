@@ -179,7 +179,7 @@ struct live_lib
         scene->transforms[light].translation = vec3f::zero();
         scene->transforms[light].rotation = quat();
         scene->transforms[light].scale = vec3f::one();
-        scene->entities[light] |= e_cmp::light;
+        add_components(scene, light, e_cmp::light);
         scene->entities[light] |= e_cmp::transform;
         
         light = get_new_entity(scene);
@@ -191,7 +191,7 @@ struct live_lib
         scene->transforms[light].translation = vec3f::zero();
         scene->transforms[light].rotation = quat();
         scene->transforms[light].scale = vec3f::one();
-        scene->entities[light] |= e_cmp::light;
+        add_components(scene, light, e_cmp::light);
         scene->entities[light] |= e_cmp::transform;
         
         // add primitve instances
@@ -0,0 +1,113 @@
+// renderer_replay.cpp
+// Copyright 2014 - 2019 Alex Dixon.
+// License: https://github.com/polymonster/pmtech/blob/master/license.md
+
+// Replays a command stream capture written with "-capture <file> <frames>" or pen::renderer_capture_begin through the
+// renderer as fast as the backend allows and reports per command type timing histograms.
+
+#include "console.h"
+#include "data_struct.h"
+#include "os.h"
+#include "pen.h"
+#include "renderer.h"
+#include "str/Str.h"
+#include "threads.h"
+
+using namespace pen;
+
+namespace
+{
+    Str* s_args = nullptr;
+    Str  s_capture_file = "";
+    Str  s_report_file = "";
+
+    void show_help()
+    {
+        PEN_LOG("renderer_replay help");
+        PEN_LOG("    -help <show this dialog>");
+        PEN_LOG("    -i <capture file>");
+        PEN_LOG("    -o (optional) <csv report file>");
+    }
+} // namespace
+
+namespace pen
+{
+    pen_creation_params pen_entry(int argc, char** argv)
+    {
+        // unpack args
+        for (u32 i = 0; i < argc; ++i)
+            sb_push(s_args, argv[i]);
+
+        u32 num_args = sb_count(s_args);
+        for (u32 i = 0; i < num_args; ++i)
+        {
+            if (s_args[i] == "-i" && i + 1 < num_args)
+                s_capture_file = s_args[i + 1];
+            else if (s_args[i] == "-o" && i + 1 < num_args)
+                s_report_file = s_args[i + 1];
+        }
+
+        pen::pen_creation_params p;
+        p.window_width = 1280;
+        p.window_height = 720;
+        p.window_title = "renderer_replay";
+        p.window_sample_count = 1;
+        p.user_thread_function = user_entry;
+        p.flags = pen::e_pen_create_flags::renderer;
+
+        // match the captured backbuffer so ratio targets resolve the same and make room for the largest frame,
+        // the user thread can be a frame ahead of the render thread
+        renderer_capture_info info;
+        if (!s_capture_file.empty() && renderer_capture_read_info(s_capture_file.c_str(), info))
+        {
+            p.window_width = info.window_width;
+            p.window_height = info.window_height;
+
+            while (p.max_renderer_commands < info.max_frame_commands * 2 + 1)
+                p.max_renderer_commands *= 2;
+        }
+
+        return p;
+    }
+} // namespace pen
+
+void* pen::user_entry(void* params)
+{
+    // unpack the params passed to the thread and signal to the engine it ok to proceed
+    pen::job_thread_params* job_params = (pen::job_thread_params*)params;
+    pen::job*               p_thread_info = job_params->job_info;
+    pen::semaphore_post(p_thread_info->p_sem_continue, 1);
+
+    u32                   error_code = 1;
+    renderer_capture_info info;
+
+    if (s_capture_file.empty())
+    {
+        show_help();
+        goto term;
+    }
+
+    if (!renderer_capture_read_info(s_capture_file.c_str(), info))
+    {
+        PEN_LOG("renderer_replay: %s is not a renderer capture", s_capture_file.c_str());
+        goto term;
+    }
+
+    if (!info.compatible)
+    {
+        PEN_LOG("renderer_replay: %s was captured by an incompatible build", s_capture_file.c_str());
+        goto term;
+    }
+
+    PEN_LOG("replaying: %s (%i frames, %i commands)", s_capture_file.c_str(), info.num_frames, info.num_commands);
+
+    if (renderer_capture_replay(s_capture_file.c_str(), s_report_file.empty() ? nullptr : s_report_file.c_str()))
+        error_code = 0;
+
+term:
+    // signal to the engine the thread has finished
+    pen::os_terminate(error_code);
+    pen::semaphore_post(p_thread_info->p_sem_terminated, 1);
+
+    return PEN_THREAD_OK;
+}
@@ -46,16 +46,26 @@ end
 local function setup_linux()
 	--linux must be linked in order
 	add_pmtech_links()
-	links 
-	{ 
-		"pthread",
-		"GLEW",
-		"GLU",
-		"GL",
-		"X11",
-		"fmod",
-		"dl"
-	}
+	if renderer_dir == "null" then
+		links 
+		{ 
+			"pthread",
+			"X11",
+			"fmod",
+			"dl"
+		}
+	else
+		links 
+		{ 
+			"pthread",
+			"GLEW",
+			"GLU",
+			"GL",
+			"X11",
+			"fmod",
+			"dl"
+		}
+	end
 
 	linkoptions {
 		'-Wl,-rpath=\\$$ORIGIN',
@@ -147,6 +147,12 @@ function setup_platform_defines()
 		("PEN_PLATFORM_" .. string.upper(platform)),
         ("PEN_RENDERER_" .. string.upper(renderer_dir))
 	}
+	if _OPTIONS["memory_size_classes"] then
+		defines { "PEN_MEMORY_SIZE_CLASSES=1" }
+	end
+	if _OPTIONS["memory_tracking"] then
+		defines { "PEN_MEMORY_TRACKING=1" }
+	end
 end
 
 -- entry
@@ -9,7 +9,8 @@ newoption
       { "opengl", "OpenGL (macOS, linux, Android)" },
       { "dx11",  "DirectX 11 (Windows only)" },
       { "metal", "Metal (macOS, iOS only)" },
-      { "vulkan", "Vulkan (Windows, linux)" }
+      { "vulkan", "Vulkan (Windows, linux)" },
+      { "null", "Null headless renderer for tests and tracing (linux)" }
    }
 }
 
@@ -59,3 +60,15 @@ newoption
    value       = "dir",
    description = "specify location of pmtech in relation to project"
 }
+
+newoption
+{
+   trigger     = "memory_size_classes",
+   description = "Build pen::memory with the thread caching size class allocator (PEN_MEMORY_SIZE_CLASSES=1)",
+}
+
+newoption
+{
+   trigger     = "memory_tracking",
+   description = "Build pen::memory with per tag allocation tracking and leak reports (PEN_MEMORY_TRACKING=1)",
+}
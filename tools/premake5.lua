@@ -24,6 +24,12 @@ dofile "pmtech.lua"
 -- mesh optimiser
 create_app_example("mesh_opt", script_path())
 
+-- command stream capture replay
+create_app_example("renderer_replay", script_path())
+
+-- micro benchmarks
+create_app_example("bench", script_path())
+
 -- dll to hot reload
 create_dll("live_lib", "live_lib", script_path())
 setup_live_lib("live_lib")